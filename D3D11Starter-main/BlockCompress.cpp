@@ -0,0 +1,843 @@
+#include "BlockCompress.h"
+#include "CpuHelpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace
+{
+	// Least-squares passes over the endpoints at High quality;
+	// past two they rarely find anything
+	const int RefineIterations = 2;
+
+	// ----------------------------------------------------
+	// The 16 texels of a block, one array per channel so
+	// four texels at a time fit in an SSE register
+	// ----------------------------------------------------
+	struct BlockTexels
+	{
+		alignas(16) float Channel[4][16];
+	};
+
+	void LoadBlock(const DdsSurface& source, unsigned int blockX, unsigned int blockY, BlockTexels& block)
+	{
+		for (unsigned int y = 0; y < 4; y++)
+		{
+			unsigned int sy = blockY * 4 + y < source.Height ? blockY * 4 + y : source.Height - 1;
+			for (unsigned int x = 0; x < 4; x++)
+			{
+				unsigned int sx = blockX * 4 + x < source.Width ? blockX * 4 + x : source.Width - 1;
+				const unsigned char* p = &source.Data[(size_t)sy * source.RowPitch + sx * 4];
+				for (unsigned int c = 0; c < 4; c++)
+					block.Channel[c][y * 4 + x] = p[c];
+			}
+		}
+	}
+
+	// ----------------------------------------------------
+	// The values a block can decode to, ordered from the
+	// first endpoint to the second, with where each one
+	// sits along that line (0 to 1)
+	// ----------------------------------------------------
+	struct Palette
+	{
+		unsigned int Count = 0;
+		float Colors[16][4] = {};
+		float Weights[16] = {};
+	};
+
+	// ----------------------------------------------------
+	// Picks each texel's palette step and returns the total
+	// squared error.  Exhaustive tries every step (SSE2 does
+	// four texels per compare); otherwise texels are just
+	// projected onto the line between the end steps.
+	// ----------------------------------------------------
+	float SelectSteps(const BlockTexels& block, unsigned int channels, const Palette& palette, bool exhaustive, unsigned char steps[16])
+	{
+		alignas(16) float errors[16];
+		alignas(16) int chosen[16];
+
+		if (exhaustive)
+		{
+#ifdef CPU_USE_SSE2
+			for (unsigned int i = 0; i < 16; i += 4)
+			{
+				__m128 best = _mm_set1_ps(3.0e38f);
+				__m128i bestStep = _mm_setzero_si128();
+				for (unsigned int p = 0; p < palette.Count; p++)
+				{
+					__m128 distance = _mm_setzero_ps();
+					for (unsigned int c = 0; c < channels; c++)
+					{
+						__m128 diff = _mm_sub_ps(_mm_load_ps(block.Channel[c] + i), _mm_set1_ps(palette.Colors[p][c]));
+						distance = _mm_add_ps(distance, _mm_mul_ps(diff, diff));
+					}
+
+					__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+					bestStep = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32((int)p)), _mm_andnot_si128(closer, bestStep));
+					best = _mm_min_ps(distance, best);
+				}
+				_mm_store_ps(errors + i, best);
+				_mm_store_si128((__m128i*)(chosen + i), bestStep);
+			}
+#else
+			for (unsigned int i = 0; i < 16; i++)
+			{
+				errors[i] = 3.0e38f;
+				chosen[i] = 0;
+				for (unsigned int p = 0; p < palette.Count; p++)
+				{
+					float distance = 0;
+					for (unsigned int c = 0; c < channels; c++)
+					{
+						float diff = block.Channel[c][i] - palette.Colors[p][c];
+						distance += diff * diff;
+					}
+					if (distance < errors[i])
+					{
+						errors[i] = distance;
+						chosen[i] = (int)p;
+					}
+				}
+			}
+#endif
+		}
+		else
+		{
+			const float* first = palette.Colors[0];
+			const float* last = palette.Colors[palette.Count - 1];
+			float direction[4] = {};
+			float length = 0;
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				direction[c] = last[c] - first[c];
+				length += direction[c] * direction[c];
+			}
+			float scale = length > 0 ? (palette.Count - 1) / length : 0.0f;
+
+#ifdef CPU_USE_SSE2
+			for (unsigned int i = 0; i < 16; i += 4)
+			{
+				__m128 t = _mm_setzero_ps();
+				for (unsigned int c = 0; c < channels; c++)
+				{
+					__m128 offset = _mm_sub_ps(_mm_load_ps(block.Channel[c] + i), _mm_set1_ps(first[c]));
+					t = _mm_add_ps(t, _mm_mul_ps(offset, _mm_set1_ps(direction[c])));
+				}
+				t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(t, _mm_set1_ps(scale)), _mm_setzero_ps()), _mm_set1_ps((float)(palette.Count - 1)));
+				_mm_store_si128((__m128i*)(chosen + i), _mm_cvtps_epi32(t));
+			}
+#else
+			for (unsigned int i = 0; i < 16; i++)
+			{
+				float t = 0;
+				for (unsigned int c = 0; c < channels; c++)
+					t += (block.Channel[c][i] - first[c]) * direction[c];
+				t = std::clamp(t * scale, 0.0f, (float)(palette.Count - 1));
+				chosen[i] = (int)(t + 0.5f);
+			}
+#endif
+
+			for (unsigned int i = 0; i < 16; i++)
+			{
+				errors[i] = 0;
+				for (unsigned int c = 0; c < channels; c++)
+				{
+					float diff = block.Channel[c][i] - palette.Colors[chosen[i]][c];
+					errors[i] += diff * diff;
+				}
+			}
+		}
+
+		float total = 0;
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			steps[i] = (unsigned char)chosen[i];
+			total += errors[i];
+		}
+		return total;
+	}
+
+	// ----------------------------------------------------
+	// A line through the block's colors.  Fast takes the
+	// bounding box diagonal, flipping channels that run
+	// against the widest one; High takes the principal axis
+	// of the covariance and spans every texel along it.
+	// ----------------------------------------------------
+	void FitEndpoints(const BlockTexels& block, unsigned int channels, BlockQuality quality, float e0[4], float e1[4])
+	{
+		float mean[4] = {};
+		float low[4], high[4];
+		for (unsigned int c = 0; c < channels; c++)
+		{
+			low[c] = high[c] = block.Channel[c][0];
+			for (unsigned int i = 0; i < 16; i++)
+			{
+				mean[c] += block.Channel[c][i];
+				low[c] = std::min(low[c], block.Channel[c][i]);
+				high[c] = std::max(high[c], block.Channel[c][i]);
+			}
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (unsigned int a = 0; a < channels; a++)
+		{
+			for (unsigned int b = a; b < channels; b++)
+			{
+				for (unsigned int i = 0; i < 16; i++)
+					covariance[a][b] += (block.Channel[a][i] - mean[a]) * (block.Channel[b][i] - mean[b]);
+				covariance[b][a] = covariance[a][b];
+			}
+		}
+
+		if (quality == BLOCK_QUALITY_FAST)
+		{
+			unsigned int widest = 0;
+			for (unsigned int c = 1; c < channels; c++)
+			{
+				if (high[c] - low[c] > high[widest] - low[widest])
+					widest = c;
+			}
+
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				bool flip = covariance[widest][c] < 0;
+				e0[c] = flip ? high[c] : low[c];
+				e1[c] = flip ? low[c] : high[c];
+			}
+			return;
+		}
+
+		// Power iteration, starting from the box diagonal
+		float axis[4] = {};
+		for (unsigned int c = 0; c < channels; c++)
+			axis[c] = high[c] - low[c] + 0.001f;
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float length = 0;
+			for (unsigned int a = 0; a < channels; a++)
+			{
+				for (unsigned int b = 0; b < channels; b++)
+					next[a] += covariance[a][b] * axis[b];
+				length += next[a] * next[a];
+			}
+			if (length <= 0)
+				break;
+
+			length = 1.0f / sqrtf(length);
+			for (unsigned int c = 0; c < channels; c++)
+				axis[c] = next[c] * length;
+		}
+
+		float minT = 0, maxT = 0;
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			float t = 0;
+			for (unsigned int c = 0; c < channels; c++)
+				t += (block.Channel[c][i] - mean[c]) * axis[c];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		for (unsigned int c = 0; c < channels; c++)
+		{
+			e0[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+			e1[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+		}
+	}
+
+	// ----------------------------------------------------
+	// Least-squares endpoints for the steps already chosen.
+	// False if every texel landed on the same step.
+	// ----------------------------------------------------
+	bool RefitEndpoints(const BlockTexels& block, unsigned int channels, const Palette& palette, const unsigned char steps[16], float e0[4], float e1[4])
+	{
+		float aa = 0, ab = 0, bb = 0;
+		float ax[4] = {}, bx[4] = {};
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			float b = palette.Weights[steps[i]];
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				ax[c] += a * block.Channel[c][i];
+				bx[c] += b * block.Channel[c][i];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+			return false;
+
+		float inverse = 1.0f / determinant;
+		for (unsigned int c = 0; c < channels; c++)
+		{
+			e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) * inverse, 0.0f, 255.0f);
+			e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) * inverse, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	// ----------------------------------------------------
+	// Endpoint search shared by every format.  An Encoding
+	// quantizes float endpoints into its palette and knows
+	// how to write the block; the lowest error one wins.
+	// ----------------------------------------------------
+	template<typename Encoding>
+	void SearchEndpoints(const BlockTexels& block, unsigned int channels, BlockQuality quality, Encoding& best)
+	{
+		float e0[4] = {}, e1[4] = {};
+		FitEndpoints(block, channels, quality, e0, e1);
+
+		bool exhaustive = quality == BLOCK_QUALITY_HIGH;
+		best.Quantize(e0, e1);
+		best.Error = SelectSteps(block, channels, best.Colors, exhaustive, best.Steps);
+		if (quality == BLOCK_QUALITY_FAST)
+			return;
+
+		for (int i = 0; i < RefineIterations && best.Error > 0; i++)
+		{
+			if (!RefitEndpoints(block, channels, best.Colors, best.Steps, e0, e1))
+				break;
+
+			Encoding candidate;
+			candidate.Quantize(e0, e1);
+			candidate.Error = SelectSteps(block, channels, candidate.Colors, exhaustive, candidate.Steps);
+			if (candidate.Error >= best.Error)
+				break;
+			best = candidate;
+		}
+	}
+
+	// ----------------------------------------------------
+	// BC1: two 5:6:5 colors and two thirds between them.
+	// The first color has to be the larger one, or the block
+	// switches to its three-color mode.
+	// ----------------------------------------------------
+	struct Bc1Encoding
+	{
+		Palette Colors;
+		unsigned char Steps[16] = {};
+		float Error = 0;
+		unsigned short Endpoint[2] = {};
+
+		static unsigned short Pack(const float color[4])
+		{
+			unsigned int r = (unsigned int)(color[0] * 31.0f / 255.0f + 0.5f);
+			unsigned int g = (unsigned int)(color[1] * 63.0f / 255.0f + 0.5f);
+			unsigned int b = (unsigned int)(color[2] * 31.0f / 255.0f + 0.5f);
+			return (unsigned short)((r << 11) | (g << 5) | b);
+		}
+
+		static void Unpack(unsigned short packed, int color[3])
+		{
+			int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+			color[0] = (r << 3) | (r >> 2);
+			color[1] = (g << 2) | (g >> 4);
+			color[2] = (b << 3) | (b >> 2);
+		}
+
+		void Quantize(const float e0[4], const float e1[4])
+		{
+			Endpoint[0] = Pack(e0);
+			Endpoint[1] = Pack(e1);
+
+			int c0[3], c1[3];
+			Unpack(Endpoint[0], c0);
+			Unpack(Endpoint[1], c1);
+
+			Colors.Count = 4;
+			for (int c = 0; c < 3; c++)
+			{
+				Colors.Colors[0][c] = (float)c0[c];
+				Colors.Colors[1][c] = (float)((2 * c0[c] + c1[c]) / 3);
+				Colors.Colors[2][c] = (float)((c0[c] + 2 * c1[c]) / 3);
+				Colors.Colors[3][c] = (float)c1[c];
+			}
+			for (int i = 0; i < 4; i++)
+				Colors.Weights[i] = i / 3.0f;
+		}
+
+		void Write(unsigned char* out) const
+		{
+			static const unsigned int forward[4] = { 0, 2, 3, 1 };
+			static const unsigned int backward[4] = { 1, 3, 2, 0 };
+
+			unsigned short first = Endpoint[0], second = Endpoint[1];
+			const unsigned int* map = forward;
+			if (first < second)
+			{
+				std::swap(first, second);
+				map = backward;
+			}
+
+			unsigned int indices = 0;
+			if (first != second)
+			{
+				for (int i = 0; i < 16; i++)
+					indices |= map[Steps[i]] << (i * 2);
+			}
+
+			memcpy(out, &first, 2);
+			memcpy(out + 2, &second, 2);
+			memcpy(out + 4, &indices, 4);
+		}
+	};
+
+	// ----------------------------------------------------
+	// BC4: two 8-bit values and six steps between them,
+	// in the eight-value mode (first value larger)
+	// ----------------------------------------------------
+	struct Bc4Encoding
+	{
+		Palette Colors;
+		unsigned char Steps[16] = {};
+		float Error = 0;
+		unsigned char Endpoint[2] = {};
+
+		void Quantize(const float e0[4], const float e1[4])
+		{
+			Endpoint[0] = (unsigned char)(e0[0] + 0.5f);
+			Endpoint[1] = (unsigned char)(e1[0] + 0.5f);
+
+			Colors.Count = 8;
+			for (int i = 0; i < 8; i++)
+			{
+				Colors.Colors[i][0] = (float)(((7 - i) * Endpoint[0] + i * Endpoint[1] + 3) / 7);
+				Colors.Weights[i] = i / 7.0f;
+			}
+		}
+
+		void Write(unsigned char* out) const
+		{
+			static const unsigned long long forward[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+			static const unsigned long long backward[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+
+			unsigned char first = Endpoint[0], second = Endpoint[1];
+			const unsigned long long* map = forward;
+			if (first < second)
+			{
+				std::swap(first, second);
+				map = backward;
+			}
+
+			unsigned long long indices = 0;
+			if (first != second)
+			{
+				for (int i = 0; i < 16; i++)
+					indices |= map[Steps[i]] << (i * 3);
+			}
+
+			out[0] = first;
+			out[1] = second;
+			for (int i = 0; i < 6; i++)
+				out[2 + i] = (unsigned char)(indices >> (i * 8));
+		}
+	};
+
+	// ----------------------------------------------------
+	// BC7 mode 6: one RGBA line with 7-bit endpoints, a
+	// shared low bit per endpoint and 16 steps
+	// ----------------------------------------------------
+	struct Bc7Encoding
+	{
+		Palette Colors;
+		unsigned char Steps[16] = {};
+		float Error = 0;
+		unsigned char Endpoint[2][4] = {}; // 7 bits each
+		unsigned char LowBit[2] = {};
+
+		void Quantize(const float e0[4], const float e1[4])
+		{
+			static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+			const float* endpoints[2] = { e0, e1 };
+			int expanded[2][4];
+			for (int e = 0; e < 2; e++)
+			{
+				// Whichever low bit lands closer overall
+				float bestError = 3.0e38f;
+				for (int bit = 0; bit < 2; bit++)
+				{
+					float error = 0;
+					int values[4];
+					for (int c = 0; c < 4; c++)
+					{
+						int q = std::clamp((int)((endpoints[e][c] - bit) * 0.5f + 0.5f), 0, 127);
+						values[c] = (q << 1) | bit;
+						error += (values[c] - endpoints[e][c]) * (values[c] - endpoints[e][c]);
+					}
+					if (error < bestError)
+					{
+						bestError = error;
+						LowBit[e] = (unsigned char)bit;
+						for (int c = 0; c < 4; c++)
+						{
+							Endpoint[e][c] = (unsigned char)(values[c] >> 1);
+							expanded[e][c] = values[c];
+						}
+					}
+				}
+			}
+
+			Colors.Count = 16;
+			for (int i = 0; i < 16; i++)
+			{
+				for (int c = 0; c < 4; c++)
+					Colors.Colors[i][c] = (float)(((64 - weights[i]) * expanded[0][c] + weights[i] * expanded[1][c] + 32) >> 6);
+				Colors.Weights[i] = weights[i] / 64.0f;
+			}
+		}
+
+		void Write(unsigned char* out) const
+		{
+			// The first texel's index has an implied top bit of
+			// zero, so flip the line if it's in the upper half
+			bool swap = Steps[0] >= 8;
+			int first = swap ? 1 : 0;
+
+			unsigned char bits[16] = {};
+			unsigned int position = 0;
+			auto put = [&](unsigned int value, unsigned int count)
+			{
+				for (unsigned int i = 0; i < count; i++, position++)
+					bits[position / 8] |= (unsigned char)(((value >> i) & 1) << (position % 8));
+			};
+
+			put(1 << 6, 7);
+			for (int c = 0; c < 4; c++)
+			{
+				put(Endpoint[first][c], 7);
+				put(Endpoint[1 - first][c], 7);
+			}
+			put(LowBit[first], 1);
+			put(LowBit[1 - first], 1);
+			for (int i = 0; i < 16; i++)
+				put(swap ? 15 - Steps[i] : Steps[i], i == 0 ? 3 : 4);
+
+			memcpy(out, bits, 16);
+		}
+	};
+
+	void EncodeBc4Channel(const BlockTexels& block, unsigned int channel, BlockQuality quality, unsigned char* out)
+	{
+		BlockTexels single;
+		memcpy(single.Channel[0], block.Channel[channel], sizeof(single.Channel[0]));
+
+		Bc4Encoding encoding;
+		SearchEndpoints(single, 1, quality, encoding);
+		encoding.Write(out);
+	}
+
+	void EncodeBlock(const BlockTexels& block, BlockFormat format, BlockQuality quality, unsigned char* out)
+	{
+		switch (format)
+		{
+		case BLOCK_FORMAT_BC1:
+		{
+			Bc1Encoding encoding;
+			SearchEndpoints(block, 3, quality, encoding);
+			encoding.Write(out);
+			break;
+		}
+		case BLOCK_FORMAT_BC4:
+			EncodeBc4Channel(block, 0, quality, out);
+			break;
+		case BLOCK_FORMAT_BC5:
+			EncodeBc4Channel(block, 0, quality, out);
+			EncodeBc4Channel(block, 1, quality, out + 8);
+			break;
+		case BLOCK_FORMAT_BC7:
+		{
+			Bc7Encoding encoding;
+			SearchEndpoints(block, 4, quality, encoding);
+			encoding.Write(out);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	// ----------------------------------------------------
+	// Decoders, for PSNR.  Each writes a block's 16 texels
+	// as RGBA8 rows of 4.
+	// ----------------------------------------------------
+	void DecodeBc1(const unsigned char* in, unsigned char texels[16][4])
+	{
+		unsigned short first, second;
+		unsigned int indices;
+		memcpy(&first, in, 2);
+		memcpy(&second, in + 2, 2);
+		memcpy(&indices, in + 4, 4);
+
+		int c0[3], c1[3], colors[4][4];
+		Bc1Encoding::Unpack(first, c0);
+		Bc1Encoding::Unpack(second, c1);
+		for (int c = 0; c < 3; c++)
+		{
+			colors[0][c] = c0[c];
+			colors[1][c] = c1[c];
+			colors[2][c] = first > second ? (2 * c0[c] + c1[c]) / 3 : (c0[c] + c1[c]) / 2;
+			colors[3][c] = first > second ? (c0[c] + 2 * c1[c]) / 3 : 0;
+		}
+		colors[0][3] = colors[1][3] = colors[2][3] = 255;
+		colors[3][3] = first > second ? 255 : 0;
+
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+				texels[i][c] = (unsigned char)colors[(indices >> (i * 2)) & 3][c];
+		}
+	}
+
+	void DecodeBc4(const unsigned char* in, unsigned char texels[16][4], int channel)
+	{
+		int values[8] = { in[0], in[1] };
+		for (int i = 1; i < 7; i++)
+		{
+			if (in[0] > in[1])
+				values[i + 1] = ((7 - i) * in[0] + i * in[1] + 3) / 7;
+			else if (i < 5)
+				values[i + 1] = ((5 - i) * in[0] + i * in[1] + 2) / 5;
+		}
+		if (in[0] <= in[1])
+		{
+			values[6] = 0;
+			values[7] = 255;
+		}
+
+		unsigned long long indices = 0;
+		for (int i = 0; i < 6; i++)
+			indices |= (unsigned long long)in[2 + i] << (i * 8);
+		for (int i = 0; i < 16; i++)
+			texels[i][channel] = (unsigned char)values[(indices >> (i * 3)) & 7];
+	}
+
+	void DecodeBc7(const unsigned char* in, unsigned char texels[16][4])
+	{
+		memset(texels, 0, 16 * 4);
+		if ((in[0] & 0x7F) != 0x40)
+			return;
+
+		unsigned int position = 7;
+		auto get = [&](unsigned int count)
+		{
+			unsigned int value = 0;
+			for (unsigned int i = 0; i < count; i++, position++)
+				value |= ((in[position / 8] >> (position % 8)) & 1) << i;
+			return value;
+		};
+
+		int endpoints[2][4];
+		for (int c = 0; c < 4; c++)
+		{
+			endpoints[0][c] = get(7) << 1;
+			endpoints[1][c] = get(7) << 1;
+		}
+		unsigned int low0 = get(1), low1 = get(1);
+		for (int c = 0; c < 4; c++)
+		{
+			endpoints[0][c] |= low0;
+			endpoints[1][c] |= low1;
+		}
+
+		static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		for (int i = 0; i < 16; i++)
+		{
+			int w = weights[get(i == 0 ? 3 : 4)];
+			for (int c = 0; c < 4; c++)
+				texels[i][c] = (unsigned char)(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6);
+		}
+	}
+
+	unsigned int GetBlockBytes(BlockFormat format)
+	{
+		return format == BLOCK_FORMAT_BC1 || format == BLOCK_FORMAT_BC4 ? 8 : 16;
+	}
+}
+
+BlockFormat GetBlockFormat(TextureUsage usage, BlockQuality quality)
+{
+	switch (usage)
+	{
+	case TEXTURE_USAGE_COLOR:
+		return quality == BLOCK_QUALITY_HIGH ? BLOCK_FORMAT_BC7 : BLOCK_FORMAT_BC1;
+	case TEXTURE_USAGE_ORM:
+		// Half of BC7's size, so packing never costs more than
+		// two separate BC4 maps
+		return BLOCK_FORMAT_BC1;
+	case TEXTURE_USAGE_NORMAL:
+		return BLOCK_FORMAT_BC5;
+	default:
+		return BLOCK_FORMAT_BC4;
+	}
+}
+
+unsigned int GetBlockFormatDds(BlockFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case BLOCK_FORMAT_BC1: return srgb ? DDS_FORMAT_BC1_UNORM_SRGB : DDS_FORMAT_BC1_UNORM;
+	case BLOCK_FORMAT_BC4: return DDS_FORMAT_BC4_UNORM;
+	case BLOCK_FORMAT_BC5: return DDS_FORMAT_BC5_UNORM;
+	case BLOCK_FORMAT_BC7: return srgb ? DDS_FORMAT_BC7_UNORM_SRGB : DDS_FORMAT_BC7_UNORM;
+	default: return srgb ? DDS_FORMAT_R8G8B8A8_UNORM_SRGB : DDS_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+unsigned int GetBlockFormatChannels(BlockFormat format)
+{
+	switch (format)
+	{
+	case BLOCK_FORMAT_BC1: return 3;
+	case BLOCK_FORMAT_BC4: return 1;
+	case BLOCK_FORMAT_BC5: return 2;
+	default: return 4;
+	}
+}
+
+void CompressSurface(const DdsSurface& source, BlockFormat format, BlockQuality quality, DdsSurface& output, ThreadPool* pool)
+{
+	unsigned int blocksX = (source.Width + 3) / 4;
+	unsigned int blocksY = (source.Height + 3) / 4;
+	unsigned int blockBytes = GetBlockBytes(format);
+
+	output.Width = source.Width;
+	output.Height = source.Height;
+	output.RowPitch = blocksX * blockBytes;
+	output.Data.assign((size_t)output.RowPitch * blocksY, 0);
+
+	ThreadPool::ForEach(pool, blocksY, [&](unsigned int y)
+	{
+		BlockTexels block;
+		for (unsigned int x = 0; x < blocksX; x++)
+		{
+			LoadBlock(source, x, y, block);
+			EncodeBlock(block, format, quality, &output.Data[(size_t)y * output.RowPitch + x * blockBytes]);
+		}
+	});
+}
+
+void DecompressSurface(const DdsSurface& compressed, BlockFormat format, unsigned int width, unsigned int height, DdsSurface& output)
+{
+	unsigned int blocksX = (width + 3) / 4;
+	unsigned int blocksY = (height + 3) / 4;
+	unsigned int blockBytes = GetBlockBytes(format);
+
+	output.Width = width;
+	output.Height = height;
+	output.RowPitch = width * 4;
+	output.Data.assign((size_t)output.RowPitch * height, 0);
+
+	for (unsigned int by = 0; by < blocksY; by++)
+	{
+		for (unsigned int bx = 0; bx < blocksX; bx++)
+		{
+			const unsigned char* in = &compressed.Data[(size_t)by * compressed.RowPitch + bx * blockBytes];
+			unsigned char texels[16][4] = {};
+			switch (format)
+			{
+			case BLOCK_FORMAT_BC1: DecodeBc1(in, texels); break;
+			case BLOCK_FORMAT_BC4: DecodeBc4(in, texels, 0); break;
+			case BLOCK_FORMAT_BC5: DecodeBc4(in, texels, 0); DecodeBc4(in + 8, texels, 1); break;
+			case BLOCK_FORMAT_BC7: DecodeBc7(in, texels); break;
+			default: break;
+			}
+
+			for (unsigned int y = 0; y < 4 && by * 4 + y < height; y++)
+			{
+				for (unsigned int x = 0; x < 4 && bx * 4 + x < width; x++)
+					memcpy(&output.Data[(size_t)(by * 4 + y) * output.RowPitch + (bx * 4 + x) * 4], texels[y * 4 + x], 4);
+			}
+		}
+	}
+}
+
+double GetSurfacePsnr(const DdsSurface& reference, const DdsSurface& test, unsigned int channels)
+{
+	double squaredError = 0;
+	size_t samples = 0;
+	for (unsigned int y = 0; y < reference.Height; y++)
+	{
+		const unsigned char* a = &reference.Data[(size_t)y * reference.RowPitch];
+		const unsigned char* b = &test.Data[(size_t)y * test.RowPitch];
+		for (unsigned int x = 0; x < reference.Width; x++)
+		{
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				double diff = (double)a[x * 4 + c] - b[x * 4 + c];
+				squaredError += diff * diff;
+			}
+		}
+		samples += (size_t)reference.Width * channels;
+	}
+
+	if (samples == 0 || squaredError == 0)
+		return 100.0;
+
+	double psnr = 10.0 * log10(255.0 * 255.0 / (squaredError / samples));
+	return psnr < 100.0 ? psnr : 100.0;
+}
+
+BlockCompressBenchmarkResults BlockCompressBenchmark(unsigned int size, ThreadPool& pool)
+{
+	// Soft gradients with a little noise, closer to a photo
+	// than pure noise (which no block format can hold)
+	std::mt19937 random(1234);
+	std::uniform_int_distribution<int> noise(-12, 12);
+	DdsSurface source;
+	source.Width = size;
+	source.Height = size;
+	source.RowPitch = size * 4;
+	source.Data.resize((size_t)source.RowPitch * size);
+	for (unsigned int y = 0; y < size; y++)
+	{
+		for (unsigned int x = 0; x < size; x++)
+		{
+			unsigned char* p = &source.Data[(size_t)y * source.RowPitch + x * 4];
+			p[0] = (unsigned char)std::clamp((int)(x * 255 / size) + noise(random), 0, 255);
+			p[1] = (unsigned char)std::clamp((int)(y * 255 / size) + noise(random), 0, 255);
+			p[2] = (unsigned char)std::clamp((int)((x + y) * 127 / size) + noise(random), 0, 255);
+			p[3] = 255;
+		}
+	}
+
+	BlockCompressBenchmarkResults results;
+	results.Size = size;
+	double megapixels = (double)size * size / 1000000.0;
+
+	for (BlockFormat format : { BLOCK_FORMAT_BC1, BLOCK_FORMAT_BC4, BLOCK_FORMAT_BC5, BLOCK_FORMAT_BC7 })
+	{
+		for (BlockQuality quality : { BLOCK_QUALITY_FAST, BLOCK_QUALITY_HIGH })
+		{
+			BlockCompressBenchmarkResults::Row row;
+			row.Format = format;
+			row.Quality = quality;
+
+			DdsSurface compressed;
+			auto start = std::chrono::high_resolution_clock::now();
+			CompressSurface(source, format, quality, compressed, nullptr);
+			row.MPs = megapixels / (MsSince(start) / 1000.0);
+
+			start = std::chrono::high_resolution_clock::now();
+			CompressSurface(source, format, quality, compressed, &pool);
+			row.PooledMPs = megapixels / (MsSince(start) / 1000.0);
+
+			DdsSurface decoded;
+			DecompressSurface(compressed, format, size, size, decoded);
+			row.Psnr = GetSurfacePsnr(source, decoded, GetBlockFormatChannels(format));
+
+			results.Rows.push_back(row);
+		}
+	}
+	return results;
+}
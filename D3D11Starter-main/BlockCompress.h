@@ -0,0 +1,75 @@
+#pragma once
+#include "DdsFile.h"
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+// --------------------------------------------------------
+// The block compressed formats the cooker writes
+// --------------------------------------------------------
+enum BlockFormat
+{
+	BLOCK_FORMAT_NONE,
+	BLOCK_FORMAT_BC1, // RGB, 4 bits per texel
+	BLOCK_FORMAT_BC4, // One channel, 4 bits per texel
+	BLOCK_FORMAT_BC5, // Two channels, 8 bits per texel
+	BLOCK_FORMAT_BC7, // RGBA, 8 bits per texel (mode 6 only)
+};
+
+// --------------------------------------------------------
+// The speed/quality knob.  Fast picks endpoints from the
+// block's bounding box and uses BC1 for color; High fits
+// them along the principal axis, refines them by least
+// squares and uses BC7 for color.
+// --------------------------------------------------------
+enum BlockQuality
+{
+	BLOCK_QUALITY_FAST,
+	BLOCK_QUALITY_HIGH,
+};
+
+// What a texture of this usage compresses to.  ORM maps
+// are always BC1 here; the cooker can opt them into BC7.
+BlockFormat GetBlockFormat(TextureUsage usage, BlockQuality quality);
+
+// DDS_FORMAT_* value for a block format
+unsigned int GetBlockFormatDds(BlockFormat format, bool srgb);
+
+// How many of R, G, B, A a format keeps (for PSNR)
+unsigned int GetBlockFormatChannels(BlockFormat format);
+
+// --------------------------------------------------------
+// Compresses an RGBA8 surface.  Partial blocks at the edges
+// repeat their last row or column.  Rows of blocks are
+// split across the pool when there is one - pass none from
+// inside a pool task.
+// --------------------------------------------------------
+void CompressSurface(const DdsSurface& source, BlockFormat format, BlockQuality quality, DdsSurface& output, ThreadPool* pool);
+
+// Back to RGBA8, for measuring quality.  Only understands
+// the BC7 mode this encoder writes.
+void DecompressSurface(const DdsSurface& compressed, BlockFormat format, unsigned int width, unsigned int height, DdsSurface& output);
+
+// Peak signal to noise ratio of the first channels of two
+// same-sized RGBA8 surfaces, in dB (capped at 100 for a
+// perfect match)
+double GetSurfacePsnr(const DdsSurface& reference, const DdsSurface& test, unsigned int channels);
+
+// --------------------------------------------------------
+// Encoding speed and quality for each format, on a
+// synthetic image
+// --------------------------------------------------------
+struct BlockCompressBenchmarkResults
+{
+	unsigned int Size = 0;
+	struct Row
+	{
+		BlockFormat Format = BLOCK_FORMAT_NONE;
+		BlockQuality Quality = BLOCK_QUALITY_FAST;
+		double MPs = 0;
+		double PooledMPs = 0;
+		double Psnr = 0;
+	};
+	std::vector<Row> Rows;
+};
+
+BlockCompressBenchmarkResults BlockCompressBenchmark(unsigned int size, ThreadPool& pool);
@@ -0,0 +1,52 @@
+#include "CBufferLayout.h"
+
+bool ValidateCBufferLayout(
+	const ShaderReflectionBuffer& buffer,
+	const CBufferField* fields,
+	size_t fieldCount,
+	unsigned int structSize,
+	std::string* error)
+{
+	auto fail = [&](const std::string& message)
+	{
+		if (error) *error = "cbuffer '" + buffer.Name + "': " + message;
+		return false;
+	};
+
+	if (structSize < buffer.Size)
+		return fail("struct is " + std::to_string(structSize) + " bytes but the shader expects " + std::to_string(buffer.Size));
+
+	// Everything the shader declares has to line up exactly
+	for (const ShaderReflectionVariable& var : buffer.Variables)
+	{
+		const CBufferField* field = 0;
+		for (size_t i = 0; i < fieldCount && !field; i++)
+		{
+			if (var.Name == fields[i].Name)
+				field = &fields[i];
+		}
+
+		if (!field)
+			return fail("no field for shader variable '" + var.Name + "'");
+
+		if (field->Offset != var.ByteOffset || field->Size != var.Size)
+		{
+			return fail("'" + var.Name + "' is at " + std::to_string(field->Offset) + " (" + std::to_string(field->Size) +
+				" bytes) but the shader has it at " + std::to_string(var.ByteOffset) + " (" + std::to_string(var.Size) + " bytes)");
+		}
+	}
+
+	// Extra fields can't land inside the buffer, or a renamed
+	// shader variable would silently stop being set
+	for (size_t i = 0; i < fieldCount; i++)
+	{
+		bool declared = false;
+		for (const ShaderReflectionVariable& var : buffer.Variables)
+			declared = declared || var.Name == fields[i].Name;
+
+		if (!declared && fields[i].Offset < buffer.Size)
+			return fail("field '" + std::string(fields[i].Name) + "' isn't declared in the shader");
+	}
+
+	return true;
+}
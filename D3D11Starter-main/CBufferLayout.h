@@ -0,0 +1,125 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <type_traits>
+
+#include "ShaderReflectionData.h"
+
+// --------------------------------------------------------
+// Compile-time description of a C++ struct that mirrors an
+// HLSL cbuffer, so the whole block can be uploaded with one
+// memcpy instead of one Set call per variable.
+//
+// Declare the struct, then describe it with CBUFFER_LAYOUT:
+//
+//   struct PerObjectVSData
+//   {
+//       DirectX::XMFLOAT4X4 world;
+//       DirectX::XMFLOAT4X4 worldInvTranspose;
+//   };
+//   CBUFFER_LAYOUT(PerObjectVSData, "PerObject",
+//       CBUFFER_FIELD(PerObjectVSData, world),
+//       CBUFFER_FIELD(PerObjectVSData, worldInvTranspose));
+//
+// The macro static_asserts that the C++ offsets match HLSL
+// packing, and ValidateCBufferLayout() checks the same list
+// against a shader's reflection data when the shader loads.
+// --------------------------------------------------------
+struct CBufferField
+{
+	const char* Name;
+	unsigned int Offset;
+	unsigned int Size;
+	bool StartsRegister; // Matrices, arrays and structs always start a new 16-byte register
+};
+
+// Matrices and other types over 16 bytes start a register, as do
+// arrays.  Specialize this for any small struct used in a cbuffer.
+template<typename T>
+struct HlslStartsRegister
+{
+	static constexpr bool Value = std::is_array_v<T> || sizeof(T) > 16;
+};
+
+// Filled in by CBUFFER_LAYOUT for each struct
+template<typename T>
+struct CBufferLayout;
+
+// --------------------------------------------------------
+// HLSL packing: a value can't straddle a 16-byte register,
+// and anything flagged StartsRegister begins on a fresh one
+// --------------------------------------------------------
+constexpr unsigned int HlslPackOffset(unsigned int offset, unsigned int size, bool startsRegister)
+{
+	unsigned int nextRegister = (offset + 15) / 16 * 16;
+	if (startsRegister)
+		return nextRegister;
+
+	if (offset % 16 + size > 16)
+		return nextRegister;
+
+	return offset;
+}
+
+// --------------------------------------------------------
+// True if every field sits exactly where HLSL would put it,
+// given the fields before it
+// --------------------------------------------------------
+template<size_t Count>
+constexpr bool HlslPackingMatches(const CBufferField (&fields)[Count])
+{
+	unsigned int offset = 0;
+	for (size_t i = 0; i < Count; i++)
+	{
+		unsigned int expected = HlslPackOffset(offset, fields[i].Size, fields[i].StartsRegister);
+		if (fields[i].Offset != expected)
+			return false;
+
+		offset = expected + fields[i].Size;
+	}
+	return true;
+}
+
+// Whole struct check used by CBUFFER_LAYOUT
+template<typename T>
+constexpr bool CBufferLayoutIsValid()
+{
+	return
+		std::is_standard_layout_v<T> &&
+		sizeof(T) % 16 == 0 && // cbuffers are whole registers, so pad the struct to match
+		HlslPackingMatches(CBufferLayout<T>::Fields);
+}
+
+#define CBUFFER_FIELD(Struct, Member) \
+	CBufferField{ #Member, (unsigned int)offsetof(Struct, Member), (unsigned int)sizeof(Struct::Member), HlslStartsRegister<decltype(Struct::Member)>::Value }
+
+#define CBUFFER_LAYOUT(Struct, BufferName, ...) \
+	template<> struct CBufferLayout<Struct> \
+	{ \
+		static constexpr const char* Name = BufferName; \
+		static constexpr CBufferField Fields[] = { __VA_ARGS__ }; \
+	}; \
+	static_assert(CBufferLayoutIsValid<Struct>(), #Struct " does not match HLSL cbuffer packing")
+
+// --------------------------------------------------------
+// Checks a layout against what a compiled shader reports.
+// Every reflected variable must have a field with the same
+// name, offset and size.  Fields the shader doesn't declare
+// are allowed only past the end of its buffer, so one struct
+// can serve shaders that declare a prefix of it.
+//
+// error - Optional, receives a description of the first mismatch
+// --------------------------------------------------------
+bool ValidateCBufferLayout(
+	const ShaderReflectionBuffer& buffer,
+	const CBufferField* fields,
+	size_t fieldCount,
+	unsigned int structSize,
+	std::string* error = 0);
+
+template<typename T>
+bool ValidateCBufferLayout(const ShaderReflectionBuffer& buffer, std::string* error = 0)
+{
+	return ValidateCBufferLayout(buffer, CBufferLayout<T>::Fields, std::size(CBufferLayout<T>::Fields), sizeof(T), error);
+}
@@ -0,0 +1,65 @@
+#include "CacheFiles.h"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+bool WriteFileAtomic(const std::filesystem::path& path, const std::function<void(std::ostream&)>& write)
+{
+	// Each write gets its own temp name, so two threads writing
+	// the same entry can't interleave into one file
+	static std::atomic<unsigned int> writeCount = 0;
+	std::filesystem::path tempPath = path;
+	tempPath += "." + FormatHashKey(std::hash<std::thread::id>()(std::this_thread::get_id())) + "." + std::to_string(writeCount++) + ".tmp";
+
+	std::error_code error;
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+			return false;
+
+		write(out);
+		out.close();
+		if (!out)
+		{
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, path, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool WriteFileAtomic(const std::filesystem::path& path, const void* data, size_t size)
+{
+	return WriteFileAtomic(path, [&](std::ostream& out)
+	{
+		out.write((const char*)data, (std::streamsize)size);
+	});
+}
+
+unsigned long long HashBytes(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string FormatHashKey(unsigned long long hash)
+{
+	char text[32];
+	snprintf(text, sizeof(text), "%016llx", hash);
+	return text;
+}
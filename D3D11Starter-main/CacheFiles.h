@@ -0,0 +1,22 @@
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <string>
+
+// --------------------------------------------------------
+// Writes a file through a temporary name and renames it into
+// place, so another thread, process or the next run never
+// reads a half-written cache entry.  The callback version
+// streams the contents; false if anything fails to write,
+// in which case the temporary file is removed.
+// --------------------------------------------------------
+bool WriteFileAtomic(const std::filesystem::path& path, const std::function<void(std::ostream&)>& write);
+bool WriteFileAtomic(const std::filesystem::path& path, const void* data, size_t size);
+
+// 64-bit FNV-1a over any bytes: file contents, key strings
+// or plain structs
+unsigned long long HashBytes(const void* data, size_t size);
+
+// A hash as the 16 hex digits cache keys and file names use
+std::string FormatHashKey(unsigned long long hash);
@@ -29,6 +29,11 @@ float Camera::GetFOV()
 	return fov;
 }
 
+float Camera::GetFarPlane()
+{
+	return farPlane;
+}
+
 Transform* Camera::GetTransform()
 {
 	return &transform;
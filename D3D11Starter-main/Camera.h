@@ -23,6 +23,7 @@ public:
 	DirectX::XMFLOAT4X4 GetProjectionMatrix();
 	float GetMouseSpeed();
 	float GetFOV();
+	float GetFarPlane();
 	Transform* GetTransform();
 
 
@@ -0,0 +1,135 @@
+#include "ConstantBufferRing.h"
+#include <cstring>
+
+// --------------------------------------------------------
+// Creates the ring's buffer if the device supports binding
+// constant buffers by offset (a D3D11.1 feature)
+// --------------------------------------------------------
+ConstantBufferRing::ConstantBufferRing(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, unsigned int sizeInBytes) :
+	supported(false),
+	mappedOnce(false),
+	allocator(sizeInBytes, 256),
+	frameIndex(1),
+	bytesWritten(0),
+	device(device),
+	context(context)
+{
+	// Need both offset binding and NO_OVERWRITE maps on constant buffers
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	HRESULT hr = device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	if (FAILED(hr) || !options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer)
+		return;
+
+	// Constant buffers can't be bigger than 4096 constants per binding,
+	// but the buffer itself can be much larger
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = allocator.GetCapacity();
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+	hr = device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+
+	supported = SUCCEEDED(hr);
+}
+
+// --------------------------------------------------------
+// Copies data into the next free block of the ring
+//
+// data       - The constant data to copy
+// size       - Size of the data in bytes
+// allocation - Filled out with the buffer and offsets to bind
+//
+// Returns false if the ring is full (or unsupported)
+// --------------------------------------------------------
+bool ConstantBufferRing::Allocate(const void* data, unsigned int size, Allocation& allocation)
+{
+	if (!supported)
+		return false;
+
+	unsigned int offset = allocator.Allocate(size);
+	if (offset == RingAllocator::InvalidOffset)
+		return false;
+
+	// The fences guarantee the GPU is done with this range, so it
+	// can be written without waiting. The very first map has to
+	// discard since nothing has been written yet.
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	D3D11_MAP mapType = mappedOnce ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD;
+	if (FAILED(context->Map(buffer.Get(), 0, mapType, 0, &mapped)))
+		return false;
+
+	memcpy((unsigned char*)mapped.pData + offset, data, size);
+	context->Unmap(buffer.Get(), 0);
+	mappedOnce = true;
+
+	allocation.Buffer = buffer.Get();
+	allocation.FirstConstant = offset / 16;
+	allocation.NumConstants = allocator.AlignSize(size) / 16;
+	allocation.Frame = frameIndex;
+
+	bytesWritten += size;
+	return true;
+}
+
+// --------------------------------------------------------
+// Frees ring space from any frames the GPU has finished
+// --------------------------------------------------------
+void ConstantBufferRing::BeginFrame()
+{
+	if (!supported)
+		return;
+
+	unsigned long long completed = 0;
+	while (!pendingFences.empty())
+	{
+		// Don't flush - we only want to know if it's already done
+		Fence& fence = pendingFences.front();
+		if (context->GetData(fence.Query.Get(), 0, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			break;
+
+		completed = fence.Value;
+		freeQueries.push_back(fence.Query);
+		pendingFences.pop_front();
+	}
+
+	if (completed > 0)
+		allocator.Retire(completed);
+}
+
+// --------------------------------------------------------
+// Fences everything allocated this frame
+// --------------------------------------------------------
+void ConstantBufferRing::EndFrame()
+{
+	if (!supported)
+		return;
+
+	// Reuse a finished query if there is one
+	Fence fence = {};
+	if (!freeQueries.empty())
+	{
+		fence.Query = freeQueries.back();
+		freeQueries.pop_back();
+	}
+	else
+	{
+		D3D11_QUERY_DESC queryDesc = {};
+		queryDesc.Query = D3D11_QUERY_EVENT;
+		device->CreateQuery(&queryDesc, fence.Query.GetAddressOf());
+	}
+
+	fence.Value = frameIndex;
+	context->End(fence.Query.Get());
+	pendingFences.push_back(fence);
+
+	allocator.EndFrame(frameIndex);
+	frameIndex++;
+}
+
+void ConstantBufferRing::ResetStats()
+{
+	allocator.ResetStats();
+	bytesWritten = 0;
+}
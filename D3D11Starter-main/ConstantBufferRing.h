@@ -0,0 +1,68 @@
+#pragma once
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include <vector>
+#include <deque>
+#include "RingAllocator.h"
+
+// --------------------------------------------------------
+// One large DYNAMIC constant buffer that per-draw constants
+// are written into with Map(NO_OVERWRITE) and bound by
+// offset with *SetConstantBuffers1().
+//
+// - Allocations are 256 bytes aligned (16 constants), as
+//   required for constant buffer offsets
+// - Space is recycled once the GPU finishes the frame that
+//   used it, tracked with event queries as fences
+// - Allocate() fails when the ring is full; callers are
+//   expected to fall back to their own buffer
+// --------------------------------------------------------
+class ConstantBufferRing
+{
+public:
+	struct Allocation
+	{
+		ID3D11Buffer* Buffer = 0;
+		unsigned int FirstConstant = 0; // In 16-byte constants
+		unsigned int NumConstants = 0;  // In 16-byte constants
+		unsigned long long Frame = 0;   // Only valid for binding during this frame
+	};
+
+	ConstantBufferRing(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, unsigned int sizeInBytes);
+
+	// False if the device can't bind constant buffers by offset
+	bool IsSupported() { return supported; }
+
+	// Copies data into the ring
+	bool Allocate(const void* data, unsigned int size, Allocation& allocation);
+
+	// Frame boundaries
+	void BeginFrame();
+	void EndFrame();
+	unsigned long long GetFrameIndex() { return frameIndex; }
+
+	// Stats
+	const RingAllocator& GetAllocator() { return allocator; }
+	unsigned int GetBytesWritten() { return bytesWritten; }
+	void ResetStats();
+
+private:
+	bool supported;
+	bool mappedOnce;
+	RingAllocator allocator;
+	unsigned long long frameIndex;
+	unsigned int bytesWritten;
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+
+	// Event queries used as fences, one per frame in flight
+	struct Fence
+	{
+		Microsoft::WRL::ComPtr<ID3D11Query> Query;
+		unsigned long long Value;
+	};
+	std::deque<Fence> pendingFences;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> freeQueries;
+};
@@ -0,0 +1,26 @@
+#include "CpuHelpers.h"
+
+#include <cmath>
+
+// --------------------------------------------------------
+// Built on first use; thread-safe as a function-local static
+// --------------------------------------------------------
+const float* GetSrgbDecodeTable()
+{
+	struct Table
+	{
+		float Values[256];
+
+		Table()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float v = i / 255.0f;
+				Values[i] = v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+	};
+
+	static const Table table;
+	return table.Values;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <chrono>
+
+// --------------------------------------------------------
+// Small pieces shared by the CPU-side texture and lighting
+// code: SSE2 detection, the sRGB decode table and a timer
+// --------------------------------------------------------
+
+// Defined wherever SSE2 can be assumed: x64, and x86 built
+// with /arch:SSE2 (or -msse2).  Code without it falls back
+// to scalar loops.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CPU_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// 256 entries, 8-bit sRGB to linear
+const float* GetSrgbDecodeTable();
+
+// Milliseconds since start, for the load-time stats and benchmarks
+inline double MsSince(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
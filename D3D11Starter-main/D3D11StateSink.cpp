@@ -0,0 +1,106 @@
+#include "D3D11StateSink.h"
+
+D3D11StateSink::D3D11StateSink(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) :
+	context(context)
+{
+	context.As(&context1);
+}
+
+void D3D11StateSink::SetShader(StateStage stage, const void* shader)
+{
+	if (stage == STATE_STAGE_VERTEX)
+		context->VSSetShader((ID3D11VertexShader*)shader, 0, 0);
+	else
+		context->PSSetShader((ID3D11PixelShader*)shader, 0, 0);
+}
+
+void D3D11StateSink::SetInputLayout(const void* layout)
+{
+	context->IASetInputLayout((ID3D11InputLayout*)layout);
+}
+
+void D3D11StateSink::SetConstantBuffer(StateStage stage, unsigned int slot, const void* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	ID3D11Buffer* buffers[] = { (ID3D11Buffer*)buffer };
+
+	if (numConstants > 0 && context1)
+	{
+		if (stage == STATE_STAGE_VERTEX)
+			context1->VSSetConstantBuffers1(slot, 1, buffers, &firstConstant, &numConstants);
+		else
+			context1->PSSetConstantBuffers1(slot, 1, buffers, &firstConstant, &numConstants);
+		return;
+	}
+
+	if (stage == STATE_STAGE_VERTEX)
+		context->VSSetConstantBuffers(slot, 1, buffers);
+	else
+		context->PSSetConstantBuffers(slot, 1, buffers);
+}
+
+void D3D11StateSink::SetShaderResource(StateStage stage, unsigned int slot, const void* srv)
+{
+	ID3D11ShaderResourceView* views[] = { (ID3D11ShaderResourceView*)srv };
+	if (stage == STATE_STAGE_VERTEX)
+		context->VSSetShaderResources(slot, 1, views);
+	else
+		context->PSSetShaderResources(slot, 1, views);
+}
+
+void D3D11StateSink::ClearShaderResources(StateStage stage, unsigned int firstSlot, unsigned int count)
+{
+	ID3D11ShaderResourceView* views[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = {};
+	if (count > D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT)
+		count = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
+
+	if (stage == STATE_STAGE_VERTEX)
+		context->VSSetShaderResources(firstSlot, count, views);
+	else
+		context->PSSetShaderResources(firstSlot, count, views);
+}
+
+void D3D11StateSink::SetSampler(StateStage stage, unsigned int slot, const void* sampler)
+{
+	ID3D11SamplerState* samplers[] = { (ID3D11SamplerState*)sampler };
+	if (stage == STATE_STAGE_VERTEX)
+		context->VSSetSamplers(slot, 1, samplers);
+	else
+		context->PSSetSamplers(slot, 1, samplers);
+}
+
+void D3D11StateSink::SetRasterState(const void* state)
+{
+	context->RSSetState((ID3D11RasterizerState*)state);
+}
+
+void D3D11StateSink::SetDepthState(const void* state, unsigned int stencilRef)
+{
+	context->OMSetDepthStencilState((ID3D11DepthStencilState*)state, stencilRef);
+}
+
+void D3D11StateSink::SetBlendState(const void* state)
+{
+	context->OMSetBlendState((ID3D11BlendState*)state, 0, 0xFFFFFFFF);
+}
+
+void D3D11StateSink::SetTopology(unsigned int topology)
+{
+	context->IASetPrimitiveTopology((D3D11_PRIMITIVE_TOPOLOGY)topology);
+}
+
+void D3D11StateSink::SetVertexBuffer(unsigned int slot, const void* buffer, unsigned int stride, unsigned int offset)
+{
+	ID3D11Buffer* buffers[] = { (ID3D11Buffer*)buffer };
+	context->IASetVertexBuffers(slot, 1, buffers, &stride, &offset);
+}
+
+void D3D11StateSink::SetIndexBuffer(const void* buffer, unsigned int format, unsigned int offset)
+{
+	context->IASetIndexBuffer((ID3D11Buffer*)buffer, (DXGI_FORMAT)format, offset);
+}
+
+void D3D11StateSink::SetRenderTarget(const void* rtv, const void* dsv)
+{
+	ID3D11RenderTargetView* rtvs[] = { (ID3D11RenderTargetView*)rtv };
+	context->OMSetRenderTargets(1, rtvs, (ID3D11DepthStencilView*)dsv);
+}
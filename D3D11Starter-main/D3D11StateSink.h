@@ -0,0 +1,32 @@
+#pragma once
+#include <d3d11_1.h>
+#include <wrl/client.h>
+
+#include "StateCache.h"
+
+// --------------------------------------------------------
+// Forwards StateCache's surviving calls to a real context
+// --------------------------------------------------------
+class D3D11StateSink : public IStateSink
+{
+public:
+	D3D11StateSink(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	void SetShader(StateStage stage, const void* shader) override;
+	void SetInputLayout(const void* layout) override;
+	void SetConstantBuffer(StateStage stage, unsigned int slot, const void* buffer, unsigned int firstConstant, unsigned int numConstants) override;
+	void SetShaderResource(StateStage stage, unsigned int slot, const void* srv) override;
+	void ClearShaderResources(StateStage stage, unsigned int firstSlot, unsigned int count) override;
+	void SetSampler(StateStage stage, unsigned int slot, const void* sampler) override;
+	void SetRasterState(const void* state) override;
+	void SetDepthState(const void* state, unsigned int stencilRef) override;
+	void SetBlendState(const void* state) override;
+	void SetTopology(unsigned int topology) override;
+	void SetVertexBuffer(unsigned int slot, const void* buffer, unsigned int stride, unsigned int offset) override;
+	void SetIndexBuffer(const void* buffer, unsigned int format, unsigned int offset) override;
+	void SetRenderTarget(const void* rtv, const void* dsv) override;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> context1; // For offset binding, if available
+};
@@ -0,0 +1,52 @@
+#include "D3DShaderCompiler.h"
+#include <d3dcompiler.h>
+#include <wrl/client.h>
+
+D3DShaderCompiler::D3DShaderCompiler()
+{
+	flags = D3DCOMPILE_ENABLE_STRICTNESS;
+#if defined(DEBUG) || defined(_DEBUG)
+	flags |= D3DCOMPILE_DEBUG;
+#else
+	flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+}
+
+std::string D3DShaderCompiler::GetIdentity() const
+{
+	return "d3dcompiler_" + std::to_string(D3D_COMPILER_VERSION) + " flags " + std::to_string(flags);
+}
+
+// --------------------------------------------------------
+// Safe to call from several threads at once
+// --------------------------------------------------------
+bool D3DShaderCompiler::Compile(const ShaderCompileJob& job, std::vector<unsigned char>& bytecode, std::string& errors)
+{
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const ShaderDefine& define : job.Defines)
+		macros.push_back({ define.Name.c_str(), define.Value.c_str() });
+	macros.push_back({ 0, 0 });
+
+	Microsoft::WRL::ComPtr<ID3DBlob> code;
+	Microsoft::WRL::ComPtr<ID3DBlob> errorBlob;
+	HRESULT hr = D3DCompileFromFile(
+		job.Source.c_str(),
+		macros.data(),
+		D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		job.EntryPoint.c_str(),
+		job.Target.c_str(),
+		flags,
+		0,
+		code.GetAddressOf(),
+		errorBlob.GetAddressOf());
+
+	if (errorBlob)
+		errors.assign((const char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize());
+
+	if (FAILED(hr))
+		return false;
+
+	const unsigned char* data = (const unsigned char*)code->GetBufferPointer();
+	bytecode.assign(data, data + code->GetBufferSize());
+	return true;
+}
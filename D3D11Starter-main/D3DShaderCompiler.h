@@ -0,0 +1,21 @@
+#pragma once
+#include "ShaderBuild.h"
+
+// --------------------------------------------------------
+// Compiles in-process with D3DCompileFromFile (FXC), which
+// produces the DXBC bytecode Direct3D 11 loads.  Quoted
+// includes resolve relative to the including file.
+// --------------------------------------------------------
+class D3DShaderCompiler : public IShaderCompiler
+{
+public:
+	D3DShaderCompiler();
+
+	std::string GetIdentity() const override;
+	bool Compile(const ShaderCompileJob& job, std::vector<unsigned char>& bytecode, std::string& errors) override;
+
+	unsigned int GetFlags() const { return flags; }
+
+private:
+	unsigned int flags;
+};
@@ -0,0 +1,327 @@
+#include "DdsFile.h"
+#include "CacheFiles.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	// Mirrors of the structs in DirectXTK's DDS.h
+	struct DdsPixelFormat
+	{
+		unsigned int Size;
+		unsigned int Flags;
+		unsigned int FourCC;
+		unsigned int RGBBitCount;
+		unsigned int RBitMask;
+		unsigned int GBitMask;
+		unsigned int BBitMask;
+		unsigned int ABitMask;
+	};
+
+	struct DdsHeader
+	{
+		unsigned int Size;
+		unsigned int Flags;
+		unsigned int Height;
+		unsigned int Width;
+		unsigned int PitchOrLinearSize;
+		unsigned int Depth;
+		unsigned int MipMapCount;
+		unsigned int Reserved1[11];
+		DdsPixelFormat PixelFormat;
+		unsigned int Caps;
+		unsigned int Caps2;
+		unsigned int Caps3;
+		unsigned int Caps4;
+		unsigned int Reserved2;
+	};
+
+	struct DdsHeaderDX10
+	{
+		unsigned int DxgiFormat;
+		unsigned int ResourceDimension;
+		unsigned int MiscFlag;
+		unsigned int ArraySize;
+		unsigned int MiscFlags2;
+	};
+
+	static_assert(sizeof(DdsHeader) == 124, "DDS header size");
+	static_assert(sizeof(DdsHeaderDX10) == 20, "DDS DX10 header size");
+
+	const unsigned int DdsMagic = 0x20534444; // "DDS "
+	const unsigned int FourCCDX10 = 0x30315844; // "DX10"
+
+	// Mips in a full chain, the most a header may claim
+	unsigned int GetMipCountLimit(unsigned int width, unsigned int height)
+	{
+		unsigned int levels = 1;
+		while (width > 1 || height > 1)
+		{
+			width >>= 1;
+			height >>= 1;
+			levels++;
+		}
+		return levels;
+	}
+}
+
+unsigned int GetDdsFormatPixelBytes(unsigned int format)
+{
+	switch (format)
+	{
+	case DDS_FORMAT_R32G32B32A32_FLOAT:
+		return 16;
+	case DDS_FORMAT_R8G8B8A8_UNORM:
+	case DDS_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DDS_FORMAT_R16G16_UNORM:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+const char* GetDdsFormatName(unsigned int format)
+{
+	switch (format)
+	{
+	case DDS_FORMAT_R32G32B32A32_FLOAT: return "RGBA32F";
+	case DDS_FORMAT_R8G8B8A8_UNORM: return "RGBA8";
+	case DDS_FORMAT_R8G8B8A8_UNORM_SRGB: return "RGBA8 sRGB";
+	case DDS_FORMAT_R16G16_UNORM: return "RG16";
+	case DDS_FORMAT_BC1_UNORM: return "BC1";
+	case DDS_FORMAT_BC1_UNORM_SRGB: return "BC1 sRGB";
+	case DDS_FORMAT_BC4_UNORM: return "BC4";
+	case DDS_FORMAT_BC5_UNORM: return "BC5";
+	case DDS_FORMAT_BC7_UNORM: return "BC7";
+	case DDS_FORMAT_BC7_UNORM_SRGB: return "BC7 sRGB";
+	default: return "Unknown";
+	}
+}
+
+unsigned int GetDdsFormatBlockBytes(unsigned int format)
+{
+	switch (format)
+	{
+	case DDS_FORMAT_BC1_UNORM:
+	case DDS_FORMAT_BC1_UNORM_SRGB:
+	case DDS_FORMAT_BC4_UNORM:
+		return 8;
+	case DDS_FORMAT_BC5_UNORM:
+	case DDS_FORMAT_BC7_UNORM:
+	case DDS_FORMAT_BC7_UNORM_SRGB:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+size_t GetDdsSurfaceBytes(unsigned int format, unsigned int width, unsigned int height)
+{
+	if (unsigned int blockBytes = GetDdsFormatBlockBytes(format))
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+
+	return (size_t)width * height * GetDdsFormatPixelBytes(format);
+}
+
+size_t GetDdsTextureBytes(const DdsTexture& texture)
+{
+	size_t bytes = 0;
+	for (unsigned int mip = 0; mip < texture.MipCount; mip++)
+	{
+		unsigned int width = texture.Width >> mip ? texture.Width >> mip : 1;
+		unsigned int height = texture.Height >> mip ? texture.Height >> mip : 1;
+		bytes += GetDdsSurfaceBytes(texture.Format, width, height);
+	}
+	return bytes * texture.ArraySize;
+}
+
+bool ReadDdsHeader(const std::filesystem::path& path, DdsTexture& texture)
+{
+	std::ifstream file(path, std::ios::binary);
+	unsigned int magic = 0;
+	DdsHeader header = {};
+	DdsHeaderDX10 dx10 = {};
+	file.read((char*)&magic, sizeof(magic));
+	file.read((char*)&header, sizeof(header));
+	if (!file || magic != DdsMagic || header.Size != sizeof(DdsHeader) || header.PixelFormat.FourCC != FourCCDX10)
+		return false;
+
+	file.read((char*)&dx10, sizeof(dx10));
+	if (!file)
+		return false;
+
+	texture = DdsTexture();
+	texture.Width = header.Width;
+	texture.Height = header.Height;
+	texture.MipCount = header.MipMapCount ? header.MipMapCount : 1;
+	texture.Format = dx10.DxgiFormat;
+	texture.IsCubemap = (dx10.MiscFlag & 0x4) != 0;
+	texture.ArraySize = dx10.ArraySize ? dx10.ArraySize : 1;
+	if (texture.IsCubemap)
+		texture.ArraySize *= 6;
+	return true;
+}
+
+bool ParseDdsHeader(const unsigned char* data, size_t size, DdsTexture& texture, size_t& dataOffset, std::string& error)
+{
+	unsigned int magic = 0;
+	DdsHeader header = {};
+	if (size < sizeof(magic) + sizeof(header))
+	{
+		error = "Too small for a DDS header";
+		return false;
+	}
+	memcpy(&magic, data, sizeof(magic));
+	memcpy(&header, data + sizeof(magic), sizeof(header));
+	if (magic != DdsMagic || header.Size != sizeof(DdsHeader) || header.PixelFormat.Size != sizeof(DdsPixelFormat))
+	{
+		error = "Not a DDS";
+		return false;
+	}
+
+	texture = DdsTexture();
+	texture.Width = header.Width;
+	texture.Height = header.Height;
+	texture.MipCount = header.MipMapCount ? header.MipMapCount : 1;
+	dataOffset = sizeof(magic) + sizeof(header);
+
+	const DdsPixelFormat& pixelFormat = header.PixelFormat;
+	if ((pixelFormat.Flags & 0x4) && pixelFormat.FourCC == FourCCDX10)
+	{
+		DdsHeaderDX10 dx10 = {};
+		if (size < dataOffset + sizeof(dx10))
+		{
+			error = "Truncated DX10 header";
+			return false;
+		}
+		memcpy(&dx10, data + dataOffset, sizeof(dx10));
+		dataOffset += sizeof(dx10);
+
+		if (dx10.ResourceDimension != 3) // Texture2D
+		{
+			error = "Only 2D textures are supported";
+			return false;
+		}
+		texture.Format = dx10.DxgiFormat;
+		texture.IsCubemap = (dx10.MiscFlag & 0x4) != 0;
+		texture.ArraySize = dx10.ArraySize ? dx10.ArraySize : 1;
+	}
+	else
+	{
+		// Legacy headers describe the format with a FourCC or bit masks
+		if (header.Caps2 & 0x200000) // Volume
+		{
+			error = "Only 2D textures are supported";
+			return false;
+		}
+
+		if (pixelFormat.Flags & 0x4)
+		{
+			switch (pixelFormat.FourCC)
+			{
+			case 0x31545844: texture.Format = DDS_FORMAT_BC1_UNORM; break; // "DXT1"
+			case 0x31495441: // "ATI1"
+			case 0x55344342: texture.Format = DDS_FORMAT_BC4_UNORM; break; // "BC4U"
+			case 0x32495441: // "ATI2"
+			case 0x55354342: texture.Format = DDS_FORMAT_BC5_UNORM; break; // "BC5U"
+			default: texture.Format = 0; break;
+			}
+		}
+		else if ((pixelFormat.Flags & 0x40) && pixelFormat.RGBBitCount == 32 && pixelFormat.RBitMask == 0xFF &&
+			pixelFormat.GBitMask == 0xFF00 && pixelFormat.BBitMask == 0xFF0000)
+		{
+			texture.Format = DDS_FORMAT_R8G8B8A8_UNORM;
+		}
+		else
+		{
+			texture.Format = 0;
+		}
+
+		// Legacy cube maps only count if all six faces are there
+		if (header.Caps2 & 0x200)
+		{
+			if ((header.Caps2 & 0xFC00) != 0xFC00)
+			{
+				error = "Cube map is missing faces";
+				return false;
+			}
+			texture.IsCubemap = true;
+		}
+	}
+
+	if (texture.IsCubemap)
+		texture.ArraySize *= 6;
+
+	if (GetDdsSurfaceBytes(texture.Format, 1, 1) == 0)
+	{
+		error = "Unsupported format " + std::to_string(texture.Format);
+		return false;
+	}
+	if (texture.Width == 0 || texture.Height == 0 || texture.Width > 16384 || texture.Height > 16384)
+	{
+		error = "Bad dimensions";
+		return false;
+	}
+	if (texture.MipCount > GetMipCountLimit(texture.Width, texture.Height) || texture.ArraySize > 2048)
+	{
+		error = "Bad mip or array count";
+		return false;
+	}
+	if (GetDdsTextureBytes(texture) > size - dataOffset)
+	{
+		error = "Truncated surface data";
+		return false;
+	}
+	return true;
+}
+
+bool SaveDds(const std::filesystem::path& path, const DdsTexture& texture)
+{
+	if (texture.Surfaces.size() != (size_t)texture.MipCount * texture.ArraySize)
+		return false;
+
+	DdsHeader header = {};
+	header.Size = sizeof(DdsHeader);
+	header.Flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000; // Caps, height, width, pixel format, mip count
+	header.Height = texture.Height;
+	header.Width = texture.Width;
+	if (GetDdsFormatBlockBytes(texture.Format))
+	{
+		header.Flags |= 0x80000; // Linear size
+		header.PitchOrLinearSize = (unsigned int)texture.Surfaces[0].Data.size();
+	}
+	else
+	{
+		header.Flags |= 0x8; // Pitch
+		header.PitchOrLinearSize = texture.Surfaces[0].RowPitch;
+	}
+	header.MipMapCount = texture.MipCount;
+	header.PixelFormat.Size = sizeof(DdsPixelFormat);
+	header.PixelFormat.Flags = 0x4; // FourCC
+	header.PixelFormat.FourCC = FourCCDX10;
+	header.Caps = 0x1000; // Texture
+	if (texture.MipCount > 1 || texture.ArraySize > 1)
+		header.Caps |= 0x8; // Complex
+	if (texture.MipCount > 1)
+		header.Caps |= 0x400000; // Mipmap
+	if (texture.IsCubemap)
+		header.Caps2 = 0xFE00; // Cubemap with all six faces
+
+	DdsHeaderDX10 dx10 = {};
+	dx10.DxgiFormat = texture.Format;
+	dx10.ResourceDimension = 3; // Texture2D
+	dx10.MiscFlag = texture.IsCubemap ? 0x4 : 0; // TextureCube
+	dx10.ArraySize = texture.IsCubemap ? texture.ArraySize / 6 : texture.ArraySize;
+
+	// Write to a temporary name first so a crash mid-write never
+	// leaves a truncated file where a good one is expected
+	return WriteFileAtomic(path, [&](std::ostream& file)
+	{
+		file.write((const char*)&DdsMagic, sizeof(DdsMagic));
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)&dx10, sizeof(dx10));
+		for (const DdsSurface& surface : texture.Surfaces)
+			file.write((const char*)surface.Data.data(), surface.Data.size());
+	});
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// DXGI_FORMAT values for what the texture tools write, so
+// this side needs no Direct3D headers
+enum DdsFormat
+{
+	DDS_FORMAT_R32G32B32A32_FLOAT = 2,
+	DDS_FORMAT_R8G8B8A8_UNORM = 28,
+	DDS_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+	DDS_FORMAT_R16G16_UNORM = 35,
+	DDS_FORMAT_BC1_UNORM = 71,
+	DDS_FORMAT_BC1_UNORM_SRGB = 72,
+	DDS_FORMAT_BC4_UNORM = 80,
+	DDS_FORMAT_BC5_UNORM = 83,
+	DDS_FORMAT_BC7_UNORM = 98,
+	DDS_FORMAT_BC7_UNORM_SRGB = 99,
+};
+
+// --------------------------------------------------------
+// One mip of one array slice, tightly packed.  For block
+// compressed formats RowPitch is one row of 4x4 blocks.
+// --------------------------------------------------------
+struct DdsSurface
+{
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	unsigned int RowPitch = 0;
+	std::vector<unsigned char> Data;
+};
+
+// --------------------------------------------------------
+// A 2D texture or texture array ready for the GPU.
+// Surfaces are ordered by array slice, then mip - the same
+// order as D3D11 subresources and the DDS file itself.
+// --------------------------------------------------------
+struct DdsTexture
+{
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	unsigned int MipCount = 1;
+	unsigned int ArraySize = 1;
+	unsigned int Format = DDS_FORMAT_R8G8B8A8_UNORM;
+	bool IsCubemap = false; // ArraySize is then a multiple of 6
+	std::vector<DdsSurface> Surfaces;
+};
+
+// Bytes per pixel of an uncompressed format, or 0 if unknown
+unsigned int GetDdsFormatPixelBytes(unsigned int format);
+
+// Short name for display, like "BC7" or "RGBA8"
+const char* GetDdsFormatName(unsigned int format);
+
+// Bytes per 4x4 block of a block compressed format, or 0
+unsigned int GetDdsFormatBlockBytes(unsigned int format);
+
+// Size of one surface of the given format and dimensions
+size_t GetDdsSurfaceBytes(unsigned int format, unsigned int width, unsigned int height);
+
+// Size of every surface in a texture, from its description
+// alone (Surfaces can be empty)
+size_t GetDdsTextureBytes(const DdsTexture& texture);
+
+// Fills in a DDS file's description without its surfaces
+bool ReadDdsHeader(const std::filesystem::path& path, DdsTexture& texture);
+
+// --------------------------------------------------------
+// Parses the headers of a DDS already in memory: the DX10
+// extended header, or a legacy one holding DXT1, ATI1/BC4U,
+// ATI2/BC5U or 32-bit RGBA.  Fills in the description
+// (without surfaces) and where the first surface starts, and
+// checks every surface the header promises is really there.
+// --------------------------------------------------------
+bool ParseDdsHeader(const unsigned char* data, size_t size, DdsTexture& texture, size_t& dataOffset, std::string& error);
+
+// Writes a DDS with the DX10 extended header, which DirectXTK's
+// CreateDDSTextureFromFile loads directly
+bool SaveDds(const std::filesystem::path& path, const DdsTexture& texture);
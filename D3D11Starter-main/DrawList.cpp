@@ -0,0 +1,164 @@
+#include "DrawList.h"
+#include "CpuHelpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+unsigned long long MakeDrawKey(unsigned int pass, unsigned int pipeline, unsigned int material, unsigned int mesh, unsigned int depthBucket)
+{
+	auto field = [](unsigned int value, unsigned int shift, unsigned int bits)
+		{
+			return ((unsigned long long)value & ((1ull << bits) - 1)) << shift;
+		};
+
+	return
+		field(pass, DrawKeyPassShift, DrawKeyPassBits) |
+		field(pipeline, DrawKeyPipelineShift, DrawKeyPipelineBits) |
+		field(material, DrawKeyMaterialShift, DrawKeyMaterialBits) |
+		field(mesh, DrawKeyMeshShift, DrawKeyMeshBits) |
+		field(depthBucket, DrawKeyDepthShift, DrawKeyDepthBits);
+}
+
+unsigned int GetDrawKeyField(unsigned long long key, unsigned int shift, unsigned int bits)
+{
+	return (unsigned int)((key >> shift) & ((1ull << bits) - 1));
+}
+
+unsigned int GetDepthBucket(float viewDepth, float farPlane)
+{
+	const unsigned int maxBucket = (1u << DrawKeyDepthBits) - 1;
+	if (farPlane <= 0.0f || viewDepth <= 0.0f)
+		return 0;
+	if (viewDepth >= farPlane)
+		return maxBucket;
+	return (unsigned int)(viewDepth / farPlane * maxBucket);
+}
+
+unsigned int DrawIdTable::Get(const void* object)
+{
+	auto found = ids.find(object);
+	if (found != ids.end())
+		return found->second;
+
+	unsigned int id = (unsigned int)ids.size();
+	ids.insert({ object, id });
+	return id;
+}
+
+void DrawList::Sort()
+{
+	if (items.size() < 2)
+		return;
+
+	scratch.resize(items.size());
+
+	for (unsigned int shift = 0; shift < 64; shift += 8)
+	{
+		size_t counts[256] = {};
+		for (const DrawItem& item : items)
+			counts[(item.Key >> shift) & 0xFF]++;
+
+		// Every key has the same byte here, so this pass wouldn't move anything
+		if (counts[(items[0].Key >> shift) & 0xFF] == items.size())
+			continue;
+
+		size_t offset = 0;
+		for (size_t& count : counts)
+		{
+			size_t c = count;
+			count = offset;
+			offset += c;
+		}
+
+		for (const DrawItem& item : items)
+			scratch[counts[(item.Key >> shift) & 0xFF]++] = item;
+
+		items.swap(scratch);
+	}
+}
+
+void DrawList::GetPassRange(unsigned int pass, size_t& begin, size_t& end) const
+{
+	auto byKey = [](const DrawItem& item, unsigned long long key) { return item.Key < key; };
+	unsigned long long first = MakeDrawKey(pass, 0, 0, 0, 0);
+	unsigned long long next = first + (1ull << DrawKeyPassShift);
+
+	begin = std::lower_bound(items.begin(), items.end(), first, byKey) - items.begin();
+	end = pass + 1 >= (1u << DrawKeyPassBits) ? items.size() :
+		std::lower_bound(items.begin() + begin, items.end(), next, byKey) - items.begin();
+}
+
+unsigned int DrawList::CountChanges(unsigned int shift, unsigned int bits) const
+{
+	unsigned int changes = 0;
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		if (i == 0 || GetDrawKeyField(items[i].Key, shift, bits) != GetDrawKeyField(items[i - 1].Key, shift, bits))
+			changes++;
+	}
+	return changes;
+}
+
+DrawListBenchmarkResults DrawListBenchmark(unsigned int draws)
+{
+	// Roughly a real scene's spread: each material belongs to
+	// one pipeline, and meshes are shared by every material
+	const unsigned int pipelines = 8;
+	const unsigned int materials = 64;
+	const unsigned int meshes = 32;
+
+	std::mt19937 random(1234);
+	std::uniform_int_distribution<unsigned int> pickMaterial(0, materials - 1);
+	std::uniform_int_distribution<unsigned int> pickMesh(0, meshes - 1);
+	std::uniform_real_distribution<float> pickDepth(0.0f, 100.0f);
+
+	struct Draw { unsigned int Material, Mesh; float Depth; };
+	std::vector<Draw> scene(draws);
+	for (Draw& d : scene)
+		d = Draw{ pickMaterial(random), pickMesh(random), pickDepth(random) };
+
+	DrawListBenchmarkResults results;
+	results.Draws = draws;
+
+	DrawList list;
+	list.Reserve(draws);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < draws; i++)
+	{
+		const Draw& d = scene[i];
+		list.Add(MakeDrawKey(1, d.Material % pipelines, d.Material, d.Mesh, GetDepthBucket(d.Depth, 100.0f)), i);
+	}
+	results.BuildMs = MsSince(start);
+
+	results.UnsortedPipelineChanges = list.CountChanges(DrawKeyPipelineShift, DrawKeyPipelineBits);
+	results.UnsortedMaterialChanges = list.CountChanges(DrawKeyMaterialShift, DrawKeyMaterialBits);
+	results.UnsortedMeshChanges = list.CountChanges(DrawKeyMeshShift, DrawKeyMeshBits);
+
+	std::vector<DrawItem> copy = list.GetItems();
+
+	start = std::chrono::high_resolution_clock::now();
+	list.Sort();
+	results.RadixSortMs = MsSince(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	std::sort(copy.begin(), copy.end(), [](const DrawItem& a, const DrawItem& b) { return a.Key < b.Key; });
+	results.StdSortMs = MsSince(start);
+
+	results.SortedPipelineChanges = list.CountChanges(DrawKeyPipelineShift, DrawKeyPipelineBits);
+	results.SortedMaterialChanges = list.CountChanges(DrawKeyMaterialShift, DrawKeyMaterialBits);
+	results.SortedMeshChanges = list.CountChanges(DrawKeyMeshShift, DrawKeyMeshBits);
+
+	// Keep the std::sort result observable and check the two agree
+	for (size_t i = 0; i < copy.size(); i++)
+	{
+		if (copy[i].Key != list.GetItems()[i].Key)
+		{
+			results.Draws = 0;
+			break;
+		}
+	}
+
+	return results;
+}
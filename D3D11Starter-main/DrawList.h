@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// 64-bit draw sort key, most significant field first:
+//
+//   pass 4 | pipeline 12 | material 16 | mesh 16 | depth 16
+//
+// Sorting by key groups draws by pass, then by pipeline,
+// material and mesh, so each is bound once per run.  Depth
+// is last and only orders draws that share everything else
+// (front to back, which helps early-z).  Values wider than
+// their field are masked.
+// --------------------------------------------------------
+const unsigned int DrawKeyPassBits = 4;
+const unsigned int DrawKeyPipelineBits = 12;
+const unsigned int DrawKeyMaterialBits = 16;
+const unsigned int DrawKeyMeshBits = 16;
+const unsigned int DrawKeyDepthBits = 16;
+
+const unsigned int DrawKeyDepthShift = 0;
+const unsigned int DrawKeyMeshShift = DrawKeyDepthShift + DrawKeyDepthBits;
+const unsigned int DrawKeyMaterialShift = DrawKeyMeshShift + DrawKeyMeshBits;
+const unsigned int DrawKeyPipelineShift = DrawKeyMaterialShift + DrawKeyMaterialBits;
+const unsigned int DrawKeyPassShift = DrawKeyPipelineShift + DrawKeyPipelineBits;
+
+unsigned long long MakeDrawKey(unsigned int pass, unsigned int pipeline, unsigned int material, unsigned int mesh, unsigned int depthBucket);
+
+// Pulls one field back out of a key
+unsigned int GetDrawKeyField(unsigned long long key, unsigned int shift, unsigned int bits);
+
+// Maps a view depth in [0, farPlane] to a depth bucket
+unsigned int GetDepthBucket(float viewDepth, float farPlane);
+
+// --------------------------------------------------------
+// Gives objects small, stable ids to put in sort keys.  Ids
+// are handed out in first-seen order and kept until Clear().
+// --------------------------------------------------------
+class DrawIdTable
+{
+public:
+	unsigned int Get(const void* object);
+	void Clear() { ids.clear(); }
+	unsigned int GetCount() const { return (unsigned int)ids.size(); }
+
+private:
+	std::unordered_map<const void*, unsigned int> ids;
+};
+
+struct DrawItem
+{
+	unsigned long long Key;
+	unsigned int Index; // Into whatever the caller is drawing from
+	unsigned int Padding;
+};
+
+// --------------------------------------------------------
+// One frame's draws, rebuilt every frame.  Sort() is an LSD
+// radix sort, 8 bits per pass; passes where every key has
+// the same byte (unused fields, a single pass) are skipped.
+// It's stable, so equal keys keep the order they were added.
+// --------------------------------------------------------
+class DrawList
+{
+public:
+	void Clear() { items.clear(); }
+	void Reserve(size_t count) { items.reserve(count); scratch.reserve(count); }
+	void Add(unsigned long long key, unsigned int index) { items.push_back(DrawItem{ key, index, 0 }); }
+	void Sort();
+
+	const std::vector<DrawItem>& GetItems() const { return items; }
+	size_t GetCount() const { return items.size(); }
+
+	// [begin, end) of the items in a pass.  Needs the items sorted,
+	// or at least added in pass order
+	void GetPassRange(unsigned int pass, size_t& begin, size_t& end) const;
+
+	// How many times a field's value changes walking the items
+	// in their current order, counting the first item - the
+	// number of binds submission would do for that field
+	unsigned int CountChanges(unsigned int shift, unsigned int bits) const;
+
+private:
+	std::vector<DrawItem> items;
+	std::vector<DrawItem> scratch;
+};
+
+// --------------------------------------------------------
+// Sort cost against binds saved, for a synthetic scene
+// --------------------------------------------------------
+struct DrawListBenchmarkResults
+{
+	unsigned int Draws = 0;
+	double BuildMs = 0;      // Making keys and filling the list
+	double RadixSortMs = 0;
+	double StdSortMs = 0;    // std::sort of the same keys, for comparison
+	unsigned int UnsortedPipelineChanges = 0;
+	unsigned int UnsortedMaterialChanges = 0;
+	unsigned int UnsortedMeshChanges = 0;
+	unsigned int SortedPipelineChanges = 0;
+	unsigned int SortedMaterialChanges = 0;
+	unsigned int SortedMeshChanges = 0;
+};
+
+// Random draws over a handful of pipelines, materials and meshes
+DrawListBenchmarkResults DrawListBenchmark(unsigned int draws);
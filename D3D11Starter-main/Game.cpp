@@ -10,14 +10,36 @@
 #include <DirectXMath.h>
 #include "Mesh.h"
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include "Transform.h"
 #include "Entity.h"
 #include "Camera.h"
 #include "Materials.h"
 #include "Lights.h"
+#include "LightManager.h"
 #include "Sky.h"
 #include "WICTextureLoader.h"
+#include "ThreadPool.h"
+#include "ShaderStructs.h"
+#include "PixelShaderPermutations.h"
+#include "ShaderBuild.h"
+#include "D3DShaderCompiler.h"
+#include "PipelineState.h"
+#include "DrawList.h"
+#include "InstanceBatcher.h"
+#include "InstanceBuffer.h"
+#include "TextureCook.h"
+#include "MipGenerator.h"
+#include "BlockCompress.h"
+#include "TextureContainer.h"
+#include "TextureUpload.h"
+#include "TextureManager.h"
+#include "MaterialAtlas.h"
+#include "VirtualTexture.h"
+#include "ImageLighting.h"
+#include <chrono>
+#include <algorithm>
 
 // Needed for a helper function to load pre-compiled shader files
 #pragma comment(lib, "d3dcompiler.lib")
@@ -47,19 +69,243 @@ bool blur = false;
 
 
 //Lights
-std::vector<Light> lights;
-Light directionalLight1;
-Light directionalLight2;
-Light directionalLight3;
-
-Light pointLight1;
-Light pointLight2;
+std::shared_ptr<LightManager> lightManager;
 
 std::shared_ptr<Sky> skyBox;
 
+// Worker threads for load-time jobs
+std::shared_ptr<ThreadPool> threadPool;
+
+// Every pipeline and state object, deduplicated by description
+std::shared_ptr<PipelineStateCache> pipelineCache;
+
+// Compiled variants of PixelShader.hlsl, and the features the UI allows
+std::shared_ptr<PixelShaderPermutations> pixelPermutations;
+static unsigned int enabledFeatures = SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_SHADOWS | SHADER_FEATURE_IMAGE_LIGHTING;
+static const unsigned int AllShaderFeatures =
+	SHADER_FEATURE_FOG_MASK | SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_SHADOWS | SHADER_FEATURE_MATERIAL_ATLAS | SHADER_FEATURE_IMAGE_LIGHTING;
+
+// Per-object shader variables, resolved once in LoadShaders()
+static ShaderVarHandle worldHandle;
+static ShaderVarHandle worldInvTransposeHandle;
+static ShaderVarHandle shadowWorldHandle;
+
+// Where the incremental shader build put each shader, and how it went
+static ShaderManifest shaderManifest;
+static ShaderBuildResults shaderBuildResults;
+
+// Where each texture's cooked DDS went, and how long each stage took
+static TextureCookResults textureCookResults;
+static double skyLoadMs = 0;
+
+// Ambient light baked from the cooked sky: irradiance as spherical
+// harmonics in the per-frame cbuffer, prefiltered specular and the
+// BRDF LUT as textures.  Without a bake, ambient stays constant.
+static ImageLightingResults imageLightingResults;
+static Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> specularLightSRV;
+static Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> brdfLutSRV;
+static Microsoft::WRL::ComPtr<ID3D11SamplerState> imageLightSampler;
+static float imageLightIntensity = 1.0f;
+
+// Fast cooks BC1 color with quick endpoint fits; High cooks BC7
+// and refines every block.  Changing it re-cooks on the next run.
+static const BlockQuality textureQuality = BLOCK_QUALITY_HIGH;
+
+// Cooked material textures, trimmed to fit the budget by dropping
+// the top mips of whatever hasn't been seen (or needed) lately
+static std::unique_ptr<TextureManager> textureManager;
+static int textureBudgetMB = 16;
+
+// This frame's draws sorted by pass, pipeline, material and mesh,
+// and how many binds submitting them took
+static DrawList drawList;
+static DrawIdTable pipelineIds;
+static DrawIdTable materialIds;
+static DrawIdTable meshIds;
+static bool sortDraws = true;
+static unsigned int framePipelineBinds = 0;
+static unsigned int frameMaterialBinds = 0;
+static unsigned int frameMeshChanges = 0;
+
+// Draws sharing a mesh and material, batched into instanced draws
+static InstanceBatcher shadowBatches;
+static InstanceBatcher opaqueBatches;
+static std::vector<InstanceData> instanceData;
+static std::shared_ptr<InstanceBuffer> instanceBuffer;
+static bool instanceDraws = true;
+static const unsigned int MaxInstancesPerDraw = 1024;
+
+// Atlas mode: the PBR materials' textures packed into one array
+// per channel, with each material an entry in a structured buffer,
+// so entities differing only by material share an instanced draw.
+// The GPU side is only made while the mode is on.
+static const char* const AtlasChannels[] = { "Albedo", "NormalMap", "OrmMap" };
+static const unsigned int AtlasChannelCount = 3;
+static const unsigned int AtlasMaterialFeatures = SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_SHADOWS | SHADER_FEATURE_IMAGE_LIGHTING;
+static std::unique_ptr<MaterialAtlas> materialAtlas;
+static std::unordered_map<const Materials*, unsigned int> atlasMaterialIndices; // Into atlasMaterials
+static std::vector<AtlasMaterialData> atlasMaterials;
+static Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> atlasArrays[AtlasChannelCount];
+static Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> atlasMaterialsSRV;
+static bool materialAtlasMode = false;
+
+// Draw list passes, in submission order
+const unsigned int DrawPassShadow = 0;
+const unsigned int DrawPassOpaque = 1;
+
 // Shadow Map Size
 UINT shadowMapResolution = 2048;
 
+// --------------------------------------------------------
+// Hands a job's cooked DDS to the texture manager, which maps
+// it, uploads its mips in place and binds it to the slot.
+// False if it wasn't cooked or the file doesn't check out.
+// --------------------------------------------------------
+static bool LoadCookedTexture(const std::string& name, std::shared_ptr<Materials> material, const std::string& slot)
+{
+	std::filesystem::path cooked = textureCookResults.GetOutput(name);
+	if (cooked.empty())
+		return false;
+
+	if (!textureManager->Load(name, cooked, material, slot))
+	{
+		printf("Can't load cooked %s\n", cooked.string().c_str());
+		return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Loads a material's texture from its cooked DDS, falling
+// back to decoding the source through WIC (outside the
+// residency budget) if it couldn't be cooked
+// --------------------------------------------------------
+static void LoadTexture(std::shared_ptr<Materials> material, const std::string& slot, const std::string& name, const std::wstring& source)
+{
+	if (LoadCookedTexture(name, material, slot))
+		return;
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), source.c_str(), nullptr, srv.GetAddressOf());
+	material->AddTextureSRV(slot, srv);
+}
+
+// --------------------------------------------------------
+// Loads a cooked occlusion/roughness/metalness texture.  The
+// sources can't stand in for it, so if it couldn't be cooked
+// this makes a 1x1 one: unoccluded, half rough, not metal.
+// --------------------------------------------------------
+static void LoadOrmTexture(std::shared_ptr<Materials> material, const std::string& name)
+{
+	if (LoadCookedTexture(name, material, "OrmMap"))
+		return;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = 1;
+	desc.Height = 1;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	unsigned char texel[4] = { 255, 128, 0, 255 };
+	D3D11_SUBRESOURCE_DATA data = {};
+	data.pSysMem = texel;
+	data.SysMemPitch = sizeof(texel);
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	Graphics::Device->CreateTexture2D(&desc, &data, texture.GetAddressOf());
+	Graphics::Device->CreateShaderResourceView(texture.Get(), nullptr, srv.GetAddressOf());
+	material->AddTextureSRV("OrmMap", srv);
+}
+
+// --------------------------------------------------------
+// Gives a PBR material a slice in the material atlas and an
+// entry in its material buffer.  Materials whose textures
+// weren't cooked, or don't match the others' sizes and
+// formats, are left out and keep drawing on their own.
+// --------------------------------------------------------
+static void AddAtlasMaterial(std::shared_ptr<Materials> material, const std::string& name)
+{
+	std::vector<const TextureContainer*> textures = {
+		textureManager->GetContainer(name + "_albedo"),
+		textureManager->GetContainer(name + "_normals"),
+		textureManager->GetContainer(name + "_orm") };
+
+	std::string error = "Uses other shader features";
+	int slice = material->GetFeatures() == AtlasMaterialFeatures ? materialAtlas->AddMaterial(textures, error) : -1;
+	if (slice < 0)
+	{
+		printf("%s stays out of the material atlas: %s\n", name.c_str(), error.c_str());
+		return;
+	}
+
+	AtlasMaterialData data = {};
+	data.colorTint = XMFLOAT4(material->GetColor());
+	data.uvScale = XMFLOAT2(material->GetUVScale());
+	data.roughness = material->GetRoughness();
+	data.slice = (unsigned int)slice;
+	atlasMaterialIndices[material.get()] = (unsigned int)atlasMaterials.size();
+	atlasMaterials.push_back(data);
+}
+
+// --------------------------------------------------------
+// Uploads the atlas arrays straight from the mapped files,
+// with every mip, and the material buffer.  These sit outside
+// the residency budget.  False (with nothing kept) if there's
+// nothing to pack or an upload fails.
+// --------------------------------------------------------
+static bool CreateMaterialAtlasResources()
+{
+	if (atlasMaterials.empty())
+		return false;
+
+	for (unsigned int c = 0; c < AtlasChannelCount; c++)
+	{
+		if (!CreateTextureArray(materialAtlas->GetArrayDescription(c), materialAtlas->GetArraySubresources(c), atlasArrays[c]))
+		{
+			for (auto& array : atlasArrays)
+				array.Reset();
+			return false;
+		}
+	}
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.ByteWidth = sizeof(AtlasMaterialData) * (unsigned int)atlasMaterials.size();
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	desc.StructureByteStride = sizeof(AtlasMaterialData);
+
+	D3D11_SUBRESOURCE_DATA data = {};
+	data.pSysMem = atlasMaterials.data();
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.NumElements = (unsigned int)atlasMaterials.size();
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	if (FAILED(Graphics::Device->CreateBuffer(&desc, &data, buffer.GetAddressOf())) ||
+		FAILED(Graphics::Device->CreateShaderResourceView(buffer.Get(), &srvDesc, atlasMaterialsSRV.ReleaseAndGetAddressOf())))
+	{
+		for (auto& array : atlasArrays)
+			array.Reset();
+		return false;
+	}
+	return true;
+}
+
+static void ReleaseMaterialAtlasResources()
+{
+	for (auto& array : atlasArrays)
+		array.Reset();
+	atlasMaterialsSRV.Reset();
+}
+
 // --------------------------------------------------------
 // Called once per program, after the window and graphics API
 // are initialized but before the game loop begins
@@ -77,44 +323,46 @@ void Game::Initialize()
 
 
 	// Lights
-	directionalLight1 = {};
+	lightManager = std::make_shared<LightManager>();
+
+	Light directionalLight1 = {};
 	directionalLight1.Type = LIGHT_TYPE_DIRECTIONAL;
 	directionalLight1.Direction = XMFLOAT3(0.0f, -1.0f, 0.0f);
 	directionalLight1.Color = XMFLOAT3(1.0f, 0.0f, 0.0f);
 	directionalLight1.Intensity = 1.0f;
-	lights.push_back(directionalLight1);
+	lightManager->AddLight(directionalLight1);
 
-	directionalLight2 = {};
+	Light directionalLight2 = {};
 	directionalLight2.Type = LIGHT_TYPE_DIRECTIONAL;
 	directionalLight2.Direction = XMFLOAT3(0.0f, 0.0f, -1.0f);
 	directionalLight2.Color = XMFLOAT3(0.0f, 0.0f, 1.0f);
 	directionalLight2.Intensity = 1.0f;
-	lights.push_back(directionalLight2);
+	lightManager->AddLight(directionalLight2);
 
-	directionalLight3 = {};
+	Light directionalLight3 = {};
 	directionalLight3.Type = LIGHT_TYPE_DIRECTIONAL;
 	directionalLight3.Direction = XMFLOAT3(0.0f, 1.0f, 0.0f);
-	directionalLight3.Color = XMFLOAT3(0.0f, .4f, 0.0f);
+	directionalLight3.Color = XMFLOAT3(0.0f, 1.0f, 0.0f);
 	directionalLight3.Intensity = 1.0f;
-	lights.push_back(directionalLight3);
+	lightManager->AddLight(directionalLight3);
 
-	pointLight1 = {};
+	Light pointLight1 = {};
 	pointLight1.Type = LIGHT_TYPE_POINT;
 	pointLight1.Range = 5.0f;
 	pointLight1.Position = XMFLOAT3(-4.0f, 0.0f, 2.0f);
 	pointLight1.Direction = XMFLOAT3(0.0f, 0.0f, 1.0f);
 	pointLight1.Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
 	pointLight1.Intensity = 1.0f;
-	lights.push_back(pointLight1);
+	lightManager->AddLight(pointLight1);
 
-	pointLight2 = {};
+	Light pointLight2 = {};
 	pointLight2.Type = LIGHT_TYPE_POINT;
 	pointLight2.Range = 5.0f;
 	pointLight2.Position = XMFLOAT3(-4.0f, -4.0f, 2.0f);
 	pointLight2.Direction = XMFLOAT3(0.0f, 0.0f, 1.0f);
 	pointLight2.Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
 	pointLight2.Intensity = 1.0f;
-	lights.push_back(pointLight2);
+	lightManager->AddLight(pointLight2);
 
 	// Camera
 	std::shared_ptr<Camera> camera1 = std::make_shared<Camera>((float)Window::Width() / Window::Height(), XMFLOAT3(0.0f, 0.0f, -10.0f));
@@ -130,10 +378,35 @@ void Game::Initialize()
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
+	threadPool = std::make_shared<ThreadPool>();
+	pipelineCache = std::make_shared<PipelineStateCache>();
+	ISimpleShader::States = Graphics::States;
+	instanceBuffer = std::make_shared<InstanceBuffer>();
+	BuildShaders();
 	LoadShaders();
+	CookTextures();
+	BakeImageLighting();
+	textureManager = std::make_unique<TextureManager>((size_t)textureBudgetMB * 1024 * 1024);
+
+	// Every fog/normal map/shadow combination of the main pixel shader,
+	// compiled from source (or pulled from the cache) in parallel
+	pixelPermutations = std::make_shared<PixelShaderPermutations>(
+		Graphics::Device, Graphics::Context,
+		FixPath(L"../../PixelShader.hlsl"),
+		FixPath(L"ShaderCache"),
+		pixelShader);
+	pixelPermutations->Build(EnumerateShaderFeatureMasks(AllShaderFeatures), *threadPool);
+	printf("Built %zu pixel shader permutations in %.2f ms (%u compiled, %u cached, %u failed)\n",
+		pixelPermutations->GetPermutationCount(), pixelPermutations->GetBuildMilliseconds(),
+		pixelPermutations->GetCompiledCount(), pixelPermutations->GetCachedCount(), pixelPermutations->GetFailedCount());
+
+	// Shared ring for constant data, if the device can bind constant buffers by offset
+	std::shared_ptr<ConstantBufferRing> constantRing = std::make_shared<ConstantBufferRing>(Graphics::Device, Graphics::Context, 1024 * 1024);
+	if (constantRing->IsSupported())
+		ISimpleShader::ConstantRing = constantRing;
 
 	// Sample State
-	D3D11_SAMPLER_DESC samplerDesc = {};
+	SamplerStateDesc samplerDesc;
 	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
 	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
 	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -141,17 +414,23 @@ void Game::Initialize()
 	samplerDesc.Filter = D3D11_FILTER_ANISOTROPIC;
 	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 
-	Graphics::Device->CreateSamplerState(&samplerDesc, &sampleS);
+	sampleS = pipelineCache->GetSamplerState(samplerDesc);
 
 	// Post Process Sampler
-	D3D11_SAMPLER_DESC postSampDesc = {};
+	SamplerStateDesc postSampDesc;
 	postSampDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
 	postSampDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
 	postSampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
 	postSampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
 	postSampDesc.MaxLOD = D3D11_FLOAT32_MAX;
 
-	Graphics::Device->CreateSamplerState(&postSampDesc, postSampler.GetAddressOf());
+	postSampler = pipelineCache->GetSamplerState(postSampDesc);
+
+	// Post process pass - a fullscreen triangle with default state
+	PipelineStateDesc postDesc;
+	postDesc.VertexShader = postVS;
+	postDesc.PixelShader = postPS;
+	postPipeline = pipelineCache->Get(postDesc);
 
 	// Post Process Resources
 	PostSetup();
@@ -159,7 +438,7 @@ void Game::Initialize()
 	shadowDSV.Reset();
 	shadowSRV.Reset();
 	shadowSampler.Reset();
-	shadowRasterizer.Reset();
+	shadowPipeline.reset();
 
 	// Shadow Map Desc
 	D3D11_TEXTURE2D_DESC shadowDesc = {};
@@ -201,7 +480,7 @@ void Game::Initialize()
 	);
 
 	// Shadow Sampler
-	D3D11_SAMPLER_DESC shadowSampDesc = {};
+	SamplerStateDesc shadowSampDesc;
 	shadowSampDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
 	shadowSampDesc.ComparisonFunc = D3D11_COMPARISON_LESS;
 	shadowSampDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
@@ -211,16 +490,21 @@ void Game::Initialize()
 	shadowSampDesc.BorderColor[1] = 1.0f;
 	shadowSampDesc.BorderColor[2] = 1.0f;
 	shadowSampDesc.BorderColor[3] = 1.0f;
-	Graphics::Device->CreateSamplerState(&shadowSampDesc, &shadowSampler);
+	shadowSampler = pipelineCache->GetSamplerState(shadowSampDesc);
+
+	// Shadow Pipeline - depth only, with a biased rasterizer
+	PipelineStateDesc shadowDesc;
+	shadowDesc.VertexShader = shadowVS;
+	shadowDesc.PixelShader = 0;
+	shadowDesc.Raster.FillMode = D3D11_FILL_SOLID;
+	shadowDesc.Raster.CullMode = D3D11_CULL_BACK;
+	shadowDesc.Raster.DepthClipEnable = true;
+	shadowDesc.Raster.DepthBias = 1000; // Multiplied by (smallest possible positive value storable in the depth buffer)
+	shadowDesc.Raster.SlopeScaledDepthBias = 1.0f;
+	shadowPipeline = pipelineCache->Get(shadowDesc);
 
-	// Shadow Rasterizer
-	D3D11_RASTERIZER_DESC shadowRastDesc = {};
-	shadowRastDesc.FillMode = D3D11_FILL_SOLID;
-	shadowRastDesc.CullMode = D3D11_CULL_BACK;
-	shadowRastDesc.DepthClipEnable = true;
-	shadowRastDesc.DepthBias = 1000; // Multiplied by (smallest possible positive value storable in the depth buffer)
-	shadowRastDesc.SlopeScaledDepthBias = 1.0f;
-	Graphics::Device->CreateRasterizerState(&shadowRastDesc, &shadowRasterizer);
+	shadowDesc.VertexShader = instancedShadowVS;
+	instancedShadowPipeline = pipelineCache->Get(shadowDesc);
 
 
 	// Matrices for shadow rendering
@@ -264,60 +548,62 @@ void Game::Initialize()
 	std::shared_ptr<Materials> position = std::make_shared<Materials>(noTint, 0.0f, vertexShader, customPS, 0, standardSize);
 
 	// Texture 1 
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/PBR/cobblestone_albedo.png").c_str(), nullptr, &cobbleAlbedoSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/PBR/cobblestone_metal.png").c_str(), nullptr, &cobbleMetalSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/PBR/cobblestone_normals.png").c_str(), nullptr, &cobbleNormalSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/PBR/cobblestone_roughness.png").c_str(), nullptr, &cobbleRoughSRV);
-
-	mat1->AddTextureSRV("Albedo", cobbleAlbedoSRV);
-	mat1->AddTextureSRV("NormalMap", cobbleNormalSRV);
-	mat1->AddTextureSRV("RoughnessMap", cobbleRoughSRV);
-	mat1->AddTextureSRV("MetallnessMap", cobbleMetalSRV);
+	LoadTexture(mat1, "Albedo", "cobblestone_albedo", FixPath(L"../../Assets/PBR/cobblestone_albedo.png"));
+	LoadTexture(mat1, "NormalMap", "cobblestone_normals", FixPath(L"../../Assets/PBR/cobblestone_normals.png"));
+	LoadOrmTexture(mat1, "cobblestone_orm");
 	mat1->AddSampler("BasicSampler", sampleS);
 
 
 	// Texture 2
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/PBR/scratched_albedo.png").c_str(), nullptr, &scratchedAlbedoSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/PBR/scratched_metal.png").c_str(), nullptr, &scratchedMetalSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/PBR/scratched_normals.png").c_str(), nullptr, &scratchedNormalSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/PBR/scratched_roughness.png").c_str(), nullptr, &scratchedRoughSRV);
-
-	mat2->AddTextureSRV("Albedo", scratchedAlbedoSRV);
-	mat2->AddTextureSRV("NormalMap", scratchedNormalSRV);
-	mat2->AddTextureSRV("RoughnessMap", scratchedRoughSRV);
-	mat2->AddTextureSRV("MetallnessMap", scratchedMetalSRV);
+	LoadTexture(mat2, "Albedo", "scratched_albedo", FixPath(L"../../Assets/PBR/scratched_albedo.png"));
+	LoadTexture(mat2, "NormalMap", "scratched_normals", FixPath(L"../../Assets/PBR/scratched_normals.png"));
+	LoadOrmTexture(mat2, "scratched_orm");
 	mat2->AddSampler("BasicSampler", sampleS);
 
 
 	// Texture 3
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/PBR/wood_albedo.png").c_str(), nullptr, &woodAlbedoSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/PBR/wood_metal.png").c_str(), nullptr, &woodMetalSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/PBR/wood_normals.png").c_str(), nullptr, &woodNormalSRV);
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/PBR/wood_roughness.png").c_str(), nullptr, &woodRoughSRV);
-
-	mat3->AddTextureSRV("Albedo", woodAlbedoSRV);
-	mat3->AddTextureSRV("NormalMap", woodNormalSRV);
-	mat3->AddTextureSRV("RoughnessMap", woodRoughSRV);
-	mat3->AddTextureSRV("MetallnessMap", woodMetalSRV);
+	LoadTexture(mat3, "Albedo", "wood_albedo", FixPath(L"../../Assets/PBR/wood_albedo.png"));
+	LoadTexture(mat3, "NormalMap", "wood_normals", FixPath(L"../../Assets/PBR/wood_normals.png"));
+	LoadOrmTexture(mat3, "wood_orm");
 	mat3->AddSampler("BasicSampler", sampleS);
 
+	// The PBR materials pick a PixelShader.hlsl permutation each frame
+	mat1->SetFeatures(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_SHADOWS | SHADER_FEATURE_IMAGE_LIGHTING);
+	mat2->SetFeatures(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_SHADOWS | SHADER_FEATURE_IMAGE_LIGHTING);
+	mat3->SetFeatures(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_SHADOWS | SHADER_FEATURE_IMAGE_LIGHTING);
+
 	mats.push_back(mat1);
 	mats.push_back(mat2);
 	mats.push_back(mat3);
+
+	// Slices for atlas mode, same order as the cooked textures
+	materialAtlas = std::make_unique<MaterialAtlas>(AtlasChannelCount);
+	AddAtlasMaterial(mat1, "cobblestone");
+	AddAtlasMaterial(mat2, "scratched");
+	AddAtlasMaterial(mat3, "wood");
 	mats.push_back(normal);
 	mats.push_back(uv);
 	mats.push_back(position);
 
-	// Sky
+	// Sky - the cooked cube map if there is one, otherwise the six source faces
+	auto skyStart = std::chrono::high_resolution_clock::now();
 	std::shared_ptr<Mesh> cube = std::make_shared<Mesh>((FixPath(L"../../Assets/Models/cube.obj").c_str()));
-	std::shared_ptr<Sky> sky = std::make_shared<Sky>(cube, sampleS, skyPS, skyVS,
-		FixPath(L"../../Assets/Skies/Clouds Pink/right.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds Pink/left.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds Pink/up.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds Pink/down.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds Pink/front.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds Pink/back.png").c_str());
+	std::shared_ptr<Sky> sky;
+	std::filesystem::path skyCubemap = textureCookResults.GetOutput("sky");
+	if (!skyCubemap.empty())
+		sky = std::make_shared<Sky>(cube, sampleS, skyPS, skyVS, pipelineCache, skyCubemap.c_str());
+	if (!sky || !sky->IsLoaded())
+	{
+		sky = std::make_shared<Sky>(cube, sampleS, skyPS, skyVS, pipelineCache,
+			FixPath(L"../../Assets/Skies/Clouds Pink/right.png").c_str(),
+			FixPath(L"../../Assets/Skies/Clouds Pink/left.png").c_str(),
+			FixPath(L"../../Assets/Skies/Clouds Pink/up.png").c_str(),
+			FixPath(L"../../Assets/Skies/Clouds Pink/down.png").c_str(),
+			FixPath(L"../../Assets/Skies/Clouds Pink/front.png").c_str(),
+			FixPath(L"../../Assets/Skies/Clouds Pink/back.png").c_str());
+	}
 	skyBox = sky;
+	skyLoadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - skyStart).count();
 
 
 	CreateGeometry();
@@ -352,6 +638,16 @@ void Game::Initialize()
 // --------------------------------------------------------
 Game::~Game()
 {
+	ISimpleShader::ConstantRing.reset();
+	ISimpleShader::States.reset();
+	instanceBuffer.reset();
+	specularLightSRV.Reset();
+	brdfLutSRV.Reset();
+	imageLightSampler.Reset();
+	pixelPermutations.reset();
+	pipelineCache.reset();
+	threadPool.reset();
+
 	ImGui_ImplDX11_Shutdown();
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
@@ -368,28 +664,273 @@ Game::~Game()
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
-	vertexShader = std::make_shared<SimpleVertexShader>(Graphics::Device,
-		Graphics::Context, FixPath(L"VertexShader.cso").c_str());
-	pixelShader = std::make_shared<SimplePixelShader>(Graphics::Device,
-		Graphics::Context, FixPath(L"PixelShader.cso").c_str());
-	customPS = std::make_shared<SimplePixelShader>(Graphics::Device,
-		Graphics::Context, FixPath(L"customPS.cso").c_str());
-	normalPS = std::make_shared<SimplePixelShader>(Graphics::Device,
-		Graphics::Context, FixPath(L"normalPS.cso").c_str());
-	uvPS = std::make_shared<SimplePixelShader>(Graphics::Device,
-		Graphics::Context, FixPath(L"uvPS.cso").c_str());
-	skyPS = std::make_shared<SimplePixelShader>(Graphics::Device,
-		Graphics::Context, FixPath(L"SkyPixelShader.cso").c_str());
-	skyVS = std::make_shared<SimpleVertexShader>(Graphics::Device,
-		Graphics::Context, FixPath(L"SkyVertexShader.cso").c_str());
-	shadowVS = std::make_shared<SimpleVertexShader>(Graphics::Device,
-		Graphics::Context, FixPath(L"ShadowMapVertexShader.cso").c_str());
-	shadowPS = std::make_shared<SimplePixelShader>(Graphics::Device,
-		Graphics::Context, FixPath(L"ShadowMapPixelShader.cso").c_str());
-	postPS = std::make_shared<SimplePixelShader>(Graphics::Device,
-		Graphics::Context, FixPath(L"PostPS.cso").c_str());
-	postVS = std::make_shared<SimpleVertexShader>(Graphics::Device,
-		Graphics::Context, FixPath(L"PostVS.cso").c_str());
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Each shader reads its file, checks its reflection cache and
+	// creates its D3D objects on a pool thread.  Device creation
+	// calls are free-threaded and the shader constructors don't
+	// use the context, so they can all run at once.  Each task
+	// writes a different member, and everything is joined below.
+	std::vector<std::future<double>> loads;
+	auto load = [&]<typename T>(std::shared_ptr<T>& shader, const wchar_t* file)
+	{
+		// Prefer the newest build from the manifest over the project's .cso
+		std::filesystem::path built = shaderManifest.GetOutputPath(std::filesystem::path(file).stem().string());
+		std::wstring path = !built.empty() && std::filesystem::exists(built) ? built.wstring() : FixPath(file);
+		loads.push_back(threadPool->Submit([&shader, path]()
+		{
+			auto taskStart = std::chrono::high_resolution_clock::now();
+			shader = std::make_shared<T>(Graphics::Device, Graphics::Context, path.c_str());
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - taskStart).count();
+		}));
+	};
+
+	load(vertexShader, L"VertexShader.cso");
+	load(instancedVS, L"InstancedVertexShader.cso");
+	load(pixelShader, L"PixelShader.cso");
+	load(customPS, L"customPS.cso");
+	load(normalPS, L"normalPS.cso");
+	load(uvPS, L"uvPS.cso");
+	load(skyPS, L"SkyPixelShader.cso");
+	load(skyVS, L"SkyVertexShader.cso");
+	load(shadowVS, L"ShadowMapVertexShader.cso");
+	load(instancedShadowVS, L"InstancedShadowVertexShader.cso");
+	load(shadowPS, L"ShadowMapPixelShader.cso");
+	load(postPS, L"PostPS.cso");
+	load(postVS, L"PostVS.cso");
+
+	// Join before anything uses the shaders
+	double slowest = 0.0;
+	double totalWork = 0.0;
+	for (std::future<double>& l : loads)
+	{
+		double ms = l.get();
+		totalWork += ms;
+		if (ms > slowest) slowest = ms;
+	}
+
+	// Per-object variables are set on every draw, so look them up once here
+	worldHandle = vertexShader->GetVariableHandle("world");
+	worldInvTransposeHandle = vertexShader->GetVariableHandle("worldInvTranspose");
+	shadowWorldHandle = shadowVS->GetVariableHandle("world");
+
+	// Check every cbuffer struct against the shaders it's used with
+	// now, rather than at the first SetBufferData() mid-frame.  Each
+	// mismatch is logged, so don't stop at the first one.
+	bool layoutsValid = true;
+	layoutsValid &= vertexShader->ValidateBufferLayout<PerFrameVSData>();
+	layoutsValid &= vertexShader->ValidateBufferLayout<PerObjectVSData>();
+	layoutsValid &= instancedVS->ValidateBufferLayout<PerFrameVSData>();
+	layoutsValid &= pixelShader->ValidateBufferLayout<PerFramePSData>();
+	layoutsValid &= pixelShader->ValidateBufferLayout<PerMaterialPSData>();
+	layoutsValid &= customPS->ValidateBufferLayout<PerMaterialPSData>();
+	layoutsValid &= normalPS->ValidateBufferLayout<PerMaterialPSData>();
+	layoutsValid &= uvPS->ValidateBufferLayout<PerMaterialPSData>();
+	layoutsValid &= skyVS->ValidateBufferLayout<SkyVSData>();
+	layoutsValid &= shadowVS->ValidateBufferLayout<ShadowPerFrameVSData>();
+	layoutsValid &= shadowVS->ValidateBufferLayout<ShadowPerObjectVSData>();
+	layoutsValid &= instancedShadowVS->ValidateBufferLayout<ShadowPerFrameVSData>();
+	layoutsValid &= postPS->ValidateBufferLayout<PostPSData>();
+	if (!layoutsValid)
+		printf("Some cbuffer structs in ShaderStructs.h don't match their shaders\n");
+
+	double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	printf("Loaded %zu shaders in %.2f ms on %u threads (slowest shader %.2f ms, %.2f ms of work)\n",
+		loads.size(), elapsed, threadPool->GetThreadCount(), slowest, totalWork);
+}
+
+
+// --------------------------------------------------------
+// Recompiles any shader whose source, includes or defines
+// changed since the last run, so editing ShaderIncludes.hlsli
+// only rebuilds the shaders that use it.  The results are
+// listed in a manifest that LoadShaders() checks first.
+//
+// Skipped when the sources aren't alongside the executable,
+// in which case any existing manifest is still used.
+// --------------------------------------------------------
+void Game::BuildShaders()
+{
+	std::filesystem::path sourceDirectory = FixPath(L"../../");
+	ShaderBuilder builder(FixPath(L"ShaderBuild"));
+
+	if (std::filesystem::exists(sourceDirectory / "ShaderIncludes.hlsli"))
+	{
+		struct { const char* Name; const char* Target; } shaders[] =
+		{
+			{ "VertexShader", "vs_5_0" },
+			{ "InstancedVertexShader", "vs_5_0" },
+			{ "PixelShader", "ps_5_0" },
+			{ "customPS", "ps_5_0" },
+			{ "normalPS", "ps_5_0" },
+			{ "uvPS", "ps_5_0" },
+			{ "SkyPixelShader", "ps_5_0" },
+			{ "SkyVertexShader", "vs_5_0" },
+			{ "ShadowMapVertexShader", "vs_5_0" },
+			{ "InstancedShadowVertexShader", "vs_5_0" },
+			{ "ShadowMapPixelShader", "ps_5_0" },
+			{ "PostPS", "ps_5_0" },
+			{ "PostVS", "vs_5_0" },
+		};
+
+		std::vector<ShaderCompileJob> jobs;
+		for (auto& shader : shaders)
+		{
+			ShaderCompileJob job;
+			job.Name = shader.Name;
+			job.Source = sourceDirectory / (std::string(shader.Name) + ".hlsl");
+			job.Target = shader.Target;
+			jobs.push_back(job);
+		}
+
+		D3DShaderCompiler compiler;
+		shaderBuildResults = builder.Build(jobs, compiler, *threadPool);
+
+		printf("Shader build: %u compiled, %u up to date, %u failed in %.2f ms\n",
+			shaderBuildResults.Compiled, shaderBuildResults.UpToDate, shaderBuildResults.Failed, shaderBuildResults.Milliseconds);
+		for (const std::filesystem::path& include : builder.GetDependencyGraph().GetIncludedFiles())
+			printf("  %s is used by %zu files\n", include.filename().string().c_str(), builder.GetDependencyGraph().GetDependents(include).size());
+		for (const std::string& error : shaderBuildResults.Errors)
+			printf("%s\n", error.c_str());
+	}
+
+	shaderManifest.Load(builder.GetManifestPath());
+}
+
+// --------------------------------------------------------
+// Decodes the PNG textures on the thread pool and writes
+// each one out as a DDS with its mip chain, named by a hash
+// of the source.  Later runs find the DDS already there and
+// load it directly, skipping the decode altogether.
+// --------------------------------------------------------
+void Game::CookTextures()
+{
+	std::vector<TextureCookJob> jobs;
+
+	// Albedo is gamma-encoded (PixelShader.hlsl decodes it with pow)
+	const char* materials[] = { "cobblestone", "scratched", "wood" };
+	struct { const char* Name; TextureUsage Usage; } maps[] =
+	{
+		{ "albedo", TEXTURE_USAGE_COLOR },
+		{ "normals", TEXTURE_USAGE_NORMAL },
+	};
+	for (const char* material : materials)
+	{
+		std::string path = "../../Assets/PBR/" + std::string(material);
+		for (auto& map : maps)
+		{
+			TextureCookJob job;
+			job.Name = std::string(material) + "_" + map.Name;
+			job.Source = FixPath(path + "_" + map.Name + ".png");
+			job.Settings.Usage = map.Usage;
+			job.Settings.Compress = true;
+			job.Settings.Quality = textureQuality;
+			jobs.push_back(job);
+		}
+
+		// Roughness and metalness (and occlusion, where a material
+		// has it) share one texture; its roughness mips widen
+		// wherever the normal map's detail is lost
+		TextureCookJob orm;
+		orm.Name = std::string(material) + "_orm";
+		orm.Source = FixPath(path + "_roughness.png");
+		orm.MetalnessSource = FixPath(path + "_metal.png");
+		orm.NormalSource = FixPath(path + "_normals.png");
+		if (std::filesystem::exists(FixPath(path + "_ao.png")))
+			orm.OcclusionSource = FixPath(path + "_ao.png");
+		orm.Settings.Usage = TEXTURE_USAGE_ORM;
+		orm.Settings.Compress = true;
+		orm.Settings.Quality = textureQuality;
+		jobs.push_back(orm);
+	}
+
+	// The sky cooks into one cube map with welded mips, so it
+	// doesn't shimmer or show its seams
+	TextureCookJob sky;
+	sky.Name = "sky";
+	for (const char* face : { "right", "left", "up", "down", "front", "back" })
+		sky.CubeFaces.push_back(FixPath(std::string("../../Assets/Skies/Clouds Pink/") + face + ".png"));
+	sky.Settings.Usage = TEXTURE_USAGE_COLOR;
+	sky.Settings.Compress = true;
+	sky.Settings.Quality = textureQuality;
+	jobs.push_back(sky);
+
+	TextureCooker cooker(FixPath(L"TextureCache"));
+	textureCookResults = cooker.Cook(jobs, *threadPool);
+
+	printf("Texture cook: %u cooked, %u cached, %u failed in %.2f ms\n",
+		textureCookResults.Cooked, textureCookResults.Cached, textureCookResults.Failed, textureCookResults.Milliseconds);
+	for (const TextureCookReport& report : textureCookResults.Reports)
+	{
+		if (!report.Error.empty())
+			printf("  %s\n", report.Error.c_str());
+		else if (!report.Cached)
+			printf("  %s: %ux%u %s, %u mips, %.1f dB - decode %.2f ms, mips %.2f ms, compress %.2f ms, write %.2f ms\n",
+				report.Name.c_str(), report.Width, report.Height, GetDdsFormatName(report.Format), report.MipCount, report.Psnr,
+				report.DecodeMs, report.MipMs, report.CompressMs, report.WriteMs);
+
+		if (report.SeparateBytes > 0 && report.Error.empty())
+			printf("  %s: %zu bytes packed, %zu as separate maps\n", report.Name.c_str(), report.Bytes, report.SeparateBytes);
+	}
+}
+
+
+// --------------------------------------------------------
+// Bakes the ambient lighting from the cooked sky cube map:
+// irradiance harmonics for the per-frame constants, plus the
+// prefiltered specular cube and BRDF LUT.  Cached like the
+// cook, by a hash of the sky.  Without a cooked sky the
+// shaders keep their constant ambient.
+// --------------------------------------------------------
+void Game::BakeImageLighting()
+{
+	std::filesystem::path sky = textureCookResults.GetOutput("sky");
+	if (sky.empty())
+	{
+		printf("Image lighting: no cooked sky, using constant ambient\n");
+		enabledFeatures &= ~SHADER_FEATURE_IMAGE_LIGHTING;
+		return;
+	}
+
+	ImageLightingBaker baker(FixPath(L"TextureCache"));
+	imageLightingResults = baker.Bake(sky, ImageLightingSettings(), threadPool.get());
+	if (!imageLightingResults.Error.empty())
+	{
+		printf("Image lighting: %s\n", imageLightingResults.Error.c_str());
+		enabledFeatures &= ~SHADER_FEATURE_IMAGE_LIGHTING;
+		return;
+	}
+
+	if (imageLightingResults.Cached)
+		printf("Image lighting: cached in %.2f ms\n", imageLightingResults.Milliseconds);
+	else
+		printf("Image lighting: baked in %.2f ms - load %.2f ms, irradiance %.2f ms, specular %.2f ms, BRDF %.2f ms, write %.2f ms\n",
+			imageLightingResults.Milliseconds, imageLightingResults.LoadMs, imageLightingResults.IrradianceMs,
+			imageLightingResults.SpecularMs, imageLightingResults.BrdfMs, imageLightingResults.WriteMs);
+
+	// Both maps go up as they were written
+	std::string error;
+	TextureContainer specular;
+	TextureContainer brdf;
+	if (!specular.Open(imageLightingResults.Specular, error) || !CreateTextureFromContainer(specular, specularLightSRV) ||
+		!brdf.Open(imageLightingResults.BrdfLut, error) || !CreateTextureFromContainer(brdf, brdfLutSRV))
+	{
+		printf("Image lighting: can't load the baked maps %s\n", error.c_str());
+		specularLightSRV.Reset();
+		brdfLutSRV.Reset();
+		enabledFeatures &= ~SHADER_FEATURE_IMAGE_LIGHTING;
+		return;
+	}
+
+	// Trilinear and clamped, so rough reflections blend between
+	// mips and the LUT's edges don't wrap
+	SamplerStateDesc clampDesc;
+	clampDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	clampDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	clampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	clampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	clampDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	imageLightSampler = pipelineCache->GetSamplerState(clampDesc);
 }
 
 
@@ -587,11 +1128,6 @@ void ImGuiUpdate(float deltaTime)
 
 }
 
-static float dir1col[4] = { 1,0,0,0 };
-static float dir2col[4] = { 0,0,1,0 };
-static float dir3col[4] = { 0,1,0,0 };
-static float point1col[4] = { 1,1,1,0 };
-static float point2col[4] = { 1,1,1,0 };
 static int blurAmount = 0;
 static int fogType = 0;
 static float fogColor[4] = { 0.5f, 0.5f, 0.5f };
@@ -605,6 +1141,13 @@ void Game::BuildUI()
 	ImGui::SeparatorText("Display Info");
 	ImGui::Text("Frame rate: %f fps", ImGui::GetIO().Framerate);
 	ImGui::Text("Res: %dx%d", Window::Width(), Window::Height());
+	ImGui::Text("CB uploads: %u (%u bytes)", ISimpleShader::UploadStats.BuffersUploaded, ISimpleShader::UploadStats.BytesUploaded);
+	ImGui::Text("CB skipped: %u unchanged, %u no-op sets", ISimpleShader::UploadStats.BuffersSkipped, ISimpleShader::UploadStats.NoOpSets);
+	ImGui::Text("Reflection cache: %u hits, %u misses", ISimpleShader::ReflectionCacheHits.load(), ISimpleShader::ReflectionCacheMisses.load());
+	if (ISimpleShader::ConstantRing)
+		ImGui::Text("CB ring: %u uploads, %u fallbacks", ISimpleShader::UploadStats.RingUploads, ISimpleShader::UploadStats.FallbackUploads);
+	else
+		ImGui::Text("CB ring: not supported");
 
 	ImGui::SeparatorText("Shadow Map Texture");
 	ImGui::Image(shadowSRV.Get(), ImVec2(512, 512));
@@ -620,18 +1163,210 @@ void Game::BuildUI()
 	ImGui::SliderFloat("End Fog Distance", &fogEnd, 0.0f, 100.0f);
 	ImGui::SliderFloat("Fog Density", &fogDensity, 0.0f,1.0f);
 
+	ImGui::SeparatorText("Shader Permutations");
+	ImGui::CheckboxFlags("Normal Maps", &enabledFeatures, SHADER_FEATURE_NORMAL_MAP);
+	ImGui::CheckboxFlags("Shadows", &enabledFeatures, SHADER_FEATURE_SHADOWS);
+	ImGui::BeginDisabled(!specularLightSRV);
+	ImGui::CheckboxFlags("Image-Based Lighting", &enabledFeatures, SHADER_FEATURE_IMAGE_LIGHTING);
+	ImGui::EndDisabled();
+	ImGui::SetItemTooltip("Ambient from the sky's baked irradiance and prefiltered reflections, instead of a constant");
+	ImGui::SliderFloat("Sky Light", &imageLightIntensity, 0.0f, 2.0f);
+	ImGui::Text("Permutations: %zu (%u compiled, %u cached, %u failed)",
+		pixelPermutations->GetPermutationCount(), pixelPermutations->GetCompiledCount(),
+		pixelPermutations->GetCachedCount(), pixelPermutations->GetFailedCount());
+	ImGui::Text("Last build: %.2f ms", pixelPermutations->GetBuildMilliseconds());
+	if (ImGui::Button("Rebuild Permutations"))
+	{
+		pixelPermutations->Build(EnumerateShaderFeatureMasks(AllShaderFeatures), *threadPool);
+	}
+	ImGui::SetItemTooltip("Recompiles only the permutations whose source, includes or defines changed");
+
+	ImGui::SeparatorText("Shader Build");
+	ImGui::Text("%u compiled, %u up to date, %u failed in %.2f ms",
+		shaderBuildResults.Compiled, shaderBuildResults.UpToDate, shaderBuildResults.Failed, shaderBuildResults.Milliseconds);
+	ImGui::SetItemTooltip("Shaders are rebuilt at startup when their source, includes or defines change");
+	for (const std::string& name : shaderBuildResults.CompiledNames)
+		ImGui::BulletText("Rebuilt %s", name.c_str());
+
+	ImGui::SeparatorText("Texture Cook");
+	ImGui::Text("%u cooked, %u cached, %u failed in %.2f ms",
+		textureCookResults.Cooked, textureCookResults.Cached, textureCookResults.Failed, textureCookResults.Milliseconds);
+	ImGui::SetItemTooltip("Textures are re-cooked when their source or cook settings change");
+
+	// Everything but the sky came from Assets/PBR
+	size_t pbrBytes = 0, pbrUncompressedBytes = 0;
+	for (const TextureCookReport& report : textureCookResults.Reports)
+	{
+		if (report.Name != "sky")
+		{
+			pbrBytes += report.Bytes;
+			pbrUncompressedBytes += report.UncompressedBytes;
+		}
+	}
+	if (pbrUncompressedBytes > 0)
+	{
+		ImGui::Text("Assets/PBR: %.1f MB as RGBA8, %.1f MB compressed (%.0f%% saved)",
+			pbrUncompressedBytes / 1048576.0, pbrBytes / 1048576.0, 100.0 * (1.0 - (double)pbrBytes / pbrUncompressedBytes));
+	}
+
+	for (const TextureCookReport& report : textureCookResults.Reports)
+	{
+		if (report.Name == "sky" && !report.Output.empty())
+		{
+			ImGui::Text("Sky: %ux%u cube map, %u mips, %.1f MB, loaded in %.2f ms",
+				report.Width, report.Height, report.MipCount, report.Bytes / 1048576.0, skyLoadMs);
+			ImGui::SetItemTooltip("All six faces in one cooked file - mapped and created in a single call");
+		}
+	}
+
+	if (specularLightSRV)
+	{
+		if (imageLightingResults.Cached)
+			ImGui::Text("Sky lighting: %u specular mips, cached in %.2f ms", imageLightingResults.SpecularMips, imageLightingResults.Milliseconds);
+		else
+			ImGui::Text("Sky lighting: %u specular mips, baked in %.2f ms", imageLightingResults.SpecularMips, imageLightingResults.Milliseconds);
+		ImGui::SetItemTooltip("Irradiance harmonics, GGX-prefiltered reflections and the BRDF LUT, read back while the sky is unchanged");
+	}
+
+	// Packed maps replace a roughness and a metalness texture each
+	unsigned int ormCount = 0;
+	size_t ormBytes = 0, ormSeparateBytes = 0;
+	for (const TextureCookReport& report : textureCookResults.Reports)
+	{
+		if (report.SeparateBytes > 0 && !report.Output.empty())
+		{
+			ormCount++;
+			ormBytes += report.Bytes;
+			ormSeparateBytes += report.SeparateBytes;
+		}
+	}
+	if (ormCount > 0)
+	{
+		ImGui::Text("ORM: %u materials, 1 sample each instead of 2, %.2f MB packed vs %.2f MB separate",
+			ormCount, ormBytes / 1048576.0, ormSeparateBytes / 1048576.0);
+		ImGui::SetItemTooltip("Occlusion, roughness and metalness in the R, G and B of one texture");
+	}
+
+	for (const TextureCookReport& report : textureCookResults.Reports)
+	{
+		if (!report.Error.empty())
+			ImGui::BulletText("%s failed", report.Name.c_str());
+		else if (report.Cached)
+			ImGui::BulletText("%s: %s, cached (hash %.2f ms)", report.Name.c_str(), GetDdsFormatName(report.Format), report.HashMs);
+		else
+			ImGui::BulletText("%s: %s at %.1f dB - decode %.2f ms, mips %.2f ms, compress %.2f ms, write %.2f ms",
+				report.Name.c_str(), GetDdsFormatName(report.Format), report.Psnr,
+				report.DecodeMs, report.MipMs, report.CompressMs, report.WriteMs);
+	}
+
+	ImGui::SeparatorText("Texture Residency");
+	const TextureResidencyStats& residency = textureManager->GetPolicy().GetStats();
+	ImGui::SliderInt("Budget (MB)", &textureBudgetMB, 1, 32);
+	ImGui::SetItemTooltip("Least recently used textures lose their top mips first when over budget");
+	ImGui::Text("%.2f of %.2f MB resident%s", residency.ResidentBytes / 1048576.0, residency.FullBytes / 1048576.0,
+		residency.OverBudget ? " (over budget)" : "");
+	ImGui::Text("%u textures reduced, %u mips short on screen, %u uploads this frame",
+		residency.ReducedTextures, residency.MissingMips, textureManager->GetLastUploads());
+	ImGui::Text("%llu mips dropped, %llu streamed back in", residency.MipsDropped, residency.MipsStreamed);
+	for (unsigned int i = 0; i < textureManager->GetPolicy().GetTextureCount(); i++)
+	{
+		const TextureResidencyPolicy& policy = textureManager->GetPolicy();
+		const DdsTexture& description = policy.GetDescription(i);
+		unsigned int mip = policy.GetResidentMip(i);
+		ImGui::BulletText("%s: %ux%u from mip %u (wants %u)", policy.GetName(i).c_str(),
+			std::max(description.Width >> mip, 1u), std::max(description.Height >> mip, 1u), mip, policy.GetWantedMip(i));
+	}
+
+	ImGui::SeparatorText("Pipeline States");
+	ImGui::Text("Pipelines: %u unique from %u requests",
+		pipelineCache->GetPipelines().GetUniqueCount(), pipelineCache->GetPipelines().GetRequestCount());
+	ImGui::Text("Raster %u, Depth %u, Blend %u, Sampler %u unique",
+		pipelineCache->GetRasterStates().GetUniqueCount(), pipelineCache->GetDepthStates().GetUniqueCount(),
+		pipelineCache->GetBlendStates().GetUniqueCount(), pipelineCache->GetSamplerStates().GetUniqueCount());
+
+	ImGui::SeparatorText("Draw Sorting");
+	ImGui::Checkbox("Sort Draws", &sortDraws);
+	ImGui::SetItemTooltip("Off submits entities in the order they were created");
+	ImGui::Text("%u draws: %u pipeline, %u material, %u mesh binds",
+		(unsigned int)drawList.GetCount(), framePipelineBinds, frameMaterialBinds, frameMeshChanges);
+
+	ImGui::SeparatorText("Instancing");
+	ImGui::Checkbox("Instance Draws", &instanceDraws);
+	ImGui::SetItemTooltip("Draws entities sharing a mesh and material with one DrawIndexedInstanced");
+	for (const InstanceBatcher* batcher : { &shadowBatches, &opaqueBatches })
+	{
+		const InstanceBatchStats& stats = batcher->GetStats();
+		ImGui::Text("%s: %u draws in %u calls (%u batches formed, %u calls saved)",
+			batcher == &shadowBatches ? "Shadow" : "Opaque",
+			stats.Draws, stats.Batches, stats.BatchesFormed, stats.DrawCallsSaved);
+	}
+
+	ImGui::SeparatorText("Material Atlas");
+	if (ImGui::Checkbox("Material Atlas", &materialAtlasMode))
+	{
+		if (!materialAtlasMode)
+			ReleaseMaterialAtlasResources();
+		else if (!CreateMaterialAtlasResources())
+			materialAtlasMode = false;
+	}
+	ImGui::SetItemTooltip("Draws the PBR materials from shared texture arrays, so entities sharing a mesh batch across materials");
+	ImGui::Text("%zu materials in %u slices, %.1f MB of arrays%s", atlasMaterials.size(), materialAtlas->GetSliceCount(),
+		materialAtlas->GetArrayBytes() / (1024.0 * 1024.0), materialAtlasMode && !instanceDraws ? " (needs instancing)" : "");
+
+	ImGui::SeparatorText("State Cache");
+	bool filterStates = Graphics::States->IsEnabled();
+	if (ImGui::Checkbox("Filter Redundant Binds", &filterStates))
+		Graphics::States->SetEnabled(filterStates);
+	ImGui::Text("Last frame: %u calls issued, %u filtered", Graphics::States->GetTotalIssued(), Graphics::States->GetTotalFiltered());
+	if (ImGui::BeginTable("StateCalls", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit))
+	{
+		const char* callNames[STATE_CALL_COUNT] = {
+			"Shader", "Input Layout", "Constant Buffer", "Shader Resource", "Sampler", "Raster",
+			"Depth", "Blend", "Topology", "Vertex Buffer", "Index Buffer", "Render Target" };
+
+		ImGui::TableSetupColumn("Call");
+		ImGui::TableSetupColumn("Issued");
+		ImGui::TableSetupColumn("Filtered");
+		ImGui::TableHeadersRow();
+		for (int call = 0; call < STATE_CALL_COUNT; call++)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::TextUnformatted(callNames[call]);
+			ImGui::TableNextColumn(); ImGui::Text("%u", Graphics::States->GetIssuedCount((StateCall)call));
+			ImGui::TableNextColumn(); ImGui::Text("%u", Graphics::States->GetFilteredCount((StateCall)call));
+		}
+		ImGui::EndTable();
+	}
+
 	ImGui::SeparatorText("Lights");
+	ImGui::Text("Active lights: %u", lightManager->GetLightCount());
+	ImGui::Text("Light bytes uploaded: %u", lightManager->GetLastUploadBytes());
 	ImGui::Text("Light color");
-	ImGui::ColorEdit4("Directional Light 1", dir1col);
-	ImGui::ColorEdit4("Directional Light 2", dir2col);
-	ImGui::ColorEdit4("Directional Light 3", dir3col);
-	ImGui::ColorEdit4("Point Light 1", point1col);
-	ImGui::ColorEdit4("Point Light 2", point2col);
-	directionalLight1.Color = XMFLOAT3(dir1col);
-	directionalLight2.Color = XMFLOAT3(dir2col);
-	directionalLight3.Color = XMFLOAT3(dir3col);
-	pointLight1.Color = XMFLOAT3(point1col);
-	pointLight2.Color = XMFLOAT3(point2col);
+	for (unsigned int i = 0; i < lightManager->GetLightCount(); i++)
+	{
+		Light light = lightManager->GetLight(i);
+		ImGui::PushID(i);
+		ImGui::Text(light.Type == LIGHT_TYPE_POINT ? "Point Light %u" : "Directional Light %u", i);
+		if (ImGui::ColorEdit3("Color", &light.Color.x)) lightManager->SetLight(i, light);
+		if (light.Type == LIGHT_TYPE_POINT && ImGui::DragFloat3("Position", &light.Position.x, 0.01f)) lightManager->SetLight(i, light);
+		ImGui::PopID();
+	}
+	if (ImGui::Button("Add Point Light"))
+	{
+		Light point = {};
+		point.Type = LIGHT_TYPE_POINT;
+		point.Range = 5.0f;
+		point.Position = XMFLOAT3(-4.0f + 4.0f * (lightManager->GetLightCount() % 4), 4.0f, 2.0f);
+		point.Direction = XMFLOAT3(0.0f, 0.0f, 1.0f);
+		point.Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
+		point.Intensity = 1.0f;
+		lightManager->AddLight(point);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Remove Last Light") && lightManager->GetLightCount() > 0)
+	{
+		lightManager->RemoveLight(lightManager->GetLightCount() - 1);
+	}
 
 	ImGui::SeparatorText("Camera:");
 	static int selected = 0;
@@ -666,6 +1401,131 @@ void Game::BuildUI()
 		ImGui::PopID();
 	}
 
+	ImGui::SeparatorText("Benchmarks");
+	static ShaderVariableBenchmarkResults varBench;
+	if (ImGui::Button("Shader Variable Lookups"))
+		varBench = ShaderVariableBenchmark(1000000);
+	if (varBench.Iterations > 0)
+	{
+		ImGui::Text("String: %.2f ns/set", varBench.StringLookupNs);
+		ImGui::Text("Hashed: %.2f ns/set", varBench.HashLookupNs);
+		ImGui::Text("Handle: %.2f ns/set", varBench.HandleNs);
+	}
+
+	static MaterialBindBenchmarkResults materialBench;
+	if (ImGui::Button("Material Binding"))
+		materialBench = MaterialBindBenchmark(mats[0], 100000);
+	ImGui::SetItemTooltip("Binds the first material over and over, by name and from its baked table");
+	if (materialBench.Iterations > 0)
+	{
+		ImGui::Text("By name: %.1f ns/bind", materialBench.ByNameNs);
+		ImGui::Text("Baked: %.1f ns/bind (%u bakes so far)", materialBench.BakedNs, mats[0]->GetBakeCount());
+	}
+
+	static std::vector<DrawListBenchmarkResults> sortBench;
+	if (ImGui::Button("Draw Sorting"))
+	{
+		sortBench.clear();
+		for (unsigned int draws : { 10000u, 30000u, 100000u })
+			sortBench.push_back(DrawListBenchmark(draws));
+	}
+	for (const DrawListBenchmarkResults& r : sortBench)
+	{
+		ImGui::Text("%u draws: keys %.2f ms, radix %.2f ms (std::sort %.2f ms)", r.Draws, r.BuildMs, r.RadixSortMs, r.StdSortMs);
+		ImGui::Text("  Binds - pipeline %u -> %u, material %u -> %u, mesh %u -> %u",
+			r.UnsortedPipelineChanges, r.SortedPipelineChanges,
+			r.UnsortedMaterialChanges, r.SortedMaterialChanges,
+			r.UnsortedMeshChanges, r.SortedMeshChanges);
+	}
+
+	static MipBenchmarkResults mipBench;
+	if (ImGui::Button("Mip Generation"))
+		mipBench = MipBenchmark(1024, *threadPool);
+	ImGui::SetItemTooltip("Six 1024x1024 faces per usage, inline and across the thread pool");
+	if (mipBench.Images > 0)
+	{
+		ImGui::Text("Color: %.1f MP/s (%.1f pooled)", mipBench.ColorMPs, mipBench.PooledColorMPs);
+		ImGui::Text("Normal: %.1f MP/s (%.1f pooled)", mipBench.NormalMPs, mipBench.PooledNormalMPs);
+		ImGui::Text("Roughness: %.1f MP/s (%.1f pooled)", mipBench.RoughnessMPs, mipBench.PooledRoughnessMPs);
+	}
+
+	static BlockCompressBenchmarkResults blockBench;
+	if (ImGui::Button("Block Compression"))
+		blockBench = BlockCompressBenchmark(512, *threadPool);
+	ImGui::SetItemTooltip("A 512x512 gradient in every format at both qualities");
+	for (const BlockCompressBenchmarkResults::Row& row : blockBench.Rows)
+	{
+		const char* names[] = { "None", "BC1", "BC4", "BC5", "BC7" };
+		ImGui::Text("%s %s: %.1f MP/s (%.1f pooled), %.1f dB", names[row.Format],
+			row.Quality == BLOCK_QUALITY_HIGH ? "high" : "fast", row.MPs, row.PooledMPs, row.Psnr);
+	}
+
+	static std::vector<TextureResidencySimulationResults> residencyBench;
+	if (ImGui::Button("Texture Residency"))
+	{
+		residencyBench.clear();
+		for (size_t budgetMB : { 4u, 16u, 64u })
+		{
+			TextureResidencySimulationSettings settings;
+			settings.BudgetBytes = budgetMB * 1024 * 1024;
+			residencyBench.push_back(SimulateTextureResidency(settings));
+		}
+	}
+	ImGui::SetItemTooltip("A camera flying past 48 objects with their own 1024x1024 BC7 texture");
+	for (const TextureResidencySimulationResults& r : residencyBench)
+	{
+		ImGui::Text("%.0f of %.0f MB: peak %.1f MB, %u frames over, %.2f missing mips/frame",
+			r.BudgetBytes / 1048576.0, r.FullBytes / 1048576.0, r.PeakBytes / 1048576.0, r.FramesOverBudget, r.MissingMipsPerFrame);
+		ImGui::Text("  %llu mips dropped, %llu streamed, %.2f us/update", r.MipsDropped, r.MipsStreamed, r.UpdateUs);
+	}
+
+	static std::vector<VirtualTextureSimulationResults> virtualBench;
+	if (ImGui::Button("Virtual Texturing"))
+	{
+		virtualBench.clear();
+		for (unsigned int slots : { 256u, 1024u, 4096u })
+		{
+			VirtualTextureSimulationSettings settings;
+			settings.Texture.CacheSlots = slots;
+			virtualBench.push_back(SimulateVirtualTexture(settings));
+		}
+	}
+	ImGui::SetItemTooltip("A camera flying low over a 64K x 64K BC7 terrain, fed by a 160x90 feedback pass");
+	for (const VirtualTextureSimulationResults& r : virtualBench)
+	{
+		ImGui::Text("%u pages (%.0f MB): %.1f%% page hits, %.1f%% sample hits, %.1f pending/frame",
+			r.CacheSlots, r.CacheBytes / 1048576.0, r.HitRate * 100, r.SampleHitRate * 100, r.PendingPerFrame);
+		ImGui::Text("  %.1f uploads, %.2f MB/frame (peak %.2f), %llu evictions, %.1f us update, %.1f us table",
+			r.UploadsPerFrame, r.UploadMBPerFrame, r.PeakUploadMB, r.Evictions, r.UpdateUs, r.PageTableUs);
+	}
+
+	static std::vector<ImageLightingBenchmarkResults> lightingBench;
+	ImGui::BeginDisabled(textureCookResults.GetOutput("sky").empty());
+	if (ImGui::Button("Image Lighting"))
+	{
+		lightingBench.clear();
+		lightingBench.push_back(ImageLightingBenchmark(textureCookResults.GetOutput("sky"), ImageLightingSettings(), *threadPool));
+	}
+	ImGui::EndDisabled();
+	ImGui::SetItemTooltip("Bakes the sky's irradiance, specular cube and BRDF LUT without the cache, inline then across the pool");
+	for (const ImageLightingBenchmarkResults& r : lightingBench)
+	{
+		const ImageLightingResults* runs[] = { &r.Inline, &r.Pooled };
+		const char* labels[] = { "Inline", "Pooled" };
+		for (int i = 0; i < 2; i++)
+		{
+			if (!runs[i]->Error.empty())
+			{
+				ImGui::Text("%s: %s", labels[i], runs[i]->Error.c_str());
+				continue;
+			}
+			ImGui::Text("%s: %.2f ms - load %.2f, irradiance %.2f, specular %.2f, BRDF %.2f",
+				labels[i], runs[i]->Milliseconds, runs[i]->LoadMs, runs[i]->IrradianceMs, runs[i]->SpecularMs, runs[i]->BrdfMs);
+		}
+		if (r.Inline.Error.empty() && r.Pooled.Error.empty() && r.Pooled.Milliseconds > 0)
+			ImGui::Text("  %.1fx on %u threads", r.Inline.Milliseconds / r.Pooled.Milliseconds, r.Threads);
+	}
+
 	ImGui::SeparatorText("Fun Features");
 	// Rewrite Bg Color
 	ImGui::ColorEdit4("BG Color", color);
@@ -713,6 +1573,8 @@ void Game::Update(float deltaTime, float totalTime)
 		entities[i].GetTransform()->MoveRelative(dx, dy, dz);
 	}
 
+	UpdateTextureResidency();
+
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::KeyDown(VK_ESCAPE))
 		Window::Quit();
@@ -721,6 +1583,42 @@ void Game::Update(float deltaTime, float totalTime)
 
 
 
+// --------------------------------------------------------
+// Tells the texture manager how big each material is on
+// screen this frame, then lets it trim or stream mips.
+// Meshes are taken to fit in a sphere as wide as their
+// largest scale, which is close enough to pick a mip.
+// --------------------------------------------------------
+void Game::UpdateTextureResidency()
+{
+	textureManager->GetPolicy().SetBudget((size_t)textureBudgetMB * 1024 * 1024);
+
+	XMFLOAT3 camPos = currentCam->GetTransform()->GetPosition();
+	XMFLOAT3 camForward = currentCam->GetTransform()->GetForward();
+	float tanHalfFov = tanf(currentCam->GetFOV() * 0.5f);
+	for (Entity& entity : entities)
+	{
+		XMFLOAT3 position = entity.GetTransform()->GetPosition();
+		XMFLOAT3 scale = entity.GetTransform()->GetScale();
+		float radius = std::max(std::max(fabsf(scale.x), fabsf(scale.y)), fabsf(scale.z));
+		XMVECTOR toEntity = XMLoadFloat3(&position) - XMLoadFloat3(&camPos);
+		float distance = XMVectorGetX(XMVector3Length(toEntity));
+
+		// Behind the camera doesn't count as used
+		if (XMVectorGetX(XMVector3Dot(toEntity, XMLoadFloat3(&camForward))) < -radius)
+			continue;
+
+		// Rows covered by the sphere; from inside it, the whole screen
+		float screenPixels = distance > radius ?
+			radius * Window::Height() / (distance * tanHalfFov) :
+			(float)Window::Height();
+		textureManager->RequestMaterial(entity.GetMaterial().get(), screenPixels);
+	}
+
+	textureManager->Update();
+}
+
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
@@ -730,15 +1628,136 @@ void Game::Draw(float deltaTime, float totalTime)
 	// - These things should happen ONCE PER FRAME
 	// - At the beginning of Game::Draw() before drawing *anything*
 	{
+		// Start counting this frame's constant buffer traffic and binds
+		ISimpleShader::ResetUploadStats();
+		Graphics::States->ResetStats();
+
+		// Reclaim ring space from frames the GPU has finished
+		if (ISimpleShader::ConstantRing)
+			ISimpleShader::ConstantRing->BeginFrame();
+
 		// Clear the back buffer (erase what's on screen) and depth buffer
 		Graphics::Context->ClearRenderTargetView(Graphics::BackBufferRTV.Get(), color);
 		Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
 		Graphics::Context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
 	}
 
+	// Instanced shaders that failed to load or lost their
+	// per-instance inputs fall back to one draw per entity
+	bool instancing = instanceDraws &&
+		instancedVS->GetPerInstanceCompatible() && instancedShadowVS->GetPerInstanceCompatible();
+
+	// Atlas materials find their slice through the instance data,
+	// so the atlas only applies to instanced draws
+	bool atlasing = instancing && materialAtlasMode && atlasArrays[0] != nullptr;
+	std::shared_ptr<SimplePixelShader> atlasPS;
+	std::shared_ptr<PipelineState> atlasPipeline;
+
+	// Pick this frame's shaders and pipelines, then build and sort the draw list
+	{
+		currentCam->Update(deltaTime);
+
+		// Swap each permutation-driven material to the variant for this
+		// frame's fog mode and the features enabled in the UI, and look
+		// up its pipeline
+		unsigned int fogFeature = GetFogFeature(fogType);
+		for (auto& m : mats)
+		{
+			if (m->GetFeatures() != 0)
+				m->SetPixelShader(pixelPermutations->Get((m->GetFeatures() & enabledFeatures) | fogFeature));
+
+			PipelineStateDesc pipelineDesc;
+			pipelineDesc.VertexShader = m->GetVertexShader();
+			pipelineDesc.PixelShader = m->GetPixelShader();
+			m->SetPipelineState(pipelineCache->Get(pipelineDesc));
+
+			// Every material uses VertexShader.hlsl, so they all share its instanced twin
+			pipelineDesc.VertexShader = instancedVS;
+			m->SetInstancedPipelineState(pipelineCache->Get(pipelineDesc));
+		}
+
+		// Every atlas material draws with the same permutation.  One
+		// that failed to build falls back to a shader without arrays.
+		if (atlasing)
+		{
+			atlasPS = pixelPermutations->Get((AtlasMaterialFeatures & enabledFeatures) | fogFeature | SHADER_FEATURE_MATERIAL_ATLAS);
+			atlasing = atlasPS->HasShaderResourceView("AtlasMaterials");
+
+			PipelineStateDesc pipelineDesc;
+			pipelineDesc.VertexShader = instancedVS;
+			pipelineDesc.PixelShader = atlasPS;
+			atlasPipeline = pipelineCache->Get(pipelineDesc);
+		}
+
+		// Ids are handed out fresh each frame so they stay small
+		pipelineIds.Clear();
+		materialIds.Clear();
+		meshIds.Clear();
+		drawList.Clear();
+		drawList.Reserve(entities.size() * 2);
+
+		XMFLOAT3 camPos = currentCam->GetTransform()->GetPosition();
+		XMFLOAT3 camForward = currentCam->GetTransform()->GetForward();
+		XMVECTOR eye = XMLoadFloat3(&camPos);
+		XMVECTOR forward = XMLoadFloat3(&camForward);
+
+		// The shadow pass only changes meshes.  All shadow draws go
+		// in before any opaque ones, so the passes stay contiguous
+		// even when sorting is off.
+		for (unsigned int i = 0; i < entities.size(); i++)
+			drawList.Add(MakeDrawKey(DrawPassShadow, 0, 0, meshIds.Get(entities[i].GetMesh().get()), 0), i);
+
+		// Atlas materials all share one pipeline and material id, so
+		// they sort together and batch by mesh alone
+		for (unsigned int i = 0; i < entities.size(); i++)
+		{
+			std::shared_ptr<Materials> mat = entities[i].GetMaterial();
+			XMFLOAT3 pos = entities[i].GetTransform()->GetPosition();
+			float depth = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&pos) - eye, forward));
+			bool atlased = atlasing && atlasMaterialIndices.count(mat.get());
+
+			drawList.Add(MakeDrawKey(DrawPassOpaque,
+				pipelineIds.Get(atlased ? atlasPipeline.get() : mat->GetPipelineState().get()),
+				materialIds.Get(atlased ? (const void*)materialAtlas.get() : mat.get()),
+				meshIds.Get(entities[i].GetMesh().get()),
+				GetDepthBucket(depth, currentCam->GetFarPlane())), i);
+		}
+
+		if (sortDraws)
+			drawList.Sort();
+
+		// Batch neighbouring draws that only differ by depth.  The
+		// instance buffer has one entry per draw list item, so each
+		// batch's instances start at its position in the list.
+		unsigned int maxInstances = instancing ? MaxInstancesPerDraw : 1;
+
+		size_t passBegin, passEnd;
+		drawList.GetPassRange(DrawPassShadow, passBegin, passEnd);
+		shadowBatches.Build(drawList, passBegin, passEnd, maxInstances);
+		drawList.GetPassRange(DrawPassOpaque, passBegin, passEnd);
+		opaqueBatches.Build(drawList, passBegin, passEnd, maxInstances);
+
+		if (instancing)
+		{
+			instanceData.resize(drawList.GetCount());
+			for (size_t d = 0; d < drawList.GetCount(); d++)
+			{
+				const DrawItem& item = drawList.GetItems()[d];
+				Transform* transform = entities[item.Index].GetTransform();
+				instanceData[d].world = transform->GetWorldMatrix();
+				instanceData[d].worldInvTranspose = transform->GetWorldInverseTransposeMatrix();
+				instanceData[d].materialIndex = GetDrawKeyField(item.Key, DrawKeyMaterialShift, DrawKeyMaterialBits);
+
+				auto atlasIndex = atlasMaterialIndices.find(entities[item.Index].GetMaterial().get());
+				if (atlasing && atlasIndex != atlasMaterialIndices.end())
+					instanceData[d].materialIndex = atlasIndex->second;
+			}
+			instanceBuffer->Upload(instanceData.data(), (unsigned int)instanceData.size());
+		}
+	}
+
 	// Shadow Map Output Merger Shift
-	ID3D11RenderTargetView* nullRTV{};
-	Graphics::Context->OMSetRenderTargets(1, &nullRTV, shadowDSV.Get());
+	Graphics::States->SetRenderTarget(0, shadowDSV.Get());
 
 
 
@@ -751,18 +1770,30 @@ void Game::Draw(float deltaTime, float totalTime)
 
 
 
-	// Render Shadows
-	Graphics::Context->RSSetState(shadowRasterizer.Get());
-	shadowVS->SetShader();
-	shadowVS->SetMatrix4x4("view", lightViewMatrix);
-	shadowVS->SetMatrix4x4("projection", lightProjectionMatrix);
-	// Deactivate Pixel Shader
-	Graphics::Context->PSSetShader(0, 0, 0);
+	// Render Shadows - the pipeline also turns off the pixel shader
+	std::shared_ptr<SimpleVertexShader> frameShadowVS = instancing ? instancedShadowVS : shadowVS;
+	(instancing ? instancedShadowPipeline : shadowPipeline)->Bind();
+	ShadowPerFrameVSData shadowFrame = {};
+	shadowFrame.view = lightViewMatrix;
+	shadowFrame.projection = lightProjectionMatrix;
+	frameShadowVS->SetBufferData(shadowFrame);
+	frameShadowVS->CopyBufferData("PerFrame");
+
+	if (instancing)
+		instanceBuffer->Bind();
 
-	for (auto& e : entities)
+	for (const InstanceBatch& batch : shadowBatches.GetBatches())
 	{
-		shadowVS->SetMatrix4x4("world", e.GetTransform()->GetWorldMatrix());
-		shadowVS->CopyAllBufferData();
+		Entity& e = entities[drawList.GetItems()[batch.First].Index];
+
+		if (instancing)
+		{
+			e.GetMesh()->DrawInstanced(batch.Count, (unsigned int)batch.First);
+			continue;
+		}
+
+		shadowVS->SetMatrix4x4(shadowWorldHandle, e.GetTransform()->GetWorldMatrix());
+		shadowVS->CopyBufferData("PerObject");
 
 		e.GetMesh()->Draw();
 	}
@@ -771,61 +1802,147 @@ void Game::Draw(float deltaTime, float totalTime)
 	viewport.Width = (float)Window::Width();
 	viewport.Height = (float)Window::Height();
 	Graphics::Context->RSSetViewports(1, &viewport);
-	Graphics::Context->OMSetRenderTargets(
-		1,
-		Graphics::BackBufferRTV.GetAddressOf(),
-		Graphics::DepthBufferDSV.Get()
-	);
-	Graphics::Context->RSSetState(0);
+	Graphics::States->SetRenderTarget(Graphics::BackBufferRTV.Get(), Graphics::DepthBufferDSV.Get());
 
 	if (blur)
 	{
 		const float bg[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
 		Graphics::Context->ClearRenderTargetView(postRenderTarget.Get(), bg);
 
-		Graphics::Context->OMSetRenderTargets(1, postRenderTarget.GetAddressOf(), Graphics::DepthBufferDSV.Get());
+		Graphics::States->SetRenderTarget(postRenderTarget.Get(), Graphics::DepthBufferDSV.Get());
 	}
 
 
 	// Entities Loop
 	{
-		currentCam->Update(deltaTime);
+		// Send any edited lights to the GPU once for the whole frame
+		lightManager->Upload();
+
+		// Per-frame data - uploaded once, shared by every entity
+		PerFrameVSData vsFrame = {};
+		vsFrame.viewMat = currentCam->GetViewMatrix();
+		vsFrame.projMat = currentCam->GetProjectionMatrix();
+		vsFrame.lightView = lightViewMatrix;
+		vsFrame.lightProj = lightProjectionMatrix;
+		vertexShader->SetBufferData(vsFrame);
+		vertexShader->CopyBufferData("PerFrame");
+		if (instancing)
+		{
+			instancedVS->SetBufferData(vsFrame);
+			instancedVS->CopyBufferData("PerFrame");
+		}
 
-		for (int i = 0; i < entities.size(); i++)
+		PerFramePSData psFrame = {};
+		psFrame.cameraPosition = currentCam->GetTransform()->GetPosition();
+		psFrame.lightCount = (int)lightManager->GetLightCount();
+		psFrame.ambient = ambientColor;
+		psFrame.fogType = fogType;
+		psFrame.fogColor = XMFLOAT3(fogColor[0], fogColor[1], fogColor[2]);
+		psFrame.fogStart = fogStart;
+		psFrame.fogEnd = fogEnd;
+		psFrame.fogDensity = fogDensity;
+		psFrame.specularMipCount = (float)imageLightingResults.SpecularMips;
+		psFrame.imageLightIntensity = imageLightIntensity;
+		memcpy(psFrame.irradianceSH, imageLightingResults.Coefficients, sizeof(psFrame.irradianceSH));
+
+		// Give every pixel shader in use this frame its data
+		std::vector<std::shared_ptr<SimplePixelShader>> framePixelShaders;
+		for (auto& m : mats)
 		{
-			entities[i].GetMaterial()->GetVertexShader()->SetShader();
-			entities[i].GetMaterial()->GetPixelShader()->SetShader();
-			std::shared_ptr<SimpleVertexShader> vs = entities[i].GetMaterial()->GetVertexShader();
-			vs->SetMatrix4x4("world", entities[i].GetTransform()->GetWorldMatrix());
-			vs->SetMatrix4x4("viewMat", currentCam->GetViewMatrix());
-			vs->SetMatrix4x4("projMat", currentCam->GetProjectionMatrix());
-			vs->SetMatrix4x4("worldInvTranspose", entities[i].GetTransform()->GetWorldInverseTransposeMatrix());
-			vs->SetMatrix4x4("lightView", lightViewMatrix);
-			vs->SetMatrix4x4("lightProj", lightProjectionMatrix);
-			vs->CopyAllBufferData();
-
-			std::shared_ptr<SimplePixelShader> ps = entities[i].GetMaterial()->GetPixelShader();
-			entities[i].GetMaterial()->PrepareMaterial();
-			ps->SetData("directionalLight1", &directionalLight1, sizeof(Light));
-			ps->SetData("directionalLight2", &directionalLight2, sizeof(Light));
-			ps->SetData("directionalLight3", &directionalLight3, sizeof(Light));
-			ps->SetData("pointLight1", &pointLight1, sizeof(Light));
-			ps->SetData("pointLight2", &pointLight2, sizeof(Light));
-			ps->SetFloat("roughness", entities[i].GetMaterial()->GetRoughness());
-			ps->SetFloat3("cameraPosition", currentCam->GetTransform()->GetPosition());
-			ps->SetFloat4("colorTint", entities[i].GetMaterial()->GetColor());
-			ps->SetFloat3("ambient", ambientColor);
-			ps->SetSamplerState("ShadowSampler", shadowSampler);
-			ps->SetShaderResourceView("ShadowMap", shadowSRV.Get());
-			
-
-			ps->SetFloat3("fogColor", fogColor);
-			ps->SetFloat("fogDensity", fogDensity);
-			ps->SetFloat("fogStart", fogStart);
-			ps->SetFloat("fogEnd", fogEnd);
-			ps->SetInt("fogType", fogType);
-			ps->CopyAllBufferData();
+			std::shared_ptr<SimplePixelShader> ps = m->GetPixelShader();
+			if (std::find(framePixelShaders.begin(), framePixelShaders.end(), ps) == framePixelShaders.end() &&
+				ps->GetBufferInfo("PerFrame"))
+			{
+				framePixelShaders.push_back(ps);
+			}
+		}
 
+		if (atlasing && std::find(framePixelShaders.begin(), framePixelShaders.end(), atlasPS) == framePixelShaders.end())
+			framePixelShaders.push_back(atlasPS);
+
+		for (auto& ps : framePixelShaders)
+		{
+			ps->SetBufferData(psFrame);
+			ps->CopyBufferData("PerFrame");
+		}
+
+		pixelShader->SetShaderResourceView("Lights", lightManager->GetSRV());
+		pixelShader->SetShaderResourceView("ShadowMap", shadowSRV.Get());
+		pixelShader->SetSamplerState("ShadowSampler", shadowSampler);
+		pixelShader->SetShaderResourceView("SpecularMap", specularLightSRV);
+		pixelShader->SetShaderResourceView("BrdfLut", brdfLutSRV);
+		pixelShader->SetSamplerState("ClampSampler", imageLightSampler);
+
+		// Walk the sorted batches, binding only where the key says
+		// the pipeline, material or mesh changed
+		framePipelineBinds = 0;
+		frameMaterialBinds = 0;
+		frameMeshChanges = 0;
+		std::shared_ptr<Materials> currentMaterial;
+		std::shared_ptr<PipelineState> currentPipeline;
+		std::shared_ptr<Mesh> currentMesh;
+		bool atlasBound = false;
+		if (instancing)
+			instanceBuffer->Bind();
+
+		for (const InstanceBatch& batch : opaqueBatches.GetBatches())
+		{
+			int i = drawList.GetItems()[batch.First].Index;
+			std::shared_ptr<Materials> mat = entities[i].GetMaterial();
+
+			// Materials often share a pipeline, so only bind on a change
+			bool atlased = atlasing && atlasMaterialIndices.count(mat.get());
+			std::shared_ptr<PipelineState> pipeline = atlased ? atlasPipeline :
+				instancing ? mat->GetInstancedPipelineState() : mat->GetPipelineState();
+			if (pipeline != currentPipeline)
+			{
+				currentPipeline = pipeline;
+				currentPipeline->Bind();
+				framePipelineBinds++;
+			}
+
+			// Per-material data - only re-sent when the material changes.
+			// Atlas materials share one set of arrays and their buffer.
+			if (atlased)
+			{
+				if (!atlasBound)
+				{
+					for (unsigned int c = 0; c < AtlasChannelCount; c++)
+						atlasPS->SetShaderResourceView(AtlasChannels[c], atlasArrays[c]);
+					atlasPS->SetShaderResourceView("AtlasMaterials", atlasMaterialsSRV);
+					atlasPS->SetSamplerState("BasicSampler", sampleS);
+					atlasBound = true;
+					currentMaterial.reset();
+					frameMaterialBinds++;
+				}
+			}
+			else if (mat != currentMaterial)
+			{
+				mat->PrepareMaterial();
+				currentMaterial = mat;
+				atlasBound = false;
+				frameMaterialBinds++;
+			}
+
+			if (entities[i].GetMesh() != currentMesh)
+			{
+				currentMesh = entities[i].GetMesh();
+				frameMeshChanges++;
+			}
+
+			// The whole batch's transforms are already in the instance buffer
+			if (instancing)
+			{
+				entities[i].GetMesh()->DrawInstanced(batch.Count, (unsigned int)batch.First);
+				continue;
+			}
+
+			// Per-object data - every material uses vertexShader, whose
+			// handles were resolved once in LoadShaders()
+			std::shared_ptr<SimpleVertexShader> vs = mat->GetVertexShader();
+			vs->SetMatrix4x4(worldHandle, entities[i].GetTransform()->GetWorldMatrix());
+			vs->SetMatrix4x4(worldInvTransposeHandle, entities[i].GetTransform()->GetWorldInverseTransposeMatrix());
+			vs->CopyBufferData("PerObject");
 
 			entities[i].GetMesh()->Draw();
 		}
@@ -836,33 +1953,30 @@ void Game::Draw(float deltaTime, float totalTime)
 	if (blur)
 	{
 		// reset render target
-		Graphics::Context->OMSetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), 0);
+		Graphics::States->SetRenderTarget(Graphics::BackBufferRTV.Get(), 0);
 
 		// Reset buffers and set black tri over everything
-		UINT stride = sizeof(Vertex);
-		UINT offset = 0;
-		ID3D11Buffer* nothing = 0;
-		Graphics::Context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
-		Graphics::Context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
+		Graphics::States->SetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
+		Graphics::States->SetVertexBuffer(0, 0, sizeof(Vertex), 0);
 
-		// bind shaders and setup srv and sampler
-		postPS->SetShader();
-		postVS->SetShader();
+		// bind pipeline and setup srv and sampler
+		postPipeline->Bind();
 
 		postPS->SetShaderResourceView("PixelColors", postSRV);
 		postPS->SetSamplerState("BasicSampler", postSampler);
 
 		// cbuffer
-		postPS->SetFloat("pixelWidth", 1.0f / Window::Width());
-		postPS->SetFloat("pixelHeight", 1.0f / Window::Height());
-		postPS->SetInt("blurDistance", blurAmount);
+		PostPSData postData = {};
+		postData.pixelWidth = 1.0f / Window::Width();
+		postData.pixelHeight = 1.0f / Window::Height();
+		postData.blurDistance = blurAmount;
+		postPS->SetBufferData(postData);
 		postPS->CopyAllBufferData();
 
 		Graphics::Context->Draw(3, 0);
 
 		// Reset Resource View
-		ID3D11ShaderResourceView* nullSRVs[16] = {};
-		Graphics::Context->PSSetShaderResources(0, 16, nullSRVs);
+		Graphics::States->ClearShaderResources(STATE_STAGE_PIXEL, 0, 16);
 	}
 
 
@@ -876,18 +1990,20 @@ void Game::Draw(float deltaTime, float totalTime)
 		ImGui::Render(); // Turns UI into renderable Tris
 		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData()); // Draw to screen
 
+		// ImGui sets its own state directly on the context
+		Graphics::States->Invalidate();
+
 		Graphics::SwapChain->Present(
 			vsync ? 1 : 0,
 			vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
 
-		// Re-bind back buffer and depth buffer after presenting
-		Graphics::Context->OMSetRenderTargets(
-			1,
-			Graphics::BackBufferRTV.GetAddressOf(),
-			Graphics::DepthBufferDSV.Get());
+		// Fence this frame's ring allocations
+		if (ISimpleShader::ConstantRing)
+			ISimpleShader::ConstantRing->EndFrame();
 
-		ID3D11ShaderResourceView* nullSRVs[128] = {};
-		Graphics::Context->PSSetShaderResources(0, 128, nullSRVs);
+		// Re-bind back buffer and depth buffer after presenting
+		Graphics::States->SetRenderTarget(Graphics::BackBufferRTV.Get(), Graphics::DepthBufferDSV.Get());
+		Graphics::States->ClearShaderResources(STATE_STAGE_PIXEL, 0, 128);
 	}
 
 
@@ -4,6 +4,7 @@
 #include <wrl/client.h>
 #include <memory>
 #include "SimpleShader.h"
+#include "PipelineState.h"
 
 
 class Game
@@ -25,9 +26,15 @@ private:
 
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
 	void LoadShaders();
+	void BuildShaders();
+	void CookTextures();
+	void BakeImageLighting();
 	void CreateGeometry();
 	void PostSetup();
 
+	// Per-frame helpers
+	void UpdateTextureResidency();
+
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
 	//     Component Object Model, which DirectX objects do
@@ -46,41 +53,29 @@ private:
 	// Shaders and shader-related constructs
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	std::shared_ptr<SimpleVertexShader> vertexShader;
+	std::shared_ptr<SimpleVertexShader> instancedVS;
 	std::shared_ptr<SimplePixelShader> skyPS;
 	std::shared_ptr<SimpleVertexShader> skyVS;
 	std::shared_ptr<SimpleVertexShader> shadowVS;
+	std::shared_ptr<SimpleVertexShader> instancedShadowVS;
 	std::shared_ptr<SimplePixelShader> shadowPS;
 	std::shared_ptr<SimplePixelShader> normalPS;
 	std::shared_ptr<SimplePixelShader> uvPS;
 	std::shared_ptr<SimplePixelShader> customPS;
 	std::shared_ptr<SimplePixelShader> postPS;
 	std::shared_ptr<SimpleVertexShader> postVS;
+	std::shared_ptr<PipelineState> postPipeline;
 	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
 
 	// Shadow Mapping
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowSRV;
-	Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowRasterizer;
+	std::shared_ptr<PipelineState> shadowPipeline;
+	std::shared_ptr<PipelineState> instancedShadowPipeline;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> shadowSampler;
 	DirectX::XMFLOAT4X4 lightViewMatrix;
 	DirectX::XMFLOAT4X4 lightProjectionMatrix;
 
-	// Texture 1 SRVs
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleAlbedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleRoughSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleMetalSRV;
-	// Texture 2 SRVs
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedAlbedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedRoughSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedMetalSRV;
-	// Texture 3 SRVs
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodAlbedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodRoughSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodMetalSRV;
-
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampleS;
 };
 
@@ -1,5 +1,6 @@
 #include "Graphics.h"
 #include <dxgi1_6.h>
+#include "D3D11StateSink.h"
 
 // Tell the drivers to use high-performance GPU in multi-GPU systems (like laptops)
 extern "C"
@@ -122,6 +123,8 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 		Context.GetAddressOf());	// Pointer to our Device Context pointer
 	if (FAILED(hr)) return hr;
 
+	States = std::make_shared<StateCache>(std::make_shared<D3D11StateSink>(Context));
+
 	// We're set up
 	apiInitialized = true;
 
@@ -152,6 +155,7 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 // --------------------------------------------------------
 void Graphics::ShutDown()
 {
+	States.reset();
 }
 
 
@@ -227,6 +231,10 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 		BackBufferRTV.GetAddressOf(), // This requires a pointer to a pointer (an array of pointers), so we get the address of the pointer
 		DepthBufferDSV.Get());
 
+	// Those binds skipped the state cache
+	if (States)
+		States->Invalidate();
+
 	// Lastly, set up a viewport so we render into
 	// to correct portion of the window
 	D3D11_VIEWPORT viewport = {};
@@ -4,6 +4,9 @@
 #include <d3d11.h>
 #include <string>
 #include <wrl/client.h>
+#include <memory>
+
+#include "StateCache.h"
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -17,6 +20,9 @@ namespace Graphics
 	inline Microsoft::WRL::ComPtr<ID3D11DeviceContext> Context;
 	inline Microsoft::WRL::ComPtr<IDXGISwapChain> SwapChain;
 
+	// Filters redundant binds on the way to Context
+	inline std::shared_ptr<StateCache> States;
+
 	// Rendering buffers
 	inline Microsoft::WRL::ComPtr<ID3D11RenderTargetView> BackBufferRTV;
 	inline Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DepthBufferDSV;
@@ -0,0 +1,649 @@
+#include "ImageLighting.h"
+#include "BlockCompress.h"
+#include "CacheFiles.h"
+#include "CpuHelpers.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// Bump when baked output changes, so every bake redoes once
+static const char* ImageLightingKeyVersion = "ibl-1";
+
+namespace
+{
+	const float Pi = 3.14159265359f;
+
+	// ----------------------------------------------------
+	// Four floats at once: four samples side by side, or
+	// the four channels of one texel
+	// ----------------------------------------------------
+#ifdef CPU_USE_SSE2
+	typedef __m128 Lanes;
+
+	inline Lanes Splat(float v) { return _mm_set1_ps(v); }
+	inline Lanes Load(const float* p) { return _mm_loadu_ps(p); }
+	inline void Store(float* p, Lanes a) { _mm_storeu_ps(p, a); }
+	inline Lanes Add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+	inline Lanes Sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+	inline Lanes Mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+	inline Lanes Div(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+	inline Lanes Sqrt(Lanes a) { return _mm_sqrt_ps(a); }
+	inline Lanes Max(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+	inline Lanes Greater(Lanes a, Lanes b) { return _mm_cmpgt_ps(a, b); }
+
+	// Zero where the mask is off, even if the value is NaN or inf
+	inline Lanes Keep(Lanes a, Lanes mask) { return _mm_and_ps(a, mask); }
+
+	inline float Sum(Lanes a)
+	{
+		float v[4];
+		_mm_storeu_ps(v, a);
+		return v[0] + v[1] + v[2] + v[3];
+	}
+#else
+	struct Lanes { float v[4]; };
+
+	template<typename Op>
+	inline Lanes Each(Lanes a, Lanes b, Op op)
+	{
+		Lanes r;
+		for (int i = 0; i < 4; i++)
+			r.v[i] = op(a.v[i], b.v[i]);
+		return r;
+	}
+
+	inline Lanes Splat(float v) { return Lanes{ { v, v, v, v } }; }
+	inline Lanes Load(const float* p) { return Lanes{ { p[0], p[1], p[2], p[3] } }; }
+	inline void Store(float* p, Lanes a) { memcpy(p, a.v, sizeof(a.v)); }
+	inline Lanes Add(Lanes a, Lanes b) { return Each(a, b, [](float x, float y) { return x + y; }); }
+	inline Lanes Sub(Lanes a, Lanes b) { return Each(a, b, [](float x, float y) { return x - y; }); }
+	inline Lanes Mul(Lanes a, Lanes b) { return Each(a, b, [](float x, float y) { return x * y; }); }
+	inline Lanes Div(Lanes a, Lanes b) { return Each(a, b, [](float x, float y) { return x / y; }); }
+	inline Lanes Sqrt(Lanes a) { return Each(a, a, [](float x, float) { return sqrtf(x); }); }
+	inline Lanes Max(Lanes a, Lanes b) { return Each(a, b, [](float x, float y) { return x > y ? x : y; }); }
+	inline Lanes Greater(Lanes a, Lanes b) { return Each(a, b, [](float x, float y) { return x > y ? 1.0f : 0.0f; }); }
+	inline Lanes Keep(Lanes a, Lanes mask) { return Each(a, mask, [](float x, float m) { return m != 0 ? x : 0.0f; }); }
+	inline float Sum(Lanes a) { return a.v[0] + a.v[1] + a.v[2] + a.v[3]; }
+#endif
+
+	// Van der Corput sequence, the second half of Hammersley points
+	float RadicalInverse(unsigned int bits)
+	{
+		bits = (bits << 16) | (bits >> 16);
+		bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+		bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+		bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+		bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+		return bits * 2.3283064365386963e-10f;
+	}
+
+	// Shader roughness is perceptual; GGX wants alpha = roughness^2
+	float GetMipRoughness(unsigned int mip, unsigned int mipCount)
+	{
+		return mipCount > 1 ? (float)mip / (mipCount - 1) : 0.0f;
+	}
+
+	unsigned char EncodeSrgb(float linear)
+	{
+		linear = linear < 0 ? 0 : (linear > 1 ? 1 : linear);
+		float s = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+		return (unsigned char)(s * 255.0f + 0.5f);
+	}
+
+	void Normalize(float v[3])
+	{
+		float scale = 1.0f / sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		v[0] *= scale;
+		v[1] *= scale;
+		v[2] *= scale;
+	}
+
+	// ----------------------------------------------------
+	// A mip's GGX lobe as directions around +Z (N = V = R),
+	// four to a group.  Each carries its N.L weight and the
+	// source level whose texels cover about its share of the
+	// lobe, so a few hundred samples still filter smoothly.
+	// ----------------------------------------------------
+	struct LobeSamples
+	{
+		std::vector<float> X, Y, Z, Weight;
+		std::vector<unsigned int> Level;
+	};
+
+	void BuildLobe(float roughness, unsigned int sampleCount, const ImageLightingSource& source, LobeSamples& lobe)
+	{
+		unsigned int lastLevel = (unsigned int)source.Sizes.size() - 1;
+		auto add = [&](float x, float y, float z, float weight, unsigned int level)
+		{
+			lobe.X.push_back(x);
+			lobe.Y.push_back(y);
+			lobe.Z.push_back(z);
+			lobe.Weight.push_back(weight);
+			lobe.Level.push_back(level < lastLevel ? level : lastLevel);
+		};
+
+		if (roughness == 0)
+		{
+			add(0, 0, 1, 1, 0);
+		}
+		else
+		{
+			float alpha = roughness * roughness;
+			float alpha2 = alpha * alpha;
+			float texelSolidAngle = 4.0f * Pi / (6.0f * source.Size * source.Size);
+			for (unsigned int i = 0; i < sampleCount; i++)
+			{
+				float u = (i + 0.5f) / sampleCount;
+				float v = RadicalInverse(i);
+				float phi = 2.0f * Pi * u;
+				float cosTheta = sqrtf((1.0f - v) / (1.0f + (alpha2 - 1.0f) * v));
+				float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+
+				// Reflect V = +Z about H
+				float hx = sinTheta * cosf(phi), hy = sinTheta * sinf(phi), hz = cosTheta;
+				float nDotL = 2.0f * hz * hz - 1.0f;
+				if (nDotL <= 0)
+					continue;
+
+				// With N = V, pdf(L) = D(H) / 4
+				float denominator = hz * hz * (alpha2 - 1.0f) + 1.0f;
+				float pdf = alpha2 / (Pi * denominator * denominator) * 0.25f;
+				float sampleSolidAngle = 1.0f / (sampleCount * pdf);
+				float level = 0.5f * log2f(sampleSolidAngle / texelSolidAngle) + 1.0f;
+				add(2.0f * hz * hx, 2.0f * hz * hy, nDotL, nDotL, level > 0 ? (unsigned int)(level + 0.5f) : 0);
+			}
+		}
+
+		// Whole groups of four; the padding weighs nothing
+		while (lobe.X.size() % 4 != 0)
+			add(0, 0, 1, 0, 0);
+	}
+}
+
+bool LoadImageLightingSource(const TextureContainer& sky, unsigned int maxSize, ImageLightingSource& source, std::string& error)
+{
+	const DdsTexture& description = sky.GetDescription();
+	if (!description.IsCubemap || description.ArraySize != 6 || description.Width != description.Height)
+	{
+		error = "Not a single cube map";
+		return false;
+	}
+
+	BlockFormat blockFormat;
+	switch (description.Format)
+	{
+	case DDS_FORMAT_R8G8B8A8_UNORM:
+	case DDS_FORMAT_R8G8B8A8_UNORM_SRGB: blockFormat = BLOCK_FORMAT_NONE; break;
+	case DDS_FORMAT_BC1_UNORM:
+	case DDS_FORMAT_BC1_UNORM_SRGB: blockFormat = BLOCK_FORMAT_BC1; break;
+	case DDS_FORMAT_BC7_UNORM:
+	case DDS_FORMAT_BC7_UNORM_SRGB: blockFormat = BLOCK_FORMAT_BC7; break;
+	default:
+		error = std::string("Can't read ") + GetDdsFormatName(description.Format) + " skies";
+		return false;
+	}
+
+	// Skip the mips bigger than anything here samples
+	unsigned int firstMip = 0;
+	while (firstMip + 1 < description.MipCount && (description.Width >> firstMip) > maxSize)
+		firstMip++;
+
+	// Sky textures hold sRGB-encoded color whatever the format says
+	const float* srgbDecode = GetSrgbDecodeTable();
+
+	source = ImageLightingSource();
+	source.Size = description.Width >> firstMip ? description.Width >> firstMip : 1;
+	for (unsigned int mip = firstMip; mip < description.MipCount; mip++)
+	{
+		unsigned int size = description.Width >> mip ? description.Width >> mip : 1;
+		source.Sizes.push_back(size);
+		for (unsigned int face = 0; face < 6; face++)
+		{
+			const TextureSubresource& subresource = sky.GetSubresource(mip, face);
+			DdsSurface rgba;
+			if (blockFormat != BLOCK_FORMAT_NONE)
+			{
+				DdsSurface compressed;
+				compressed.RowPitch = subresource.RowPitch;
+				compressed.Data.assign(subresource.Data, subresource.Data + subresource.SlicePitch);
+				DecompressSurface(compressed, blockFormat, size, size, rgba);
+			}
+			else
+			{
+				rgba.RowPitch = size * 4;
+				rgba.Data.resize((size_t)size * size * 4);
+				for (unsigned int y = 0; y < size; y++)
+					memcpy(&rgba.Data[(size_t)y * rgba.RowPitch], subresource.Data + (size_t)y * subresource.RowPitch, rgba.RowPitch);
+			}
+
+			std::vector<float>& texels = source.Faces[face].emplace_back((size_t)size * size * 4);
+			for (size_t i = 0; i < texels.size(); i += 4)
+			{
+				texels[i + 0] = srgbDecode[rgba.Data[i + 0]];
+				texels[i + 1] = srgbDecode[rgba.Data[i + 1]];
+				texels[i + 2] = srgbDecode[rgba.Data[i + 2]];
+				texels[i + 3] = rgba.Data[i + 3] / 255.0f;
+			}
+		}
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Each face adds its texels into nine RGBA sums, weighted
+// by the solid angle they cover.  The sums are rescaled so
+// the weights total exactly 4 pi, then each band takes its
+// cosine lobe factor (pi, 2pi/3, pi/4) over pi.
+// --------------------------------------------------------
+void ProjectIrradiance(const ImageLightingSource& source, const ImageLightingSettings& settings, float irradiance[9][4], ThreadPool* pool)
+{
+	unsigned int level = 0;
+	while (level + 1 < source.Sizes.size() && source.Sizes[level] > settings.IrradianceSize)
+		level++;
+	unsigned int size = source.Sizes[level];
+
+	float faceSums[6][9][4] = {};
+	float faceWeights[6] = {};
+	ThreadPool::ForEach(pool, 6, [&](unsigned int face)
+	{
+		Lanes sums[9];
+		for (Lanes& sum : sums)
+			sum = Splat(0);
+		float weightSum = 0;
+
+		const float* texel = source.Faces[face][level].data();
+		float step = 2.0f / size;
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++, texel += 4)
+			{
+				float s = (x + 0.5f) * step - 1.0f;
+				float t = (y + 0.5f) * step - 1.0f;
+				float d = 1.0f + s * s + t * t;
+				float weight = step * step / (d * sqrtf(d));
+
+				float dir[3];
+				GetCubeDirection(face, s, t, dir);
+				Normalize(dir);
+				float dx = dir[0], dy = dir[1], dz = dir[2];
+				float basis[9] =
+				{
+					0.282095f,
+					0.488603f * dy,
+					0.488603f * dz,
+					0.488603f * dx,
+					1.092548f * dx * dy,
+					1.092548f * dy * dz,
+					0.315392f * (3.0f * dz * dz - 1.0f),
+					1.092548f * dx * dz,
+					0.546274f * (dx * dx - dy * dy),
+				};
+
+				Lanes color = Load(texel);
+				for (int i = 0; i < 9; i++)
+					sums[i] = Add(sums[i], Mul(color, Splat(basis[i] * weight)));
+				weightSum += weight;
+			}
+		}
+
+		for (int i = 0; i < 9; i++)
+			Store(faceSums[face][i], sums[i]);
+		faceWeights[face] = weightSum;
+	});
+
+	float totalWeight = 0;
+	for (float weight : faceWeights)
+		totalWeight += weight;
+
+	const float bands[9] = { 1.0f, 2.0f / 3, 2.0f / 3, 2.0f / 3, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+	for (int i = 0; i < 9; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			float sum = 0;
+			for (unsigned int face = 0; face < 6; face++)
+				sum += faceSums[face][i][c];
+			irradiance[i][c] = c < 3 ? sum * (4.0f * Pi / totalWeight) * bands[i] : 0.0f;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Every texel of every mip gathers its mip's lobe, turned
+// to face along the texel's direction.  Four lobe samples
+// are rotated at a time; each then reads one texel from its
+// source level.  Work is split into strips of rows, so the
+// big top mip doesn't end up on one thread.
+// --------------------------------------------------------
+void PrefilterSpecular(const ImageLightingSource& source, const ImageLightingSettings& settings, DdsTexture& specular, ThreadPool* pool)
+{
+	unsigned int size = settings.SpecularSize < source.Size ? settings.SpecularSize : source.Size;
+	unsigned int mipCount = GetMipLevelCount(size, size);
+	mipCount = settings.SpecularMips < mipCount ? settings.SpecularMips : mipCount;
+
+	specular = DdsTexture();
+	specular.Width = size;
+	specular.Height = size;
+	specular.MipCount = mipCount;
+	specular.ArraySize = 6;
+	specular.IsCubemap = true;
+	specular.Format = DDS_FORMAT_R8G8B8A8_UNORM_SRGB;
+	specular.Surfaces.resize((size_t)6 * mipCount);
+
+	std::vector<LobeSamples> lobes(mipCount);
+	for (unsigned int mip = 0; mip < mipCount; mip++)
+	{
+		BuildLobe(GetMipRoughness(mip, mipCount), settings.SpecularSamples, source, lobes[mip]);
+
+		// The mirror reads the level the mip's own size matches
+		if (mip == 0)
+		{
+			unsigned int level = 0;
+			while (level + 1 < source.Sizes.size() && source.Sizes[level] > size)
+				level++;
+			lobes[0].Level[0] = level;
+		}
+
+		for (unsigned int face = 0; face < 6; face++)
+		{
+			DdsSurface& surface = specular.Surfaces[(size_t)face * mipCount + mip];
+			surface.Width = surface.Height = size >> mip;
+			surface.RowPitch = surface.Width * 4;
+			surface.Data.resize((size_t)surface.RowPitch * surface.Height);
+		}
+	}
+
+	const unsigned int StripRows = 8;
+	struct Strip { unsigned int Mip, Face, Row; };
+	std::vector<Strip> strips;
+	for (unsigned int mip = 0; mip < mipCount; mip++)
+	{
+		for (unsigned int face = 0; face < 6; face++)
+		{
+			for (unsigned int row = 0; row < (size >> mip); row += StripRows)
+				strips.push_back(Strip{ mip, face, row });
+		}
+	}
+
+	ThreadPool::ForEach(pool, (unsigned int)strips.size(), [&](unsigned int i)
+	{
+		const Strip& strip = strips[i];
+		const LobeSamples& lobe = lobes[strip.Mip];
+		DdsSurface& surface = specular.Surfaces[(size_t)strip.Face * mipCount + strip.Mip];
+		unsigned int mipSize = surface.Width;
+		unsigned int lastRow = strip.Row + StripRows < mipSize ? strip.Row + StripRows : mipSize;
+		float step = 2.0f / mipSize;
+
+		for (unsigned int y = strip.Row; y < lastRow; y++)
+		{
+			for (unsigned int x = 0; x < mipSize; x++)
+			{
+				float n[3];
+				GetCubeDirection(strip.Face, (x + 0.5f) * step - 1.0f, (y + 0.5f) * step - 1.0f, n);
+				Normalize(n);
+
+				// Any tangent will do, the lobe is round
+				float up[3] = { 0, 0, 1 };
+				if (fabsf(n[2]) > 0.999f)
+				{
+					up[0] = 1;
+					up[2] = 0;
+				}
+				float tangent[3] = { up[1] * n[2] - up[2] * n[1], up[2] * n[0] - up[0] * n[2], up[0] * n[1] - up[1] * n[0] };
+				Normalize(tangent);
+				float bitangent[3] = { n[1] * tangent[2] - n[2] * tangent[1], n[2] * tangent[0] - n[0] * tangent[2], n[0] * tangent[1] - n[1] * tangent[0] };
+
+				Lanes color = Splat(0);
+				float totalWeight = 0;
+				for (size_t s = 0; s < lobe.X.size(); s += 4)
+				{
+					Lanes lx = Load(&lobe.X[s]);
+					Lanes ly = Load(&lobe.Y[s]);
+					Lanes lz = Load(&lobe.Z[s]);
+					float dirs[3][4];
+					for (int c = 0; c < 3; c++)
+						Store(dirs[c], Add(Add(Mul(Splat(tangent[c]), lx), Mul(Splat(bitangent[c]), ly)), Mul(Splat(n[c]), lz)));
+
+					for (int lane = 0; lane < 4; lane++)
+					{
+						float weight = lobe.Weight[s + lane];
+						if (weight == 0)
+							continue;
+
+						unsigned int level = lobe.Level[s + lane];
+						float dir[3] = { dirs[0][lane], dirs[1][lane], dirs[2][lane] };
+						CubeTexel texel = GetCubeTexel(dir, source.Sizes[level]);
+						const float* in = &source.Faces[texel.Face][level][((size_t)texel.Y * source.Sizes[level] + texel.X) * 4];
+						color = Add(color, Mul(Load(in), Splat(weight)));
+						totalWeight += weight;
+					}
+				}
+
+				float rgba[4];
+				Store(rgba, Mul(color, Splat(1.0f / totalWeight)));
+				unsigned char* out = &surface.Data[(size_t)y * surface.RowPitch + x * 4];
+				out[0] = EncodeSrgb(rgba[0]);
+				out[1] = EncodeSrgb(rgba[1]);
+				out[2] = EncodeSrgb(rgba[2]);
+				out[3] = 255;
+			}
+		}
+	});
+}
+
+// --------------------------------------------------------
+// The split sum's second half: for each N.V and roughness,
+// what F0 is scaled by and biased by once the GGX lobe is
+// integrated against Schlick-GGX visibility (k = alpha / 2,
+// the image-based lighting remap).  A row shares its
+// half vectors, and texels take four of them at a time.
+// --------------------------------------------------------
+void BuildBrdfLut(const ImageLightingSettings& settings, DdsTexture& lut, ThreadPool* pool)
+{
+	unsigned int size = settings.BrdfSize;
+	unsigned int sampleCount = (settings.BrdfSamples + 3) / 4 * 4;
+
+	lut = DdsTexture();
+	lut.Width = size;
+	lut.Height = size;
+	lut.Format = DDS_FORMAT_R16G16_UNORM;
+	lut.Surfaces.resize(1);
+	DdsSurface& surface = lut.Surfaces[0];
+	surface.Width = surface.Height = size;
+	surface.RowPitch = size * 4;
+	surface.Data.resize((size_t)surface.RowPitch * size);
+
+	ThreadPool::ForEach(pool, size, [&](unsigned int y)
+	{
+		float roughness = (y + 0.5f) / size;
+		float alpha = roughness * roughness;
+		float alpha2 = alpha * alpha;
+		float k = alpha * 0.5f;
+
+		// Padding past BrdfSamples has H = 0, so N.L < 0 masks it out
+		std::vector<float> hx(sampleCount), hy(sampleCount), hz(sampleCount);
+		for (unsigned int i = 0; i < settings.BrdfSamples; i++)
+		{
+			float u = (i + 0.5f) / settings.BrdfSamples;
+			float v = RadicalInverse(i);
+			float phi = 2.0f * Pi * u;
+			float cosTheta = sqrtf((1.0f - v) / (1.0f + (alpha2 - 1.0f) * v));
+			float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+			hx[i] = sinTheta * cosf(phi);
+			hy[i] = sinTheta * sinf(phi);
+			hz[i] = cosTheta;
+		}
+
+		for (unsigned int x = 0; x < size; x++)
+		{
+			float nDotV = (x + 0.5f) / size;
+			Lanes vx = Splat(sqrtf(1.0f - nDotV * nDotV));
+			Lanes vz = Splat(nDotV);
+			Lanes one = Splat(1.0f);
+			Lanes kLanes = Splat(k);
+			Lanes g1View = Div(vz, Add(Mul(vz, Sub(one, kLanes)), kLanes));
+
+			Lanes scale = Splat(0), bias = Splat(0);
+			for (unsigned int i = 0; i < sampleCount; i += 4)
+			{
+				Lanes h_x = Load(&hx[i]);
+				Lanes h_z = Load(&hz[i]);
+				Lanes vDotH = Max(Add(Mul(vx, h_x), Mul(vz, h_z)), Splat(0));
+				Lanes nDotL = Sub(Mul(Mul(Splat(2.0f), vDotH), h_z), vz);
+				Lanes mask = Greater(nDotL, Splat(0));
+
+				Lanes g1Light = Div(nDotL, Add(Mul(nDotL, Sub(one, kLanes)), kLanes));
+				Lanes visibility = Div(Mul(Mul(g1View, g1Light), vDotH), Mul(h_z, vz));
+				Lanes fresnel = Sub(one, vDotH);
+				Lanes fresnel2 = Mul(fresnel, fresnel);
+				fresnel = Mul(Mul(fresnel2, fresnel2), fresnel);
+
+				scale = Add(scale, Keep(Mul(Sub(one, fresnel), visibility), mask));
+				bias = Add(bias, Keep(Mul(fresnel, visibility), mask));
+			}
+
+			float a = Sum(scale) / settings.BrdfSamples;
+			float b = Sum(bias) / settings.BrdfSamples;
+			unsigned short texel[2] =
+			{
+				(unsigned short)((a < 0 ? 0 : (a > 1 ? 1 : a)) * 65535.0f + 0.5f),
+				(unsigned short)((b < 0 ? 0 : (b > 1 ? 1 : b)) * 65535.0f + 0.5f),
+			};
+			memcpy(&surface.Data[(size_t)y * surface.RowPitch + x * 4], texel, sizeof(texel));
+		}
+	});
+}
+
+// The irradiance file back into coefficients
+static bool ReadIrradiance(const std::filesystem::path& path, float irradiance[9][4])
+{
+	TextureContainer container;
+	std::string error;
+	if (!container.Open(path, error))
+		return false;
+
+	const DdsTexture& description = container.GetDescription();
+	if (description.Format != DDS_FORMAT_R32G32B32A32_FLOAT || description.Width != 9 || description.Height != 1)
+		return false;
+
+	memcpy(irradiance, container.GetSubresource(0, 0).Data, sizeof(float) * 9 * 4);
+	return true;
+}
+
+ImageLightingBaker::ImageLightingBaker(const std::filesystem::path& outputDirectory) :
+	outputDirectory(outputDirectory)
+{
+}
+
+ImageLightingResults ImageLightingBaker::Bake(const std::filesystem::path& sky, const ImageLightingSettings& settings, ThreadPool* pool, bool useCache)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	ImageLightingResults results;
+
+	// Keyed by the sky's bytes, so a re-cooked sky re-bakes
+	auto stageStart = std::chrono::high_resolution_clock::now();
+	MappedFile skyFile(sky);
+	TextureContainer container;
+	if (!skyFile.IsOpen() || !container.Parse((const unsigned char*)skyFile.GetData(), skyFile.GetSize(), results.Error))
+	{
+		if (results.Error.empty())
+			results.Error = "Can't open " + sky.string();
+		return results;
+	}
+
+	std::string hash;
+	std::string lutKey = ImageLightingKeyVersion;
+	lutKey += '\0';
+	lutKey += std::to_string(settings.BrdfSize) + "x" + std::to_string(settings.BrdfSamples);
+
+	std::string skyKey = ImageLightingKeyVersion;
+	skyKey += '\0';
+	skyKey += std::to_string(settings.SpecularSize) + "x" + std::to_string(settings.SpecularMips) + "x" + std::to_string(settings.SpecularSamples);
+	skyKey += '\0';
+	skyKey += std::to_string(settings.IrradianceSize);
+	skyKey += '\0';
+	hash = FormatHashKey(HashBytes(skyFile.GetData(), skyFile.GetSize()));
+	skyKey += hash;
+
+	hash = FormatHashKey(HashBytes(skyKey.data(), skyKey.size()));
+	results.Irradiance = outputDirectory / (std::string("ibl_irradiance_") + hash + ".dds");
+	results.Specular = outputDirectory / (std::string("ibl_specular_") + hash + ".dds");
+	hash = FormatHashKey(HashBytes(lutKey.data(), lutKey.size()));
+	results.BrdfLut = outputDirectory / (std::string("ibl_brdf_") + hash + ".dds");
+	results.HashMs = MsSince(stageStart);
+
+	DdsTexture header;
+	if (useCache && std::filesystem::exists(results.Specular) && std::filesystem::exists(results.BrdfLut) &&
+		ReadDdsHeader(results.Specular, header) && ReadIrradiance(results.Irradiance, results.Coefficients))
+	{
+		results.Cached = true;
+		results.SpecularMips = header.MipCount;
+		results.Milliseconds = MsSince(start);
+		return results;
+	}
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	ImageLightingSource source;
+	if (!LoadImageLightingSource(container, settings.SpecularSize, source, results.Error))
+	{
+		results.Error = sky.filename().string() + ": " + results.Error;
+		return results;
+	}
+	results.LoadMs = MsSince(stageStart);
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	ProjectIrradiance(source, settings, results.Coefficients, pool);
+	results.IrradianceMs = MsSince(stageStart);
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	DdsTexture specular;
+	PrefilterSpecular(source, settings, specular, pool);
+	results.SpecularMips = specular.MipCount;
+	results.SpecularMs = MsSince(stageStart);
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	DdsTexture brdfLut;
+	BuildBrdfLut(settings, brdfLut, pool);
+	results.BrdfMs = MsSince(stageStart);
+
+	if (useCache)
+	{
+		stageStart = std::chrono::high_resolution_clock::now();
+		DdsTexture irradiance;
+		irradiance.Width = 9;
+		irradiance.Height = 1;
+		irradiance.Format = DDS_FORMAT_R32G32B32A32_FLOAT;
+		DdsSurface& surface = irradiance.Surfaces.emplace_back();
+		surface.Width = 9;
+		surface.Height = 1;
+		surface.RowPitch = 9 * 16;
+		surface.Data.resize(surface.RowPitch);
+		memcpy(surface.Data.data(), results.Coefficients, surface.Data.size());
+
+		std::error_code error;
+		std::filesystem::create_directories(outputDirectory, error);
+		if (!SaveDds(results.Irradiance, irradiance) || !SaveDds(results.Specular, specular) || !SaveDds(results.BrdfLut, brdfLut))
+		{
+			results.Error = "Can't write to " + outputDirectory.string();
+			return results;
+		}
+		results.WriteMs = MsSince(stageStart);
+	}
+
+	results.Milliseconds = MsSince(start);
+	return results;
+}
+
+ImageLightingBenchmarkResults ImageLightingBenchmark(const std::filesystem::path& sky, const ImageLightingSettings& settings, ThreadPool& pool)
+{
+	ImageLightingBaker baker("");
+	ImageLightingBenchmarkResults results;
+	results.Threads = pool.GetThreadCount() + 1;
+	results.Inline = baker.Bake(sky, settings, nullptr, false);
+	results.Pooled = baker.Bake(sky, settings, &pool, false);
+	return results;
+}
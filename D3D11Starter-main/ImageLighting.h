@@ -0,0 +1,111 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "DdsFile.h"
+#include "TextureContainer.h"
+#include "ThreadPool.h"
+
+// --------------------------------------------------------
+// Image-based lighting baked from the sky cube map, for the
+// split-sum approximation the pixel shader uses in place of
+// a constant ambient color:
+//
+//  - Irradiance: the sky projected onto 9 spherical harmonic
+//    coefficients and convolved with a cosine lobe, already
+//    divided by pi, so albedo * SH(normal) is the diffuse
+//  - Specular: the sky prefiltered with GGX at a roughness
+//    per mip, from a mirror at mip 0 to fully rough at the
+//    last one
+//  - BRDF LUT: the split sum's scale and bias on F0, with
+//    N.V across and roughness down
+// --------------------------------------------------------
+struct ImageLightingSettings
+{
+	unsigned int SpecularSize = 128;    // Top mip of the specular cube map
+	unsigned int SpecularMips = 6;      // One roughness step each, 128 down to 4
+	unsigned int SpecularSamples = 256; // GGX samples per texel
+	unsigned int IrradianceSize = 32;   // Face size the harmonics are projected from
+	unsigned int BrdfSize = 64;
+	unsigned int BrdfSamples = 512;
+};
+
+// What the bakes read: the sky's mips as linear RGBA floats
+struct ImageLightingSource
+{
+	unsigned int Size = 0; // Top level kept
+	std::vector<unsigned int> Sizes;
+	std::vector<std::vector<float>> Faces[6]; // Per level
+};
+
+// Keeps the mips from maxSize down, decoding block
+// compressed skies.  Fails for anything but a cube map.
+bool LoadImageLightingSource(const TextureContainer& sky, unsigned int maxSize, ImageLightingSource& source, std::string& error);
+
+// --------------------------------------------------------
+// The three bakes.  Each takes the pool, or none to run
+// inline; inner loops work on four samples (or channels) at
+// a time with SSE2, scalar where it's missing.
+//
+// Irradiance is RGB per coefficient, padded to match a
+// cbuffer float4 array.  Specular is an RGBA8 sRGB cube
+// map; the LUT is RG16 with the scale in R, bias in G.
+// --------------------------------------------------------
+void ProjectIrradiance(const ImageLightingSource& source, const ImageLightingSettings& settings, float irradiance[9][4], ThreadPool* pool);
+void PrefilterSpecular(const ImageLightingSource& source, const ImageLightingSettings& settings, DdsTexture& specular, ThreadPool* pool);
+void BuildBrdfLut(const ImageLightingSettings& settings, DdsTexture& lut, ThreadPool* pool);
+
+// --------------------------------------------------------
+// What one bake did, with each stage timed.  Cached bakes
+// only hash the sky and read the irradiance back.
+// --------------------------------------------------------
+struct ImageLightingResults
+{
+	std::string Error; // Empty on success
+	bool Cached = false;
+	std::filesystem::path Irradiance; // 9x1 RGBA32F
+	std::filesystem::path Specular;
+	std::filesystem::path BrdfLut;
+	float Coefficients[9][4] = {};
+	unsigned int SpecularMips = 0;
+	double HashMs = 0;
+	double LoadMs = 0;
+	double IrradianceMs = 0;
+	double SpecularMs = 0;
+	double BrdfMs = 0;
+	double WriteMs = 0;
+	double Milliseconds = 0;
+};
+
+// --------------------------------------------------------
+// Bakes a cooked sky cube map's lighting to DDS files named
+// by a key hashed from the sky file and settings, so a run
+// with the same sky reads the last one's.  The BRDF LUT
+// doesn't depend on the sky and is keyed by settings alone.
+// --------------------------------------------------------
+class ImageLightingBaker
+{
+public:
+	ImageLightingBaker(const std::filesystem::path& outputDirectory);
+
+	// Pass no pool to run inline; with one, don't call this from
+	// inside a pool task.  Without the cache nothing is read or
+	// written, which is what the benchmark wants.
+	ImageLightingResults Bake(const std::filesystem::path& sky, const ImageLightingSettings& settings, ThreadPool* pool, bool useCache = true);
+
+private:
+	std::filesystem::path outputDirectory;
+};
+
+// --------------------------------------------------------
+// Uncached bake times for a sky, inline and across the pool
+// --------------------------------------------------------
+struct ImageLightingBenchmarkResults
+{
+	ImageLightingResults Inline;
+	ImageLightingResults Pooled;
+	unsigned int Threads = 0;
+};
+
+ImageLightingBenchmarkResults ImageLightingBenchmark(const std::filesystem::path& sky, const ImageLightingSettings& settings, ThreadPool& pool);
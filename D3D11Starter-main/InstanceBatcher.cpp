@@ -0,0 +1,36 @@
+#include "InstanceBatcher.h"
+
+void InstanceBatcher::Build(const DrawList& list, size_t begin, size_t end, unsigned int maxInstances)
+{
+	batches.clear();
+	stats = InstanceBatchStats();
+
+	// Everything above the depth bucket has to match
+	const unsigned long long batchMask = ~((1ull << (DrawKeyDepthShift + DrawKeyDepthBits)) - 1);
+	const std::vector<DrawItem>& items = list.GetItems();
+
+	for (size_t i = begin; i < end; i++)
+	{
+		if (!batches.empty())
+		{
+			InstanceBatch& last = batches.back();
+			if (last.Count < maxInstances &&
+				(items[last.First].Key & batchMask) == (items[i].Key & batchMask))
+			{
+				last.Count++;
+				continue;
+			}
+		}
+
+		batches.push_back(InstanceBatch{ i, 1 });
+	}
+
+	stats.Draws = (unsigned int)(end - begin);
+	stats.Batches = (unsigned int)batches.size();
+	stats.DrawCallsSaved = stats.Draws - stats.Batches;
+	for (const InstanceBatch& batch : batches)
+	{
+		if (batch.Count > 1)
+			stats.BatchesFormed++;
+	}
+}
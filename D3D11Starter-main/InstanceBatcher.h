@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+
+#include "DrawList.h"
+
+// A run of draws that can go out as one instanced draw
+struct InstanceBatch
+{
+	size_t First;       // Index of the first item in the draw list
+	unsigned int Count; // Items First to First + Count - 1
+};
+
+struct InstanceBatchStats
+{
+	unsigned int Draws = 0;
+	unsigned int Batches = 0;        // Draw calls actually made
+	unsigned int BatchesFormed = 0;  // Batches of more than one draw
+	unsigned int DrawCallsSaved = 0; // Draws - Batches
+};
+
+// --------------------------------------------------------
+// Groups a sorted draw list's neighbouring draws whose keys
+// match on everything but depth - same pass, pipeline,
+// material and mesh - so each group can be drawn with one
+// DrawIndexedInstanced.  Sorting is what puts matching draws
+// next to each other; unsorted lists still work, they just
+// form fewer batches.
+//
+// Batch instances are numbered by draw list position, so the
+// instance buffer holds one entry per item in list order and
+// a batch's first instance is its First.
+// --------------------------------------------------------
+class InstanceBatcher
+{
+public:
+	// Replaces the batches with those for items [begin, end).
+	// A maxInstances of 1 turns batching off.
+	void Build(const DrawList& list, size_t begin, size_t end, unsigned int maxInstances);
+
+	const std::vector<InstanceBatch>& GetBatches() const { return batches; }
+	const InstanceBatchStats& GetStats() const { return stats; }
+
+private:
+	std::vector<InstanceBatch> batches;
+	InstanceBatchStats stats;
+};
@@ -0,0 +1,54 @@
+#include "InstanceBuffer.h"
+#include "Graphics.h"
+#include <cstring>
+
+InstanceBuffer::InstanceBuffer(unsigned int initialCapacity) :
+	capacity(initialCapacity > 0 ? initialCapacity : 1),
+	count(0)
+{
+}
+
+// --------------------------------------------------------
+// (Re)creates the buffer at the current capacity
+// --------------------------------------------------------
+void InstanceBuffer::CreateBuffer()
+{
+	buffer.Reset();
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = sizeof(InstanceData) * capacity;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	Graphics::Device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+}
+
+// --------------------------------------------------------
+// Discards the old contents and writes the new ones with a
+// single map, so the GPU never waits on last frame's data
+// --------------------------------------------------------
+void InstanceBuffer::Upload(const InstanceData* instances, unsigned int instanceCount)
+{
+	if (!buffer || instanceCount > capacity)
+	{
+		while (capacity < instanceCount)
+			capacity *= 2;
+		CreateBuffer();
+	}
+
+	count = instanceCount;
+	if (count == 0 || !buffer)
+		return;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (SUCCEEDED(Graphics::Context->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+	{
+		memcpy(mapped.pData, instances, sizeof(InstanceData) * count);
+		Graphics::Context->Unmap(buffer.Get(), 0);
+	}
+}
+
+void InstanceBuffer::Bind(unsigned int slot)
+{
+	Graphics::States->SetVertexBuffer(slot, buffer.Get(), sizeof(InstanceData), 0);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include "ShaderStructs.h"
+
+// --------------------------------------------------------
+// Dynamic vertex buffer of InstanceData, refilled once per
+// frame and bound to the instanced shaders' slot 1.  Grows
+// (doubling) when a frame needs more room than it has.
+// --------------------------------------------------------
+class InstanceBuffer
+{
+public:
+	InstanceBuffer(unsigned int initialCapacity = 256);
+
+	// Replaces the contents with count instances
+	void Upload(const InstanceData* instances, unsigned int count);
+
+	// Binds to the per-instance vertex buffer slot
+	void Bind(unsigned int slot = 1);
+
+	unsigned int GetCapacity() const { return capacity; }
+	unsigned int GetCount() const { return count; }
+
+private:
+	unsigned int capacity;
+	unsigned int count;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+
+	void CreateBuffer();
+};
@@ -0,0 +1,28 @@
+#include "ShaderIncludes.hlsli"
+
+// ShadowMapVertexShader.hlsl with the world matrix read per
+// instance - see InstancedVertexShader.hlsl
+
+// Set once per frame
+cbuffer PerFrame : register(b0)
+{
+    matrix view;
+    matrix projection;
+}
+
+// Only the world matrix is read, but the instance buffer's
+// stride is still the full InstanceData
+struct VertexShaderInput
+{
+    float3 localPosition : POSITION;
+    float3 normal : NORMAL;
+    float3 tangent : TANGENT;
+    float2 uv : TEXCOORD;
+    float4x4 world : WORLD_PER_INSTANCE;
+};
+
+float4 main(VertexShaderInput input) : SV_POSITION
+{
+    matrix wvp = mul(projection, mul(view, input.world));
+    return mul(wvp, float4(input.localPosition, 1.0f));
+}
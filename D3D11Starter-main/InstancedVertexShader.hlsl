@@ -0,0 +1,52 @@
+#include "ShaderIncludes.hlsli"
+
+// Same as VertexShader.hlsl, but the per-object data comes
+// from the instance buffer instead of a cbuffer, so a whole
+// batch of entities sharing a mesh and material is one draw.
+// In atlas mode the material can differ per instance too.
+
+// Set once per frame
+cbuffer PerFrame : register(b0)
+{
+    float4x4 viewMat;
+    float4x4 projMat;
+    matrix lightView;
+    matrix lightProj;
+}
+
+// Slot 0 is the mesh's vertices, slot 1 the instance buffer
+// - The "_PER_INSTANCE" suffix is what tells SimpleShader to
+//   read an element from slot 1, once per instance
+// - Must match InstanceData in ShaderStructs.h
+struct VertexShaderInput
+{
+    float3 localPosition : POSITION;
+    float3 normal : NORMAL;
+    float3 tangent : TANGENT;
+    float2 uv : TEXCOORD;
+    float4x4 world : WORLD_PER_INSTANCE;
+    float4x4 worldInvTranspose : WORLDINVTRANSPOSE_PER_INSTANCE;
+    uint materialIndex : MATERIAL_PER_INSTANCE;
+};
+
+VertexToPixel main(VertexShaderInput input)
+{
+    VertexToPixel output;
+
+    matrix wvp = mul(projMat, mul(viewMat, input.world));
+    output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+
+    output.uv = input.uv;
+
+    output.normal = normalize(mul((float3x3)input.worldInvTranspose, input.normal));
+    output.tangent = normalize(mul((float3x3)input.world, input.tangent));
+
+    output.worldPosition = mul(input.world, float4(input.localPosition, 1)).xyz;
+
+    matrix shadowWVP = mul(lightProj, mul(lightView, input.world));
+    output.shadowMapPos = mul(shadowWVP, float4(input.localPosition, 1.0f));
+
+    output.materialIndex = input.materialIndex;
+
+    return output;
+}
@@ -0,0 +1,57 @@
+#include "LightManager.h"
+#include "Graphics.h"
+
+LightManager::LightManager(unsigned int initialCapacity) :
+	lights(initialCapacity)
+{
+}
+
+// --------------------------------------------------------
+// (Re)creates the structured buffer and its SRV at the
+// current capacity
+// --------------------------------------------------------
+void LightManager::CreateBuffer()
+{
+	buffer.Reset();
+	srv.Reset();
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.ByteWidth = sizeof(Light) * lights.GetCapacity();
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	desc.StructureByteStride = sizeof(Light);
+	Graphics::Device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = lights.GetCapacity();
+	Graphics::Device->CreateShaderResourceView(buffer.Get(), &srvDesc, srv.GetAddressOf());
+}
+
+// --------------------------------------------------------
+// Sends changed lights to the GPU.  Only the dirty range
+// is copied unless the buffer had to be recreated.
+// --------------------------------------------------------
+void LightManager::Upload()
+{
+	PackedUpload upload = lights.TakeUpload();
+	if (upload.Recreate)
+		CreateBuffer();
+
+	if (upload.Count > 0)
+	{
+		// Copy just the changed lights
+		D3D11_BOX box = {};
+		box.left = upload.First * sizeof(Light);
+		box.right = (upload.First + upload.Count) * sizeof(Light);
+		box.top = 0;
+		box.bottom = 1;
+		box.front = 0;
+		box.back = 1;
+		Graphics::Context->UpdateSubresource(buffer.Get(), 0, &box, lights.GetData() + upload.First, 0, 0);
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+#include "Lights.h"
+#include "PackedUploadArray.h"
+
+// Lights are uploaded as a StructuredBuffer<Light>, so the C++ struct
+// must keep the same 16-byte aligned stride as the HLSL one
+static_assert(sizeof(Light) == 64, "Light must match the HLSL StructuredBuffer stride");
+
+// --------------------------------------------------------
+// Owns the packed array of scene lights and the GPU
+// structured buffer they live in.
+//
+// - Lights can be added, removed or edited at any time
+// - Edits only mark the touched range as dirty, and
+//   Upload() copies just that range to the GPU
+// - The bookkeeping is PackedUploadArray's; Upload() is
+//   the only part that touches Direct3D
+// --------------------------------------------------------
+class LightManager
+{
+public:
+	LightManager(unsigned int initialCapacity = 16);
+
+	// Editing the light list
+	unsigned int AddLight(const Light& light) { return lights.Add(light); }
+	void RemoveLight(unsigned int index) { lights.Remove(index); }
+	bool SetLight(unsigned int index, const Light& light) { return lights.Set(index, light); }
+	void Clear() { lights.Clear(); }
+
+	// Getters
+	const Light& GetLight(unsigned int index) const { return lights.Get(index); }
+	const Light* GetLightData() const { return lights.GetData(); }
+	unsigned int GetLightCount() const { return lights.GetCount(); }
+	unsigned int GetCapacity() const { return lights.GetCapacity(); }
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetSRV() { return srv; }
+
+	// Change tracking
+	bool IsDirty() const { return lights.IsDirty(); }
+	unsigned int GetDirtyFirst() const { return lights.GetDirtyFirst(); }
+	unsigned int GetDirtyCount() const { return lights.GetDirtyCount(); }
+	unsigned int GetPendingUploadBytes() const { return lights.GetPendingUploadBytes(); }
+
+	// Upload stats
+	unsigned int GetLastUploadBytes() const { return lights.GetLastUploadBytes(); }
+	unsigned long long GetTotalUploadBytes() const { return lights.GetTotalUploadBytes(); }
+
+	// Copies any changed lights to the GPU, growing the buffer if needed
+	void Upload();
+
+private:
+	PackedUploadArray<Light> lights;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+
+	void CreateBuffer();
+};
@@ -0,0 +1,103 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+	Open(path);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+// --------------------------------------------------------
+// Maps the entire file for reading
+//
+// Returns false if the file is missing, empty or can't
+// be mapped
+// --------------------------------------------------------
+bool MappedFile::Open(const std::filesystem::path& path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = (const unsigned char*)view;
+	size = (size_t)fileSize.QuadPart;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info = {};
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		close(file);
+		return false;
+	}
+
+	// The mapping stays valid after the descriptor is closed
+	void* view = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (view == MAP_FAILED)
+		return false;
+
+	data = (const unsigned char*)view;
+	size = (size_t)info.st_size;
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle) CloseHandle(fileHandle);
+	mappingHandle = 0;
+	fileHandle = 0;
+#else
+	if (data) munmap((void*)data, size);
+#endif
+
+	data = 0;
+	size = 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <filesystem>
+
+// --------------------------------------------------------
+// A read-only memory mapping of a whole file.  Uses
+// CreateFileMapping on Windows and mmap elsewhere, so code
+// reading cached data doesn't need a platform check.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const std::filesystem::path& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::filesystem::path& path);
+	void Close();
+
+	bool IsOpen() const { return data != 0; }
+	const unsigned char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	const unsigned char* data = 0;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* fileHandle = 0;
+	void* mappingHandle = 0;
+#endif
+};
@@ -0,0 +1,104 @@
+#include "MaterialAtlas.h"
+
+MaterialAtlas::MaterialAtlas(unsigned int channelCount) :
+	channels(channelCount)
+{
+}
+
+int MaterialAtlas::AddMaterial(const std::vector<const TextureContainer*>& textures, std::string& error)
+{
+	if (textures.size() != channels.size())
+	{
+		error = "Expected " + std::to_string(channels.size()) + " textures";
+		return -1;
+	}
+
+	// Same textures, same slice
+	for (unsigned int slice = 0; slice < slices.size(); slice++)
+	{
+		if (slices[slice] == textures)
+			return (int)slice;
+	}
+
+	if (slices.size() >= MaxSlices)
+	{
+		error = "No slices left";
+		return -1;
+	}
+
+	for (unsigned int c = 0; c < channels.size(); c++)
+	{
+		if (!textures[c] || textures[c]->GetSubresources().empty())
+		{
+			error = "Channel " + std::to_string(c) + " has no texture";
+			return -1;
+		}
+
+		const DdsTexture& texture = textures[c]->GetDescription();
+		if (texture.ArraySize != 1 || texture.IsCubemap)
+		{
+			error = "Channel " + std::to_string(c) + " isn't a single 2D texture";
+			return -1;
+		}
+
+		const DdsTexture& array = channels[c].Description;
+		if (!slices.empty() && (texture.Width != array.Width || texture.Height != array.Height || texture.Format != array.Format))
+		{
+			error = "Channel " + std::to_string(c) + " is " +
+				std::to_string(texture.Width) + "x" + std::to_string(texture.Height) + " " + GetDdsFormatName(texture.Format) +
+				", the array is " +
+				std::to_string(array.Width) + "x" + std::to_string(array.Height) + " " + GetDdsFormatName(array.Format);
+			return -1;
+		}
+	}
+
+	// Everything fits, so only now change the arrays
+	for (unsigned int c = 0; c < channels.size(); c++)
+	{
+		const DdsTexture& texture = textures[c]->GetDescription();
+		DdsTexture& array = channels[c].Description;
+		if (slices.empty())
+		{
+			array.Width = texture.Width;
+			array.Height = texture.Height;
+			array.Format = texture.Format;
+			array.MipCount = texture.MipCount;
+		}
+		else if (texture.MipCount < array.MipCount)
+		{
+			array.MipCount = texture.MipCount;
+		}
+	}
+
+	slices.push_back(textures);
+	return (int)slices.size() - 1;
+}
+
+DdsTexture MaterialAtlas::GetArrayDescription(unsigned int channel) const
+{
+	DdsTexture description = channels[channel].Description;
+	description.ArraySize = (unsigned int)slices.size();
+	return description;
+}
+
+std::vector<TextureSubresource> MaterialAtlas::GetArraySubresources(unsigned int channel) const
+{
+	unsigned int mipCount = channels[channel].Description.MipCount;
+
+	std::vector<TextureSubresource> subresources;
+	subresources.reserve(slices.size() * mipCount);
+	for (const std::vector<const TextureContainer*>& slice : slices)
+	{
+		for (unsigned int mip = 0; mip < mipCount; mip++)
+			subresources.push_back(slice[channel]->GetSubresource(mip, 0));
+	}
+	return subresources;
+}
+
+size_t MaterialAtlas::GetArrayBytes() const
+{
+	size_t bytes = 0;
+	for (unsigned int c = 0; c < channels.size(); c++)
+		bytes += GetDdsTextureBytes(GetArrayDescription(c));
+	return bytes;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "DdsFile.h"
+#include "TextureContainer.h"
+
+// --------------------------------------------------------
+// Packs materials' textures into one texture array per
+// channel (albedo, normals, ORM...), so materials can share
+// a pixel shader's bindings and draw in the same instanced
+// call.  Each set of textures gets a slice, and the slice is
+// the same in every channel, so one index finds them all.
+// Materials made from the same textures share a slice.
+//
+// The first material sets each channel's size and format;
+// later ones must match, or they're turned away and keep
+// drawing on their own.  Mip chains may differ in length -
+// the arrays keep the mips every slice has.
+//
+// Nothing here touches Direct3D.  An array is described by
+// the containers' mapped subresources in D3D11 order, ready
+// for CreateTexture2D, so the containers must outlive it.
+// --------------------------------------------------------
+class MaterialAtlas
+{
+public:
+	MaterialAtlas(unsigned int channelCount);
+
+	// Finds or allocates the slice for a material's textures,
+	// one per channel in channel order.  -1 if they don't fit
+	// the arrays (or the arrays are full), with why in error.
+	int AddMaterial(const std::vector<const TextureContainer*>& textures, std::string& error);
+
+	unsigned int GetChannelCount() const { return (unsigned int)channels.size(); }
+	unsigned int GetSliceCount() const { return (unsigned int)slices.size(); }
+
+	// A channel's array: the shared size, format and mips, with
+	// one slice per allocated slice.  Surfaces is always empty.
+	DdsTexture GetArrayDescription(unsigned int channel) const;
+
+	// Every subresource of a channel's array, slice by slice,
+	// each with its mips top down
+	std::vector<TextureSubresource> GetArraySubresources(unsigned int channel) const;
+
+	// Every channel's array, every mip
+	size_t GetArrayBytes() const;
+
+	// D3D11's limit on array slices
+	static const unsigned int MaxSlices = 2048;
+
+private:
+	struct Channel
+	{
+		DdsTexture Description; // ArraySize unused
+	};
+
+	std::vector<Channel> channels;
+	std::vector<std::vector<const TextureContainer*>> slices; // Textures per slice, by channel
+};
@@ -1 +1,105 @@
 #include "Materials.h"
+#include "Graphics.h"
+
+#include <chrono>
+#include <cstring>
+
+// --------------------------------------------------------
+// Resolves textures, samplers and the PerMaterial values
+// against the current pixel shader.  Anything the shader
+// doesn't declare is left out, so the debug shaders that
+// only read colorTint just get that.
+// --------------------------------------------------------
+void Materials::Bake()
+{
+	bindings = MaterialBindingTable();
+	bindings.Shader = pixel.get();
+	dirty = false;
+	bakeCount++;
+
+	for (auto& t : textureSRVs)
+	{
+		const SimpleSRV* info = pixel->GetShaderResourceViewInfo(t.first);
+		if (info)
+			bindings.ShaderResources.push_back({ info->BindIndex, t.second.Get() });
+	}
+
+	for (auto& s : samplers)
+	{
+		const SimpleSampler* info = pixel->GetSamplerInfo(s.first);
+		if (info)
+			bindings.Samplers.push_back({ info->BindIndex, s.second.Get() });
+	}
+
+	for (unsigned int i = 0; i < pixel->GetBufferCount(); i++)
+	{
+		const SimpleConstantBuffer* cb = pixel->GetBufferInfo(i);
+		if (cb && cb->Name == "PerMaterial")
+		{
+			bindings.ConstantBufferIndex = (int)i;
+			bindings.Constants.assign(cb->Size, 0);
+			break;
+		}
+	}
+
+	if (bindings.ConstantBufferIndex < 0)
+		return;
+
+	// Place each value wherever this shader put it
+	auto pack = [&](const char* name, const void* data, unsigned int size)
+		{
+			const SimpleShaderVariable* var = pixel->GetVariableInfo(name);
+			if (var && var->ConstantBufferIndex == (unsigned int)bindings.ConstantBufferIndex &&
+				var->Size >= size && var->ByteOffset + size <= bindings.Constants.size())
+			{
+				memcpy(&bindings.Constants[var->ByteOffset], data, size);
+			}
+		};
+
+	pack("colorTint", color, sizeof(color));
+	pack("uvScale", uvScale, sizeof(uvScale));
+	pack("roughness", &roughness, sizeof(roughness));
+	pack("specMap", &specMap, sizeof(specMap));
+}
+
+void Materials::PrepareMaterial()
+{
+	if (dirty || bindings.Shader != pixel.get())
+		Bake();
+
+	for (const MaterialBindingTable::Slot& srv : bindings.ShaderResources)
+		Graphics::States->SetShaderResource(STATE_STAGE_PIXEL, srv.BindIndex, srv.Object);
+
+	for (const MaterialBindingTable::Slot& sampler : bindings.Samplers)
+		Graphics::States->SetSampler(STATE_STAGE_PIXEL, sampler.BindIndex, sampler.Object);
+
+	if (bindings.ConstantBufferIndex >= 0)
+	{
+		pixel->SetBufferBytes(bindings.ConstantBufferIndex, bindings.Constants.data(), (unsigned int)bindings.Constants.size());
+		pixel->CopyBufferData(bindings.ConstantBufferIndex);
+	}
+}
+
+MaterialBindBenchmarkResults MaterialBindBenchmark(std::shared_ptr<Materials> material, unsigned int iterations)
+{
+	MaterialBindBenchmarkResults results;
+	results.Iterations = iterations;
+
+	auto nsPerCall = [iterations](std::chrono::high_resolution_clock::time_point start)
+		{
+			std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+			return elapsed.count() / iterations;
+		};
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < iterations; i++)
+		material->PrepareMaterialByName();
+	results.ByNameNs = nsPerCall(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < iterations; i++)
+		material->PrepareMaterial();
+	results.BakedNs = nsPerCall(start);
+
+	return results;
+}
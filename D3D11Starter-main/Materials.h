@@ -1,7 +1,39 @@
 #pragma once
 #include <memory>
 #include "SimpleShader.h"
+#include "PipelineState.h"
+#include "ShaderStructs.h"
 #include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// A material resolved against its pixel shader's reflection:
+// which register each texture and sampler goes in, and the
+// PerMaterial cbuffer already packed to the shader's layout.
+// Binding it is a few array walks with no name lookups.
+// --------------------------------------------------------
+struct MaterialBindingTable
+{
+	struct Slot
+	{
+		unsigned int BindIndex;
+		const void* Object; // Kept alive by the material's own maps
+	};
+
+	const void* Shader = 0; // What it was baked against
+	std::vector<Slot> ShaderResources;
+	std::vector<Slot> Samplers;
+	int ConstantBufferIndex = -1; // -1 if the shader has no PerMaterial
+	std::vector<unsigned char> Constants;
+};
+
+// Per-call cost of binding a material, by name and baked
+struct MaterialBindBenchmarkResults
+{
+	unsigned int Iterations = 0;
+	double ByNameNs = 0;
+	double BakedNs = 0;
+};
 
 class Materials
 {
@@ -14,6 +46,14 @@ private:
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
 	int specMap;
 	float uvScale[2];
+	unsigned int features; // ShaderFeature bits this material supports, if it uses permutations
+	std::shared_ptr<PipelineState> pipeline; // Matches the current shaders, from Game's pipeline cache
+	std::shared_ptr<PipelineState> instancedPipeline; // Same, with the instanced vertex shader
+	MaterialBindingTable bindings;
+	bool dirty; // Something changed since the last bake
+	unsigned int bakeCount;
+
+	void Bake();
 
 public:
 	Materials(float tint[4], float rough, std::shared_ptr<SimpleVertexShader> vertexShader, std::shared_ptr<SimplePixelShader> pixelShader,int specTF,float texSize[2])
@@ -35,15 +75,29 @@ public:
 		if (rough < 0) rough = 0;
 
 		specMap = specTF;
-
+		features = 0;
+		dirty = true;
+		bakeCount = 0;
 	}
 
-	void PrepareMaterial()
+	// Binds textures and uploads the PerMaterial cbuffer - only
+	// needs to happen when the material being drawn changes.
+	// Re-bakes first if the material or its shader changed.
+	void PrepareMaterial();
+
+	// The unbaked way, looking everything up by name each call.
+	// Kept as the baseline for MaterialBindBenchmark().
+	void PrepareMaterialByName()
 	{
 		for (auto& t : textureSRVs) { this->GetPixelShader()->SetShaderResourceView(t.first.c_str(), t.second); }
 		for (auto& s : samplers) { this->GetPixelShader()->SetSamplerState(s.first.c_str(), s.second); }
-		this->GetPixelShader()->SetInt("specMap", specMap);
-		this->GetPixelShader()->SetFloat2("uvScale", uvScale);
+		PerMaterialPSData data = {};
+		data.colorTint = DirectX::XMFLOAT4(color);
+		data.uvScale = DirectX::XMFLOAT2(uvScale);
+		data.roughness = roughness;
+		data.specMap = specMap;
+		this->GetPixelShader()->SetBufferData(data);
+		this->GetPixelShader()->CopyBufferData("PerMaterial");
 	}
 
 	std::shared_ptr<SimpleVertexShader> GetVertexShader()
@@ -58,6 +112,8 @@ public:
 
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> pixelShader)
 	{
+		// No dirty flag - the per-frame permutation pick sets the
+		// same shader again, and PrepareMaterial() notices a real change
 		pixel = pixelShader;
 	}
 
@@ -66,7 +122,37 @@ public:
 		return pixel;
 	}
 
-	float* GetColor()
+	std::shared_ptr<PipelineState> GetPipelineState()
+	{
+		return pipeline;
+	}
+
+	void SetPipelineState(std::shared_ptr<PipelineState> pipelineState)
+	{
+		pipeline = pipelineState;
+	}
+
+	std::shared_ptr<PipelineState> GetInstancedPipelineState()
+	{
+		return instancedPipeline;
+	}
+
+	void SetInstancedPipelineState(std::shared_ptr<PipelineState> pipelineState)
+	{
+		instancedPipeline = pipelineState;
+	}
+
+	unsigned int GetFeatures()
+	{
+		return features;
+	}
+
+	void SetFeatures(unsigned int shaderFeatures)
+	{
+		features = shaderFeatures;
+	}
+
+	const float* GetColor()
 	{
 		return color;
 	}
@@ -77,6 +163,7 @@ public:
 		{
 			color[i] = tint[i];
 		}
+		dirty = true;
 	}
 
 	float GetRoughness()
@@ -89,16 +176,41 @@ public:
 		if (rough > 1) rough = 1;
 		if (rough < 0) rough = 0;
 		roughness = rough;
+		dirty = true;
 	}
 
 	void AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 	{
 		textureSRVs.insert({ name,srv });
+		dirty = true;
+	}
+
+	// Swaps in a new view for a texture that's already bound,
+	// releasing the old one (residency changes do this)
+	void SetTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+	{
+		textureSRVs[name] = srv;
+		dirty = true;
+	}
+
+	const float* GetUVScale()
+	{
+		return uvScale;
 	}
 
 	void AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
 	{
 		samplers.insert({ name,sampler });
+		dirty = true;
+	}
+
+	// How many times the binding table has been (re)built
+	unsigned int GetBakeCount()
+	{
+		return bakeCount;
 	}
 };
 
+// Times PrepareMaterialByName() against PrepareMaterial() on one material
+MaterialBindBenchmarkResults MaterialBindBenchmark(std::shared_ptr<Materials> material, unsigned int iterations);
+
@@ -403,10 +403,20 @@ void Mesh::Draw()
 	// Buffer setting
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
-	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	Graphics::States->SetVertexBuffer(0, vertexBuffer.Get(), stride, offset);
+	Graphics::States->SetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
 
 	// Draw Object
 	UINT indexCount = (UINT)GetIndexCount();
 	Graphics::Context->DrawIndexed(indexCount, 0, 0);
+}
+
+void Mesh::DrawInstanced(unsigned int instanceCount, unsigned int firstInstance)
+{
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	Graphics::States->SetVertexBuffer(0, vertexBuffer.Get(), stride, offset);
+	Graphics::States->SetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+
+	Graphics::Context->DrawIndexedInstanced((UINT)GetIndexCount(), instanceCount, 0, 0, firstInstance);
 }
\ No newline at end of file
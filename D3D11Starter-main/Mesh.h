@@ -50,5 +50,9 @@ public:
     // Methods
     void Draw();
 
+	// Draws instanceCount copies, reading per-instance data from
+	// whatever is bound to vertex buffer slot 1, starting at firstInstance
+	void DrawInstanced(unsigned int instanceCount, unsigned int firstInstance);
+
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 };
\ No newline at end of file
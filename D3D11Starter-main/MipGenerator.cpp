@@ -0,0 +1,680 @@
+#include "MipGenerator.h"
+#include "CpuHelpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace
+{
+	// Edge of the square tiles the first levels are built in.
+	// 64x64 RGBA floats is 64KB, so a tile and its smaller
+	// levels stay in L2 the whole time.
+	const unsigned int MipTileSize = 64;
+	const unsigned int MipTileLevels = 6; // 64 -> 1
+
+	// ----------------------------------------------------
+	// One RGBA texel of working data, and the handful of
+	// operations the filters need on it
+	// ----------------------------------------------------
+#ifdef CPU_USE_SSE2
+	typedef __m128 Texel;
+
+	inline Texel LoadTexel(const float* p) { return _mm_loadu_ps(p); }
+	inline void StoreTexel(float* p, Texel t) { _mm_storeu_ps(p, t); }
+	inline Texel MakeTexel(float r, float g, float b, float a) { return _mm_set_ps(a, b, g, r); }
+
+	inline Texel AverageTexels(Texel a, Texel b, Texel c, Texel d)
+	{
+		return _mm_mul_ps(_mm_add_ps(_mm_add_ps(a, b), _mm_add_ps(c, d)), _mm_set1_ps(0.25f));
+	}
+
+	// Clamps to [0, 1] and rounds to 8 bits per channel
+	inline void StoreUnorm8(unsigned char* out, Texel t)
+	{
+		t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		__m128i i = _mm_cvtps_epi32(_mm_mul_ps(t, _mm_set1_ps(255.0f)));
+		i = _mm_packs_epi32(i, i);
+		i = _mm_packus_epi16(i, i);
+		int packed = _mm_cvtsi128_si32(i);
+		memcpy(out, &packed, 4);
+	}
+#else
+	struct Texel { float v[4]; };
+
+	inline Texel LoadTexel(const float* p) { return Texel{ { p[0], p[1], p[2], p[3] } }; }
+	inline void StoreTexel(float* p, Texel t) { memcpy(p, t.v, sizeof(t.v)); }
+	inline Texel MakeTexel(float r, float g, float b, float a) { return Texel{ { r, g, b, a } }; }
+
+	inline Texel AverageTexels(Texel a, Texel b, Texel c, Texel d)
+	{
+		Texel t;
+		for (int i = 0; i < 4; i++)
+			t.v[i] = (a.v[i] + b.v[i] + c.v[i] + d.v[i]) * 0.25f;
+		return t;
+	}
+
+	inline void StoreUnorm8(unsigned char* out, Texel t)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			float v = t.v[i] < 0 ? 0 : (t.v[i] > 1 ? 1 : t.v[i]);
+			out[i] = (unsigned char)(v * 255.0f + 0.5f);
+		}
+	}
+#endif
+
+	// ----------------------------------------------------
+	// Lookup tables between 8-bit values and working values
+	// ----------------------------------------------------
+	const unsigned int SrgbEncodeSteps = 4096;
+
+	struct MipTables
+	{
+		float Unorm[256];        // v / 255
+		const float* SrgbDecode = GetSrgbDecodeTable(); // sRGB to linear
+		float Snorm[256];        // v / 255 * 2 - 1
+		float AlphaSquared[256]; // (v / 255)^4, the shader's alpha = roughness^2, squared
+		unsigned char SrgbEncode[SrgbEncodeSteps + 1]; // Linear to sRGB
+
+		MipTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float v = i / 255.0f;
+				Unorm[i] = v;
+				Snorm[i] = v * 2.0f - 1.0f;
+				AlphaSquared[i] = v * v * v * v;
+			}
+			for (unsigned int i = 0; i <= SrgbEncodeSteps; i++)
+			{
+				float v = (float)i / SrgbEncodeSteps;
+				float s = v <= 0.0031308f ? v * 12.92f : 1.055f * powf(v, 1.0f / 2.4f) - 0.055f;
+				SrgbEncode[i] = (unsigned char)(s * 255.0f + 0.5f);
+			}
+		}
+	};
+
+	const MipTables& GetMipTables()
+	{
+		static const MipTables tables;
+		return tables;
+	}
+
+	// ----------------------------------------------------
+	// Working copies of every level below the top, in
+	// float RGBA.  Normals stay unnormalized here so each
+	// level's length still says how much they spread out.
+	// ----------------------------------------------------
+	struct MipChain
+	{
+		const DecodedImage* Image = nullptr;
+		TextureUsage Usage = TEXTURE_USAGE_LINEAR;
+		unsigned int LevelCount = 1;
+		unsigned int TileWidth = 0;
+		unsigned int TileHeight = 0;
+		unsigned int TiledLevels = 0; // Levels built by the tile pass
+		std::vector<unsigned int> Widths;
+		std::vector<unsigned int> Heights;
+		std::vector<std::vector<float>> Levels; // [0] is left empty
+
+		unsigned int GetTileCount() const
+		{
+			return (Widths[0] / TileWidth) * (Heights[0] / TileHeight);
+		}
+	};
+
+	void SetupChain(MipChain& chain, const DecodedImage* image, TextureUsage usage, unsigned int levelCount)
+	{
+		chain.Image = image;
+		chain.Usage = usage;
+
+		unsigned int fullCount = GetMipLevelCount(image->Width, image->Height);
+		chain.LevelCount = levelCount == 0 || levelCount > fullCount ? fullCount : levelCount;
+
+		chain.Widths.resize(chain.LevelCount);
+		chain.Heights.resize(chain.LevelCount);
+		chain.Levels.resize(chain.LevelCount);
+		for (unsigned int l = 0; l < chain.LevelCount; l++)
+		{
+			chain.Widths[l] = image->Width >> l ? image->Width >> l : 1;
+			chain.Heights[l] = image->Height >> l ? image->Height >> l : 1;
+			if (l > 0)
+				chain.Levels[l].resize((size_t)chain.Widths[l] * chain.Heights[l] * 4);
+		}
+
+		// Tiles only work when they halve evenly all the way down,
+		// otherwise the whole image is one big "tile"
+		if (image->Width % MipTileSize == 0 && image->Height % MipTileSize == 0)
+		{
+			chain.TileWidth = MipTileSize;
+			chain.TileHeight = MipTileSize;
+			chain.TiledLevels = chain.LevelCount - 1 < MipTileLevels ? chain.LevelCount - 1 : MipTileLevels;
+		}
+		else
+		{
+			chain.TileWidth = image->Width;
+			chain.TileHeight = image->Height;
+			chain.TiledLevels = chain.LevelCount - 1;
+		}
+	}
+
+	// Top level texel to working value
+	inline Texel DecodeTexel(const unsigned char* p, TextureUsage usage, const MipTables& tables)
+	{
+		switch (usage)
+		{
+		case TEXTURE_USAGE_COLOR:
+			return MakeTexel(tables.SrgbDecode[p[0]], tables.SrgbDecode[p[1]], tables.SrgbDecode[p[2]], tables.Unorm[p[3]]);
+
+		case TEXTURE_USAGE_NORMAL:
+		{
+			// Normalized up front, so quantization doesn't
+			// read as variance at the top level
+			float x = tables.Snorm[p[0]];
+			float y = tables.Snorm[p[1]];
+			float z = tables.Snorm[p[2]];
+			float length = sqrtf(x * x + y * y + z * z);
+			float scale = length > 0 ? 1.0f / length : 0.0f;
+			return MakeTexel(x * scale, y * scale, z * scale, tables.Unorm[p[3]]);
+		}
+
+		case TEXTURE_USAGE_ROUGHNESS:
+			return MakeTexel(tables.AlphaSquared[p[0]], tables.AlphaSquared[p[1]], tables.AlphaSquared[p[2]], tables.Unorm[p[3]]);
+
+		case TEXTURE_USAGE_ORM:
+			return MakeTexel(tables.Unorm[p[0]], tables.AlphaSquared[p[1]], tables.Unorm[p[2]], tables.Unorm[p[3]]);
+
+		default:
+			return MakeTexel(tables.Unorm[p[0]], tables.Unorm[p[1]], tables.Unorm[p[2]], tables.Unorm[p[3]]);
+		}
+	}
+
+	// ----------------------------------------------------
+	// Averages 2x2 blocks of src into dst.  Both are
+	// sub-rectangles of larger images (strides in texels);
+	// an odd last row or column is reused rather than read
+	// past the edge.
+	// ----------------------------------------------------
+	void FilterLevel(
+		const float* src, unsigned int srcStride, unsigned int srcWidth, unsigned int srcHeight,
+		float* dst, unsigned int dstStride, unsigned int dstWidth, unsigned int dstHeight)
+	{
+		for (unsigned int y = 0; y < dstHeight; y++)
+		{
+			unsigned int y0 = y * 2 < srcHeight ? y * 2 : srcHeight - 1;
+			unsigned int y1 = y0 + 1 < srcHeight ? y0 + 1 : y0;
+			const float* row0 = src + (size_t)y0 * srcStride * 4;
+			const float* row1 = src + (size_t)y1 * srcStride * 4;
+			float* out = dst + (size_t)y * dstStride * 4;
+
+			// Evenly halved rows skip the edge checks
+			unsigned int even = srcWidth >= dstWidth * 2 ? dstWidth : srcWidth / 2;
+			unsigned int x = 0;
+			for (; x < even; x++)
+			{
+				StoreTexel(out + x * 4, AverageTexels(
+					LoadTexel(row0 + x * 8), LoadTexel(row0 + x * 8 + 4),
+					LoadTexel(row1 + x * 8), LoadTexel(row1 + x * 8 + 4)));
+			}
+			for (; x < dstWidth; x++)
+			{
+				unsigned int x0 = x * 2 < srcWidth ? x * 2 : srcWidth - 1;
+				unsigned int x1 = x0 + 1 < srcWidth ? x0 + 1 : x0;
+				StoreTexel(out + x * 4, AverageTexels(
+					LoadTexel(row0 + x0 * 4), LoadTexel(row0 + x1 * 4),
+					LoadTexel(row1 + x0 * 4), LoadTexel(row1 + x1 * 4)));
+			}
+		}
+	}
+
+	// ----------------------------------------------------
+	// Decodes one tile of the top level, then filters it
+	// down through the tiled levels
+	// ----------------------------------------------------
+	void BuildTile(MipChain& chain, unsigned int tile)
+	{
+		if (chain.TiledLevels == 0)
+			return;
+
+		const MipTables& tables = GetMipTables();
+		unsigned int tilesX = chain.Widths[0] / chain.TileWidth;
+		unsigned int left = (tile % tilesX) * chain.TileWidth;
+		unsigned int top = (tile / tilesX) * chain.TileHeight;
+
+		std::vector<float> scratch((size_t)chain.TileWidth * chain.TileHeight * 4);
+		for (unsigned int y = 0; y < chain.TileHeight; y++)
+		{
+			const unsigned char* in = &chain.Image->Pixels[((size_t)(top + y) * chain.Widths[0] + left) * 4];
+			float* out = &scratch[(size_t)y * chain.TileWidth * 4];
+			for (unsigned int x = 0; x < chain.TileWidth; x++)
+				StoreTexel(out + x * 4, DecodeTexel(in + x * 4, chain.Usage, tables));
+		}
+
+		const float* src = scratch.data();
+		unsigned int srcStride = chain.TileWidth;
+		unsigned int srcWidth = chain.TileWidth;
+		unsigned int srcHeight = chain.TileHeight;
+		for (unsigned int l = 1; l <= chain.TiledLevels; l++)
+		{
+			// This tile's part of the level
+			bool tiled = chain.TileWidth != chain.Widths[0] || chain.TileHeight != chain.Heights[0];
+			unsigned int width = tiled ? chain.TileWidth >> l : chain.Widths[l];
+			unsigned int height = tiled ? chain.TileHeight >> l : chain.Heights[l];
+			float* dst = &chain.Levels[l][((size_t)(top >> l) * chain.Widths[l] + (left >> l)) * 4];
+
+			FilterLevel(src, srcStride, srcWidth, srcHeight, dst, chain.Widths[l], width, height);
+
+			src = dst;
+			srcStride = chain.Widths[l];
+			srcWidth = width;
+			srcHeight = height;
+		}
+	}
+
+	// Levels below the tiles, one whole image at a time
+	void BuildTail(MipChain& chain)
+	{
+		for (unsigned int l = chain.TiledLevels + 1; l < chain.LevelCount; l++)
+		{
+			FilterLevel(
+				chain.Levels[l - 1].data(), chain.Widths[l - 1], chain.Widths[l - 1], chain.Heights[l - 1],
+				chain.Levels[l].data(), chain.Widths[l], chain.Widths[l], chain.Heights[l]);
+		}
+	}
+
+	// ----------------------------------------------------
+	// Turns one working level back into 8-bit texels.
+	// Roughness reads its normal chain's level covering the
+	// same footprint: an averaged normal of length L means a
+	// spread of (1 - L) / L, which is added to alpha squared.
+	// ----------------------------------------------------
+	void EncodeLevel(const MipChain& chain, const MipChain* normals, unsigned int level, DdsSurface& surface)
+	{
+		const MipTables& tables = GetMipTables();
+		unsigned int width = chain.Widths[level];
+		unsigned int height = chain.Heights[level];
+
+		surface.Width = width;
+		surface.Height = height;
+		surface.RowPitch = width * 4;
+
+		// The top level is the source, untouched
+		if (level == 0)
+		{
+			surface.Data = chain.Image->Pixels;
+			return;
+		}
+
+		surface.Data.resize((size_t)surface.RowPitch * height);
+
+		// Smallest normal level still at least as detailed as this one
+		unsigned int normalLevel = 0;
+		if (normals)
+		{
+			while (normalLevel + 1 < normals->LevelCount && normals->Widths[normalLevel + 1] >= width)
+				normalLevel++;
+			if (normalLevel == 0)
+				normals = nullptr;
+		}
+
+		const float* in = chain.Levels[level].data();
+		unsigned char* out = surface.Data.data();
+		for (unsigned int y = 0; y < height; y++)
+		{
+			for (unsigned int x = 0; x < width; x++, in += 4, out += 4)
+			{
+				Texel t = LoadTexel(in);
+				float v[4];
+				StoreTexel(v, t);
+
+				switch (chain.Usage)
+				{
+				case TEXTURE_USAGE_COLOR:
+					StoreUnorm8(out, t);
+					for (int c = 0; c < 3; c++)
+					{
+						float linear = v[c] < 0 ? 0 : (v[c] > 1 ? 1 : v[c]);
+						out[c] = tables.SrgbEncode[(unsigned int)(linear * SrgbEncodeSteps + 0.5f)];
+					}
+					break;
+
+				case TEXTURE_USAGE_NORMAL:
+				{
+					float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+					float scale = length > 0 ? 0.5f / length : 0.0f;
+					StoreUnorm8(out, MakeTexel(v[0] * scale + 0.5f, v[1] * scale + 0.5f, v[2] * scale + 0.5f, v[3]));
+					break;
+				}
+
+				case TEXTURE_USAGE_ROUGHNESS:
+				case TEXTURE_USAGE_ORM:
+				{
+					float spread = 0;
+					if (normals)
+					{
+						unsigned int nx = (unsigned int)((unsigned long long)x * normals->Widths[normalLevel] / width);
+						unsigned int ny = (unsigned int)((unsigned long long)y * normals->Heights[normalLevel] / height);
+						const float* n = &normals->Levels[normalLevel][((size_t)ny * normals->Widths[normalLevel] + nx) * 4];
+						float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+						length = length > 0.0001f ? length : 0.0001f;
+						spread = (1.0f - length) / length;
+					}
+
+					// Packed maps only carry roughness in G
+					int first = chain.Usage == TEXTURE_USAGE_ORM ? 1 : 0;
+					int last = chain.Usage == TEXTURE_USAGE_ORM ? 1 : 2;
+					for (int c = first; c <= last; c++)
+					{
+						float alphaSquared = v[c] + spread;
+						v[c] = sqrtf(sqrtf(alphaSquared < 1 ? alphaSquared : 1));
+					}
+					StoreUnorm8(out, MakeTexel(v[0], v[1], v[2], v[3]));
+					break;
+				}
+
+				default:
+					StoreUnorm8(out, t);
+					break;
+				}
+			}
+		}
+	}
+
+	// ----------------------------------------------------
+	// Averages one level's edge texels with the texels they
+	// touch on the neighbouring faces.  Stepping half a texel
+	// past an edge lands in the neighbour, so no adjacency
+	// tables are needed.  Each group ends up equal, so
+	// visiting it again from another member changes nothing.
+	// ----------------------------------------------------
+	void WeldCubeLevel(MipChain* faces[6], unsigned int level)
+	{
+		unsigned int size = faces[0]->Widths[level];
+		auto texelAt = [&](const CubeTexel& t) { return &faces[t.Face]->Levels[level][((size_t)t.Y * size + t.X) * 4]; };
+
+		// One texel per face, all sharing every edge
+		if (size == 1)
+		{
+			float sum[4] = {};
+			for (unsigned int f = 0; f < 6; f++)
+			{
+				for (int c = 0; c < 4; c++)
+					sum[c] += faces[f]->Levels[level][c];
+			}
+			for (unsigned int f = 0; f < 6; f++)
+			{
+				for (int c = 0; c < 4; c++)
+					faces[f]->Levels[level][c] = sum[c] / 6.0f;
+			}
+			return;
+		}
+
+		float step = 2.0f / size;
+		for (unsigned int f = 0; f < 6; f++)
+		{
+			for (unsigned int y = 0; y < size; y++)
+			{
+				bool edgeRow = y == 0 || y == size - 1;
+				for (unsigned int x = 0; x < size; x += edgeRow ? 1 : size - 1)
+				{
+					CubeTexel group[3] = { { f, x, y } };
+					unsigned int count = 1;
+					float s = (x + 0.5f) * step - 1.0f;
+					float t = (y + 0.5f) * step - 1.0f;
+					float dir[3];
+					if (x == 0 || x == size - 1)
+					{
+						GetCubeDirection(f, x == 0 ? -1.0f - step * 0.5f : 1.0f + step * 0.5f, t, dir);
+						group[count++] = GetCubeTexel(dir, size);
+					}
+					if (edgeRow)
+					{
+						GetCubeDirection(f, s, y == 0 ? -1.0f - step * 0.5f : 1.0f + step * 0.5f, dir);
+						group[count++] = GetCubeTexel(dir, size);
+					}
+
+					float sum[4] = {};
+					for (unsigned int i = 0; i < count; i++)
+					{
+						const float* p = texelAt(group[i]);
+						for (int c = 0; c < 4; c++)
+							sum[c] += p[c];
+					}
+					for (unsigned int i = 0; i < count; i++)
+					{
+						float* p = texelAt(group[i]);
+						for (int c = 0; c < 4; c++)
+							p[c] = sum[c] / count;
+					}
+				}
+			}
+		}
+	}
+}
+
+unsigned int GetMipLevelCount(unsigned int width, unsigned int height)
+{
+	unsigned int levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		levels++;
+	}
+	return levels;
+}
+
+void GetCubeDirection(unsigned int face, float s, float t, float dir[3])
+{
+	switch (face)
+	{
+	case 0: dir[0] = 1; dir[1] = -t; dir[2] = -s; break;
+	case 1: dir[0] = -1; dir[1] = -t; dir[2] = s; break;
+	case 2: dir[0] = s; dir[1] = 1; dir[2] = t; break;
+	case 3: dir[0] = s; dir[1] = -1; dir[2] = -t; break;
+	case 4: dir[0] = s; dir[1] = -t; dir[2] = 1; break;
+	default: dir[0] = -s; dir[1] = -t; dir[2] = -1; break;
+	}
+}
+
+CubeTexel GetCubeTexel(const float dir[3], unsigned int size)
+{
+	float ax = fabsf(dir[0]), ay = fabsf(dir[1]), az = fabsf(dir[2]);
+	CubeTexel texel;
+	float s, t, major;
+	if (ax >= ay && ax >= az)
+	{
+		texel.Face = dir[0] > 0 ? 0 : 1;
+		major = ax;
+		s = dir[0] > 0 ? -dir[2] : dir[2];
+		t = -dir[1];
+	}
+	else if (ay >= az)
+	{
+		texel.Face = dir[1] > 0 ? 2 : 3;
+		major = ay;
+		s = dir[0];
+		t = dir[1] > 0 ? dir[2] : -dir[2];
+	}
+	else
+	{
+		texel.Face = dir[2] > 0 ? 4 : 5;
+		major = az;
+		s = dir[2] > 0 ? dir[0] : -dir[0];
+		t = -dir[1];
+	}
+
+	auto toTexel = [size, major](float c)
+	{
+		int i = (int)floorf((c / major + 1.0f) * 0.5f * size);
+		return (unsigned int)(i < 0 ? 0 : (i >= (int)size ? size - 1 : i));
+	};
+	texel.X = toTexel(s);
+	texel.Y = toTexel(t);
+	return texel;
+}
+
+void GenerateMips(const std::vector<MipChainJob>& jobs, ThreadPool* pool)
+{
+	// One chain per job, then one per paired normal map
+	std::vector<MipChain> chains(jobs.size());
+	std::vector<int> normalChains(jobs.size(), -1);
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		SetupChain(chains[i], jobs[i].Image, jobs[i].Usage, jobs[i].LevelCount);
+		if ((jobs[i].Usage == TEXTURE_USAGE_ROUGHNESS || jobs[i].Usage == TEXTURE_USAGE_ORM) && jobs[i].Normals)
+			normalChains[i] = (int)chains.size();
+	}
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		if (normalChains[i] >= 0)
+		{
+			chains.emplace_back();
+			SetupChain(chains.back(), jobs[i].Normals, TEXTURE_USAGE_NORMAL, 0);
+		}
+	}
+
+	// Every tile of every chain
+	struct TileTask { unsigned int Chain, Tile; };
+	std::vector<TileTask> tiles;
+	for (unsigned int c = 0; c < chains.size(); c++)
+	{
+		for (unsigned int t = 0; t < chains[c].GetTileCount(); t++)
+			tiles.push_back(TileTask{ c, t });
+	}
+	ThreadPool::ForEach(pool, (unsigned int)tiles.size(), [&](unsigned int i)
+	{
+		BuildTile(chains[tiles[i].Chain], tiles[i].Tile);
+	});
+
+	ThreadPool::ForEach(pool, (unsigned int)chains.size(), [&](unsigned int c)
+	{
+		BuildTail(chains[c]);
+	});
+
+	// Every level of every job
+	struct LevelTask { unsigned int Job, Level; };
+	std::vector<LevelTask> levels;
+	for (unsigned int j = 0; j < jobs.size(); j++)
+	{
+		jobs[j].Output->resize(chains[j].LevelCount);
+		for (unsigned int l = 0; l < chains[j].LevelCount; l++)
+			levels.push_back(LevelTask{ j, l });
+	}
+	ThreadPool::ForEach(pool, (unsigned int)levels.size(), [&](unsigned int i)
+	{
+		const LevelTask& task = levels[i];
+		const MipChain* normals = normalChains[task.Job] >= 0 ? &chains[normalChains[task.Job]] : nullptr;
+		EncodeLevel(chains[task.Job], normals, task.Level, (*jobs[task.Job].Output)[task.Level]);
+	});
+}
+
+bool GenerateCubeMips(const CubeMipJob& job, ThreadPool* pool)
+{
+	if (job.Usage != TEXTURE_USAGE_COLOR && job.Usage != TEXTURE_USAGE_LINEAR)
+		return false;
+	for (unsigned int f = 0; f < 6; f++)
+	{
+		if (!job.Faces[f] || !job.Outputs[f] ||
+			job.Faces[f]->Width != job.Faces[f]->Height || job.Faces[f]->Width != job.Faces[0]->Width)
+			return false;
+	}
+
+	MipChain chains[6];
+	MipChain* faces[6];
+	for (unsigned int f = 0; f < 6; f++)
+	{
+		SetupChain(chains[f], job.Faces[f], job.Usage, job.LevelCount);
+		faces[f] = &chains[f];
+	}
+	unsigned int levelCount = chains[0].LevelCount;
+	unsigned int tileCount = chains[0].GetTileCount();
+
+	// Same tiles and tails as any other texture...
+	ThreadPool::ForEach(pool, 6 * tileCount, [&](unsigned int i)
+	{
+		BuildTile(chains[i / tileCount], i % tileCount);
+	});
+	ThreadPool::ForEach(pool, 6, [&](unsigned int f)
+	{
+		BuildTail(chains[f]);
+	});
+
+	// ...then every level below the top is welded on its own,
+	// still in linear space
+	ThreadPool::ForEach(pool, levelCount - 1, [&](unsigned int l)
+	{
+		WeldCubeLevel(faces, l + 1);
+	});
+
+	for (unsigned int f = 0; f < 6; f++)
+		job.Outputs[f]->resize(levelCount);
+	ThreadPool::ForEach(pool, 6 * levelCount, [&](unsigned int i)
+	{
+		unsigned int f = i / levelCount;
+		unsigned int l = i % levelCount;
+		EncodeLevel(chains[f], nullptr, l, (*job.Outputs[f])[l]);
+	});
+	return true;
+}
+
+MipBenchmarkResults MipBenchmark(unsigned int size, ThreadPool& pool)
+{
+	const unsigned int faces = 6;
+
+	// Smooth gradients with noise on top, so normals actually
+	// spread out as they're averaged
+	std::mt19937 random(1234);
+	std::uniform_int_distribution<int> noise(-24, 24);
+	std::vector<DecodedImage> images(faces);
+	for (DecodedImage& image : images)
+	{
+		image.Width = size;
+		image.Height = size;
+		image.Pixels.resize((size_t)size * size * 4);
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				unsigned char* p = &image.Pixels[((size_t)y * size + x) * 4];
+				p[0] = (unsigned char)std::clamp(128 + noise(random), 0, 255);
+				p[1] = (unsigned char)std::clamp(128 + noise(random), 0, 255);
+				p[2] = (unsigned char)std::clamp((int)(x * 255 / size) / 4 + 192 + noise(random) / 4, 0, 255);
+				p[3] = (unsigned char)(y * 255 / size);
+			}
+		}
+	}
+
+	MipBenchmarkResults results;
+	results.Images = faces;
+	results.Size = size;
+	results.Megapixels = faces * (double)size * size / 1000000.0;
+
+	std::vector<std::vector<DdsSurface>> outputs(faces);
+	auto run = [&](TextureUsage usage, ThreadPool* runPool)
+	{
+		std::vector<MipChainJob> jobs(faces);
+		for (unsigned int f = 0; f < faces; f++)
+		{
+			jobs[f].Image = &images[f];
+			jobs[f].Usage = usage;
+			jobs[f].Normals = usage == TEXTURE_USAGE_ROUGHNESS ? &images[(f + 1) % faces] : nullptr;
+			jobs[f].Output = &outputs[f];
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		GenerateMips(jobs, runPool);
+		return results.Megapixels / (MsSince(start) / 1000.0);
+	};
+
+	results.ColorMPs = run(TEXTURE_USAGE_COLOR, nullptr);
+	results.NormalMPs = run(TEXTURE_USAGE_NORMAL, nullptr);
+	results.RoughnessMPs = run(TEXTURE_USAGE_ROUGHNESS, nullptr);
+	results.PooledColorMPs = run(TEXTURE_USAGE_COLOR, &pool);
+	results.PooledNormalMPs = run(TEXTURE_USAGE_NORMAL, &pool);
+	results.PooledRoughnessMPs = run(TEXTURE_USAGE_ROUGHNESS, &pool);
+	return results;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <vector>
+
+#include "DdsFile.h"
+#include "PngDecoder.h"
+#include "ThreadPool.h"
+
+// --------------------------------------------------------
+// What a texture's texels mean, which decides how they are
+// averaged into smaller mips
+// --------------------------------------------------------
+enum TextureUsage
+{
+	TEXTURE_USAGE_LINEAR,    // Plain data, averaged as stored
+	TEXTURE_USAGE_COLOR,     // sRGB-encoded color, averaged in linear space
+	TEXTURE_USAGE_NORMAL,    // Tangent-space normals, renormalized each level
+	TEXTURE_USAGE_ROUGHNESS, // Perceptual roughness, widened where normals diverge
+	TEXTURE_USAGE_ORM,       // Packed occlusion/roughness/metalness, roughness in G
+};
+
+// --------------------------------------------------------
+// One image to build a full mip chain for.  A roughness map
+// (or the G of a packed ORM map) can name the normal map
+// it's paired with; each of its mips
+// then grows by the variance the normal map loses at that
+// size (Toksvig), so bumpy surfaces don't turn into sharp
+// sparkly highlights in the distance.
+// --------------------------------------------------------
+struct MipChainJob
+{
+	const DecodedImage* Image = nullptr;
+	TextureUsage Usage = TEXTURE_USAGE_LINEAR;
+	const DecodedImage* Normals = nullptr;     // Roughness and ORM only, optional
+	std::vector<DdsSurface>* Output = nullptr; // Receives every level, top first
+	unsigned int LevelCount = 0;               // 0 for a full chain down to 1x1
+};
+
+// Mips in a full chain for the given top level size
+unsigned int GetMipLevelCount(unsigned int width, unsigned int height);
+
+// Direction through (s, t) on a cube face, both -1 to 1
+// with t downward - the way D3D samples cube maps
+void GetCubeDirection(unsigned int face, float s, float t, float dir[3]);
+
+struct CubeTexel
+{
+	unsigned int Face, X, Y;
+};
+
+// The texel a direction lands in, with size x size faces
+CubeTexel GetCubeTexel(const float dir[3], unsigned int size);
+
+// --------------------------------------------------------
+// Builds mip chains with SSE2 box filtering (scalar where
+// SSE2 is missing).
+//
+// Images are cut into 64x64 tiles that each filter their
+// share of the first six levels while the texels are still
+// in cache; the few levels past that are finished per image,
+// then every level of every image is encoded back to 8 bits
+// as its own task.  With a pool, tiles, images and levels
+// all run side by side.  Pass no pool from inside a pool
+// task (texture cooking does this) to run it all inline.
+// --------------------------------------------------------
+void GenerateMips(const std::vector<MipChainJob>& jobs, ThreadPool* pool);
+
+// --------------------------------------------------------
+// The six square faces of a cube map, +X -X +Y -Y +Z -Z
+// in D3D order.  Color and linear usages only - normals and
+// roughness mean nothing once averaged across faces.
+// --------------------------------------------------------
+struct CubeMipJob
+{
+	const DecodedImage* Faces[6] = {};
+	TextureUsage Usage = TEXTURE_USAGE_COLOR;
+	std::vector<DdsSurface>* Outputs[6] = {}; // Every level of each face, top first
+	unsigned int LevelCount = 0;              // 0 for a full chain down to 1x1
+};
+
+// --------------------------------------------------------
+// Builds a cube map's mip chains like GenerateMips, then
+// welds the faces together below the top level: texels on
+// an edge are averaged with the ones they touch across it
+// (three faces at a corner), so the seams don't show as a
+// filtered cube map blurs.  The 1x1 level is the average of
+// all six faces.  Fails if the faces aren't square and the
+// same size.
+// --------------------------------------------------------
+bool GenerateCubeMips(const CubeMipJob& job, ThreadPool* pool);
+
+// --------------------------------------------------------
+// Mip generation throughput on synthetic images, in source
+// megapixels per second, inline and across the pool
+// --------------------------------------------------------
+struct MipBenchmarkResults
+{
+	unsigned int Images = 0;
+	unsigned int Size = 0;
+	double Megapixels = 0; // Top level texels filtered, per run
+	double ColorMPs = 0;
+	double NormalMPs = 0;
+	double RoughnessMPs = 0; // Including its paired normal map
+	double PooledColorMPs = 0;
+	double PooledNormalMPs = 0;
+	double PooledRoughnessMPs = 0;
+};
+
+// Six size x size "faces" of each usage, like a cube map
+MipBenchmarkResults MipBenchmark(unsigned int size, ThreadPool& pool);
@@ -0,0 +1,167 @@
+#pragma once
+#include <cstring>
+#include <vector>
+
+// What the owner of a PackedUploadArray should send to the GPU
+struct PackedUpload
+{
+	bool Recreate = false;  // The buffer must be rebuilt at GetCapacity() first
+	unsigned int First = 0; // Items [First, First + Count) to copy
+	unsigned int Count = 0;
+};
+
+// --------------------------------------------------------
+// A packed array of items mirrored in a GPU buffer, with
+// the bookkeeping that decides what needs sending - no
+// Direct3D here, so it can be tested without a device.
+//
+// - Items stay packed: removing one shifts the rest down,
+//   which dirties everything after it
+// - Edits only grow a dirty range, and unchanged Set()
+//   calls are ignored
+// - Growing past the capacity doubles it and asks for the
+//   buffer to be recreated, which resends everything
+//
+// T must be trivially copyable (it's compared with memcmp).
+// --------------------------------------------------------
+template<typename T>
+class PackedUploadArray
+{
+public:
+	PackedUploadArray(unsigned int initialCapacity = 16) :
+		capacity(initialCapacity > 0 ? initialCapacity : 1)
+	{
+	}
+
+	// Appends an item, returning its index
+	unsigned int Add(const T& item)
+	{
+		unsigned int index = (unsigned int)items.size();
+		items.push_back(item);
+
+		// Outgrew the GPU buffer, so it has to be rebuilt on the next upload
+		if (items.size() > capacity)
+		{
+			while (capacity < items.size())
+				capacity *= 2;
+			needsRecreate = true;
+		}
+
+		MarkDirty(index, index + 1);
+		return index;
+	}
+
+	// Removes an item, keeping the rest in order
+	void Remove(unsigned int index)
+	{
+		if (index >= items.size())
+			return;
+
+		items.erase(items.begin() + index);
+
+		// Whatever was pending past the new end no longer exists.
+		// The GPU only reads GetCount() items, so the stale last
+		// slot never needs clearing.
+		if (dirtyEnd > items.size())
+			dirtyEnd = (unsigned int)items.size();
+
+		if (index < items.size())
+			MarkDirty(index, (unsigned int)items.size());
+	}
+
+	// Replaces an item; true if it actually changed
+	bool Set(unsigned int index, const T& item)
+	{
+		if (index >= items.size())
+			return false;
+
+		if (memcmp(&items[index], &item, sizeof(T)) == 0)
+			return false;
+
+		items[index] = item;
+		MarkDirty(index, index + 1);
+		return true;
+	}
+
+	void Clear()
+	{
+		items.clear();
+		dirtyBegin = dirtyEnd = 0;
+	}
+
+	// Getters
+	const T& Get(unsigned int index) const { return items[index]; }
+	const T* GetData() const { return items.data(); }
+	unsigned int GetCount() const { return (unsigned int)items.size(); }
+	unsigned int GetCapacity() const { return capacity; }
+
+	// Change tracking
+	bool IsDirty() const { return dirtyBegin < dirtyEnd || needsRecreate; }
+	unsigned int GetDirtyFirst() const { return dirtyBegin; }
+	unsigned int GetDirtyCount() const { return dirtyEnd > dirtyBegin ? dirtyEnd - dirtyBegin : 0; }
+
+	// Bytes the next upload will send
+	unsigned int GetPendingUploadBytes() const
+	{
+		if (needsRecreate)
+			return (unsigned int)(items.size() * sizeof(T));
+
+		return GetDirtyCount() * (unsigned int)sizeof(T);
+	}
+
+	// --------------------------------------------------------
+	// Hands the pending work to the owner, who recreates the
+	// buffer if asked and copies the range, then starts a new
+	// dirty range.  Counts the bytes as uploaded.
+	// --------------------------------------------------------
+	PackedUpload TakeUpload()
+	{
+		PackedUpload upload;
+		if (needsRecreate)
+		{
+			// A fresh buffer has nothing in it, so everything goes up
+			upload.Recreate = true;
+			needsRecreate = false;
+			dirtyBegin = 0;
+			dirtyEnd = (unsigned int)items.size();
+		}
+
+		upload.First = dirtyBegin;
+		upload.Count = GetDirtyCount();
+		dirtyBegin = dirtyEnd = 0;
+
+		lastUploadBytes = upload.Count * (unsigned int)sizeof(T);
+		totalUploadBytes += lastUploadBytes;
+		return upload;
+	}
+
+	// Upload stats
+	unsigned int GetLastUploadBytes() const { return lastUploadBytes; }
+	unsigned long long GetTotalUploadBytes() const { return totalUploadBytes; }
+
+private:
+	std::vector<T> items;
+	unsigned int capacity;
+	bool needsRecreate = true;
+
+	// Half-open range [dirtyBegin, dirtyEnd) changed since the last upload
+	unsigned int dirtyBegin = 0;
+	unsigned int dirtyEnd = 0;
+
+	unsigned int lastUploadBytes = 0;
+	unsigned long long totalUploadBytes = 0;
+
+	// Grows the dirty range to cover [first, end)
+	void MarkDirty(unsigned int first, unsigned int end)
+	{
+		if (dirtyBegin >= dirtyEnd)
+		{
+			dirtyBegin = first;
+			dirtyEnd = end;
+			return;
+		}
+
+		if (first < dirtyBegin) dirtyBegin = first;
+		if (end > dirtyEnd) dirtyEnd = end;
+	}
+};
@@ -0,0 +1,156 @@
+#include "PipelineState.h"
+#include "Graphics.h"
+
+PipelineState::PipelineState(
+	const PipelineStateDesc& desc,
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterState,
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthState,
+	Microsoft::WRL::ComPtr<ID3D11BlendState> blendState) :
+	vertexShader(desc.VertexShader),
+	pixelShader(desc.PixelShader),
+	rasterState(rasterState),
+	depthState(depthState),
+	blendState(blendState),
+	topology(desc.Topology)
+{
+}
+
+void PipelineState::Bind() const
+{
+	vertexShader->SetShader();
+
+	if (pixelShader)
+		pixelShader->SetShader();
+	else
+		Graphics::States->SetShader(STATE_STAGE_PIXEL, 0);
+
+	Graphics::States->SetRasterState(rasterState.Get());
+	Graphics::States->SetDepthState(depthState.Get());
+	Graphics::States->SetBlendState(blendState.Get());
+	Graphics::States->SetTopology(topology);
+}
+
+// --------------------------------------------------------
+// Conversions from the plain descs to D3D's
+// --------------------------------------------------------
+static Microsoft::WRL::ComPtr<ID3D11RasterizerState> CreateRasterState(const RasterStateDesc& desc)
+{
+	D3D11_RASTERIZER_DESC rasterDesc = {};
+	rasterDesc.FillMode = (D3D11_FILL_MODE)desc.FillMode;
+	rasterDesc.CullMode = (D3D11_CULL_MODE)desc.CullMode;
+	rasterDesc.FrontCounterClockwise = desc.FrontCounterClockwise;
+	rasterDesc.DepthBias = desc.DepthBias;
+	rasterDesc.DepthBiasClamp = desc.DepthBiasClamp;
+	rasterDesc.SlopeScaledDepthBias = desc.SlopeScaledDepthBias;
+	rasterDesc.DepthClipEnable = desc.DepthClipEnable;
+	rasterDesc.ScissorEnable = desc.ScissorEnable;
+	rasterDesc.MultisampleEnable = desc.MultisampleEnable;
+	rasterDesc.AntialiasedLineEnable = desc.AntialiasedLineEnable;
+
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> state;
+	Graphics::Device->CreateRasterizerState(&rasterDesc, state.GetAddressOf());
+	return state;
+}
+
+static Microsoft::WRL::ComPtr<ID3D11DepthStencilState> CreateDepthState(const DepthStateDesc& desc)
+{
+	D3D11_DEPTH_STENCILOP_DESC keep = {};
+	keep.StencilFailOp = D3D11_STENCIL_OP_KEEP;
+	keep.StencilDepthFailOp = D3D11_STENCIL_OP_KEEP;
+	keep.StencilPassOp = D3D11_STENCIL_OP_KEEP;
+	keep.StencilFunc = D3D11_COMPARISON_ALWAYS;
+
+	D3D11_DEPTH_STENCIL_DESC depthDesc = {};
+	depthDesc.DepthEnable = desc.DepthEnable;
+	depthDesc.DepthWriteMask = (D3D11_DEPTH_WRITE_MASK)desc.DepthWriteMask;
+	depthDesc.DepthFunc = (D3D11_COMPARISON_FUNC)desc.DepthFunc;
+	depthDesc.StencilEnable = desc.StencilEnable;
+	depthDesc.StencilReadMask = D3D11_DEFAULT_STENCIL_READ_MASK;
+	depthDesc.StencilWriteMask = D3D11_DEFAULT_STENCIL_WRITE_MASK;
+	depthDesc.FrontFace = keep;
+	depthDesc.BackFace = keep;
+
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> state;
+	Graphics::Device->CreateDepthStencilState(&depthDesc, state.GetAddressOf());
+	return state;
+}
+
+static Microsoft::WRL::ComPtr<ID3D11BlendState> CreateBlendState(const BlendStateDesc& desc)
+{
+	D3D11_BLEND_DESC blendDesc = {};
+	blendDesc.AlphaToCoverageEnable = desc.AlphaToCoverageEnable;
+	blendDesc.IndependentBlendEnable = false;
+	for (D3D11_RENDER_TARGET_BLEND_DESC& target : blendDesc.RenderTarget)
+	{
+		target.BlendEnable = desc.BlendEnable;
+		target.SrcBlend = (D3D11_BLEND)desc.SrcBlend;
+		target.DestBlend = (D3D11_BLEND)desc.DestBlend;
+		target.BlendOp = (D3D11_BLEND_OP)desc.BlendOp;
+		target.SrcBlendAlpha = (D3D11_BLEND)desc.SrcBlendAlpha;
+		target.DestBlendAlpha = (D3D11_BLEND)desc.DestBlendAlpha;
+		target.BlendOpAlpha = (D3D11_BLEND_OP)desc.BlendOpAlpha;
+		target.RenderTargetWriteMask = (UINT8)desc.RenderTargetWriteMask;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11BlendState> state;
+	Graphics::Device->CreateBlendState(&blendDesc, state.GetAddressOf());
+	return state;
+}
+
+static Microsoft::WRL::ComPtr<ID3D11SamplerState> CreateSamplerState(const SamplerStateDesc& desc)
+{
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	samplerDesc.Filter = (D3D11_FILTER)desc.Filter;
+	samplerDesc.AddressU = (D3D11_TEXTURE_ADDRESS_MODE)desc.AddressU;
+	samplerDesc.AddressV = (D3D11_TEXTURE_ADDRESS_MODE)desc.AddressV;
+	samplerDesc.AddressW = (D3D11_TEXTURE_ADDRESS_MODE)desc.AddressW;
+	samplerDesc.MipLODBias = desc.MipLODBias;
+	samplerDesc.MaxAnisotropy = desc.MaxAnisotropy;
+	samplerDesc.ComparisonFunc = (D3D11_COMPARISON_FUNC)desc.ComparisonFunc;
+	for (int i = 0; i < 4; i++)
+		samplerDesc.BorderColor[i] = desc.BorderColor[i];
+	samplerDesc.MinLOD = desc.MinLOD;
+	samplerDesc.MaxLOD = desc.MaxLOD;
+
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> state;
+	Graphics::Device->CreateSamplerState(&samplerDesc, state.GetAddressOf());
+	return state;
+}
+
+PipelineStateCache::PipelineStateCache() :
+	rasterStates(CreateRasterState),
+	depthStates(CreateDepthState),
+	blendStates(CreateBlendState),
+	samplerStates(CreateSamplerState)
+{
+}
+
+// --------------------------------------------------------
+// Looks the pipeline up by its key, creating it (and any
+// state objects it needs) on a miss
+// --------------------------------------------------------
+std::shared_ptr<PipelineState> PipelineStateCache::Get(const PipelineStateDesc& desc)
+{
+	if (!desc.VertexShader)
+		return 0;
+
+	PipelineStateKey key;
+	key.VertexShader = (unsigned long long)(size_t)desc.VertexShader.get();
+	key.PixelShader = (unsigned long long)(size_t)desc.PixelShader.get();
+	key.InputLayout = (unsigned long long)(size_t)desc.VertexShader->GetInputLayout().Get();
+	key.Raster = HashStateDesc(desc.Raster);
+	key.Depth = HashStateDesc(desc.Depth);
+	key.Blend = HashStateDesc(desc.Blend);
+	key.Topology = (unsigned int)desc.Topology;
+
+	// The key only holds addresses and hashes, so the full desc
+	// goes to the create function with the request
+	return pipelines.Get(key, [&](const PipelineStateKey&)
+	{
+		return std::make_shared<PipelineState>(
+			desc,
+			GetRasterState(desc.Raster),
+			GetDepthState(desc.Depth),
+			GetBlendState(desc.Blend));
+	});
+}
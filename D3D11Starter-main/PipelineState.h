@@ -0,0 +1,85 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+
+#include "PipelineStateDesc.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// Everything needed to build a pipeline
+// --------------------------------------------------------
+struct PipelineStateDesc
+{
+	std::shared_ptr<SimpleVertexShader> VertexShader; // Also supplies the input layout
+	std::shared_ptr<SimplePixelShader> PixelShader;   // Null for depth-only passes
+	RasterStateDesc Raster;
+	DepthStateDesc Depth;
+	BlendStateDesc Blend;
+	D3D11_PRIMITIVE_TOPOLOGY Topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+};
+
+// --------------------------------------------------------
+// An immutable bundle of shaders and fixed-function state,
+// set with a single Bind().  Only made by PipelineStateCache,
+// so identical descs share one object.
+// --------------------------------------------------------
+class PipelineState
+{
+public:
+	PipelineState(
+		const PipelineStateDesc& desc,
+		Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterState,
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthState,
+		Microsoft::WRL::ComPtr<ID3D11BlendState> blendState);
+
+	// Sets the shaders (and their constant buffers), input
+	// layout, raster, depth, blend and topology
+	void Bind() const;
+
+	std::shared_ptr<SimpleVertexShader> GetVertexShader() const { return vertexShader; }
+	std::shared_ptr<SimplePixelShader> GetPixelShader() const { return pixelShader; }
+
+private:
+	const std::shared_ptr<SimpleVertexShader> vertexShader;
+	const std::shared_ptr<SimplePixelShader> pixelShader;
+	const Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterState;
+	const Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthState;
+	const Microsoft::WRL::ComPtr<ID3D11BlendState> blendState;
+	const D3D11_PRIMITIVE_TOPOLOGY topology;
+};
+
+// --------------------------------------------------------
+// Creates pipelines and the D3D state objects inside them,
+// handing back the existing object whenever an identical
+// desc has been requested before.
+//
+// Pipelines hold their shaders, so a cached pipeline's
+// shader addresses can't be reused by a different shader.
+// --------------------------------------------------------
+class PipelineStateCache
+{
+public:
+	PipelineStateCache();
+
+	std::shared_ptr<PipelineState> Get(const PipelineStateDesc& desc);
+
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> GetRasterState(const RasterStateDesc& desc) { return rasterStates.Get(desc); }
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> GetDepthState(const DepthStateDesc& desc) { return depthStates.Get(desc); }
+	Microsoft::WRL::ComPtr<ID3D11BlendState> GetBlendState(const BlendStateDesc& desc) { return blendStates.Get(desc); }
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> GetSamplerState(const SamplerStateDesc& desc) { return samplerStates.Get(desc); }
+
+	// Stats - unique objects vs requests for each kind
+	const StateObjectCache<PipelineStateKey, std::shared_ptr<PipelineState>>& GetPipelines() const { return pipelines; }
+	const StateObjectCache<RasterStateDesc, Microsoft::WRL::ComPtr<ID3D11RasterizerState>>& GetRasterStates() const { return rasterStates; }
+	const StateObjectCache<DepthStateDesc, Microsoft::WRL::ComPtr<ID3D11DepthStencilState>>& GetDepthStates() const { return depthStates; }
+	const StateObjectCache<BlendStateDesc, Microsoft::WRL::ComPtr<ID3D11BlendState>>& GetBlendStates() const { return blendStates; }
+	const StateObjectCache<SamplerStateDesc, Microsoft::WRL::ComPtr<ID3D11SamplerState>>& GetSamplerStates() const { return samplerStates; }
+
+private:
+	StateObjectCache<PipelineStateKey, std::shared_ptr<PipelineState>> pipelines;
+	StateObjectCache<RasterStateDesc, Microsoft::WRL::ComPtr<ID3D11RasterizerState>> rasterStates;
+	StateObjectCache<DepthStateDesc, Microsoft::WRL::ComPtr<ID3D11DepthStencilState>> depthStates;
+	StateObjectCache<BlendStateDesc, Microsoft::WRL::ComPtr<ID3D11BlendState>> blendStates;
+	StateObjectCache<SamplerStateDesc, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplerStates;
+};
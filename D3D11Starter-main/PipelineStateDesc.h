@@ -0,0 +1,151 @@
+#pragma once
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+
+#include "CacheFiles.h"
+
+// --------------------------------------------------------
+// Plain descriptions of fixed-function state, with no
+// Direct3D dependency so they can be hashed and compared
+// without a device.  Fields hold the raw D3D11 enum values
+// and default to D3D11's own defaults.
+//
+// Every field is 4 bytes, so there is no padding and two
+// descs are equal exactly when their bytes are.
+// --------------------------------------------------------
+struct RasterStateDesc
+{
+	unsigned int FillMode = 3;        // D3D11_FILL_SOLID
+	unsigned int CullMode = 3;        // D3D11_CULL_BACK
+	unsigned int FrontCounterClockwise = 0;
+	int DepthBias = 0;
+	float DepthBiasClamp = 0.0f;
+	float SlopeScaledDepthBias = 0.0f;
+	unsigned int DepthClipEnable = 1;
+	unsigned int ScissorEnable = 0;
+	unsigned int MultisampleEnable = 0;
+	unsigned int AntialiasedLineEnable = 0;
+};
+
+struct DepthStateDesc
+{
+	unsigned int DepthEnable = 1;
+	unsigned int DepthWriteMask = 1;  // D3D11_DEPTH_WRITE_MASK_ALL
+	unsigned int DepthFunc = 2;       // D3D11_COMPARISON_LESS
+	unsigned int StencilEnable = 0;
+};
+
+// Same blend for every render target
+struct BlendStateDesc
+{
+	unsigned int AlphaToCoverageEnable = 0;
+	unsigned int BlendEnable = 0;
+	unsigned int SrcBlend = 2;        // D3D11_BLEND_ONE
+	unsigned int DestBlend = 1;       // D3D11_BLEND_ZERO
+	unsigned int BlendOp = 1;         // D3D11_BLEND_OP_ADD
+	unsigned int SrcBlendAlpha = 2;
+	unsigned int DestBlendAlpha = 1;
+	unsigned int BlendOpAlpha = 1;
+	unsigned int RenderTargetWriteMask = 0xF;
+};
+
+struct SamplerStateDesc
+{
+	unsigned int Filter = 0x15;       // D3D11_FILTER_MIN_MAG_MIP_LINEAR
+	unsigned int AddressU = 3;        // D3D11_TEXTURE_ADDRESS_CLAMP
+	unsigned int AddressV = 3;
+	unsigned int AddressW = 3;
+	float MipLODBias = 0.0f;
+	unsigned int MaxAnisotropy = 1;
+	unsigned int ComparisonFunc = 1;  // D3D11_COMPARISON_NEVER
+	float BorderColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	float MinLOD = -3.402823466e+38f;
+	float MaxLOD = 3.402823466e+38f;
+};
+
+// --------------------------------------------------------
+// Identifies a whole pipeline.  Shaders and the input layout
+// are identified by address, the fixed-function states by
+// their desc hashes.  Also padding-free.
+// --------------------------------------------------------
+struct PipelineStateKey
+{
+	unsigned long long VertexShader = 0;
+	unsigned long long PixelShader = 0;
+	unsigned long long InputLayout = 0;
+	unsigned long long Raster = 0;
+	unsigned long long Depth = 0;
+	unsigned long long Blend = 0;
+	unsigned int Topology = 4;        // D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+	unsigned int Reserved = 0;
+};
+
+// Same hash as the file caches, over the desc's bytes
+template<typename Desc>
+unsigned long long HashStateDesc(const Desc& desc)
+{
+	return HashBytes(&desc, sizeof(Desc));
+}
+
+// --------------------------------------------------------
+// Hands out one shared object per unique desc.  Requests
+// with a desc that's been seen before return the existing
+// object instead of creating another.
+//
+// Object is held by value - a ComPtr or shared_ptr.  Create
+// is only called on a miss and may return null (a failed
+// creation isn't cached, so it's retried next time).  Objects
+// that need more than the desc to build pass their own create
+// function to Get() instead.
+// --------------------------------------------------------
+template<typename Desc, typename Object>
+class StateObjectCache
+{
+public:
+	using CreateFunction = std::function<Object(const Desc&)>;
+
+	StateObjectCache(CreateFunction create = nullptr) : create(create), requests(0), collisions(0) {}
+
+	Object Get(const Desc& desc) { return Get(desc, create); }
+
+	Object Get(const Desc& desc, const CreateFunction& createOnMiss)
+	{
+		requests++;
+
+		unsigned long long hash = HashStateDesc(desc);
+		auto range = entries.equal_range(hash);
+		for (auto entry = range.first; entry != range.second; entry++)
+		{
+			// Compare the full desc - equal hashes don't guarantee equal state
+			if (memcmp(&entry->second.Description, &desc, sizeof(Desc)) == 0)
+				return entry->second.Value;
+			collisions++;
+		}
+
+		Object object = createOnMiss ? createOnMiss(desc) : Object();
+		if (object)
+			entries.insert({ hash, Entry{ desc, object } });
+		return object;
+	}
+
+	void Clear() { entries.clear(); }
+
+	// Stats
+	unsigned int GetRequestCount() const { return requests; }
+	unsigned int GetUniqueCount() const { return (unsigned int)entries.size(); }
+	unsigned int GetCollisionCount() const { return collisions; }
+	void ResetStats() { requests = 0; collisions = 0; }
+
+private:
+	struct Entry
+	{
+		Desc Description;
+		Object Value;
+	};
+
+	CreateFunction create;
+	std::unordered_multimap<unsigned long long, Entry> entries;
+	unsigned int requests;
+	unsigned int collisions;
+};
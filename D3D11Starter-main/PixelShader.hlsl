@@ -1,13 +1,65 @@
 #include "ShaderIncludes.hlsli"
 
+// PERMUTATION DEFINES =========
+// Set by PixelShaderPermutations when compiling variants.  The
+// defaults below are what the build-time PixelShader.cso uses,
+// which picks the fog mode at runtime as a fallback.
+
+#ifndef FOG_MODE
+#define FOG_MODE -1 // 0 none, 1 linear, 2 exponential, -1 read fogType
+#endif
+
+#ifndef USE_NORMAL_MAP
+#define USE_NORMAL_MAP 1
+#endif
+
+#ifndef USE_SHADOWS
+#define USE_SHADOWS 1
+#endif
+
+#ifndef USE_MATERIAL_ATLAS
+#define USE_MATERIAL_ATLAS 0 // Needs InstancedVertexShader for materialIndex
+#endif
+
+#ifndef USE_IMAGE_LIGHTING
+#define USE_IMAGE_LIGHTING 1
+#endif
+
+#if USE_MATERIAL_ATLAS
+// Every atlas material's textures, one slice each, and the
+// per-material values PerMaterial would otherwise hold
+struct AtlasMaterial
+{
+    float4 colorTint;
+    float2 uvScale;
+    float roughness;
+    uint slice;
+};
+
+Texture2DArray Albedo : register(t0);
+Texture2DArray NormalMap : register(t1);
+Texture2DArray OrmMap : register(t2);
+StructuredBuffer<AtlasMaterial> AtlasMaterials : register(t5);
+#define SAMPLE_MATERIAL(map, uv) map.Sample(BasicSampler, float3(uv, material.slice))
+#else
 Texture2D Albedo : register(t0);
 Texture2D NormalMap : register(t1);
-Texture2D RoughnessMap : register(t2);
-Texture2D MetalnessMap : register(t3);
-Texture2D ShadowMap : register(t4);
+Texture2D OrmMap : register(t2); // Occlusion, roughness, metalness
+#define SAMPLE_MATERIAL(map, uv) map.Sample(BasicSampler, uv)
+#endif
+
+Texture2D ShadowMap : register(t3);
+StructuredBuffer<Light> Lights : register(t4);
 SamplerState BasicSampler : register(s0);
 SamplerComparisonState ShadowSampler : register(s1);
 
+#if USE_IMAGE_LIGHTING
+// Baked from the sky by ImageLighting
+TextureCube SpecularMap : register(t6); // GGX-prefiltered, roughness per mip
+Texture2D BrdfLut : register(t7);       // F0 scale and bias by N.V and roughness
+SamplerState ClampSampler : register(s2);
+#endif
+
 // CONSTANTS ===================
 
 // A constant Fresnel value for non-metals (glass and plastic have values of about 0.04)
@@ -19,27 +71,33 @@ static const float MIN_ROUGHNESS = 0.0000001f; // 6 zeros after decimal
 static const float PI = 3.14159265359f;
 
 
-cbuffer DataFromCpu : register(b0)
+// Set once per frame
+cbuffer PerFrame : register(b0)
 {
-    int specMap;
-    
-    float4 colorTint;
     float3 cameraPosition;
-    float3 ambient;
-    float2 uvScale;
-    float roughness;
-    
-    Light directionalLight1;
-    Light directionalLight2;
-    Light directionalLight3;
-    Light pointLight1;
-    Light pointLight2;
+    int lightCount;
     
+    float3 ambient;
     int fogType;
+    
     float3 fogColor;
     float fogStart;
+    
     float fogEnd;
     float fogDensity;
+    float specularMipCount;
+    float imageLightIntensity;
+    
+    float4 irradianceSH[9]; // Sky irradiance over pi, as spherical harmonics
+}
+
+// Set whenever the material changes
+cbuffer PerMaterial : register(b1)
+{
+    float4 colorTint;
+    float2 uvScale;
+    float roughness;
+    int specMap;
 }
 
 
@@ -157,6 +215,25 @@ float3 MicrofacetBRDF(float3 n, float3 l, float3 v, float roughness, float3 f0,
     return specularResult * max(dot(n, l), 0);
 }
 
+// IMAGE-BASED LIGHTING =========
+
+// Diffuse light from the sky's 9 baked coefficients, ready to
+// multiply by albedo
+float3 IrradianceSH(float3 n)
+{
+    float3 result =
+        irradianceSH[0].rgb * 0.282095f +
+        irradianceSH[1].rgb * 0.488603f * n.y +
+        irradianceSH[2].rgb * 0.488603f * n.z +
+        irradianceSH[3].rgb * 0.488603f * n.x +
+        irradianceSH[4].rgb * 1.092548f * n.x * n.y +
+        irradianceSH[5].rgb * 1.092548f * n.y * n.z +
+        irradianceSH[6].rgb * 0.315392f * (3 * n.z * n.z - 1) +
+        irradianceSH[7].rgb * 1.092548f * n.x * n.z +
+        irradianceSH[8].rgb * 0.546274f * (n.x * n.x - n.y * n.y);
+    return max(result, 0);
+}
+
 // OLD LIGHT CALCULATIONS =========
 
 float3 PointLightDir(Light light,VertexToPixel input)
@@ -209,6 +286,14 @@ float4 lightCalc(Light light, VertexToPixel input, float3 surfaceColor, float3 n
 // --------------------------------------------------------
 float4 main(VertexToPixel input) : SV_TARGET
 {
+#if USE_MATERIAL_ATLAS
+    AtlasMaterial material = AtlasMaterials[input.materialIndex];
+    float2 materialUVScale = material.uvScale;
+#else
+    float2 materialUVScale = uvScale;
+#endif
+
+#if USE_SHADOWS
     // Persepctive fixing
     input.shadowMapPos /= input.shadowMapPos.w;
     
@@ -217,11 +302,17 @@ float4 main(VertexToPixel input) : SV_TARGET
     
     float distToLight = input.shadowMapPos.z;
     float shadowAmount = ShadowMap.SampleCmpLevelZero(ShadowSampler, shadowUV, distToLight);
+#else
+    float shadowAmount = 1.0f;
+#endif
     
     
     
     // Normals
-    float3 unpackedNormal = NormalMap.Sample(BasicSampler, input.uv).rgb * 2 - 1;
+#if USE_NORMAL_MAP
+    // Cooked normal maps are BC5, which only keeps x and y
+    float2 unpackedXY = SAMPLE_MATERIAL(NormalMap, input.uv).rg * 2 - 1;
+    float3 unpackedNormal = float3(unpackedXY, sqrt(saturate(1 - dot(unpackedXY, unpackedXY))));
     unpackedNormal = normalize(unpackedNormal);
     
     float3 N = normalize(input.normal);
@@ -231,15 +322,18 @@ float4 main(VertexToPixel input) : SV_TARGET
     float3x3 TBN = float3x3(T, B, N);
     
     input.normal = mul(unpackedNormal, TBN);
+#else
+    input.normal = normalize(input.normal);
+#endif
     
     // Albedo(SurfaceColor)
-    float3 surfaceColor = pow(Albedo.Sample(BasicSampler, input.uv * uvScale).rgb, 2.2f);
-    
-    // Rough
-    float roughness = RoughnessMap.Sample(BasicSampler, input.uv).r;
+    float3 surfaceColor = pow(SAMPLE_MATERIAL(Albedo, input.uv * materialUVScale).rgb, 2.2f);
     
-    // Metallic
-    float metalness = MetalnessMap.Sample(BasicSampler, input.uv).r;
+    // Occlusion, rough and metallic, packed into one texture
+    float3 orm = SAMPLE_MATERIAL(OrmMap, input.uv).rgb;
+    float occlusion = orm.r;
+    float roughness = orm.g;
+    float metalness = orm.b;
     
     // Specular
     // !Assume albedo texture is actually holding specular color where metalness == 1
@@ -249,20 +343,51 @@ float4 main(VertexToPixel input) : SV_TARGET
     
     // Lights
     float3 color = 0;
-    color += lightCalc(directionalLight1, input, surfaceColor, input.normal,roughness,metalness);
-    color += lightCalc(directionalLight2, input, surfaceColor, input.normal,roughness,metalness);
-    color += lightCalc(directionalLight3, input, surfaceColor, input.normal,roughness,metalness);
-    
-    color += lightCalc(pointLight1, input, surfaceColor,input.normal,roughness,metalness) * Attenuate(pointLight1, input.worldPosition);
-    color += lightCalc(pointLight2, input, surfaceColor,input.normal,roughness,metalness) * Attenuate(pointLight2, input.worldPosition);
+    for (int i = 0; i < lightCount; i++)
+    {
+        Light light = Lights[i];
+        float3 lightColor = lightCalc(light, input, surfaceColor, input.normal, roughness, metalness).rgb;
+        
+        if (light.Type == LIGHT_TYPE_POINT)
+        {
+            lightColor *= Attenuate(light, input.worldPosition);
+        }
+        
+        // The shadow map is rendered looking down the first light
+        if (i == 0)
+        {
+            lightColor *= shadowAmount;
+        }
+        
+        color += lightColor;
+    }
     
-    color += (surfaceColor * ambient * shadowAmount);
+#if USE_IMAGE_LIGHTING
+    // Split-sum ambient: the prefiltered sky along the reflection,
+    // scaled and biased per the LUT, plus diffuse from the harmonics
+    float3 V = normalize(cameraPosition - input.worldPosition);
+    float NdotV = saturate(dot(input.normal, V));
+    float3 R = reflect(-V, input.normal);
+    float2 brdf = BrdfLut.SampleLevel(ClampSampler, float2(NdotV, roughness), 0).rg;
+    float3 prefiltered = SpecularMap.SampleLevel(ClampSampler, R, roughness * (specularMipCount - 1)).rgb;
+    float3 ambientSpecular = prefiltered * (specularColor * brdf.x + brdf.y);
+    float3 F = specularColor + (max(1 - roughness, specularColor) - specularColor) * pow(1 - NdotV, 5);
+    float3 ambientDiffuse = DiffuseEnergyConserve(IrradianceSH(input.normal), F, metalness) * surfaceColor;
+    color += (ambientDiffuse + ambientSpecular) * imageLightIntensity * occlusion;
+#else
+    color += (surfaceColor * ambient * shadowAmount * occlusion);
+#endif
     
     // fog
+#if FOG_MODE != 0
     float fog = 0.0f;
     float surfaceDistance = distance(cameraPosition, input.worldPosition);
     
-    
+#if FOG_MODE == 1
+    fog = smoothstep(fogStart, fogEnd, surfaceDistance);
+#elif FOG_MODE == 2
+    fog = 1.0f - exp(-surfaceDistance * fogDensity);
+#else
     switch (fogType)
     {
         case 0:
@@ -275,8 +400,10 @@ float4 main(VertexToPixel input) : SV_TARGET
             fog = 1.0f - exp(-surfaceDistance * fogDensity);
             break;
     }
+#endif
     
     color = lerp(color, fogColor, fog);
+#endif
     
     return float4(pow(color, 1.0f / 2.2f), 1);
 }
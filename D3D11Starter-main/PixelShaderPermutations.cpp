@@ -0,0 +1,125 @@
+#include "PixelShaderPermutations.h"
+#include "ShaderStructs.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+PixelShaderPermutations::PixelShaderPermutations(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const std::filesystem::path& sourceFile,
+	const std::filesystem::path& cacheDirectory,
+	std::shared_ptr<SimplePixelShader> fallback) :
+	device(device),
+	context(context),
+	sourceFile(sourceFile),
+	cache(cacheDirectory),
+	fallback(fallback),
+	compiledCount(0),
+	cachedCount(0),
+	failedCount(0),
+	buildMilliseconds(0)
+{
+}
+
+// --------------------------------------------------------
+// Builds every requested permutation, one pool task each,
+// and swaps them in once all are done
+// --------------------------------------------------------
+void PixelShaderPermutations::Build(const std::vector<unsigned int>& featureMasks, ThreadPool& pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Keys first, on this thread: the graph reads the source and
+	// each include once for all permutations, and isn't safe to
+	// fill from several threads.  Rescanned every build, since
+	// any file may have changed.
+	graph.Clear();
+	std::string identity = compiler.GetIdentity();
+	std::vector<unsigned long long> keys(featureMasks.size());
+	std::vector<char> hashed(featureMasks.size());
+	for (size_t i = 0; i < featureMasks.size(); i++)
+		hashed[i] = HashShaderJob(graph, GetJob(featureMasks[i]), identity, keys[i]);
+
+	std::vector<std::shared_ptr<SimplePixelShader>> results(featureMasks.size());
+	std::atomic<unsigned int> compiled = 0;
+	std::atomic<unsigned int> failed = 0;
+
+	pool.ParallelFor((unsigned int)featureMasks.size(), [&](unsigned int i)
+	{
+		bool didCompile = false;
+		if (hashed[i])
+			results[i] = BuildPermutation(featureMasks[i], keys[i], didCompile);
+
+		if (!results[i]) failed++;
+		else if (didCompile) compiled++;
+	});
+
+	// Keep whatever was there before for anything that failed,
+	// so a typo while editing doesn't drop back to the fallback
+	for (size_t i = 0; i < featureMasks.size(); i++)
+	{
+		if (results[i])
+			shaders[featureMasks[i]] = results[i];
+	}
+
+	compiledCount = compiled;
+	failedCount = failed;
+	cachedCount = (unsigned int)featureMasks.size() - compiledCount - failedCount;
+	buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+std::shared_ptr<SimplePixelShader> PixelShaderPermutations::Get(unsigned int features)
+{
+	auto result = shaders.find(features);
+	if (result == shaders.end())
+		return fallback;
+
+	return result->second;
+}
+
+ShaderCompileJob PixelShaderPermutations::GetJob(unsigned int features) const
+{
+	ShaderCompileJob job;
+	job.Name = sourceFile.stem().string();
+	job.Source = sourceFile;
+	job.EntryPoint = "main";
+	job.Target = "ps_5_0";
+	job.Defines = GetShaderFeatureDefines(features);
+	return job;
+}
+
+// --------------------------------------------------------
+// Runs on a pool thread.  D3DCompileFromFile and device
+// creation are both safe to call from several threads.
+// --------------------------------------------------------
+std::shared_ptr<SimplePixelShader> PixelShaderPermutations::BuildPermutation(unsigned int features, unsigned long long key, bool& compiled)
+{
+	compiled = false;
+	if (!cache.Contains(key))
+	{
+		std::vector<unsigned char> bytecode;
+		std::string errors;
+		if (!compiler.Compile(GetJob(features), bytecode, errors))
+		{
+			printf("Permutation 0x%x of %s failed:\n%s\n", features, sourceFile.filename().string().c_str(), errors.c_str());
+			return 0;
+		}
+
+		if (!cache.Store(key, bytecode.data(), bytecode.size()))
+			return 0;
+
+		compiled = true;
+	}
+
+	// Loading from the cache file also gives it a reflection sidecar
+	std::shared_ptr<SimplePixelShader> shader = std::make_shared<SimplePixelShader>(device, context, cache.GetPath(key).c_str());
+	if (!shader->IsShaderValid())
+		return 0;
+
+	// Every permutation is drawn with the same structs as PixelShader.cso
+	bool layoutsValid =
+		shader->ValidateBufferLayout<PerFramePSData>() &&
+		shader->ValidateBufferLayout<PerMaterialPSData>();
+	return layoutsValid ? shader : 0;
+}
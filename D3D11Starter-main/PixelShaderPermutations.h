@@ -0,0 +1,70 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "D3DShaderCompiler.h"
+#include "SimpleShader.h"
+#include "ShaderPermutations.h"
+#include "ThreadPool.h"
+
+// --------------------------------------------------------
+// Compiled variants of one pixel shader, selected by a
+// ShaderFeature mask.
+//
+// Build() compiles every requested permutation in parallel
+// with D3DShaderCompiler, storing the bytecode in a cache
+// folder keyed by HashShaderJob, the same content hash (and
+// include graph) ShaderBuilder uses.  Inputs that haven't
+// changed since the last build are loaded from the cache
+// instead of recompiled, so calling Build() again after
+// editing a shader only recompiles what the edit touched.
+//
+// Get() falls back to the build-time shader for any mask
+// that failed to compile (or if the source isn't available).
+// --------------------------------------------------------
+class PixelShaderPermutations
+{
+public:
+	PixelShaderPermutations(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		const std::filesystem::path& sourceFile,
+		const std::filesystem::path& cacheDirectory,
+		std::shared_ptr<SimplePixelShader> fallback);
+
+	void Build(const std::vector<unsigned int>& featureMasks, ThreadPool& pool);
+	std::shared_ptr<SimplePixelShader> Get(unsigned int features);
+
+	// Results of the last Build()
+	unsigned int GetCompiledCount() { return compiledCount; }
+	unsigned int GetCachedCount() { return cachedCount; }
+	unsigned int GetFailedCount() { return failedCount; }
+	double GetBuildMilliseconds() { return buildMilliseconds; }
+	size_t GetPermutationCount() { return shaders.size(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	std::filesystem::path sourceFile;
+	ShaderPermutationCache cache;
+	std::shared_ptr<SimplePixelShader> fallback;
+	D3DShaderCompiler compiler;
+	ShaderDependencyGraph graph;
+
+	std::unordered_map<unsigned int, std::shared_ptr<SimplePixelShader>> shaders;
+
+	unsigned int compiledCount;
+	unsigned int cachedCount;
+	unsigned int failedCount;
+	double buildMilliseconds;
+
+	ShaderCompileJob GetJob(unsigned int features) const;
+
+	// Compiles (or finds in the cache) and creates a single permutation
+	std::shared_ptr<SimplePixelShader> BuildPermutation(unsigned int features, unsigned long long key, bool& compiled);
+};
@@ -0,0 +1,621 @@
+#include "PngDecoder.h"
+
+#include <cstring>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Deflate reads bits least significant first.  Keeps up to
+	// 64 bits buffered; reading past the end yields zeros and
+	// reports an overrun.
+	// --------------------------------------------------------
+	class BitReader
+	{
+	public:
+		BitReader(const unsigned char* data, size_t size) : data(data), size(size), pos(0), buffer(0), count(0), padding(0), overrun(false) {}
+
+		unsigned int Peek(unsigned int bits)
+		{
+			Refill(bits);
+			return (unsigned int)(buffer & ((1ull << bits) - 1));
+		}
+
+		void Skip(unsigned int bits)
+		{
+			buffer >>= bits;
+			count -= bits;
+		}
+
+		unsigned int Read(unsigned int bits)
+		{
+			if (bits == 0)
+				return 0;
+			unsigned int value = Peek(bits);
+			Skip(bits);
+			return value;
+		}
+
+		// Drops the rest of the current byte, for stored blocks
+		void AlignToByte()
+		{
+			Skip(count % 8);
+		}
+
+		// Byte copies for stored blocks - the bit buffer is byte
+		// aligned by then, so drain it before touching data directly
+		bool ReadBytes(unsigned char* dest, size_t length)
+		{
+			while (length > 0 && count >= 8)
+			{
+				*dest++ = (unsigned char)Read(8);
+				length--;
+			}
+			if (pos + length > size)
+			{
+				overrun = true;
+				return false;
+			}
+			memcpy(dest, data + pos, length);
+			pos += length;
+			return true;
+		}
+
+		// True once any padding has actually been consumed
+		bool Overrun() const { return overrun || count < padding; }
+
+	private:
+		const unsigned char* data;
+		size_t size;
+		size_t pos;
+		unsigned long long buffer;
+		unsigned int count;
+		unsigned int padding;
+		bool overrun;
+
+		void Refill(unsigned int bits)
+		{
+			while (count < bits)
+			{
+				// Past the end, pad with zeros - a short final code
+				// still needs a full-width peek
+				if (pos < size)
+					buffer |= (unsigned long long)data[pos++] << count;
+				else
+					padding += 8;
+				count += 8;
+			}
+		}
+	};
+
+	// --------------------------------------------------------
+	// Canonical Huffman table.  Codes up to FastBits long
+	// decode with one lookup; longer ones walk the canonical
+	// counts a bit at a time.
+	// --------------------------------------------------------
+	class Huffman
+	{
+	public:
+		static const unsigned int MaxBits = 15;
+		static const unsigned int FastBits = 9;
+
+		bool Build(const unsigned char* lengths, unsigned int symbolCount)
+		{
+			memset(counts, 0, sizeof(counts));
+			for (unsigned int s = 0; s < symbolCount; s++)
+				counts[lengths[s]]++;
+			counts[0] = 0;
+
+			// Over-subscribed code lengths can't be decoded
+			int left = 1;
+			for (unsigned int len = 1; len <= MaxBits; len++)
+			{
+				left <<= 1;
+				left -= counts[len];
+				if (left < 0)
+					return false;
+			}
+
+			unsigned short offsets[MaxBits + 1] = {};
+			for (unsigned int len = 1; len < MaxBits; len++)
+				offsets[len + 1] = offsets[len] + counts[len];
+			for (unsigned int s = 0; s < symbolCount; s++)
+			{
+				if (lengths[s] != 0)
+					symbols[offsets[lengths[s]]++] = (unsigned short)s;
+			}
+
+			// Fill the fast table from the canonical codes, bit-reversed
+			// since the stream is read least significant bit first
+			memset(fast, 0, sizeof(fast));
+			unsigned int code = 0;
+			unsigned int index = 0;
+			for (unsigned int len = 1; len <= FastBits; len++)
+			{
+				for (unsigned int i = 0; i < counts[len]; i++, index++, code++)
+				{
+					unsigned int reversed = 0;
+					for (unsigned int b = 0; b < len; b++)
+						reversed |= ((code >> b) & 1) << (len - 1 - b);
+
+					for (unsigned int fill = reversed; fill < (1u << FastBits); fill += 1u << len)
+						fast[fill] = (unsigned short)((symbols[index] << 4) | len);
+				}
+				code <<= 1;
+			}
+
+			return true;
+		}
+
+		// Returns the symbol, or -1 for an invalid code
+		int Decode(BitReader& bits) const
+		{
+			unsigned short entry = fast[bits.Peek(FastBits)];
+			if (entry != 0)
+			{
+				bits.Skip(entry & 15);
+				return entry >> 4;
+			}
+
+			// Slow path, as in zlib's puff
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (unsigned int len = 1; len <= MaxBits; len++)
+			{
+				code |= bits.Read(1);
+				int count = counts[len];
+				if (code - count < first)
+					return symbols[index + (code - first)];
+				index += count;
+				first += count;
+				first <<= 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+
+	private:
+		unsigned short counts[MaxBits + 1];
+		unsigned short symbols[288];
+		unsigned short fast[1 << FastBits];
+	};
+
+	const unsigned short LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned char LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const unsigned short DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned char DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	bool InflateBlock(BitReader& bits, const Huffman& lengthCodes, const Huffman& distanceCodes, std::vector<unsigned char>& output, std::string& error)
+	{
+		while (true)
+		{
+			int symbol = lengthCodes.Decode(bits);
+			if (symbol < 0 || bits.Overrun())
+			{
+				error = "Bad literal/length code";
+				return false;
+			}
+
+			if (symbol < 256)
+			{
+				output.push_back((unsigned char)symbol);
+				continue;
+			}
+			if (symbol == 256)
+				return true;
+
+			symbol -= 257;
+			if (symbol >= 29)
+			{
+				error = "Bad length symbol";
+				return false;
+			}
+			unsigned int length = LengthBase[symbol] + bits.Read(LengthExtra[symbol]);
+
+			int distSymbol = distanceCodes.Decode(bits);
+			if (distSymbol < 0 || distSymbol >= 30)
+			{
+				error = "Bad distance code";
+				return false;
+			}
+			size_t distance = DistanceBase[distSymbol] + bits.Read(DistanceExtra[distSymbol]);
+			if (distance > output.size())
+			{
+				error = "Distance reaches before the start of the output";
+				return false;
+			}
+
+			// Byte at a time, since the copy may overlap itself
+			size_t from = output.size() - distance;
+			output.resize(output.size() + length);
+			unsigned char* out = output.data();
+			size_t to = output.size() - length;
+			for (unsigned int i = 0; i < length; i++)
+				out[to + i] = out[from + i];
+		}
+	}
+
+	unsigned int ReadBigEndian32(const unsigned char* p)
+	{
+		return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+	}
+
+	unsigned char Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = p > a ? p - a : a - p;
+		int pb = p > b ? p - b : b - p;
+		int pc = p > c ? p - c : c - p;
+		if (pa <= pb && pa <= pc) return (unsigned char)a;
+		if (pb <= pc) return (unsigned char)b;
+		return (unsigned char)c;
+	}
+}
+
+bool Inflate(const unsigned char* data, size_t size, std::vector<unsigned char>& output, std::string& error)
+{
+	BitReader bits(data, size);
+	Huffman lengthCodes;
+	Huffman distanceCodes;
+
+	bool last = false;
+	while (!last)
+	{
+		last = bits.Read(1) != 0;
+		unsigned int type = bits.Read(2);
+
+		if (type == 0)
+		{
+			// Stored
+			bits.AlignToByte();
+			unsigned int length = bits.Read(16);
+			unsigned int inverse = bits.Read(16);
+			if ((length ^ 0xFFFF) != inverse)
+			{
+				error = "Stored block length check failed";
+				return false;
+			}
+			size_t start = output.size();
+			output.resize(start + length);
+			if (!bits.ReadBytes(output.data() + start, length))
+			{
+				error = "Stored block runs past the end of the data";
+				return false;
+			}
+			continue;
+		}
+
+		unsigned char lengths[288 + 32] = {};
+		unsigned int lengthCount = 288;
+		unsigned int distanceCount = 30;
+
+		if (type == 1)
+		{
+			// Fixed codes
+			for (unsigned int s = 0; s < 288; s++)
+				lengths[s] = s < 144 ? 8 : s < 256 ? 9 : s < 280 ? 7 : 8;
+			for (unsigned int s = 0; s < 30; s++)
+				lengths[288 + s] = 5;
+		}
+		else if (type == 2)
+		{
+			// Dynamic codes, themselves Huffman coded
+			lengthCount = bits.Read(5) + 257;
+			distanceCount = bits.Read(5) + 1;
+			unsigned int codeLengthCount = bits.Read(4) + 4;
+			if (lengthCount > 286 || distanceCount > 30)
+			{
+				error = "Too many length or distance codes";
+				return false;
+			}
+
+			static const unsigned char order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+			unsigned char codeLengths[19] = {};
+			for (unsigned int i = 0; i < codeLengthCount; i++)
+				codeLengths[order[i]] = (unsigned char)bits.Read(3);
+
+			Huffman codeLengthCodes;
+			if (!codeLengthCodes.Build(codeLengths, 19))
+			{
+				error = "Bad code length codes";
+				return false;
+			}
+
+			unsigned char all[286 + 30] = {};
+			unsigned int index = 0;
+			while (index < lengthCount + distanceCount)
+			{
+				int symbol = codeLengthCodes.Decode(bits);
+				if (symbol < 0 || bits.Overrun())
+				{
+					error = "Bad code length";
+					return false;
+				}
+
+				if (symbol < 16)
+				{
+					all[index++] = (unsigned char)symbol;
+					continue;
+				}
+
+				unsigned char repeat = 0;
+				unsigned int times;
+				if (symbol == 16)
+				{
+					if (index == 0)
+					{
+						error = "Repeat with no previous length";
+						return false;
+					}
+					repeat = all[index - 1];
+					times = 3 + bits.Read(2);
+				}
+				else if (symbol == 17)
+					times = 3 + bits.Read(3);
+				else
+					times = 11 + bits.Read(7);
+
+				if (index + times > lengthCount + distanceCount)
+				{
+					error = "Code lengths overflow";
+					return false;
+				}
+				while (times-- > 0)
+					all[index++] = repeat;
+			}
+
+			memcpy(lengths, all, lengthCount);
+			memcpy(lengths + 288, all + lengthCount, distanceCount);
+		}
+		else
+		{
+			error = "Invalid block type";
+			return false;
+		}
+
+		if (!lengthCodes.Build(lengths, lengthCount) || !distanceCodes.Build(lengths + 288, distanceCount))
+		{
+			error = "Bad Huffman code lengths";
+			return false;
+		}
+
+		if (!InflateBlock(bits, lengthCodes, distanceCodes, output, error))
+			return false;
+	}
+
+	return true;
+}
+
+bool DecodePng(const unsigned char* data, size_t size, DecodedImage& image, std::string& error)
+{
+	static const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+	if (size < 8 || memcmp(data, signature, 8) != 0)
+	{
+		error = "Not a PNG";
+		return false;
+	}
+
+	unsigned int width = 0, height = 0;
+	unsigned int bitDepth = 0, colorType = 0, interlace = 0;
+	unsigned char palette[256][4] = {};
+	unsigned int paletteSize = 0;
+	bool hasColorKey = false;
+	unsigned int colorKey[3] = {};
+	std::vector<unsigned char> compressed;
+
+	// Walk the chunks, gathering what's needed
+	size_t pos = 8;
+	bool ended = false;
+	while (!ended && pos + 12 <= size)
+	{
+		unsigned int length = ReadBigEndian32(data + pos);
+		const unsigned char* type = data + pos + 4;
+		const unsigned char* body = data + pos + 8;
+		if (length > size - pos - 12)
+		{
+			error = "Truncated chunk";
+			return false;
+		}
+
+		if (memcmp(type, "IHDR", 4) == 0 && length >= 13)
+		{
+			width = ReadBigEndian32(body);
+			height = ReadBigEndian32(body + 4);
+			bitDepth = body[8];
+			colorType = body[9];
+			interlace = body[12];
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			paletteSize = length / 3 > 256 ? 256 : length / 3;
+			for (unsigned int i = 0; i < paletteSize; i++)
+			{
+				palette[i][0] = body[i * 3 + 0];
+				palette[i][1] = body[i * 3 + 1];
+				palette[i][2] = body[i * 3 + 2];
+				palette[i][3] = 255;
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (colorType == 3)
+			{
+				for (unsigned int i = 0; i < length && i < 256; i++)
+					palette[i][3] = body[i];
+			}
+			else if (colorType == 0 && length >= 2)
+			{
+				hasColorKey = true;
+				colorKey[0] = (body[0] << 8) | body[1];
+			}
+			else if (colorType == 2 && length >= 6)
+			{
+				hasColorKey = true;
+				for (int c = 0; c < 3; c++)
+					colorKey[c] = (body[c * 2] << 8) | body[c * 2 + 1];
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), body, body + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			ended = true;
+		}
+
+		pos += 12 + (size_t)length;
+	}
+
+	unsigned int channels = 0;
+	switch (colorType)
+	{
+	case 0: channels = 1; break; // Gray
+	case 2: channels = 3; break; // RGB
+	case 3: channels = 1; break; // Palette
+	case 4: channels = 2; break; // Gray + alpha
+	case 6: channels = 4; break; // RGBA
+	default: error = "Unknown color type"; return false;
+	}
+
+	if (width == 0 || height == 0 || width > 16384 || height > 16384)
+	{
+		error = "Missing or unsupported image size";
+		return false;
+	}
+	if (bitDepth != 1 && bitDepth != 2 && bitDepth != 4 && bitDepth != 8 && bitDepth != 16)
+	{
+		error = "Unsupported bit depth";
+		return false;
+	}
+	if (interlace != 0)
+	{
+		error = "Interlaced PNGs aren't supported";
+		return false;
+	}
+	if (compressed.size() < 6)
+	{
+		error = "No image data";
+		return false;
+	}
+
+	// Skip the 2-byte zlib header; the adler32 at the end is ignored
+	size_t bitsPerPixel = (size_t)channels * bitDepth;
+	size_t rowBytes = (width * bitsPerPixel + 7) / 8;
+	size_t filterStride = bitsPerPixel < 8 ? 1 : bitsPerPixel / 8;
+
+	std::vector<unsigned char> raw;
+	raw.reserve((rowBytes + 1) * height);
+	if (!Inflate(compressed.data() + 2, compressed.size() - 2, raw, error))
+		return false;
+	if (raw.size() < (rowBytes + 1) * height)
+	{
+		error = "Image data is shorter than the image";
+		return false;
+	}
+
+	// Undo the per-row filters in place
+	for (unsigned int y = 0; y < height; y++)
+	{
+		unsigned char filter = raw[y * (rowBytes + 1)];
+		unsigned char* row = &raw[y * (rowBytes + 1) + 1];
+		const unsigned char* prior = y > 0 ? row - (rowBytes + 1) : 0;
+
+		for (size_t x = 0; x < rowBytes; x++)
+		{
+			int a = x >= filterStride ? row[x - filterStride] : 0;
+			int b = prior ? prior[x] : 0;
+			int c = prior && x >= filterStride ? prior[x - filterStride] : 0;
+
+			switch (filter)
+			{
+			case 0: break;
+			case 1: row[x] = (unsigned char)(row[x] + a); break;
+			case 2: row[x] = (unsigned char)(row[x] + b); break;
+			case 3: row[x] = (unsigned char)(row[x] + ((a + b) >> 1)); break;
+			case 4: row[x] = (unsigned char)(row[x] + Paeth(a, b, c)); break;
+			default: error = "Unknown row filter"; return false;
+			}
+		}
+	}
+
+	// Expand to RGBA8
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height * 4);
+
+	unsigned int maxSample = (1u << bitDepth) - 1;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		const unsigned char* row = &raw[y * (rowBytes + 1) + 1];
+		unsigned char* out = &image.Pixels[(size_t)y * width * 4];
+
+		for (unsigned int x = 0; x < width; x++, out += 4)
+		{
+			// Full-precision samples, for the color key, then scaled to 8 bits
+			unsigned int samples[4] = {};
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				size_t bit = ((size_t)x * channels + c) * bitDepth;
+				if (bitDepth == 16)
+					samples[c] = (row[bit / 8] << 8) | row[bit / 8 + 1];
+				else if (bitDepth == 8)
+					samples[c] = row[bit / 8];
+				else
+					samples[c] = (row[bit / 8] >> (8 - bitDepth - bit % 8)) & maxSample;
+			}
+
+			auto to8 = [&](unsigned int sample) -> unsigned char
+				{
+					if (bitDepth == 16) return (unsigned char)(sample >> 8);
+					return (unsigned char)(sample * 255 / maxSample);
+				};
+
+			switch (colorType)
+			{
+			case 0:
+				out[0] = out[1] = out[2] = to8(samples[0]);
+				out[3] = hasColorKey && samples[0] == colorKey[0] ? 0 : 255;
+				break;
+			case 2:
+				out[0] = to8(samples[0]);
+				out[1] = to8(samples[1]);
+				out[2] = to8(samples[2]);
+				out[3] = hasColorKey && samples[0] == colorKey[0] && samples[1] == colorKey[1] && samples[2] == colorKey[2] ? 0 : 255;
+				break;
+			case 3:
+				if (samples[0] >= paletteSize)
+				{
+					error = "Palette index out of range";
+					return false;
+				}
+				memcpy(out, palette[samples[0]], 4);
+				break;
+			case 4:
+				out[0] = out[1] = out[2] = to8(samples[0]);
+				out[3] = to8(samples[1]);
+				break;
+			case 6:
+				out[0] = to8(samples[0]);
+				out[1] = to8(samples[1]);
+				out[2] = to8(samples[2]);
+				out[3] = to8(samples[3]);
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool ReadPngSize(const unsigned char* data, size_t size, unsigned int& width, unsigned int& height)
+{
+	// IHDR always comes first, right after the signature
+	static const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+	if (size < 24 || memcmp(data, signature, 8) != 0 || memcmp(data + 12, "IHDR", 4) != 0)
+		return false;
+
+	width = ReadBigEndian32(data + 16);
+	height = ReadBigEndian32(data + 20);
+	return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// A decoded image, always 8-bit RGBA with tightly packed
+// rows (Width * 4 bytes each)
+// --------------------------------------------------------
+struct DecodedImage
+{
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	std::vector<unsigned char> Pixels;
+};
+
+// --------------------------------------------------------
+// Standalone PNG decoder with its own inflate, so texture
+// cooking doesn't need WIC and runs on any platform.
+//
+// Handles every non-interlaced color type at 1 to 16 bits
+// per sample (16-bit samples keep their high byte) plus
+// tRNS transparency.  Interlaced images are rejected.
+// --------------------------------------------------------
+bool DecodePng(const unsigned char* data, size_t size, DecodedImage& image, std::string& error);
+
+// Just the dimensions, from the header chunk
+bool ReadPngSize(const unsigned char* data, size_t size, unsigned int& width, unsigned int& height);
+
+// Raw deflate stream (no zlib header) into output, which is
+// appended to.  Exposed for testing.
+bool Inflate(const unsigned char* data, size_t size, std::vector<unsigned char>& output, std::string& error);
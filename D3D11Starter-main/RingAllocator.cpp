@@ -0,0 +1,114 @@
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(unsigned int capacity, unsigned int alignment) :
+	alignment(alignment > 0 ? alignment : 1),
+	head(0),
+	tail(0),
+	used(0),
+	currentFrameBytes(0),
+	allocationCount(0),
+	failedAllocationCount(0),
+	wrapCount(0)
+{
+	// Keep the whole ring a multiple of the alignment so the
+	// wrap point is always an aligned offset
+	this->capacity = capacity / this->alignment * this->alignment;
+}
+
+// --------------------------------------------------------
+// Allocates an aligned block from the ring
+//
+// size - Number of bytes needed (rounded up to the alignment)
+//
+// Returns the byte offset of the block, or InvalidOffset
+// if there isn't enough free space
+// --------------------------------------------------------
+unsigned int RingAllocator::Allocate(unsigned int size)
+{
+	unsigned int alignedSize = AlignSize(size);
+	if (alignedSize == 0 || alignedSize > capacity)
+	{
+		failedAllocationCount++;
+		return InvalidOffset;
+	}
+
+	// Nothing in flight, so start over at the front
+	if (used == 0)
+		head = tail = 0;
+
+	unsigned int offset = InvalidOffset;
+	if (used == 0 || head > tail)
+	{
+		// Free space is [head, capacity) plus [0, tail)
+		if (capacity - head >= alignedSize)
+		{
+			offset = head;
+		}
+		else if (tail >= alignedSize)
+		{
+			// Skip the end of the ring - the skipped bytes belong
+			// to this frame so they are freed along with it
+			unsigned int skipped = capacity - head;
+			used += skipped;
+			currentFrameBytes += skipped;
+			offset = 0;
+			wrapCount++;
+		}
+	}
+	else if (head < tail && tail - head >= alignedSize)
+	{
+		// Free space is [head, tail)
+		offset = head;
+	}
+
+	if (offset == InvalidOffset)
+	{
+		failedAllocationCount++;
+		return InvalidOffset;
+	}
+
+	head = offset + alignedSize;
+	if (head == capacity)
+		head = 0;
+
+	used += alignedSize;
+	currentFrameBytes += alignedSize;
+	allocationCount++;
+	return offset;
+}
+
+// --------------------------------------------------------
+// Marks the end of a frame.  Everything allocated since
+// the last call stays in use until Retire() sees this fence.
+// --------------------------------------------------------
+void RingAllocator::EndFrame(unsigned long long fenceValue)
+{
+	FrameRecord frame = {};
+	frame.Fence = fenceValue;
+	frame.Bytes = currentFrameBytes;
+	frames.push_back(frame);
+
+	currentFrameBytes = 0;
+}
+
+// --------------------------------------------------------
+// Frees every frame whose fence value is less than or
+// equal to the completed value
+// --------------------------------------------------------
+void RingAllocator::Retire(unsigned long long completedFenceValue)
+{
+	while (!frames.empty() && frames.front().Fence <= completedFenceValue)
+	{
+		unsigned int bytes = frames.front().Bytes;
+		tail = (tail + bytes) % capacity;
+		used -= bytes;
+		frames.pop_front();
+	}
+}
+
+void RingAllocator::ResetStats()
+{
+	allocationCount = 0;
+	failedAllocationCount = 0;
+	wrapCount = 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <deque>
+
+// --------------------------------------------------------
+// Sub-allocates a fixed-size region as a ring, handing out
+// aligned offsets.  Memory is returned a whole frame at a
+// time: EndFrame() tags everything allocated since the last
+// call with a fence value, and Retire() frees every frame
+// whose fence the GPU has passed.
+//
+// This class never touches the GPU - the owner supplies the
+// fence values - so it can be driven by a fake fence.
+// --------------------------------------------------------
+class RingAllocator
+{
+public:
+	static const unsigned int InvalidOffset = 0xFFFFFFFF;
+
+	RingAllocator(unsigned int capacity, unsigned int alignment = 256);
+
+	// Returns the offset of the allocation, or InvalidOffset
+	// if the ring doesn't have room until frames are retired
+	unsigned int Allocate(unsigned int size);
+
+	// Frame tracking
+	void EndFrame(unsigned long long fenceValue);
+	void Retire(unsigned long long completedFenceValue);
+
+	// Getters
+	unsigned int GetCapacity() const { return capacity; }
+	unsigned int GetAlignment() const { return alignment; }
+	unsigned int GetUsedBytes() const { return used; }
+	unsigned int GetHead() const { return head; }
+	unsigned int GetTail() const { return tail; }
+	unsigned int GetFramesInFlight() const { return (unsigned int)frames.size(); }
+
+	// Stats
+	unsigned int GetAllocationCount() const { return allocationCount; }
+	unsigned int GetFailedAllocationCount() const { return failedAllocationCount; }
+	unsigned int GetWrapCount() const { return wrapCount; }
+	void ResetStats();
+
+	unsigned int AlignSize(unsigned int size) const { return (size + alignment - 1) / alignment * alignment; }
+
+private:
+	struct FrameRecord
+	{
+		unsigned long long Fence;
+		unsigned int Bytes; // Everything this frame consumed, including skipped space at the wrap
+	};
+
+	unsigned int capacity;
+	unsigned int alignment;
+	unsigned int head; // Next byte to hand out
+	unsigned int tail; // Oldest byte still in use
+	unsigned int used;
+	unsigned int currentFrameBytes;
+	std::deque<FrameRecord> frames;
+
+	unsigned int allocationCount;
+	unsigned int failedAllocationCount;
+	unsigned int wrapCount;
+};
@@ -0,0 +1,414 @@
+#include "ShaderBuild.h"
+#include "CacheFiles.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <set>
+#include <sstream>
+#include <thread>
+
+// Bump when the key layout changes, so every shader rebuilds once
+static const char* ShaderBuildKeyVersion = "build-1";
+
+
+// --------------------------------------------------------
+// Dependency graph
+// --------------------------------------------------------
+bool ShaderDependencyGraph::Scan(const std::filesystem::path& file)
+{
+	std::filesystem::path key = file.lexically_normal();
+	if (nodes.count(key) > 0)
+		return true;
+
+	std::string source;
+	if (!ReadShaderSource(key, source))
+		return false;
+
+	// Added before recursing so an include cycle stops here
+	Node& node = nodes[key];
+	node.ContentHash = HashBytes(source.data(), source.size());
+
+	std::vector<std::string> names;
+	FindShaderIncludeNames(source, names);
+
+	for (const std::string& name : names)
+	{
+		// Quoted includes are relative to the including file
+		std::filesystem::path include = (key.parent_path() / name).lexically_normal();
+		if (!Scan(include))
+			return false;
+
+		// A header included twice is still one edge
+		if (std::find(node.Includes.begin(), node.Includes.end(), include) != node.Includes.end())
+			continue;
+
+		node.Includes.push_back(include);
+		nodes[include].IncludedBy.push_back(key);
+	}
+
+	return true;
+}
+
+void ShaderDependencyGraph::Clear()
+{
+	nodes.clear();
+}
+
+std::vector<std::filesystem::path> ShaderDependencyGraph::GetIncludes(const std::filesystem::path& file) const
+{
+	std::vector<std::filesystem::path> result;
+	std::set<std::filesystem::path> visited;
+
+	std::function<void(const std::filesystem::path&)> visit = [&](const std::filesystem::path& current)
+	{
+		auto node = nodes.find(current);
+		if (node == nodes.end())
+			return;
+
+		for (const std::filesystem::path& include : node->second.Includes)
+		{
+			if (!visited.insert(include).second)
+				continue;
+
+			result.push_back(include);
+			visit(include);
+		}
+	};
+
+	visit(file.lexically_normal());
+	return result;
+}
+
+std::vector<std::filesystem::path> ShaderDependencyGraph::GetDependents(const std::filesystem::path& file) const
+{
+	std::vector<std::filesystem::path> result;
+	std::set<std::filesystem::path> visited;
+	std::vector<std::filesystem::path> open = { file.lexically_normal() };
+
+	while (!open.empty())
+	{
+		std::filesystem::path current = open.back();
+		open.pop_back();
+
+		auto node = nodes.find(current);
+		if (node == nodes.end())
+			continue;
+
+		for (const std::filesystem::path& parent : node->second.IncludedBy)
+		{
+			if (!visited.insert(parent).second)
+				continue;
+
+			result.push_back(parent);
+			open.push_back(parent);
+		}
+	}
+
+	return result;
+}
+
+unsigned long long ShaderDependencyGraph::GetContentHash(const std::filesystem::path& file) const
+{
+	auto node = nodes.find(file.lexically_normal());
+	return node == nodes.end() ? 0 : node->second.ContentHash;
+}
+
+std::vector<std::filesystem::path> ShaderDependencyGraph::GetIncludedFiles() const
+{
+	std::vector<std::filesystem::path> result;
+	for (const auto& node : nodes)
+	{
+		if (!node.second.IncludedBy.empty())
+			result.push_back(node.first);
+	}
+	return result;
+}
+
+
+// --------------------------------------------------------
+// Command line compiler
+// --------------------------------------------------------
+CommandLineShaderCompiler::CommandLineShaderCompiler(const std::string& commandTemplate, const std::string& defineFlag) :
+	commandTemplate(commandTemplate),
+	defineFlag(defineFlag)
+{
+}
+
+CommandLineShaderCompiler CommandLineShaderCompiler::Fxc(const std::string& executable)
+{
+	return CommandLineShaderCompiler(
+		"\"" + executable + "\" /nologo /E {entry} /T {target} {defines} /Fo \"{output}\" \"{input}\"",
+		"/D ");
+}
+
+CommandLineShaderCompiler CommandLineShaderCompiler::Dxc(const std::string& executable)
+{
+	CommandLineShaderCompiler dxc(
+		"\"" + executable + "\" -E {entry} -T {target} {defines} -Fo \"{output}\" \"{input}\"",
+		"-D ");
+	dxc.minimumShaderModel = "6_0";
+	return dxc;
+}
+
+std::string CommandLineShaderCompiler::GetIdentity() const
+{
+	return commandTemplate + '\0' + defineFlag + '\0' + minimumShaderModel;
+}
+
+static void ReplaceAll(std::string& text, const std::string& from, const std::string& to)
+{
+	size_t position = 0;
+	while ((position = text.find(from, position)) != std::string::npos)
+	{
+		text.replace(position, from.size(), to);
+		position += to.size();
+	}
+}
+
+// --------------------------------------------------------
+// Raises a target like "ps_5_0" to the given model ("6_0")
+// if it's older
+// --------------------------------------------------------
+static std::string RaiseShaderModel(const std::string& target, const std::string& minimumModel)
+{
+	size_t underscore = target.find('_');
+	if (minimumModel.empty() || underscore == std::string::npos)
+		return target;
+
+	std::string model = target.substr(underscore + 1);
+	return model < minimumModel ? target.substr(0, underscore + 1) + minimumModel : target;
+}
+
+// --------------------------------------------------------
+// Runs the compiler into a temporary file, then reads the
+// result back.  The compiler's own output becomes the error
+// text if it fails.
+// --------------------------------------------------------
+bool CommandLineShaderCompiler::Compile(const ShaderCompileJob& job, std::vector<unsigned char>& bytecode, std::string& errors)
+{
+	// Names only need to be unique between threads of this process
+	std::string unique = job.Name + "-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	std::error_code error;
+	std::filesystem::path tempDirectory = std::filesystem::temp_directory_path(error);
+	std::filesystem::path outputPath = tempDirectory / (unique + ".cso");
+	std::filesystem::path logPath = tempDirectory / (unique + ".log");
+
+	std::string defines;
+	for (const ShaderDefine& define : job.Defines)
+		defines += defineFlag + define.Name + "=" + define.Value + " ";
+
+	std::string command = commandTemplate;
+	ReplaceAll(command, "{input}", job.Source.string());
+	ReplaceAll(command, "{output}", outputPath.string());
+	ReplaceAll(command, "{entry}", job.EntryPoint);
+	ReplaceAll(command, "{target}", RaiseShaderModel(job.Target, minimumShaderModel));
+	ReplaceAll(command, "{defines}", defines);
+	command += " > \"" + logPath.string() + "\" 2>&1";
+
+#ifdef _WIN32
+	// cmd.exe strips the first and last quote of the whole line
+	command = "\"" + command + "\"";
+#endif
+
+	int exitCode = std::system(command.c_str());
+
+	ReadShaderSource(logPath, errors);
+	std::filesystem::remove(logPath, error);
+
+	std::string output;
+	bool succeeded = exitCode == 0 && ReadShaderSource(outputPath, output) && !output.empty();
+	std::filesystem::remove(outputPath, error);
+
+	if (!succeeded)
+		return false;
+
+	bytecode.assign(output.begin(), output.end());
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Manifest - one tab separated line per shader:
+//   name  key  output  source
+// --------------------------------------------------------
+bool ShaderManifest::Load(const std::filesystem::path& path)
+{
+	directory = path.parent_path();
+	entries.clear();
+
+	std::string text;
+	if (!ReadShaderSource(path, text))
+		return false;
+
+	std::istringstream lines(text);
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::vector<std::string> fields;
+		std::istringstream columns(line);
+		std::string field;
+		while (std::getline(columns, field, '\t'))
+			fields.push_back(field);
+
+		if (fields.size() != 4)
+			continue;
+
+		ShaderManifestEntry entry;
+		entry.Name = fields[0];
+		entry.Key = strtoull(fields[1].c_str(), 0, 16);
+		entry.Output = fields[2];
+		entry.Source = fields[3];
+		entries[entry.Name] = entry;
+	}
+
+	return true;
+}
+
+bool ShaderManifest::Save(const std::filesystem::path& path) const
+{
+	std::string text = "# name\tkey\toutput\tsource\n";
+	for (const auto& entry : entries)
+	{
+		text += entry.second.Name + '\t' + FormatHashKey(entry.second.Key) + '\t' + entry.second.Output + '\t' + entry.second.Source + '\n';
+	}
+
+	return WriteFileAtomic(path, text.data(), text.size());
+}
+
+const ShaderManifestEntry* ShaderManifest::Find(const std::string& name) const
+{
+	auto entry = entries.find(name);
+	return entry == entries.end() ? 0 : &entry->second;
+}
+
+void ShaderManifest::Set(const ShaderManifestEntry& entry)
+{
+	entries[entry.Name] = entry;
+}
+
+std::filesystem::path ShaderManifest::GetOutputPath(const std::string& name) const
+{
+	const ShaderManifestEntry* entry = Find(name);
+	return entry ? directory / entry->Output : std::filesystem::path();
+}
+
+
+// --------------------------------------------------------
+// Content hashes come from the graph, so a shared include is
+// only read once however many shaders use it
+// --------------------------------------------------------
+bool HashShaderJob(ShaderDependencyGraph& graph, const ShaderCompileJob& job, const std::string& compilerIdentity, unsigned long long& key)
+{
+	if (!graph.Scan(job.Source))
+		return false;
+
+	std::string hash;
+	std::string keyData = ShaderBuildKeyVersion;
+	keyData += '\0' + compilerIdentity + '\0' + job.EntryPoint + '\0' + job.Target + '\0';
+	for (const ShaderDefine& define : job.Defines)
+		keyData += define.Name + '=' + define.Value + '\0';
+
+	hash = FormatHashKey(graph.GetContentHash(job.Source));
+	keyData += hash;
+
+	// Include paths aren't hashed, only their names and contents,
+	// so moving the project doesn't rebuild everything
+	for (const std::filesystem::path& include : graph.GetIncludes(job.Source))
+	{
+		hash = FormatHashKey(graph.GetContentHash(include));
+		keyData += '\0' + include.filename().string() + '=' + hash;
+	}
+
+	key = HashBytes(keyData.data(), keyData.size());
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Builder
+// --------------------------------------------------------
+ShaderBuilder::ShaderBuilder(const std::filesystem::path& outputDirectory) :
+	outputDirectory(outputDirectory)
+{
+}
+
+ShaderBuildResults ShaderBuilder::Build(const std::vector<ShaderCompileJob>& jobs, IShaderCompiler& compiler, ThreadPool& pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	ShaderBuildResults results;
+
+	std::error_code error;
+	std::filesystem::create_directories(outputDirectory, error);
+
+	// A missing manifest just means everything is out of date
+	ShaderManifest manifest;
+	manifest.Load(GetManifestPath());
+
+	// Rescan every time - any file may have changed since the last build
+	graph.Clear();
+	std::string identity = compiler.GetIdentity();
+
+	std::vector<unsigned long long> keys(jobs.size());
+	std::vector<unsigned int> outOfDate;
+	for (unsigned int i = 0; i < jobs.size(); i++)
+	{
+		if (!HashShaderJob(graph, jobs[i], identity, keys[i]))
+		{
+			results.Failed++;
+			results.Errors.push_back(jobs[i].Name + ": couldn't read " + jobs[i].Source.string() + " or one of its includes");
+			continue;
+		}
+
+		const ShaderManifestEntry* entry = manifest.Find(jobs[i].Name);
+		if (entry && entry->Key == keys[i] && std::filesystem::exists(manifest.GetOutputPath(jobs[i].Name), error))
+			results.UpToDate++;
+		else
+			outOfDate.push_back(i);
+	}
+
+	std::vector<std::string> errors(outOfDate.size());
+	std::vector<char> succeeded(outOfDate.size(), 0);
+	pool.ParallelFor((unsigned int)outOfDate.size(), [&](unsigned int i)
+	{
+		const ShaderCompileJob& job = jobs[outOfDate[i]];
+
+		std::vector<unsigned char> bytecode;
+		succeeded[i] =
+			compiler.Compile(job, bytecode, errors[i]) &&
+			WriteFileAtomic(outputDirectory / (job.Name + ".cso"), bytecode.data(), bytecode.size());
+	});
+
+	for (size_t i = 0; i < outOfDate.size(); i++)
+	{
+		const ShaderCompileJob& job = jobs[outOfDate[i]];
+		if (!succeeded[i])
+		{
+			results.Failed++;
+			results.Errors.push_back(job.Name + ":\n" + errors[i]);
+			continue;
+		}
+
+		ShaderManifestEntry entry;
+		entry.Name = job.Name;
+		entry.Key = keys[outOfDate[i]];
+		entry.Output = job.Name + ".cso";
+		entry.Source = job.Source.string();
+		manifest.Set(entry);
+
+		results.Compiled++;
+		results.CompiledNames.push_back(job.Name);
+	}
+
+	if (results.Compiled > 0 && !manifest.Save(GetManifestPath()))
+		results.Errors.push_back("Couldn't write " + GetManifestPath().string());
+
+	results.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return results;
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <filesystem>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderPermutations.h"
+#include "ThreadPool.h"
+
+// --------------------------------------------------------
+// Which files each shader pulls in with #include, in both
+// directions.  Every file is read and hashed once per scan,
+// no matter how many shaders include it.
+// --------------------------------------------------------
+class ShaderDependencyGraph
+{
+public:
+	// Reads a file and, recursively, everything it includes
+	bool Scan(const std::filesystem::path& file);
+	void Clear();
+
+	// Everything a file depends on, directly or not, in first-seen order
+	std::vector<std::filesystem::path> GetIncludes(const std::filesystem::path& file) const;
+
+	// Every scanned file that depends on this one, directly or not
+	std::vector<std::filesystem::path> GetDependents(const std::filesystem::path& file) const;
+
+	// Hash of the file's text, or 0 if it was never scanned
+	unsigned long long GetContentHash(const std::filesystem::path& file) const;
+
+	// Files that are included by something, for tools and the UI
+	std::vector<std::filesystem::path> GetIncludedFiles() const;
+
+private:
+	struct Node
+	{
+		unsigned long long ContentHash = 0;
+		std::vector<std::filesystem::path> Includes;
+		std::vector<std::filesystem::path> IncludedBy;
+	};
+
+	std::map<std::filesystem::path, Node> nodes;
+};
+
+// --------------------------------------------------------
+// One shader to build
+// --------------------------------------------------------
+struct ShaderCompileJob
+{
+	std::string Name; // Output is Name.cso, and the manifest is keyed by it
+	std::filesystem::path Source;
+	std::string EntryPoint = "main";
+	std::string Target;  // Such as "vs_5_0"
+	std::vector<ShaderDefine> Defines;
+};
+
+// --------------------------------------------------------
+// Content hash of everything that affects a compile: the
+// source and every include (by name and text, so moving the
+// project changes nothing), the defines, entry point, target
+// and compiler identity.  Scans the source into the graph
+// first if it isn't there.
+//
+// Returns false if the source or an include can't be read
+// --------------------------------------------------------
+bool HashShaderJob(ShaderDependencyGraph& graph, const ShaderCompileJob& job, const std::string& compilerIdentity, unsigned long long& key);
+
+// --------------------------------------------------------
+// A compiler backend.  Compile() is called from several
+// threads at once.
+// --------------------------------------------------------
+class IShaderCompiler
+{
+public:
+	virtual ~IShaderCompiler() {}
+
+	// Part of every shader's key - include the compiler version
+	// and anything else that changes its output
+	virtual std::string GetIdentity() const = 0;
+
+	virtual bool Compile(const ShaderCompileJob& job, std::vector<unsigned char>& bytecode, std::string& errors) = 0;
+};
+
+// --------------------------------------------------------
+// Runs an external compiler (fxc.exe or dxc) per shader.
+// The command is a template with these placeholders:
+//   {input} {output} {entry} {target} {defines}
+// --------------------------------------------------------
+class CommandLineShaderCompiler : public IShaderCompiler
+{
+public:
+	CommandLineShaderCompiler(const std::string& commandTemplate, const std::string& defineFlag);
+
+	static CommandLineShaderCompiler Fxc(const std::string& executable = "fxc");
+
+	// DXC only compiles shader model 6 and up, so older targets
+	// are raised to 6_0.  Its DXIL output won't load in D3D11;
+	// this is for validating and building the shader library.
+	static CommandLineShaderCompiler Dxc(const std::string& executable = "dxc");
+
+	std::string GetIdentity() const override;
+	bool Compile(const ShaderCompileJob& job, std::vector<unsigned char>& bytecode, std::string& errors) override;
+
+private:
+	std::string commandTemplate;
+	std::string defineFlag;
+	std::string minimumShaderModel;
+};
+
+// --------------------------------------------------------
+// Name -> compiled file, written by ShaderBuilder.  The game
+// looks shaders up here first so it picks up the newest build.
+// --------------------------------------------------------
+struct ShaderManifestEntry
+{
+	std::string Name;
+	unsigned long long Key = 0;
+	std::string Output; // Relative to the manifest's folder
+	std::string Source;
+};
+
+class ShaderManifest
+{
+public:
+	bool Load(const std::filesystem::path& path);
+	bool Save(const std::filesystem::path& path) const;
+
+	const ShaderManifestEntry* Find(const std::string& name) const;
+	void Set(const ShaderManifestEntry& entry);
+
+	// Full path to a shader's output, or empty if it isn't listed
+	std::filesystem::path GetOutputPath(const std::string& name) const;
+
+	size_t GetEntryCount() const { return entries.size(); }
+
+private:
+	std::filesystem::path directory;
+	std::map<std::string, ShaderManifestEntry> entries;
+};
+
+struct ShaderBuildResults
+{
+	unsigned int Compiled = 0;
+	unsigned int UpToDate = 0;
+	unsigned int Failed = 0;
+	double Milliseconds = 0;
+	std::vector<std::string> CompiledNames;
+	std::vector<std::string> Errors;
+};
+
+// --------------------------------------------------------
+// Incremental shader build.  Each job's key hashes its
+// source, every include, the defines, entry point, target
+// and compiler identity; only jobs whose key differs from
+// the manifest (or whose output is missing) are compiled,
+// in parallel on the thread pool.
+//
+// Failed jobs keep their old manifest entry, so the last
+// good build stays loadable while a shader is being fixed.
+// --------------------------------------------------------
+class ShaderBuilder
+{
+public:
+	ShaderBuilder(const std::filesystem::path& outputDirectory);
+
+	ShaderBuildResults Build(const std::vector<ShaderCompileJob>& jobs, IShaderCompiler& compiler, ThreadPool& pool);
+
+	std::filesystem::path GetManifestPath() const { return outputDirectory / "shaders.manifest"; }
+	const ShaderDependencyGraph& GetDependencyGraph() const { return graph; }
+
+private:
+	std::filesystem::path outputDirectory;
+	ShaderDependencyGraph graph;
+};
@@ -33,6 +33,7 @@ struct VertexToPixel
     float3 worldPosition : POSITION;
     float3 tangent : TANGENT;
     float2 uv : TEXCOORD;
+    nointerpolation uint materialIndex : MATERIAL_INDEX; // Into AtlasMaterials, when instanced
 };
 
 #endif
\ No newline at end of file
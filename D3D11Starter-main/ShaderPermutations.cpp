@@ -0,0 +1,117 @@
+#include "ShaderPermutations.h"
+#include "CacheFiles.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+unsigned int GetFogFeature(int fogType)
+{
+	switch (fogType)
+	{
+	case 1: return SHADER_FEATURE_FOG_LINEAR;
+	case 2: return SHADER_FEATURE_FOG_EXPONENTIAL;
+	default: return 0;
+	}
+}
+
+// --------------------------------------------------------
+// Every define is always present (as 0 or 1), so the shader
+// never has to guess and the key covers the full set
+// --------------------------------------------------------
+std::vector<ShaderDefine> GetShaderFeatureDefines(unsigned int features)
+{
+	int fogMode = 0;
+	if (features & SHADER_FEATURE_FOG_LINEAR) fogMode = 1;
+	else if (features & SHADER_FEATURE_FOG_EXPONENTIAL) fogMode = 2;
+
+	std::vector<ShaderDefine> defines;
+	defines.push_back({ "FOG_MODE", std::to_string(fogMode) });
+	defines.push_back({ "USE_NORMAL_MAP", (features & SHADER_FEATURE_NORMAL_MAP) ? "1" : "0" });
+	defines.push_back({ "USE_SHADOWS", (features & SHADER_FEATURE_SHADOWS) ? "1" : "0" });
+	defines.push_back({ "USE_MATERIAL_ATLAS", (features & SHADER_FEATURE_MATERIAL_ATLAS) ? "1" : "0" });
+	defines.push_back({ "USE_IMAGE_LIGHTING", (features & SHADER_FEATURE_IMAGE_LIGHTING) ? "1" : "0" });
+	return defines;
+}
+
+// --------------------------------------------------------
+// All subsets of the given bits.  Fog bits are exclusive, so
+// masks with both fog modes set are left out.
+// --------------------------------------------------------
+std::vector<unsigned int> EnumerateShaderFeatureMasks(unsigned int bits)
+{
+	std::vector<unsigned int> masks;
+
+	// Standard trick for walking every subset of a bit mask
+	unsigned int subset = 0;
+	do
+	{
+		if ((subset & SHADER_FEATURE_FOG_MASK) != SHADER_FEATURE_FOG_MASK)
+			masks.push_back(subset);
+		subset = (subset - bits) & bits;
+	} while (subset != 0);
+
+	return masks;
+}
+
+bool ReadShaderSource(const std::filesystem::path& path, std::string& text)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	text = contents.str();
+	return true;
+}
+
+// --------------------------------------------------------
+// Angle bracket includes aren't used by our shaders
+// --------------------------------------------------------
+void FindShaderIncludeNames(const std::string& source, std::vector<std::string>& names)
+{
+	std::istringstream lines(source);
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line[start] != '#')
+			continue;
+
+		size_t directive = line.find_first_not_of(" \t", start + 1);
+		if (directive == std::string::npos || line.compare(directive, 7, "include") != 0)
+			continue;
+
+		size_t open = line.find('"', directive + 7);
+		size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+		if (close != std::string::npos)
+			names.push_back(line.substr(open + 1, close - open - 1));
+	}
+}
+
+ShaderPermutationCache::ShaderPermutationCache(const std::filesystem::path& directory) :
+	directory(directory)
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+}
+
+std::filesystem::path ShaderPermutationCache::GetPath(unsigned long long key) const
+{
+	return directory / (FormatHashKey(key) + ".cso");
+}
+
+bool ShaderPermutationCache::Contains(unsigned long long key) const
+{
+	std::error_code error;
+	return std::filesystem::exists(GetPath(key), error);
+}
+
+// --------------------------------------------------------
+// Writes through a temporary file and renames, so another
+// thread or process never sees a half-written entry
+// --------------------------------------------------------
+bool ShaderPermutationCache::Store(unsigned long long key, const void* bytecode, size_t size)
+{
+	return WriteFileAtomic(GetPath(key), bytecode, size);
+}
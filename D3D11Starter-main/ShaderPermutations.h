@@ -0,0 +1,62 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Feature bits that select a pixel shader permutation.  Each
+// maps to a define in PixelShader.hlsl, so a disabled feature
+// is compiled out instead of branched around.
+// --------------------------------------------------------
+enum ShaderFeature : unsigned int
+{
+	SHADER_FEATURE_FOG_LINEAR = 1 << 0,
+	SHADER_FEATURE_FOG_EXPONENTIAL = 1 << 1,
+	SHADER_FEATURE_NORMAL_MAP = 1 << 2,
+	SHADER_FEATURE_SHADOWS = 1 << 3,
+	SHADER_FEATURE_MATERIAL_ATLAS = 1 << 4, // Textures from MaterialAtlas arrays, picked per instance
+	SHADER_FEATURE_IMAGE_LIGHTING = 1 << 5, // Ambient from the sky's baked lighting instead of a constant
+};
+
+// Fog is a per-frame choice rather than a material one
+static const unsigned int SHADER_FEATURE_FOG_MASK = SHADER_FEATURE_FOG_LINEAR | SHADER_FEATURE_FOG_EXPONENTIAL;
+
+// Matches the fogType values used by the UI (0 none, 1 linear, 2 exponential)
+unsigned int GetFogFeature(int fogType);
+
+struct ShaderDefine
+{
+	std::string Name;
+	std::string Value;
+};
+
+// The defines for a feature mask, in a fixed order
+std::vector<ShaderDefine> GetShaderFeatureDefines(unsigned int features);
+
+// Every feature mask made from the given bits, including zero
+std::vector<unsigned int> EnumerateShaderFeatureMasks(unsigned int bits);
+
+// Reads a whole shader source file as text
+bool ReadShaderSource(const std::filesystem::path& path, std::string& text);
+
+// The quoted file names from a source's #include lines, in order
+void FindShaderIncludeNames(const std::string& source, std::vector<std::string>& names);
+
+// --------------------------------------------------------
+// Folder of compiled permutations named by their key, so
+// identical inputs are only ever compiled once
+// --------------------------------------------------------
+class ShaderPermutationCache
+{
+public:
+	ShaderPermutationCache(const std::filesystem::path& directory);
+
+	std::filesystem::path GetPath(unsigned long long key) const;
+	bool Contains(unsigned long long key) const;
+	bool Store(unsigned long long key, const void* bytecode, size_t size);
+
+	const std::filesystem::path& GetDirectory() const { return directory; }
+
+private:
+	std::filesystem::path directory;
+};
@@ -0,0 +1,244 @@
+#include "ShaderReflectionData.h"
+#include "CacheFiles.h"
+#include "MappedFile.h"
+
+// "SREF" in little-endian, bumped version whenever the layout changes
+static const unsigned int ReflectionMagic = 0x46455253;
+static const unsigned int ReflectionVersion = 1;
+
+// --------------------------------------------------------
+// The general byte hash, named for what the reflection
+// cache keys on
+// --------------------------------------------------------
+unsigned long long HashShaderBytecode(const void* bytecode, size_t size)
+{
+	return HashBytes(bytecode, size);
+}
+
+// --------------------------------------------------------
+// Little-endian writer and bounds-checked reader, so the
+// format is the same whatever machine wrote it
+// --------------------------------------------------------
+namespace
+{
+	void WriteU32(std::vector<unsigned char>& bytes, unsigned int value)
+	{
+		for (int i = 0; i < 4; i++)
+			bytes.push_back((unsigned char)(value >> (i * 8)));
+	}
+
+	void WriteU64(std::vector<unsigned char>& bytes, unsigned long long value)
+	{
+		WriteU32(bytes, (unsigned int)value);
+		WriteU32(bytes, (unsigned int)(value >> 32));
+	}
+
+	void WriteString(std::vector<unsigned char>& bytes, const std::string& str)
+	{
+		WriteU32(bytes, (unsigned int)str.size());
+		bytes.insert(bytes.end(), str.begin(), str.end());
+	}
+
+	struct Reader
+	{
+		const unsigned char* Bytes;
+		size_t Size;
+		size_t Position = 0;
+		bool Failed = false;
+
+		unsigned int U32()
+		{
+			if (Size - Position < 4) { Failed = true; return 0; }
+			unsigned int value = 0;
+			for (int i = 0; i < 4; i++)
+				value |= (unsigned int)Bytes[Position + i] << (i * 8);
+			Position += 4;
+			return value;
+		}
+
+		unsigned long long U64()
+		{
+			unsigned long long low = U32();
+			unsigned long long high = U32();
+			return low | (high << 32);
+		}
+
+		std::string String()
+		{
+			unsigned int length = U32();
+			if (Failed || Size - Position < length) { Failed = true; return std::string(); }
+			std::string str((const char*)Bytes + Position, length);
+			Position += length;
+			return str;
+		}
+
+		// Guards against a corrupt count asking for a huge allocation
+		unsigned int Count(size_t minBytesPerItem)
+		{
+			unsigned int count = U32();
+			if (Failed || count > (Size - Position) / minBytesPerItem) { Failed = true; return 0; }
+			return count;
+		}
+	};
+}
+
+// --------------------------------------------------------
+// Writes reflection data in the sidecar format:
+//
+//   magic, version, bytecode hash
+//   thread group size (3 x u32)
+//   constant buffers: count, then name/type/bind/size and variables
+//   resources: count, then name/kind/bind
+//   input parameters: count, then semantic/index/mask/component
+//
+// Strings are a u32 length followed by the characters.
+// --------------------------------------------------------
+void SerializeShaderReflection(const ShaderReflectionData& data, std::vector<unsigned char>& bytes)
+{
+	bytes.clear();
+	WriteU32(bytes, ReflectionMagic);
+	WriteU32(bytes, ReflectionVersion);
+	WriteU64(bytes, data.BytecodeHash);
+
+	for (int i = 0; i < 3; i++)
+		WriteU32(bytes, data.ThreadGroupSize[i]);
+
+	WriteU32(bytes, (unsigned int)data.ConstantBuffers.size());
+	for (const ShaderReflectionBuffer& cb : data.ConstantBuffers)
+	{
+		WriteString(bytes, cb.Name);
+		WriteU32(bytes, cb.Type);
+		WriteU32(bytes, cb.BindIndex);
+		WriteU32(bytes, cb.Size);
+		WriteU32(bytes, (unsigned int)cb.Variables.size());
+		for (const ShaderReflectionVariable& var : cb.Variables)
+		{
+			WriteString(bytes, var.Name);
+			WriteU32(bytes, var.ByteOffset);
+			WriteU32(bytes, var.Size);
+		}
+	}
+
+	WriteU32(bytes, (unsigned int)data.Resources.size());
+	for (const ShaderReflectionResource& res : data.Resources)
+	{
+		WriteString(bytes, res.Name);
+		WriteU32(bytes, res.Kind);
+		WriteU32(bytes, res.BindIndex);
+	}
+
+	WriteU32(bytes, (unsigned int)data.InputParameters.size());
+	for (const ShaderReflectionInput& input : data.InputParameters)
+	{
+		WriteString(bytes, input.SemanticName);
+		WriteU32(bytes, input.SemanticIndex);
+		WriteU32(bytes, input.Mask);
+		WriteU32(bytes, input.ComponentType);
+	}
+}
+
+// --------------------------------------------------------
+// Parses the sidecar format
+//
+// expectedHash - Hash of the .cso this data should describe
+//
+// Returns false if the data is malformed, from another
+// version, or was made from different bytecode
+// --------------------------------------------------------
+bool DeserializeShaderReflection(const unsigned char* bytes, size_t size, unsigned long long expectedHash, ShaderReflectionData& data)
+{
+	Reader reader = { bytes, size };
+	if (reader.U32() != ReflectionMagic || reader.U32() != ReflectionVersion)
+		return false;
+
+	ShaderReflectionData result;
+	result.BytecodeHash = reader.U64();
+	if (reader.Failed || result.BytecodeHash != expectedHash)
+		return false;
+
+	for (int i = 0; i < 3; i++)
+		result.ThreadGroupSize[i] = reader.U32();
+
+	result.ConstantBuffers.resize(reader.Count(20));
+	for (ShaderReflectionBuffer& cb : result.ConstantBuffers)
+	{
+		cb.Name = reader.String();
+		cb.Type = reader.U32();
+		cb.BindIndex = reader.U32();
+		cb.Size = reader.U32();
+		cb.Variables.resize(reader.Count(12));
+		for (ShaderReflectionVariable& var : cb.Variables)
+		{
+			var.Name = reader.String();
+			var.ByteOffset = reader.U32();
+			var.Size = reader.U32();
+
+			// A variable outside its buffer would write out of bounds later
+			if (var.ByteOffset > cb.Size || var.Size > cb.Size - var.ByteOffset)
+				return false;
+		}
+	}
+
+	result.Resources.resize(reader.Count(12));
+	for (ShaderReflectionResource& res : result.Resources)
+	{
+		res.Name = reader.String();
+		res.Kind = reader.U32();
+		res.BindIndex = reader.U32();
+	}
+
+	result.InputParameters.resize(reader.Count(16));
+	for (ShaderReflectionInput& input : result.InputParameters)
+	{
+		input.SemanticName = reader.String();
+		input.SemanticIndex = reader.U32();
+		input.Mask = reader.U32();
+		input.ComponentType = reader.U32();
+	}
+
+	if (reader.Failed || reader.Position != size)
+		return false;
+
+	data = std::move(result);
+	return true;
+}
+
+// --------------------------------------------------------
+// "Shader.cso" -> "Shader.refl" in the same folder
+// --------------------------------------------------------
+std::filesystem::path GetShaderReflectionPath(const std::filesystem::path& shaderFile)
+{
+	std::filesystem::path path = shaderFile;
+	path.replace_extension(".refl");
+	return path;
+}
+
+bool LoadShaderReflection(const std::filesystem::path& path, unsigned long long expectedHash, ShaderReflectionData& data)
+{
+	MappedFile file;
+	if (!file.Open(path))
+		return false;
+
+	return DeserializeShaderReflection(file.GetData(), file.GetSize(), expectedHash, data);
+}
+
+// --------------------------------------------------------
+// Writes a sidecar file.  Goes through a temporary file so
+// a crash mid-write can't leave a truncated cache behind.
+// --------------------------------------------------------
+bool SaveShaderReflection(const std::filesystem::path& path, const ShaderReflectionData& data)
+{
+	std::vector<unsigned char> bytes;
+	SerializeShaderReflection(data, bytes);
+	return WriteFileAtomic(path, bytes.data(), bytes.size());
+}
+
+void BuildShaderVariableTable(const ShaderReflectionData& data, ShaderVariableTable& table)
+{
+	table.Clear();
+	for (unsigned int b = 0; b < data.ConstantBuffers.size(); b++)
+	{
+		for (const ShaderReflectionVariable& var : data.ConstantBuffers[b].Variables)
+			table.Add(var.Name, b, var.ByteOffset, var.Size);
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "ShaderVariableTable.h"
+
+// --------------------------------------------------------
+// Everything SimpleShader needs from shader reflection,
+// in plain types with no Direct3D dependency.  This is what
+// gets cached in a ".refl" sidecar next to each .cso so
+// later launches can skip D3DReflect entirely.
+//
+// Enum-valued fields (buffer type, component type) hold the
+// raw D3D values, which are stable across SDK versions.
+// --------------------------------------------------------
+enum ShaderResourceKind
+{
+	SHADER_RESOURCE_TEXTURE = 0, // Textures and structured buffers
+	SHADER_RESOURCE_SAMPLER = 1,
+	SHADER_RESOURCE_UAV = 2
+};
+
+struct ShaderReflectionVariable
+{
+	std::string Name;
+	unsigned int ByteOffset = 0;
+	unsigned int Size = 0;
+};
+
+struct ShaderReflectionBuffer
+{
+	std::string Name;
+	unsigned int Type = 0; // D3D_CBUFFER_TYPE
+	unsigned int BindIndex = 0;
+	unsigned int Size = 0;
+	std::vector<ShaderReflectionVariable> Variables;
+};
+
+struct ShaderReflectionResource
+{
+	std::string Name;
+	unsigned int Kind = SHADER_RESOURCE_TEXTURE;
+	unsigned int BindIndex = 0;
+};
+
+struct ShaderReflectionInput
+{
+	std::string SemanticName;
+	unsigned int SemanticIndex = 0;
+	unsigned int Mask = 0;
+	unsigned int ComponentType = 0; // D3D_REGISTER_COMPONENT_TYPE
+};
+
+struct ShaderReflectionData
+{
+	unsigned long long BytecodeHash = 0;
+	std::vector<ShaderReflectionBuffer> ConstantBuffers;
+	std::vector<ShaderReflectionResource> Resources; // In binding order
+	std::vector<ShaderReflectionInput> InputParameters;
+	unsigned int ThreadGroupSize[3] = {};
+};
+
+// HashBytes of compiled shader code, used as the cache key
+unsigned long long HashShaderBytecode(const void* bytecode, size_t size);
+
+// Binary format
+void SerializeShaderReflection(const ShaderReflectionData& data, std::vector<unsigned char>& bytes);
+bool DeserializeShaderReflection(const unsigned char* bytes, size_t size, unsigned long long expectedHash, ShaderReflectionData& data);
+
+// Sidecar files - loading maps the file and parses it in place
+std::filesystem::path GetShaderReflectionPath(const std::filesystem::path& shaderFile);
+bool LoadShaderReflection(const std::filesystem::path& path, unsigned long long expectedHash, ShaderReflectionData& data);
+bool SaveShaderReflection(const std::filesystem::path& path, const ShaderReflectionData& data);
+
+// Fills a handle table from reflection data
+void BuildShaderVariableTable(const ShaderReflectionData& data, ShaderVariableTable& table);
@@ -0,0 +1,143 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include "CBufferLayout.h"
+
+// --------------------------------------------------------
+// C++ mirrors of the cbuffers in the .hlsl files.  Each one
+// is checked against HLSL packing at compile time and against
+// the shader's reflection when the shader loads, so a change
+// on either side shows up as an error instead of bad data.
+// --------------------------------------------------------
+
+// VertexShader.hlsl
+struct PerFrameVSData
+{
+	DirectX::XMFLOAT4X4 viewMat;
+	DirectX::XMFLOAT4X4 projMat;
+	DirectX::XMFLOAT4X4 lightView;
+	DirectX::XMFLOAT4X4 lightProj;
+};
+CBUFFER_LAYOUT(PerFrameVSData, "PerFrame",
+	CBUFFER_FIELD(PerFrameVSData, viewMat),
+	CBUFFER_FIELD(PerFrameVSData, projMat),
+	CBUFFER_FIELD(PerFrameVSData, lightView),
+	CBUFFER_FIELD(PerFrameVSData, lightProj));
+
+struct PerObjectVSData
+{
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInvTranspose;
+};
+CBUFFER_LAYOUT(PerObjectVSData, "PerObject",
+	CBUFFER_FIELD(PerObjectVSData, world),
+	CBUFFER_FIELD(PerObjectVSData, worldInvTranspose));
+
+// PixelShader.hlsl
+struct PerFramePSData
+{
+	DirectX::XMFLOAT3 cameraPosition;
+	int lightCount;
+	DirectX::XMFLOAT3 ambient;
+	int fogType;
+	DirectX::XMFLOAT3 fogColor;
+	float fogStart;
+	float fogEnd;
+	float fogDensity;
+	float specularMipCount;
+	float imageLightIntensity;
+	DirectX::XMFLOAT4 irradianceSH[9]; // RGB, from ImageLighting
+};
+CBUFFER_LAYOUT(PerFramePSData, "PerFrame",
+	CBUFFER_FIELD(PerFramePSData, cameraPosition),
+	CBUFFER_FIELD(PerFramePSData, lightCount),
+	CBUFFER_FIELD(PerFramePSData, ambient),
+	CBUFFER_FIELD(PerFramePSData, fogType),
+	CBUFFER_FIELD(PerFramePSData, fogColor),
+	CBUFFER_FIELD(PerFramePSData, fogStart),
+	CBUFFER_FIELD(PerFramePSData, fogEnd),
+	CBUFFER_FIELD(PerFramePSData, fogDensity),
+	CBUFFER_FIELD(PerFramePSData, specularMipCount),
+	CBUFFER_FIELD(PerFramePSData, imageLightIntensity),
+	CBUFFER_FIELD(PerFramePSData, irradianceSH));
+
+// PixelShader.hlsl - the debug pixel shaders declare just colorTint
+struct PerMaterialPSData
+{
+	DirectX::XMFLOAT4 colorTint;
+	DirectX::XMFLOAT2 uvScale;
+	float roughness;
+	int specMap;
+};
+CBUFFER_LAYOUT(PerMaterialPSData, "PerMaterial",
+	CBUFFER_FIELD(PerMaterialPSData, colorTint),
+	CBUFFER_FIELD(PerMaterialPSData, uvScale),
+	CBUFFER_FIELD(PerMaterialPSData, roughness),
+	CBUFFER_FIELD(PerMaterialPSData, specMap));
+
+// ShadowMapVertexShader.hlsl
+struct ShadowPerFrameVSData
+{
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+};
+CBUFFER_LAYOUT(ShadowPerFrameVSData, "PerFrame",
+	CBUFFER_FIELD(ShadowPerFrameVSData, view),
+	CBUFFER_FIELD(ShadowPerFrameVSData, projection));
+
+struct ShadowPerObjectVSData
+{
+	DirectX::XMFLOAT4X4 world;
+};
+CBUFFER_LAYOUT(ShadowPerObjectVSData, "PerObject",
+	CBUFFER_FIELD(ShadowPerObjectVSData, world));
+
+// SkyVertexShader.hlsl
+struct SkyVSData
+{
+	DirectX::XMFLOAT4X4 viewMat;
+	DirectX::XMFLOAT4X4 projMat;
+};
+CBUFFER_LAYOUT(SkyVSData, "DataFromCPU",
+	CBUFFER_FIELD(SkyVSData, viewMat),
+	CBUFFER_FIELD(SkyVSData, projMat));
+
+// PostPS.hlsl
+struct PostPSData
+{
+	float pixelWidth;
+	float pixelHeight;
+	int blurDistance;
+	float padding;
+};
+CBUFFER_LAYOUT(PostPSData, "Data",
+	CBUFFER_FIELD(PostPSData, pixelWidth),
+	CBUFFER_FIELD(PostPSData, pixelHeight),
+	CBUFFER_FIELD(PostPSData, blurDistance));
+
+// --------------------------------------------------------
+// Per-instance vertex data for InstancedVertexShader.hlsl
+// and InstancedShadowVertexShader.hlsl (vertex buffer slot 1,
+// the *_PER_INSTANCE semantics).  Matrices are laid out the
+// same way as in the cbuffers.
+// --------------------------------------------------------
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInvTranspose;
+	unsigned int materialIndex; // Into AtlasMaterials for atlas draws, else the draw list id
+};
+static_assert(sizeof(InstanceData) == 132, "InstanceData must match the per-instance input layout");
+
+// --------------------------------------------------------
+// One entry of PixelShader.hlsl's AtlasMaterials buffer: a
+// material's PerMaterial values plus its MaterialAtlas slice
+// --------------------------------------------------------
+struct AtlasMaterialData
+{
+	DirectX::XMFLOAT4 colorTint;
+	DirectX::XMFLOAT2 uvScale;
+	float roughness;
+	unsigned int slice;
+};
+static_assert(sizeof(AtlasMaterialData) == 32, "AtlasMaterialData must match the HLSL StructuredBuffer stride");
@@ -0,0 +1,201 @@
+#include "ShaderVariableTable.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+
+// --------------------------------------------------------
+// Adds a variable to the table, keeping it sorted by hash
+// --------------------------------------------------------
+void ShaderVariableTable::Add(const std::string& name, unsigned int cbIndex, unsigned int byteOffset, unsigned int size)
+{
+	Entry entry = {};
+	entry.Hash = ShaderNameHash(name.c_str());
+	entry.Ambiguous = false;
+	entry.Name = name;
+	entry.Handle.ConstantBufferIndex = cbIndex;
+	entry.Handle.ByteOffset = byteOffset;
+	entry.Handle.Size = size;
+
+	auto pos = std::lower_bound(entries.begin(), entries.end(), entry.Hash,
+		[](const Entry& e, unsigned int hash) { return e.Hash < hash; });
+
+	// Same hash already present - either a duplicate name (first one
+	// wins, matching the string table) or a genuine collision.  The
+	// whole run of equal hashes is checked, since earlier collisions
+	// may have put several names there.
+	auto end = pos;
+	for (; end != entries.end() && end->Hash == entry.Hash; ++end)
+	{
+		if (end->Name == name)
+			return;
+	}
+
+	if (end != pos)
+	{
+		for (auto e = pos; e != end; ++e)
+			e->Ambiguous = true;
+		entry.Ambiguous = true;
+		collisions = true;
+	}
+
+	entries.insert(end, entry);
+}
+
+void ShaderVariableTable::Clear()
+{
+	entries.clear();
+	collisions = false;
+}
+
+// --------------------------------------------------------
+// Finds a variable by name.  Compares the full name, so this
+// still works for names involved in a hash collision.
+// --------------------------------------------------------
+ShaderVarHandle ShaderVariableTable::Find(const std::string& name) const
+{
+	unsigned int hash = ShaderNameHash(name.c_str());
+	auto pos = std::lower_bound(entries.begin(), entries.end(), hash,
+		[](const Entry& e, unsigned int h) { return e.Hash < h; });
+
+	for (; pos != entries.end() && pos->Hash == hash; ++pos)
+	{
+		if (pos->Name == name)
+			return pos->Handle;
+	}
+
+	return {};
+}
+
+// --------------------------------------------------------
+// Finds a variable by pre-computed name hash
+// --------------------------------------------------------
+ShaderVarHandle ShaderVariableTable::Find(unsigned int nameHash) const
+{
+	const Entry* entry = FindEntry(nameHash);
+	if (!entry || entry->Ambiguous)
+		return {};
+
+	return entry->Handle;
+}
+
+const ShaderVariableTable::Entry* ShaderVariableTable::FindEntry(unsigned int nameHash) const
+{
+	// Small tables are faster to scan than to search
+	if (entries.size() <= 8)
+	{
+		for (const Entry& e : entries)
+			if (e.Hash == nameHash)
+				return &e;
+		return 0;
+	}
+
+	auto pos = std::lower_bound(entries.begin(), entries.end(), nameHash,
+		[](const Entry& e, unsigned int h) { return e.Hash < h; });
+
+	if (pos == entries.end() || pos->Hash != nameHash)
+		return 0;
+
+	return &*pos;
+}
+
+
+// --------------------------------------------------------
+// Benchmark: sets "world" and "worldInvTranspose" in a copy
+// of the PerObject layout, the way Game::Draw does for every
+// entity, using each of the three lookup styles
+// --------------------------------------------------------
+namespace
+{
+	struct BenchVariable { unsigned int CB, Offset, Size; };
+
+	// Takes the name by value on purpose, like the old API
+	bool SetByString(std::unordered_map<std::string, BenchVariable>& table, unsigned char* buffer, std::string name, const void* data, unsigned int size)
+	{
+		auto result = table.find(name);
+		if (result == table.end() || size > result->second.Size)
+			return false;
+
+		memcpy(buffer + result->second.Offset, data, size);
+		return true;
+	}
+
+	bool SetByHandle(unsigned char* buffer, const ShaderVarHandle& handle, const void* data, unsigned int size)
+	{
+		if (!handle.IsValid() || size > handle.Size)
+			return false;
+
+		memcpy(buffer + handle.ByteOffset, data, size);
+		return true;
+	}
+
+	double NsPerSet(std::chrono::high_resolution_clock::time_point start, unsigned int sets)
+	{
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return sets > 0 ? elapsed.count() / sets : 0.0;
+	}
+}
+
+ShaderVariableBenchmarkResults ShaderVariableBenchmark(unsigned int iterations)
+{
+	// Same names and offsets as VertexShader.hlsl, plus the
+	// per-frame variables so the tables aren't trivially small
+	const char* names[] = { "viewMat", "projMat", "lightView", "lightProj", "world", "worldInvTranspose" };
+	const unsigned int cbs[] = { 0, 0, 0, 0, 1, 1 };
+	const unsigned int offsets[] = { 0, 64, 128, 192, 0, 64 };
+
+	std::unordered_map<std::string, BenchVariable> stringTable;
+	ShaderVariableTable hashTable;
+	for (int i = 0; i < 6; i++)
+	{
+		stringTable.insert({ names[i], { cbs[i], offsets[i], 64 } });
+		hashTable.Add(names[i], cbs[i], offsets[i], 64);
+	}
+
+	unsigned char buffer[128] = {};
+	float matrix[16] = {};
+	unsigned int failures = 0;
+
+	ShaderVariableBenchmarkResults results;
+	results.Iterations = iterations;
+
+	// Old API: two string constructions and map lookups per object
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		matrix[0] = (float)i;
+		failures += !SetByString(stringTable, buffer, "world", matrix, sizeof(matrix));
+		failures += !SetByString(stringTable, buffer, "worldInvTranspose", matrix, sizeof(matrix));
+	}
+	results.StringLookupNs = NsPerSet(start, iterations * 2);
+
+	// Hashes are folded at compile time, only the search remains
+	constexpr unsigned int worldHash = ShaderNameHash("world");
+	constexpr unsigned int worldInvTransposeHash = ShaderNameHash("worldInvTranspose");
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		matrix[0] = (float)i;
+		failures += !SetByHandle(buffer, hashTable.Find(worldHash), matrix, sizeof(matrix));
+		failures += !SetByHandle(buffer, hashTable.Find(worldInvTransposeHash), matrix, sizeof(matrix));
+	}
+	results.HashLookupNs = NsPerSet(start, iterations * 2);
+
+	// Resolved once up front
+	ShaderVarHandle world = hashTable.Find("world");
+	ShaderVarHandle worldInvTranspose = hashTable.Find("worldInvTranspose");
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		matrix[0] = (float)i;
+		failures += !SetByHandle(buffer, world, matrix, sizeof(matrix));
+		failures += !SetByHandle(buffer, worldInvTranspose, matrix, sizeof(matrix));
+	}
+	results.HandleNs = NsPerSet(start, iterations * 2);
+
+	// Keep the work observable so none of the loops get optimized away
+	if (failures > 0 || buffer[0] == 0xFF)
+		results.Iterations = 0;
+
+	return results;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// FNV-1a hash of a shader variable name.  constexpr so hot
+// code can hash a literal at compile time:
+//
+//   constexpr unsigned int worldHash = ShaderNameHash("world");
+// --------------------------------------------------------
+constexpr unsigned int ShaderNameHash(const char* name)
+{
+	unsigned int hash = 2166136261u;
+	while (*name)
+	{
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------
+// A pre-resolved shader variable: which constant buffer it
+// lives in and where.  Setting data through a handle is a
+// straight memcpy with no name lookup.
+//
+// Handles belong to the shader that produced them - the
+// same name can sit at a different offset in another shader.
+// --------------------------------------------------------
+struct ShaderVarHandle
+{
+	unsigned int ConstantBufferIndex = 0;
+	unsigned int ByteOffset = 0;
+	unsigned int Size = 0; // Zero means "not found"
+
+	bool IsValid() const { return Size > 0; }
+};
+
+// --------------------------------------------------------
+// Name -> handle table for one shader's constant buffer
+// variables, kept as a sorted array of name hashes so a
+// lookup is a binary search over integers.
+//
+// Has no Direct3D dependency, so it can be built and timed
+// without a device (see ShaderVariableBenchmark below).
+// --------------------------------------------------------
+class ShaderVariableTable
+{
+public:
+	void Add(const std::string& name, unsigned int cbIndex, unsigned int byteOffset, unsigned int size);
+	void Clear();
+
+	ShaderVarHandle Find(const std::string& name) const;
+	ShaderVarHandle Find(unsigned int nameHash) const;
+
+	size_t GetCount() const { return entries.size(); }
+
+	// True if two different names hashed to the same value.  Hash
+	// lookups of those names are refused rather than guessed.
+	bool HasCollisions() const { return collisions; }
+
+private:
+	struct Entry
+	{
+		unsigned int Hash;
+		bool Ambiguous;
+		std::string Name;
+		ShaderVarHandle Handle;
+	};
+
+	std::vector<Entry> entries; // Sorted by hash
+	bool collisions = false;
+
+	const Entry* FindEntry(unsigned int nameHash) const;
+};
+
+// --------------------------------------------------------
+// Results of timing the three ways of setting a variable,
+// in nanoseconds per set
+// --------------------------------------------------------
+struct ShaderVariableBenchmarkResults
+{
+	unsigned int Iterations = 0;
+	double StringLookupNs = 0; // std::string by value + unordered_map, the old API
+	double HashLookupNs = 0;   // Compile-time hash + table search
+	double HandleNs = 0;       // Pre-resolved handle, memcpy only
+};
+
+// Times setting a typical per-object cbuffer's variables each way
+ShaderVariableBenchmarkResults ShaderVariableBenchmark(unsigned int iterations);
@@ -1,12 +1,18 @@
 #include "ShaderIncludes.hlsli"
 
-cbuffer externalData : register(b0)
+// Set once per frame
+cbuffer PerFrame : register(b0)
 {
-    matrix world;
     matrix view;
     matrix projection;
 }
 
+// Set for every draw
+cbuffer PerObject : register(b1)
+{
+    matrix world;
+}
+
 // Struct representing a single vertex worth of data
 // - This should match the vertex definition in our C++ code
 // - By "match", I mean the size, order and number of members
@@ -4,6 +4,18 @@
 bool ISimpleShader::ReportErrors = false;
 bool ISimpleShader::ReportWarnings = false;
 
+// Constant buffer upload totals, reset by the caller (usually once per frame)
+SimpleShaderUploadStats ISimpleShader::UploadStats = {};
+
+// No constant buffer ring by default
+std::shared_ptr<ConstantBufferRing> ISimpleShader::ConstantRing;
+std::shared_ptr<StateCache> ISimpleShader::States;
+
+// Reflection sidecar files are read and written by default
+bool ISimpleShader::UseReflectionCache = true;
+std::atomic<unsigned int> ISimpleShader::ReflectionCacheHits = 0;
+std::atomic<unsigned int> ISimpleShader::ReflectionCacheMisses = 0;
+
 // To enable error reporting, use either or both 
 // of the following lines somewhere in your program, 
 // preferably before loading/using any shaders.
@@ -25,6 +37,16 @@ ISimpleShader::ISimpleShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Micros
 	this->device = device;
 	this->deviceContext = context;
 
+	// The 11.1 context is only needed to bind ring buffers by offset
+	context.As(&this->deviceContext1);
+
+	// Partial constant buffer updates are optional in 11.1
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	this->partialUpdates =
+		this->deviceContext1 &&
+		SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+		options.ConstantBufferPartialUpdate;
+
 	// Set up fields
 	this->constantBufferCount = 0;
 	this->constantBuffers = 0;
@@ -65,6 +87,7 @@ void ISimpleShader::CleanUp()
 
 	// Clean up tables
 	varTable.clear();
+	varHandleTable.Clear();
 	cbTable.clear();
 	samplerTable.clear();
 	textureTable.clear();
@@ -94,6 +117,44 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Get the reflection data, either from the sidecar cache (if it
+	// was made from this exact bytecode) or from D3DReflect
+	unsigned long long bytecodeHash = HashShaderBytecode(
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize());
+	std::filesystem::path reflectionPath = GetShaderReflectionPath(shaderFile);
+
+	if (UseReflectionCache && LoadShaderReflection(reflectionPath, bytecodeHash, reflection))
+	{
+		ReflectionCacheHits++;
+	}
+	else
+	{
+		ReflectionCacheMisses++;
+		if (!ReflectShader(shaderBlob, reflection))
+		{
+			// Never cache a failed reflection - it would be read back
+			// as a shader with no constant buffers or resources
+			if (ReportErrors)
+			{
+				LogError("SimpleShader::LoadShaderFile() - Unable to reflect shader '");
+				LogW(shaderFile);
+				LogError("'.\n");
+			}
+
+			return false;
+		}
+		reflection.BytecodeHash = bytecodeHash;
+
+		// Failing to write the cache isn't an error, just slower next time
+		if (UseReflectionCache && !SaveShaderReflection(reflectionPath, reflection) && ReportWarnings)
+		{
+			LogWarning("SimpleShader::LoadShaderFile() - Unable to write reflection cache '");
+			LogW(reflectionPath.wstring());
+			LogWarning("'.\n");
+		}
+	}
+
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
 	shaderValid = CreateShader(shaderBlob);
@@ -109,55 +170,36 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
-	// Set up shader reflection to get information about
-	// this shader and its variables,  buffers, etc.
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-	
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
+	constantBufferCount = (unsigned int)reflection.ConstantBuffers.size();
 	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
 	
 	// Handle bound resources (like shaders and samplers)
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (const ShaderReflectionResource& resource : reflection.Resources)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
-
 		// Check the type
-		switch (resourceDesc.Type)
+		switch (resource.Kind)
 		{
-		case D3D_SIT_STRUCTURED: // Treat structured buffers as texture resources
-		case D3D_SIT_TEXTURE: // A texture resource
+		case SHADER_RESOURCE_TEXTURE: // A texture or structured buffer
 		{
 			// Create the SRV wrapper
 			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
+			srv->BindIndex = resource.BindIndex;					// Shader bind point
 			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
 
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
+			textureTable.insert(std::pair<std::string, SimpleSRV*>(resource.Name, srv));
 			shaderResourceViews.push_back(srv);
 		}
 			break;
 
-		case D3D_SIT_SAMPLER: // A sampler resource
+		case SHADER_RESOURCE_SAMPLER: // A sampler resource
 		{
 			// Create the sampler wrapper
 			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
+			samp->BindIndex = resource.BindIndex;				// Shader bind point
 			samp->Index = (unsigned int)samplerStates.size();	// Raw index
 
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
+			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resource.Name, samp));
 			samplerStates.push_back(samp);
 		}
 			break;
@@ -167,24 +209,11 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	// Loop through all constant buffers
 	for (unsigned int b = 0; b < constantBufferCount; b++)
 	{
-		// Get this buffer
-		ID3D11ShaderReflectionConstantBuffer* cb =
-			refl->GetConstantBufferByIndex(b);
-		
-		// Get the description of this buffer
-		D3D11_SHADER_BUFFER_DESC bufferDesc;
-		cb->GetDesc(&bufferDesc);
+		const ShaderReflectionBuffer& bufferDesc = reflection.ConstantBuffers[b];
 
-		// Save the type, which we reference when setting these buffers
-		constantBuffers[b].Type = bufferDesc.Type;
-		
-		// Get the description of the resource binding, so
-		// we know exactly how it's bound in the shader
-		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
-		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
-		
 		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
+		constantBuffers[b].Type = (D3D_CBUFFER_TYPE)bufferDesc.Type;
+		constantBuffers[b].BindIndex = bufferDesc.BindIndex;
 		constantBuffers[b].Name = bufferDesc.Name;
 		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
 
@@ -203,36 +232,151 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
 		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
 
+		// Nothing is on the GPU yet, so the whole buffer starts dirty
+		constantBuffers[b].DirtyBegin = 0;
+		constantBuffers[b].DirtyEnd = bufferDesc.Size;
+
 		// Loop through all variables in this buffer
-		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		for (const ShaderReflectionVariable& var : bufferDesc.Variables)
 		{
-			// Get this variable
-			ID3D11ShaderReflectionVariable* var =
-				cb->GetVariableByIndex(v);
-			
-			// Get the description of the variable and its type
-			D3D11_SHADER_VARIABLE_DESC varDesc;
-			var->GetDesc(&varDesc);
-
 			// Create the variable struct
 			SimpleShaderVariable varStruct = {};
 			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
-			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
+			varStruct.ByteOffset = var.ByteOffset;
+			varStruct.Size = var.Size;
 
 			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
+			varTable.insert(std::pair<std::string, SimpleShaderVariable>(var.Name, varStruct));
 			constantBuffers[b].Variables.push_back(varStruct);
 		}
 	}
 
+	// Handle table for the fast Set overloads
+	BuildShaderVariableTable(reflection, varHandleTable);
+
 	// All set
 	return true;
 }
 
+// --------------------------------------------------------
+// Runs D3DReflect on compiled shader code and copies out
+// everything SimpleShader uses into plain data that can be
+// cached on disk
+//
+// shaderBlob - The shader's compiled code
+// data       - Filled out with the reflection results
+//
+// Returns false (leaving data empty) if D3DReflect fails
+// --------------------------------------------------------
+bool ISimpleShader::ReflectShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, ShaderReflectionData& data)
+{
+	data = {};
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
+	HRESULT hr = D3DReflect(
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize(),
+		IID_ID3D11ShaderReflection,
+		(void**)refl.GetAddressOf());
+	if (FAILED(hr))
+		return false;
+
+	// Get the description of the shader
+	D3D11_SHADER_DESC shaderDesc;
+	refl->GetDesc(&shaderDesc);
+
+	// Bound resources, in the order reflection lists them
+	for (unsigned int r = 0; r < shaderDesc.BoundResources; r++)
+	{
+		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
+		refl->GetResourceBindingDesc(r, &resourceDesc);
+
+		ShaderReflectionResource resource;
+		resource.Name = resourceDesc.Name;
+		resource.BindIndex = resourceDesc.BindPoint;
+
+		switch (resourceDesc.Type)
+		{
+		case D3D_SIT_STRUCTURED: // Treat structured buffers as texture resources
+		case D3D_SIT_TEXTURE:
+			resource.Kind = SHADER_RESOURCE_TEXTURE;
+			break;
+
+		case D3D_SIT_SAMPLER:
+			resource.Kind = SHADER_RESOURCE_SAMPLER;
+			break;
+
+		case D3D_SIT_UAV_APPEND_STRUCTURED:
+		case D3D_SIT_UAV_CONSUME_STRUCTURED:
+		case D3D_SIT_UAV_RWBYTEADDRESS:
+		case D3D_SIT_UAV_RWSTRUCTURED:
+		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+		case D3D_SIT_UAV_RWTYPED:
+			resource.Kind = SHADER_RESOURCE_UAV;
+			break;
+
+		default: // Constant buffers are handled below
+			continue;
+		}
+
+		data.Resources.push_back(resource);
+	}
+
+	// Constant buffers and their variables
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
+	{
+		ID3D11ShaderReflectionConstantBuffer* cb = refl->GetConstantBufferByIndex(b);
+		D3D11_SHADER_BUFFER_DESC bufferDesc;
+		cb->GetDesc(&bufferDesc);
+
+		// Get the description of the resource binding, so
+		// we know exactly how it's bound in the shader
+		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+
+		ShaderReflectionBuffer buffer;
+		buffer.Name = bufferDesc.Name;
+		buffer.Type = bufferDesc.Type;
+		buffer.BindIndex = bindDesc.BindPoint;
+		buffer.Size = bufferDesc.Size;
+
+		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		{
+			D3D11_SHADER_VARIABLE_DESC varDesc;
+			cb->GetVariableByIndex(v)->GetDesc(&varDesc);
+
+			ShaderReflectionVariable var;
+			var.Name = varDesc.Name;
+			var.ByteOffset = varDesc.StartOffset;
+			var.Size = varDesc.Size;
+			buffer.Variables.push_back(var);
+		}
+
+		data.ConstantBuffers.push_back(buffer);
+	}
+
+	// Vertex inputs, for building input layouts
+	for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetInputParameterDesc(i, &paramDesc);
+
+		ShaderReflectionInput input;
+		input.SemanticName = paramDesc.SemanticName;
+		input.SemanticIndex = paramDesc.SemanticIndex;
+		input.Mask = paramDesc.Mask;
+		input.ComponentType = paramDesc.ComponentType;
+		data.InputParameters.push_back(input);
+	}
+
+	// Zeros for anything but compute shaders
+	refl->GetThreadGroupSize(
+		&data.ThreadGroupSize[0],
+		&data.ThreadGroupSize[1],
+		&data.ThreadGroupSize[2]);
+	return true;
+}
+
 // --------------------------------------------------------
 // Helper for looking up a variable by name and also
 // verifying that it is the requested size
@@ -278,6 +422,50 @@ SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
 	return result->second;
 }
 
+// --------------------------------------------------------
+// Helper for ValidateBufferLayout() and SetBufferData() -
+// finds a constant buffer by name and checks a C++ layout
+// against it, remembering the result so the check only
+// runs once per layout
+//
+// Returns null if the buffer is missing or doesn't match
+// --------------------------------------------------------
+SimpleConstantBuffer* ISimpleShader::FindLayoutBuffer(const char* name, const CBufferField* fields, size_t fieldCount, unsigned int structSize)
+{
+	// Only a few buffers per shader, so compare names directly
+	// rather than building a std::string for the table
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		SimpleConstantBuffer* cb = &constantBuffers[i];
+		if (cb->Name != name)
+			continue;
+
+		if (cb->CheckedLayout != fields)
+		{
+			std::string error;
+			cb->CheckedLayout = fields;
+			cb->CheckedLayoutMatches = ValidateCBufferLayout(reflection.ConstantBuffers[i], fields, fieldCount, structSize, &error);
+
+			if (!cb->CheckedLayoutMatches && ReportErrors)
+			{
+				LogError("SimpleShader - Layout mismatch in ");
+				LogError(error);
+				LogError("\n");
+			}
+		}
+
+		return cb->CheckedLayoutMatches ? cb : 0;
+	}
+
+	if (ReportWarnings)
+	{
+		LogWarning("SimpleShader - Constant buffer '");
+		Log(name);
+		LogWarning("' not found.\n");
+	}
+	return 0;
+}
+
 // --------------------------------------------------------
 // Prints the specified message to the console with the 
 // given color and Visual Studio's output window
@@ -349,9 +537,7 @@ void ISimpleShader::CopyAllBufferData()
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
 		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		UploadBuffer(&constantBuffers[i]);
 	}
 }
 
@@ -380,9 +566,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -402,9 +586,167 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
+}
+
+// --------------------------------------------------------
+// Replaces a constant buffer's local data with pre-packed
+// bytes.  Size must be the buffer's full size.
+// --------------------------------------------------------
+bool ISimpleShader::SetBufferBytes(unsigned int index, const void* data, unsigned int size)
+{
+	if (!shaderValid || index >= constantBufferCount)
+		return false;
+
+	SimpleConstantBuffer* cb = &constantBuffers[index];
+	if (size != cb->Size)
+		return false;
+
+	WriteLocalData(cb, 0, data, size);
+	return true;
+}
+
+// --------------------------------------------------------
+// Copies a buffer's local data to the GPU and records the
+// upload in the shared stats.  Buffers with no changes since
+// their last upload are skipped.
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	// Nothing changed and the GPU copy is still valid
+	if (cb->DirtyBegin >= cb->DirtyEnd && !IsRingAllocationStale(cb))
+	{
+		UploadStats.BuffersSkipped++;
+		return;
+	}
+
+	UploadStats.BuffersUploaded++;
+
+	// Write into the shared ring if there is one, which means the
+	// binding changes with every copy and has to be re-set now.
+	// A fresh allocation always needs the whole buffer.
+	if (ConstantRing && deviceContext1)
+	{
+		if (ConstantRing->Allocate(cb->LocalDataBuffer, cb->Size, cb->RingAllocation))
+		{
+			UploadStats.RingUploads++;
+			UploadStats.BytesUploaded += cb->Size;
+			cb->DirtyBegin = cb->DirtyEnd = 0;
+			BindConstantBuffer(cb);
+			return;
+		}
+
+		UploadStats.FallbackUploads++;
+	}
+
+	// Ring is full (or not in use), so update this shader's own buffer.
+	// Our buffer doesn't hold what the ring did, so it all goes up.
+	bool wasInRing = cb->RingAllocation.Buffer != 0;
+	cb->RingAllocation = {};
+	if (wasInRing)
+	{
+		cb->DirtyBegin = 0;
+		cb->DirtyEnd = cb->Size;
+	}
+
+	// Constant buffer updates work in whole 16-byte constants
+	unsigned int begin = cb->DirtyBegin / 16 * 16;
+	unsigned int end = (cb->DirtyEnd + 15) / 16 * 16;
+	unsigned int bufferWidth = (cb->Size + 15) / 16 * 16;
+	if (partialUpdates && (begin > 0 || end < bufferWidth))
+	{
+		D3D11_BOX box = {};
+		box.left = begin;
+		box.right = end;
+		box.top = 0;
+		box.bottom = 1;
+		box.front = 0;
+		box.back = 1;
+
+		// Source pointer is for the start of the box
+		deviceContext1->UpdateSubresource1(
+			cb->ConstantBuffer.Get(), 0, &box,
+			cb->LocalDataBuffer + begin, 0, 0, 0);
+
+		UploadStats.BytesUploaded += end - begin;
+	}
+	else
+	{
+		deviceContext->UpdateSubresource(
+			cb->ConstantBuffer.Get(), 0, 0,
+			cb->LocalDataBuffer, 0, 0);
+
+		UploadStats.BytesUploaded += cb->Size;
+	}
+
+	cb->DirtyBegin = cb->DirtyEnd = 0;
+
+	// Swap the binding back from the ring to our own buffer
+	if (wasInRing)
+		BindConstantBuffer(cb);
+}
+
+// --------------------------------------------------------
+// Ring data is only good for the frame it was written in
+// --------------------------------------------------------
+bool ISimpleShader::IsRingAllocationStale(SimpleConstantBuffer* cb)
+{
+	return cb->RingAllocation.Buffer &&
+		(!ConstantRing || cb->RingAllocation.Frame != ConstantRing->GetFrameIndex());
+}
+
+// --------------------------------------------------------
+// Copies new data into a buffer's local data, growing its
+// dirty range.  Writes of identical bytes are counted and
+// otherwise ignored, so re-setting unchanged values each
+// frame doesn't cause an upload.
+// --------------------------------------------------------
+void ISimpleShader::WriteLocalData(SimpleConstantBuffer* cb, unsigned int offset, const void* data, unsigned int size)
+{
+	unsigned char* dest = cb->LocalDataBuffer + offset;
+	if (memcmp(dest, data, size) == 0)
+	{
+		UploadStats.NoOpSets++;
+		return;
+	}
+
+	memcpy(dest, data, size);
+
+	if (cb->DirtyBegin >= cb->DirtyEnd)
+	{
+		cb->DirtyBegin = offset;
+		cb->DirtyEnd = offset + size;
+	}
+	else
+	{
+		if (offset < cb->DirtyBegin) cb->DirtyBegin = offset;
+		if (offset + size > cb->DirtyEnd) cb->DirtyEnd = offset + size;
+	}
+}
+
+// --------------------------------------------------------
+// Binds all of this shader's constant buffers to its stage.
+// Ring data is only good for the frame it was written in,
+// so older ring allocations get re-uploaded instead.
+// --------------------------------------------------------
+void ISimpleShader::BindConstantBuffers()
+{
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		// Skip "buffers" that aren't true constant buffers
+		SimpleConstantBuffer* cb = &constantBuffers[i];
+		if (cb->Type != D3D11_CT_CBUFFER)
+			continue;
+
+		// Stale ring data may have been overwritten since
+		if (IsRingAllocationStale(cb))
+		{
+			UploadBuffer(cb);
+			continue;
+		}
+
+		BindConstantBuffer(cb);
+	}
 }
 
 
@@ -446,10 +788,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 	}
 
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	WriteLocalData(&constantBuffers[var->ConstantBufferIndex], var->ByteOffset, data, size);
 
 	// Success
 	return true;
@@ -535,6 +874,65 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 dat
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Resolves a variable name to a handle for the fast Set
+// overloads.  Returns an invalid handle (Size of zero) if
+// the variable doesn't exist.
+// --------------------------------------------------------
+ShaderVarHandle ISimpleShader::GetVariableHandle(std::string name)
+{
+	ShaderVarHandle handle = varHandleTable.Find(name);
+	if (!handle.IsValid() && ReportWarnings)
+	{
+		LogWarning("SimpleShader::GetVariableHandle() - Shader variable '");
+		Log(name);
+		LogWarning("' not found. Ensure the name is spelled correctly and that it exists in a constant buffer in the shader.\n");
+	}
+
+	return handle;
+}
+
+// --------------------------------------------------------
+// Resolves a variable by its name hash, which can be
+// computed at compile time with ShaderNameHash()
+// --------------------------------------------------------
+ShaderVarHandle ISimpleShader::GetVariableHandle(unsigned int nameHash)
+{
+	return varHandleTable.Find(nameHash);
+}
+
+// --------------------------------------------------------
+// Sets a variable through a pre-resolved handle - no name
+// lookup, just a copy into the local data buffer
+//
+// handle - A handle from this shader's GetVariableHandle()
+// data   - The data to set in the buffer
+// size   - The size of the data (must not exceed the variable's size)
+//
+// Returns true if data is copied, false if the handle is invalid
+// --------------------------------------------------------
+bool ISimpleShader::SetData(const ShaderVarHandle& handle, const void* data, unsigned int size)
+{
+	if (!handle.IsValid() || size > handle.Size || handle.ConstantBufferIndex >= constantBufferCount)
+		return false;
+
+	WriteLocalData(&constantBuffers[handle.ConstantBufferIndex], handle.ByteOffset, data, size);
+
+	return true;
+}
+
+// Typed versions of the handle-based SetData()
+bool ISimpleShader::SetInt(const ShaderVarHandle& handle, int data) { return SetData(handle, &data, sizeof(int)); }
+bool ISimpleShader::SetFloat(const ShaderVarHandle& handle, float data) { return SetData(handle, &data, sizeof(float)); }
+bool ISimpleShader::SetFloat2(const ShaderVarHandle& handle, const float data[2]) { return SetData(handle, data, sizeof(float) * 2); }
+bool ISimpleShader::SetFloat2(const ShaderVarHandle& handle, const DirectX::XMFLOAT2& data) { return SetData(handle, &data, sizeof(float) * 2); }
+bool ISimpleShader::SetFloat3(const ShaderVarHandle& handle, const float data[3]) { return SetData(handle, data, sizeof(float) * 3); }
+bool ISimpleShader::SetFloat3(const ShaderVarHandle& handle, const DirectX::XMFLOAT3& data) { return SetData(handle, &data, sizeof(float) * 3); }
+bool ISimpleShader::SetFloat4(const ShaderVarHandle& handle, const float data[4]) { return SetData(handle, data, sizeof(float) * 4); }
+bool ISimpleShader::SetFloat4(const ShaderVarHandle& handle, const DirectX::XMFLOAT4& data) { return SetData(handle, &data, sizeof(float) * 4); }
+bool ISimpleShader::SetMatrix4x4(const ShaderVarHandle& handle, const float data[16]) { return SetData(handle, data, sizeof(float) * 16); }
+bool ISimpleShader::SetMatrix4x4(const ShaderVarHandle& handle, const DirectX::XMFLOAT4X4& data) { return SetData(handle, &data, sizeof(float) * 16); }
+
 // --------------------------------------------------------
 // Determines if the shader contains the specified
 // variable within one of its constant buffers
@@ -771,28 +1169,14 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 	// matches what the vertex shader expects.  Code adapted from:
 	// https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
 
-	// Reflect shader info
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-	
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
-	// Read input layout description from shader info
+	// Read input layout description from the reflection data
+	// (loaded from the cache or reflected by LoadShaderFile)
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
-	for (unsigned int i = 0; i< shaderDesc.InputParameters; i++)
+	for (const ShaderReflectionInput& paramDesc : reflection.InputParameters)
 	{
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetInputParameterDesc(i, &paramDesc);
-
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
-		std::string sem = paramDesc.SemanticName;
+		const std::string& sem = paramDesc.SemanticName;
 		int lenDiff = (int)sem.size() - (int)perInstanceStr.size();
 		bool isPerInstance = 
 			lenDiff >= 0 &&
@@ -800,7 +1184,7 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 
 		// Fill out input element desc
 		D3D11_INPUT_ELEMENT_DESC elementDesc = {};
-		elementDesc.SemanticName = paramDesc.SemanticName;
+		elementDesc.SemanticName = paramDesc.SemanticName.c_str();
 		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
 		elementDesc.InputSlot = 0;
 		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
@@ -869,22 +1253,51 @@ void SimpleVertexShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader and input layout
-	deviceContext->IASetInputLayout(inputLayout.Get());
-	deviceContext->VSSetShader(shader.Get(), 0, 0);
+	if (States)
+	{
+		States->SetInputLayout(inputLayout.Get());
+		States->SetShader(STATE_STAGE_VERTEX, shader.Get());
+	}
+	else
+	{
+		deviceContext->IASetInputLayout(inputLayout.Get());
+		deviceContext->VSSetShader(shader.Get(), 0, 0);
+	}
 
 	// Set the constant buffers
-	for (unsigned int i = 0; i < constantBufferCount; i++)
+	BindConstantBuffers();
+}
+
+// --------------------------------------------------------
+// Binds one constant buffer to the vertex shader stage,
+// either by offset from the shared ring or as a whole buffer
+// --------------------------------------------------------
+void SimpleVertexShader::BindConstantBuffer(SimpleConstantBuffer* cb)
+{
+	if (States)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
+		if (cb->RingAllocation.Buffer && deviceContext1)
+			States->SetConstantBuffer(STATE_STAGE_VERTEX, cb->BindIndex, cb->RingAllocation.Buffer, cb->RingAllocation.FirstConstant, cb->RingAllocation.NumConstants);
+		else
+			States->SetConstantBuffer(STATE_STAGE_VERTEX, cb->BindIndex, cb->ConstantBuffer.Get());
+		return;
+	}
 
-		// This is a real constant buffer, so set it
-		deviceContext->VSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
+	if (cb->RingAllocation.Buffer && deviceContext1)
+	{
+		deviceContext1->VSSetConstantBuffers1(
+			cb->BindIndex,
 			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+			&cb->RingAllocation.Buffer,
+			&cb->RingAllocation.FirstConstant,
+			&cb->RingAllocation.NumConstants);
+		return;
 	}
+
+	deviceContext->VSSetConstantBuffers(
+		cb->BindIndex,
+		1,
+		cb->ConstantBuffer.GetAddressOf());
 }
 
 // --------------------------------------------------------
@@ -911,7 +1324,10 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (States)
+		States->SetShaderResource(STATE_STAGE_VERTEX, srvInfo->BindIndex, srv.Get());
+	else
+		deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -940,8 +1356,11 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// Set the sampler state
+	if (States)
+		States->SetSampler(STATE_STAGE_VERTEX, sampInfo->BindIndex, samplerState.Get());
+	else
+		deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1012,21 +1431,45 @@ void SimplePixelShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 	
 	// Set the shader
-	deviceContext->PSSetShader(shader.Get(), 0, 0);
+	if (States)
+		States->SetShader(STATE_STAGE_PIXEL, shader.Get());
+	else
+		deviceContext->PSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
-	for (unsigned int i = 0; i < constantBufferCount; i++)
+	BindConstantBuffers();
+}
+
+// --------------------------------------------------------
+// Binds one constant buffer to the pixel shader stage,
+// either by offset from the shared ring or as a whole buffer
+// --------------------------------------------------------
+void SimplePixelShader::BindConstantBuffer(SimpleConstantBuffer* cb)
+{
+	if (States)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
+		if (cb->RingAllocation.Buffer && deviceContext1)
+			States->SetConstantBuffer(STATE_STAGE_PIXEL, cb->BindIndex, cb->RingAllocation.Buffer, cb->RingAllocation.FirstConstant, cb->RingAllocation.NumConstants);
+		else
+			States->SetConstantBuffer(STATE_STAGE_PIXEL, cb->BindIndex, cb->ConstantBuffer.Get());
+		return;
+	}
 
-		// This is a real constant buffer, so set it
-		deviceContext->PSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
+	if (cb->RingAllocation.Buffer && deviceContext1)
+	{
+		deviceContext1->PSSetConstantBuffers1(
+			cb->BindIndex,
 			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+			&cb->RingAllocation.Buffer,
+			&cb->RingAllocation.FirstConstant,
+			&cb->RingAllocation.NumConstants);
+		return;
 	}
+
+	deviceContext->PSSetConstantBuffers(
+		cb->BindIndex,
+		1,
+		cb->ConstantBuffer.GetAddressOf());
 }
 
 // --------------------------------------------------------
@@ -1053,7 +1496,10 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (States)
+		States->SetShaderResource(STATE_STAGE_PIXEL, srvInfo->BindIndex, srv.Get());
+	else
+		deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1082,8 +1528,11 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// Set the sampler state
+	if (States)
+		States->SetSampler(STATE_STAGE_PIXEL, sampInfo->BindIndex, samplerState.Get());
+	else
+		deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1159,18 +1608,30 @@ void SimpleDomainShader::SetShaderAndCBs()
 	deviceContext->DSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
+	BindConstantBuffers();
+}
 
-		// This is a real constant buffer, so set it
-		deviceContext->DSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
+// --------------------------------------------------------
+// Binds one constant buffer to the domain shader stage,
+// either by offset from the shared ring or as a whole buffer
+// --------------------------------------------------------
+void SimpleDomainShader::BindConstantBuffer(SimpleConstantBuffer* cb)
+{
+	if (cb->RingAllocation.Buffer && deviceContext1)
+	{
+		deviceContext1->DSSetConstantBuffers1(
+			cb->BindIndex,
 			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+			&cb->RingAllocation.Buffer,
+			&cb->RingAllocation.FirstConstant,
+			&cb->RingAllocation.NumConstants);
+		return;
 	}
+
+	deviceContext->DSSetConstantBuffers(
+		cb->BindIndex,
+		1,
+		cb->ConstantBuffer.GetAddressOf());
 }
 
 // --------------------------------------------------------
@@ -1301,19 +1762,31 @@ void SimpleHullShader::SetShaderAndCBs()
 	// Set the shader
 	deviceContext->HSSetShader(shader.Get(), 0, 0);
 
-	// Set the constant buffers?
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
+	// Set the constant buffers
+	BindConstantBuffers();
+}
 
-		// This is a real constant buffer, so set it
-		deviceContext->HSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
+// --------------------------------------------------------
+// Binds one constant buffer to the hull shader stage,
+// either by offset from the shared ring or as a whole buffer
+// --------------------------------------------------------
+void SimpleHullShader::BindConstantBuffer(SimpleConstantBuffer* cb)
+{
+	if (cb->RingAllocation.Buffer && deviceContext1)
+	{
+		deviceContext1->HSSetConstantBuffers1(
+			cb->BindIndex,
 			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+			&cb->RingAllocation.Buffer,
+			&cb->RingAllocation.FirstConstant,
+			&cb->RingAllocation.NumConstants);
+		return;
 	}
+
+	deviceContext->HSSetConstantBuffers(
+		cb->BindIndex,
+		1,
+		cb->ConstantBuffer.GetAddressOf());
 }
 
 // --------------------------------------------------------
@@ -1575,19 +2048,31 @@ void SimpleGeometryShader::SetShaderAndCBs()
 	// Set the shader
 	deviceContext->GSSetShader(shader.Get(), 0, 0);
 
-	// Set the constant buffers?
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
+	// Set the constant buffers
+	BindConstantBuffers();
+}
 
-		// This is a real constant buffer, so set it
-		deviceContext->GSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
+// --------------------------------------------------------
+// Binds one constant buffer to the geometry shader stage,
+// either by offset from the shared ring or as a whole buffer
+// --------------------------------------------------------
+void SimpleGeometryShader::BindConstantBuffer(SimpleConstantBuffer* cb)
+{
+	if (cb->RingAllocation.Buffer && deviceContext1)
+	{
+		deviceContext1->GSSetConstantBuffers1(
+			cb->BindIndex,
 			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+			&cb->RingAllocation.Buffer,
+			&cb->RingAllocation.FirstConstant,
+			&cb->RingAllocation.NumConstants);
+		return;
 	}
+
+	deviceContext->GSSetConstantBuffers(
+		cb->BindIndex,
+		1,
+		cb->ConstantBuffer.GetAddressOf());
 }
 
 // --------------------------------------------------------
@@ -1730,43 +2215,17 @@ bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBl
 	if (result != S_OK)
 		return false;
 
-	// Set up shader reflection to get information about UAV's
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-	
 	// Grab the thread info
-	threadsTotal = refl->GetThreadGroupSize(
-		&threadsX,
-		&threadsY,
-		&threadsZ);
+	threadsX = reflection.ThreadGroupSize[0];
+	threadsY = reflection.ThreadGroupSize[1];
+	threadsZ = reflection.ThreadGroupSize[2];
+	threadsTotal = threadsX * threadsY * threadsZ;
 
 	// Loop and get all UAV resources
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (const ShaderReflectionResource& resource : reflection.Resources)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
-
-		// Check the type, looking for any kind of UAV
-		switch (resourceDesc.Type)
-		{
-		case D3D_SIT_UAV_APPEND_STRUCTURED:
-		case D3D_SIT_UAV_CONSUME_STRUCTURED:
-		case D3D_SIT_UAV_RWBYTEADDRESS:
-		case D3D_SIT_UAV_RWSTRUCTURED:
-		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
-		case D3D_SIT_UAV_RWTYPED:
-			uavTable.insert(std::pair<std::string, unsigned int>(resourceDesc.Name, resourceDesc.BindPoint));
-		}
+		if (resource.Kind == SHADER_RESOURCE_UAV)
+			uavTable.insert(std::pair<std::string, unsigned int>(resource.Name, resource.BindIndex));
 	}
 
 	// All set
@@ -1785,19 +2244,31 @@ void SimpleComputeShader::SetShaderAndCBs()
 	// Set the shader
 	deviceContext->CSSetShader(shader.Get(), 0, 0);
 
-	// Set the constant buffers?
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
+	// Set the constant buffers
+	BindConstantBuffers();
+}
 
-		// This is a real constant buffer, so set it
-		deviceContext->CSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
+// --------------------------------------------------------
+// Binds one constant buffer to the compute shader stage,
+// either by offset from the shared ring or as a whole buffer
+// --------------------------------------------------------
+void SimpleComputeShader::BindConstantBuffer(SimpleConstantBuffer* cb)
+{
+	if (cb->RingAllocation.Buffer && deviceContext1)
+	{
+		deviceContext1->CSSetConstantBuffers1(
+			cb->BindIndex,
 			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+			&cb->RingAllocation.Buffer,
+			&cb->RingAllocation.FirstConstant,
+			&cb->RingAllocation.NumConstants);
+		return;
 	}
+
+	deviceContext->CSSetConstantBuffers(
+		cb->BindIndex,
+		1,
+		cb->ConstantBuffer.GetAddressOf());
 }
 
 // --------------------------------------------------------
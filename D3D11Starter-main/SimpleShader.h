@@ -10,6 +10,14 @@
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <memory>
+#include <atomic>
+
+#include "ConstantBufferRing.h"
+#include "StateCache.h"
+#include "ShaderVariableTable.h"
+#include "ShaderReflectionData.h"
+#include "CBufferLayout.h"
 
 
 // --------------------------------------------------------
@@ -37,6 +45,11 @@ struct SimpleConstantBuffer
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
 	std::vector<SimpleShaderVariable> Variables;
+	ConstantBufferRing::Allocation RingAllocation; // Where the data lives when using the ring
+	unsigned int DirtyBegin = 0; // Byte range of the local data changed since
+	unsigned int DirtyEnd = 0;   // the last upload - empty when Begin >= End
+	const CBufferField* CheckedLayout = 0; // Last C++ layout validated against this buffer
+	bool CheckedLayoutMatches = false;
 };
 
 // --------------------------------------------------------
@@ -57,6 +70,20 @@ struct SimpleSampler
 	unsigned int BindIndex; // The register of the Sampler
 };
 
+// --------------------------------------------------------
+// Running totals of constant buffer traffic across all
+// shaders, so callers can measure bytes sent per frame
+// --------------------------------------------------------
+struct SimpleShaderUploadStats
+{
+	unsigned int BuffersUploaded = 0;
+	unsigned int BytesUploaded = 0;
+	unsigned int RingUploads = 0;     // Uploads written into the shared ring
+	unsigned int FallbackUploads = 0; // Uploads that found the ring full
+	unsigned int NoOpSets = 0;        // Sets that wrote the bytes already there
+	unsigned int BuffersSkipped = 0;  // Copies skipped because nothing changed
+};
+
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
 // --------------------------------------------------------
@@ -89,6 +116,39 @@ public:
 	bool SetMatrix4x4(std::string name, const float data[16]);
 	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
 
+	// Pre-resolved variable handles - look these up once and reuse
+	// them for any per-frame or per-draw sets
+	ShaderVarHandle GetVariableHandle(std::string name);
+	ShaderVarHandle GetVariableHandle(unsigned int nameHash); // See ShaderNameHash()
+
+	bool SetData(const ShaderVarHandle& handle, const void* data, unsigned int size);
+
+	bool SetInt(const ShaderVarHandle& handle, int data);
+	bool SetFloat(const ShaderVarHandle& handle, float data);
+	bool SetFloat2(const ShaderVarHandle& handle, const float data[2]);
+	bool SetFloat2(const ShaderVarHandle& handle, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(const ShaderVarHandle& handle, const float data[3]);
+	bool SetFloat3(const ShaderVarHandle& handle, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(const ShaderVarHandle& handle, const float data[4]);
+	bool SetFloat4(const ShaderVarHandle& handle, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(const ShaderVarHandle& handle, const float data[16]);
+	bool SetMatrix4x4(const ShaderVarHandle& handle, const DirectX::XMFLOAT4X4& data);
+
+	// Sets an entire constant buffer from a struct described with
+	// CBUFFER_LAYOUT (see ShaderStructs.h) in a single copy
+	template<typename T>
+	bool SetBufferData(const T& data);
+
+	// Checks a CBUFFER_LAYOUT struct against this shader's buffer.
+	// Call when the shader is loaded so a mismatch is reported up
+	// front; SetBufferData() reuses the result.
+	template<typename T>
+	bool ValidateBufferLayout();
+
+	// Sets an entire constant buffer from bytes already packed to
+	// its reflected layout, such as a material's baked constants
+	bool SetBufferBytes(unsigned int index, const void* data, unsigned int size);
+
 	// Setting shader resources
 	virtual bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
 	virtual bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
@@ -122,12 +182,34 @@ public:
 	static bool ReportErrors;
 	static bool ReportWarnings;
 
+	// Upload tracking
+	static SimpleShaderUploadStats UploadStats;
+	static void ResetUploadStats() { UploadStats = {}; }
+
+	// Optional shared ring for constant data.  When set, copies are
+	// written into the ring and bound by offset immediately, rather
+	// than updating each shader's own buffer.
+	static std::shared_ptr<ConstantBufferRing> ConstantRing;
+
+	// Optional redundant-state filter.  When set, vertex and pixel
+	// shaders bind themselves and their resources through it.
+	static std::shared_ptr<StateCache> States;
+
+	// Reflection results are cached in a ".refl" file next to each
+	// .cso, keyed by a hash of the bytecode, so D3DReflect only runs
+	// when a shader is new or has been rebuilt
+	static bool UseReflectionCache;
+	static std::atomic<unsigned int> ReflectionCacheHits;
+	static std::atomic<unsigned int> ReflectionCacheMisses;
+
 protected:
 	
 	bool shaderValid;
 	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> deviceContext1; // For offset binding, if available
+	bool partialUpdates; // Can update just the dirty part of a constant buffer
 
 	// Resource counts
 	unsigned int constantBufferCount;
@@ -138,21 +220,36 @@ protected:
 	std::vector<SimpleSampler*>	samplerStates;
 	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
 	std::unordered_map<std::string, SimpleShaderVariable> varTable;
+	ShaderVariableTable varHandleTable;
+
+	// Reflection data for the loaded shader, set before CreateShader()
+	ShaderReflectionData reflection;
 	std::unordered_map<std::string, SimpleSRV*> textureTable;
 	std::unordered_map<std::string, SimpleSampler*> samplerTable;
 
 	// Initialization method
 	bool LoadShaderFile(LPCWSTR shaderFile);
+	static bool ReflectShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, ShaderReflectionData& data);
 
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob) = 0;
 	virtual void SetShaderAndCBs() = 0;
+	virtual void BindConstantBuffer(SimpleConstantBuffer* cb) = 0;
 
 	virtual void CleanUp();
 
 	// Helpers for finding data by name
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+	SimpleConstantBuffer* FindLayoutBuffer(const char* name, const CBufferField* fields, size_t fieldCount, unsigned int structSize);
+
+	// Writes into a buffer's local data, tracking what changed
+	void WriteLocalData(SimpleConstantBuffer* cb, unsigned int offset, const void* data, unsigned int size);
+
+	// Sends a buffer's local data to the GPU
+	void UploadBuffer(SimpleConstantBuffer* cb);
+	bool IsRingAllocationStale(SimpleConstantBuffer* cb);
+	void BindConstantBuffers();
 
 	// Error logging
 	void Log(std::string message, WORD color);
@@ -165,6 +262,38 @@ protected:
 	void LogWarningW(std::wstring message);
 };
 
+// --------------------------------------------------------
+// Copies a whole struct into the matching constant buffer.
+// The layout is normally validated at load time by
+// ValidateBufferLayout(), and a mismatch leaves the buffer
+// untouched.
+// --------------------------------------------------------
+template<typename T>
+bool ISimpleShader::SetBufferData(const T& data)
+{
+	SimpleConstantBuffer* cb = FindLayoutBuffer(
+		CBufferLayout<T>::Name,
+		CBufferLayout<T>::Fields,
+		std::size(CBufferLayout<T>::Fields),
+		sizeof(T));
+	if (!cb)
+		return false;
+
+	// Validation guarantees the struct covers the whole buffer
+	WriteLocalData(cb, 0, &data, cb->Size);
+	return true;
+}
+
+template<typename T>
+bool ISimpleShader::ValidateBufferLayout()
+{
+	return FindLayoutBuffer(
+		CBufferLayout<T>::Name,
+		CBufferLayout<T>::Fields,
+		std::size(CBufferLayout<T>::Fields),
+		sizeof(T)) != 0;
+}
+
 // --------------------------------------------------------
 // Derived class for VERTEX shaders ///////////////////////
 // --------------------------------------------------------
@@ -187,6 +316,7 @@ protected:
 	 Microsoft::WRL::ComPtr<ID3D11VertexShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(SimpleConstantBuffer* cb);
 	void CleanUp();
 };
 
@@ -208,6 +338,7 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(SimpleConstantBuffer* cb);
 	void CleanUp();
 };
 
@@ -228,6 +359,7 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(SimpleConstantBuffer* cb);
 	void CleanUp();
 };
 
@@ -248,6 +380,7 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11HullShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(SimpleConstantBuffer* cb);
 	void CleanUp();
 };
 
@@ -280,6 +413,7 @@ protected:
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	bool CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(SimpleConstantBuffer* cb);
 	void CleanUp();
 
 	// Helpers
@@ -319,5 +453,6 @@ protected:
 
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(SimpleConstantBuffer* cb);
 	void CleanUp();
 };
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "Sky.h"
+#include "ShaderStructs.h"
+#include "TextureUpload.h"
 
 // --------------------------------------------------------
 // Author: Chris Cascioli
@@ -14,12 +16,32 @@
 //   your own implementation.
 // --------------------------------------------------------
 
+void Sky::Init(std::shared_ptr<Mesh> box, ComPtr<ID3D11SamplerState> sampler, std::shared_ptr<SimplePixelShader> pixelShader, std::shared_ptr<SimpleVertexShader> vertexShader,
+	std::shared_ptr<PipelineStateCache> pipelines)
+{
+	samplerState = sampler;
+	mesh = box;
+	ps = pixelShader;
+	vs = vertexShader;
+
+	// Inside of the cube, drawn at the far plane
+	PipelineStateDesc desc;
+	desc.VertexShader = vs;
+	desc.PixelShader = ps;
+	desc.Raster.FillMode = D3D11_FILL_SOLID;
+	desc.Raster.CullMode = D3D11_CULL_FRONT;
+	desc.Raster.DepthClipEnable = false;
+	desc.Depth.DepthEnable = true;
+	desc.Depth.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	desc.Depth.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+	pipeline = pipelines->Get(desc);
+}
+
 Sky::~Sky()
 {
 	samplerState.ReleaseAndGetAddressOf();
 	srv.ReleaseAndGetAddressOf();
-	depthStencilState.ReleaseAndGetAddressOf();
-	rasterizerState.ReleaseAndGetAddressOf();
+	pipeline.reset();
 	mesh.reset();
 	ps.reset();
 	vs.reset();
@@ -27,27 +49,41 @@ Sky::~Sky()
 
 void Sky::Draw(std::shared_ptr<Camera> cam)
 {
-	Graphics::Context->RSSetState(rasterizerState.Get());
-	Graphics::Context->OMSetDepthStencilState(depthStencilState.Get(), 0);
-	ps->SetShader();
-	vs->SetShader();
-	vs->SetMatrix4x4("viewMat", cam->GetViewMatrix());
-	vs->SetMatrix4x4("projMat", cam->GetProjectionMatrix());
+	pipeline->Bind();
+	SkyVSData vsData = {};
+	vsData.viewMat = cam->GetViewMatrix();
+	vsData.projMat = cam->GetProjectionMatrix();
+	vs->SetBufferData(vsData);
 	vs->CopyAllBufferData();
 	ps->SetSamplerState("sampleState", samplerState);
 	ps->SetShaderResourceView("textureCube", srv);
 	ps->CopyAllBufferData();
 
 	mesh->Draw();
-	Graphics::Context->RSSetState(nullptr);
-	Graphics::Context->OMSetDepthStencilState(nullptr,0);
 };
 
+// --------------------------------------------------------
+// A cooked cube map is already in D3D11's subresource order,
+// so its mapped pages go straight to CreateTexture2D
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(const wchar_t* cubemap)
+{
+	TextureContainer container;
+	std::string error;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeSRV;
+	if (!container.Open(cubemap, error) || !container.GetDescription().IsCubemap)
+		return cubeSRV;
+
+	CreateTextureFromContainer(container, cubeSRV);
+	return cubeSRV;
+}
+
 // --------------------------------------------------------
 // Loads six individual textures (the six faces of a cube map), then
 // creates a blank cube map and copies each of the six textures to
 // another face.  Afterwards, creates a shader resource view for
 // the cube map and cleans up all of the temporary resources.
+// Six cooked DDS faces skip all that and upload in place.
 // --------------------------------------------------------
 Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 	const wchar_t* right,
@@ -57,23 +93,57 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 	const wchar_t* front,
 	const wchar_t* back)
 {
+	// When every face was cooked, map the six DDS files and hand
+	// their mips straight to one CreateTexture2D - no temporary
+	// textures and no copies
+	const wchar_t* faces[6] = { right, left, up, down, front, back };
+	{
+		TextureContainer containers[6];
+		const TextureContainer* cooked[6] = {};
+		std::string error;
+		for (int i = 0; i < 6; i++)
+		{
+			if (std::filesystem::path(faces[i]).extension() != L".dds" || !containers[i].Open(faces[i], error))
+				break;
+			cooked[i] = &containers[i];
+		}
+
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeSRV;
+		if (cooked[5] && CreateCubemapFromContainers(cooked, cubeSRV))
+			return cubeSRV;
+	}
+
 	// Load the 6 textures into an array.
 	// - We need references to the TEXTURES, not SHADER RESOURCE VIEWS!
-	// - Explicitly NOT generating mipmaps, as we don't need them for the sky!
+	// - WIC faces have one mip; cooked faces carry a full chain
 	// - Order matters here!  +X, -X, +Y, -Y, +Z, -Z
+	// - Faces that went through the texture cooker are already
+	//   GPU-ready DDS files, so skip WIC's decode for those
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> textures[6] = {};
-	DirectX::CreateWICTextureFromFile(Graphics::Device.Get(), right, (ID3D11Resource**)textures[0].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(Graphics::Device.Get(), left, (ID3D11Resource**)textures[1].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(Graphics::Device.Get(), up, (ID3D11Resource**)textures[2].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(Graphics::Device.Get(), down, (ID3D11Resource**)textures[3].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(Graphics::Device.Get(), front, (ID3D11Resource**)textures[4].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(Graphics::Device.Get(), back, (ID3D11Resource**)textures[5].GetAddressOf(), 0);
+	for (int i = 0; i < 6; i++)
+	{
+		if (std::filesystem::path(faces[i]).extension() == L".dds")
+			DirectX::CreateDDSTextureFromFile(Graphics::Device.Get(), faces[i], (ID3D11Resource**)textures[i].GetAddressOf(), 0);
+		else
+			DirectX::CreateWICTextureFromFile(Graphics::Device.Get(), faces[i], (ID3D11Resource**)textures[i].GetAddressOf(), 0);
+	}
 
 	// We'll assume all of the textures are the same color format and resolution,
 	// so get the description of the first texture
 	D3D11_TEXTURE2D_DESC faceDesc = {};
 	textures[0]->GetDesc(&faceDesc);
 
+	// Only keep the mips every face has
+	unsigned int mipLevels = faceDesc.MipLevels;
+	for (int i = 1; i < 6; i++)
+	{
+		D3D11_TEXTURE2D_DESC desc = {};
+		if (!textures[i])
+			continue;
+		textures[i]->GetDesc(&desc);
+		mipLevels = desc.MipLevels < mipLevels ? desc.MipLevels : mipLevels;
+	}
+
 	// Describe the resource for the cube map, which is simply 
 	// a "texture 2d array" with the TEXTURECUBE flag set.  
 	// This is a special GPU resource format, NOT just a 
@@ -85,7 +155,7 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 	cubeDesc.Format = faceDesc.Format; // Match the loaded texture's color format
 	cubeDesc.Width = faceDesc.Width;   // Match the size
 	cubeDesc.Height = faceDesc.Height; // Match the size
-	cubeDesc.MipLevels = 1;            // Only need 1
+	cubeDesc.MipLevels = mipLevels;    // As many as the faces share
 	cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE; // This should be treated as a CUBE, not 6 separate textures
 	cubeDesc.Usage = D3D11_USAGE_DEFAULT; // Standard usage
 	cubeDesc.SampleDesc.Count = 1;
@@ -99,20 +169,27 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 	// one at a time, to the cube map texure
 	for (int i = 0; i < 6; i++)
 	{
-		// Calculate the subresource position to copy into
-		unsigned int subresource = D3D11CalcSubresource(
-			0,  // Which mip (zero, since there's only one)
-			i,  // Which array element?
-			1); // How many mip levels are in the texture?
-
-		// Copy from one resource (texture) to another
-		Graphics::Context->CopySubresourceRegion(
-			cubeMapTexture.Get(),  // Destination resource
-			subresource,           // Dest subresource index (one of the array elements)
-			0, 0, 0,               // XYZ location of copy
-			textures[i].Get(),     // Source resource
-			0,                     // Source subresource index (we're assuming there's only one)
-			0);                    // Source subresource "box" of data to copy (zero means the whole thing)
+		D3D11_TEXTURE2D_DESC desc = {};
+		if (textures[i])
+			textures[i]->GetDesc(&desc);
+
+		for (unsigned int mip = 0; mip < mipLevels; mip++)
+		{
+			// Calculate the subresource position to copy into
+			unsigned int subresource = D3D11CalcSubresource(
+				mip,        // Which mip
+				i,          // Which array element?
+				mipLevels); // How many mip levels are in the texture?
+
+			// Copy from one resource (texture) to another
+			Graphics::Context->CopySubresourceRegion(
+				cubeMapTexture.Get(),  // Destination resource
+				subresource,           // Dest subresource index (one of the array elements)
+				0, 0, 0,               // XYZ location of copy
+				textures[i].Get(),     // Source resource
+				D3D11CalcSubresource(mip, 0, desc.MipLevels), // Same mip of the face
+				0);                    // Source subresource "box" of data to copy (zero means the whole thing)
+		}
 	}
 
 	// At this point, all of the faces have been copied into the 
@@ -120,7 +197,7 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Format = cubeDesc.Format;         // Same format as texture
 	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE; // Treat this as a cube!
-	srvDesc.TextureCube.MipLevels = 1;        // Only need access to 1 mip
+	srvDesc.TextureCube.MipLevels = mipLevels; // Every mip we copied
 	srvDesc.TextureCube.MostDetailedMip = 0;  // Index of the first mip we want to see
 
 	// Make the SRV
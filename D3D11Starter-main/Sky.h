@@ -5,9 +5,12 @@
 #include "Mesh.h"
 #include "SimpleShader.h"
 #include "WICTextureLoader.h"
+#include "DDSTextureLoader.h"
 #include "PathHelpers.h"
 #include "Camera.h"
+#include "PipelineState.h"
 #include <memory>
+#include <filesystem>
 
 using Microsoft::WRL::ComPtr;
 
@@ -16,14 +19,14 @@ class Sky
 private: 
 	ComPtr<ID3D11SamplerState> samplerState;
 	ComPtr<ID3D11ShaderResourceView> srv;
-	ComPtr<ID3D11DepthStencilState> depthStencilState;
-	ComPtr<ID3D11RasterizerState> rasterizerState;
+	std::shared_ptr<PipelineState> pipeline;
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<SimplePixelShader> ps;
 	std::shared_ptr<SimpleVertexShader> vs;
 
 public:
 	Sky(std::shared_ptr<Mesh> box,ComPtr<ID3D11SamplerState> sampler, std::shared_ptr<SimplePixelShader> pixelShader, std::shared_ptr<SimpleVertexShader> vertexShader,
+		std::shared_ptr<PipelineStateCache> pipelines,
 		const wchar_t* right,
 		const wchar_t* left,
 		const wchar_t* up,
@@ -31,27 +34,34 @@ public:
 		const wchar_t* front,
 		const wchar_t* back)
 	{
-		samplerState = sampler;
-		mesh = box;
-		ps = pixelShader;
-		vs = vertexShader;
-
-		D3D11_RASTERIZER_DESC rDesc = {};
-		rDesc.FillMode = D3D11_FILL_SOLID;
-		rDesc.CullMode = D3D11_CULL_FRONT;
-		Graphics::Device->CreateRasterizerState(&rDesc,&rasterizerState);
-
-		D3D11_DEPTH_STENCIL_DESC dsDesc = {};
-		dsDesc.DepthEnable = true;
-		dsDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-		Graphics::Device->CreateDepthStencilState(&dsDesc, &depthStencilState);
-
+		Init(box, sampler, pixelShader, vertexShader, pipelines);
 		srv = CreateCubemap(right, left, up, down, front, back);
 	};
 
+	// From one cooked DDS cube map holding all six faces
+	Sky(std::shared_ptr<Mesh> box, ComPtr<ID3D11SamplerState> sampler, std::shared_ptr<SimplePixelShader> pixelShader, std::shared_ptr<SimpleVertexShader> vertexShader,
+		std::shared_ptr<PipelineStateCache> pipelines,
+		const wchar_t* cubemap)
+	{
+		Init(box, sampler, pixelShader, vertexShader, pipelines);
+		srv = CreateCubemap(cubemap);
+	};
+
 	~Sky();
 
 	void Draw(std::shared_ptr<Camera> cam);
+
+	// False if the cube map couldn't be created
+	bool IsLoaded() const { return srv != nullptr; }
+
+private:
+	void Init(std::shared_ptr<Mesh> box, ComPtr<ID3D11SamplerState> sampler, std::shared_ptr<SimplePixelShader> pixelShader, std::shared_ptr<SimpleVertexShader> vertexShader,
+		std::shared_ptr<PipelineStateCache> pipelines);
+
+	// Maps the file and uploads every face and mip in one call
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateCubemap(const wchar_t* cubemap);
+
+public:
 // --------------------------------------------------------
 // Author: Chris Cascioli
 // Purpose: Creates a cube map on the GPU from 6 individual textures
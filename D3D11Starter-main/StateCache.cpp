@@ -0,0 +1,206 @@
+#include "StateCache.h"
+
+StateCache::StateCache(std::shared_ptr<IStateSink> sink) :
+	sink(sink),
+	enabled(true)
+{
+	ResetStats();
+}
+
+bool StateCache::Update(Binding& binding, StateCall call, const void* object, unsigned int a, unsigned int b)
+{
+	if (enabled && binding.Known && binding.Object == object && binding.A == a && binding.B == b)
+	{
+		filtered[call]++;
+		return false;
+	}
+
+	binding.Known = true;
+	binding.Object = object;
+	binding.A = a;
+	binding.B = b;
+	issued[call]++;
+	return true;
+}
+
+void StateCache::SetShader(StateStage stage, const void* shader)
+{
+	if (Update(shaders[stage], STATE_CALL_SHADER, shader))
+		sink->SetShader(stage, shader);
+}
+
+void StateCache::SetInputLayout(const void* layout)
+{
+	if (Update(inputLayout, STATE_CALL_INPUT_LAYOUT, layout))
+		sink->SetInputLayout(layout);
+}
+
+void StateCache::SetConstantBuffer(StateStage stage, unsigned int slot, const void* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	// Slots past the tracked range are just passed along
+	if (slot >= MaxConstantBuffers)
+	{
+		issued[STATE_CALL_CONSTANT_BUFFER]++;
+		sink->SetConstantBuffer(stage, slot, buffer, firstConstant, numConstants);
+	}
+	else if (Update(constantBuffers[stage][slot], STATE_CALL_CONSTANT_BUFFER, buffer, firstConstant, numConstants))
+	{
+		sink->SetConstantBuffer(stage, slot, buffer, firstConstant, numConstants);
+	}
+}
+
+void StateCache::SetShaderResource(StateStage stage, unsigned int slot, const void* srv)
+{
+	if (slot >= MaxShaderResources)
+	{
+		issued[STATE_CALL_SHADER_RESOURCE]++;
+		sink->SetShaderResource(stage, slot, srv);
+	}
+	else if (Update(shaderResources[stage][slot], STATE_CALL_SHADER_RESOURCE, srv))
+	{
+		sink->SetShaderResource(stage, slot, srv);
+	}
+}
+
+void StateCache::SetSampler(StateStage stage, unsigned int slot, const void* sampler)
+{
+	if (slot >= MaxSamplers)
+	{
+		issued[STATE_CALL_SAMPLER]++;
+		sink->SetSampler(stage, slot, sampler);
+	}
+	else if (Update(samplers[stage][slot], STATE_CALL_SAMPLER, sampler))
+	{
+		sink->SetSampler(stage, slot, sampler);
+	}
+}
+
+void StateCache::SetRasterState(const void* state)
+{
+	if (Update(rasterState, STATE_CALL_RASTER, state))
+		sink->SetRasterState(state);
+}
+
+void StateCache::SetDepthState(const void* state, unsigned int stencilRef)
+{
+	if (Update(depthState, STATE_CALL_DEPTH, state, stencilRef))
+		sink->SetDepthState(state, stencilRef);
+}
+
+void StateCache::SetBlendState(const void* state)
+{
+	if (Update(blendState, STATE_CALL_BLEND, state))
+		sink->SetBlendState(state);
+}
+
+void StateCache::SetTopology(unsigned int value)
+{
+	if (Update(topology, STATE_CALL_TOPOLOGY, 0, value))
+		sink->SetTopology(value);
+}
+
+void StateCache::SetVertexBuffer(unsigned int slot, const void* buffer, unsigned int stride, unsigned int offset)
+{
+	if (slot >= MaxVertexBuffers)
+	{
+		issued[STATE_CALL_VERTEX_BUFFER]++;
+		sink->SetVertexBuffer(slot, buffer, stride, offset);
+	}
+	else if (Update(vertexBuffers[slot], STATE_CALL_VERTEX_BUFFER, buffer, stride, offset))
+	{
+		sink->SetVertexBuffer(slot, buffer, stride, offset);
+	}
+}
+
+void StateCache::SetIndexBuffer(const void* buffer, unsigned int format, unsigned int offset)
+{
+	if (Update(indexBuffer, STATE_CALL_INDEX_BUFFER, buffer, format, offset))
+		sink->SetIndexBuffer(buffer, format, offset);
+}
+
+// --------------------------------------------------------
+// Never filtered.  Binding an output silently unbinds any
+// SRV of the same resource, so SRV tracking can't be
+// trusted afterwards.
+// --------------------------------------------------------
+void StateCache::SetRenderTarget(const void* rtv, const void* dsv)
+{
+	issued[STATE_CALL_RENDER_TARGETS]++;
+	sink->SetRenderTarget(rtv, dsv);
+
+	for (unsigned int stage = 0; stage < STATE_STAGE_COUNT; stage++)
+	{
+		for (Binding& srv : shaderResources[stage])
+			srv.Known = false;
+	}
+}
+
+void StateCache::ClearShaderResources(StateStage stage, unsigned int firstSlot, unsigned int count)
+{
+	// Nothing to do if every slot is already known to be empty
+	bool alreadyClear = enabled && firstSlot + count <= MaxShaderResources;
+	for (unsigned int slot = firstSlot; alreadyClear && slot < firstSlot + count; slot++)
+		alreadyClear = shaderResources[stage][slot].Known && shaderResources[stage][slot].Object == 0;
+
+	if (alreadyClear)
+	{
+		filtered[STATE_CALL_SHADER_RESOURCE]++;
+		return;
+	}
+
+	issued[STATE_CALL_SHADER_RESOURCE]++;
+	sink->ClearShaderResources(stage, firstSlot, count);
+
+	for (unsigned int slot = firstSlot; slot < firstSlot + count && slot < MaxShaderResources; slot++)
+	{
+		Binding& srv = shaderResources[stage][slot];
+		srv.Known = true;
+		srv.Object = 0;
+	}
+}
+
+void StateCache::Invalidate()
+{
+	for (unsigned int stage = 0; stage < STATE_STAGE_COUNT; stage++)
+	{
+		shaders[stage].Known = false;
+		for (Binding& cb : constantBuffers[stage]) cb.Known = false;
+		for (Binding& srv : shaderResources[stage]) srv.Known = false;
+		for (Binding& sampler : samplers[stage]) sampler.Known = false;
+	}
+
+	for (Binding& vb : vertexBuffers)
+		vb.Known = false;
+
+	inputLayout.Known = false;
+	rasterState.Known = false;
+	depthState.Known = false;
+	blendState.Known = false;
+	topology.Known = false;
+	indexBuffer.Known = false;
+}
+
+unsigned int StateCache::GetTotalIssued() const
+{
+	unsigned int total = 0;
+	for (unsigned int count : issued)
+		total += count;
+	return total;
+}
+
+unsigned int StateCache::GetTotalFiltered() const
+{
+	unsigned int total = 0;
+	for (unsigned int count : filtered)
+		total += count;
+	return total;
+}
+
+void StateCache::ResetStats()
+{
+	for (unsigned int i = 0; i < STATE_CALL_COUNT; i++)
+	{
+		issued[i] = 0;
+		filtered[i] = 0;
+	}
+}
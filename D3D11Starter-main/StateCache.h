@@ -0,0 +1,142 @@
+#pragma once
+#include <memory>
+
+// Shader stages the cache tracks bindings for
+enum StateStage
+{
+	STATE_STAGE_VERTEX = 0,
+	STATE_STAGE_PIXEL = 1,
+	STATE_STAGE_COUNT
+};
+
+// Kinds of calls, for the counters
+enum StateCall
+{
+	STATE_CALL_SHADER = 0,
+	STATE_CALL_INPUT_LAYOUT,
+	STATE_CALL_CONSTANT_BUFFER,
+	STATE_CALL_SHADER_RESOURCE,
+	STATE_CALL_SAMPLER,
+	STATE_CALL_RASTER,
+	STATE_CALL_DEPTH,
+	STATE_CALL_BLEND,
+	STATE_CALL_TOPOLOGY,
+	STATE_CALL_VERTEX_BUFFER,
+	STATE_CALL_INDEX_BUFFER,
+	STATE_CALL_RENDER_TARGETS,
+	STATE_CALL_COUNT
+};
+
+// --------------------------------------------------------
+// Receives the calls that make it through StateCache.
+// D3D11StateSink forwards them to a device context; a test
+// can record them instead.  Objects are passed as untyped
+// pointers so this side needs no Direct3D headers.
+// --------------------------------------------------------
+class IStateSink
+{
+public:
+	virtual ~IStateSink() {}
+
+	virtual void SetShader(StateStage stage, const void* shader) = 0;
+	virtual void SetInputLayout(const void* layout) = 0;
+
+	// A count of zero binds the whole buffer, otherwise it's
+	// bound by offset (both in 16-byte constants)
+	virtual void SetConstantBuffer(StateStage stage, unsigned int slot, const void* buffer, unsigned int firstConstant, unsigned int numConstants) = 0;
+
+	virtual void SetShaderResource(StateStage stage, unsigned int slot, const void* srv) = 0;
+	virtual void ClearShaderResources(StateStage stage, unsigned int firstSlot, unsigned int count) = 0;
+	virtual void SetSampler(StateStage stage, unsigned int slot, const void* sampler) = 0;
+	virtual void SetRasterState(const void* state) = 0;
+	virtual void SetDepthState(const void* state, unsigned int stencilRef) = 0;
+	virtual void SetBlendState(const void* state) = 0; // Default blend factor and sample mask
+	virtual void SetTopology(unsigned int topology) = 0;
+	virtual void SetVertexBuffer(unsigned int slot, const void* buffer, unsigned int stride, unsigned int offset) = 0;
+	virtual void SetIndexBuffer(const void* buffer, unsigned int format, unsigned int offset) = 0;
+	virtual void SetRenderTarget(const void* rtv, const void* dsv) = 0; // Null rtv for depth-only
+};
+
+// --------------------------------------------------------
+// Remembers what's bound in every slot and drops calls that
+// wouldn't change anything.
+//
+// - Render target changes are always passed through, and
+//   forget every SRV binding, since D3D unbinds any SRV
+//   whose resource becomes an output
+// - Anything that touches the context directly (ImGui,
+//   for one) must be followed by Invalidate()
+// --------------------------------------------------------
+class StateCache
+{
+public:
+	static const unsigned int MaxConstantBuffers = 14;
+	static const unsigned int MaxShaderResources = 128;
+	static const unsigned int MaxSamplers = 16;
+	static const unsigned int MaxVertexBuffers = 32;
+
+	StateCache(std::shared_ptr<IStateSink> sink);
+
+	void SetShader(StateStage stage, const void* shader);
+	void SetInputLayout(const void* layout);
+	void SetConstantBuffer(StateStage stage, unsigned int slot, const void* buffer, unsigned int firstConstant = 0, unsigned int numConstants = 0);
+	void SetShaderResource(StateStage stage, unsigned int slot, const void* srv);
+	void SetSampler(StateStage stage, unsigned int slot, const void* sampler);
+	void SetRasterState(const void* state);
+	void SetDepthState(const void* state, unsigned int stencilRef = 0);
+	void SetBlendState(const void* state);
+	void SetTopology(unsigned int topology);
+	void SetVertexBuffer(unsigned int slot, const void* buffer, unsigned int stride, unsigned int offset);
+	void SetIndexBuffer(const void* buffer, unsigned int format, unsigned int offset);
+	void SetRenderTarget(const void* rtv, const void* dsv);
+
+	// Unbinds a range of SRV slots in one call, such as after a
+	// pass that read from a texture about to become a target
+	void ClearShaderResources(StateStage stage, unsigned int firstSlot, unsigned int count);
+
+	// Forgets everything, so the next call of each kind goes through
+	void Invalidate();
+
+	// With filtering off every call goes through (still counted)
+	void SetEnabled(bool enable) { enabled = enable; }
+	bool IsEnabled() const { return enabled; }
+
+	// Stats
+	unsigned int GetIssuedCount(StateCall call) const { return issued[call]; }
+	unsigned int GetFilteredCount(StateCall call) const { return filtered[call]; }
+	unsigned int GetTotalIssued() const;
+	unsigned int GetTotalFiltered() const;
+	void ResetStats();
+
+private:
+	// One tracked binding - the object plus up to two values
+	// that also have to match (offsets, strides, formats)
+	struct Binding
+	{
+		bool Known = false;
+		const void* Object = 0;
+		unsigned int A = 0;
+		unsigned int B = 0;
+	};
+
+	std::shared_ptr<IStateSink> sink;
+	bool enabled;
+
+	Binding shaders[STATE_STAGE_COUNT];
+	Binding constantBuffers[STATE_STAGE_COUNT][MaxConstantBuffers];
+	Binding shaderResources[STATE_STAGE_COUNT][MaxShaderResources];
+	Binding samplers[STATE_STAGE_COUNT][MaxSamplers];
+	Binding inputLayout;
+	Binding rasterState;
+	Binding depthState;
+	Binding blendState;
+	Binding topology;
+	Binding vertexBuffers[MaxVertexBuffers];
+	Binding indexBuffer;
+
+	unsigned int issued[STATE_CALL_COUNT];
+	unsigned int filtered[STATE_CALL_COUNT];
+
+	// Records the new binding and returns true if it changed
+	bool Update(Binding& binding, StateCall call, const void* object, unsigned int a = 0, unsigned int b = 0);
+};
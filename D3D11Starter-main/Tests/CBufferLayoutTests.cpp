@@ -0,0 +1,127 @@
+#include "TestFramework.h"
+#include "CBufferLayout.h"
+
+// Plain float arrays stand in for the DirectXMath types
+struct Float4x4 { float M[16]; };
+struct Float3 { float V[3]; };
+
+struct TestPerObject
+{
+	Float4x4 world;
+	Float3 tint;
+	float roughness;
+};
+CBUFFER_LAYOUT(TestPerObject, "PerObject",
+	CBUFFER_FIELD(TestPerObject, world),
+	CBUFFER_FIELD(TestPerObject, tint),
+	CBUFFER_FIELD(TestPerObject, roughness));
+
+// The same cbuffer plus one value, padded out to a register
+struct TestPerObjectExtended
+{
+	Float4x4 world;
+	Float3 tint;
+	float roughness;
+	float metalness;
+	float padding[3];
+};
+CBUFFER_LAYOUT(TestPerObjectExtended, "PerObject",
+	CBUFFER_FIELD(TestPerObjectExtended, world),
+	CBUFFER_FIELD(TestPerObjectExtended, tint),
+	CBUFFER_FIELD(TestPerObjectExtended, roughness),
+	CBUFFER_FIELD(TestPerObjectExtended, metalness));
+
+// What the shader's reflection reports for TestPerObject
+static ShaderReflectionBuffer MakeBuffer()
+{
+	ShaderReflectionBuffer buffer;
+	buffer.Name = "PerObject";
+	buffer.Size = 80;
+	buffer.Variables.push_back({ "world", 0, 64 });
+	buffer.Variables.push_back({ "tint", 64, 12 });
+	buffer.Variables.push_back({ "roughness", 76, 4 });
+	return buffer;
+}
+
+TEST(HlslPackingRules)
+{
+	// A float3 after a float fits the rest of the register...
+	CHECK(HlslPackOffset(4, 12, false) == 4);
+	// ...but not after a float2, and matrices start a new one
+	CHECK(HlslPackOffset(8, 12, false) == 16);
+	CHECK(HlslPackOffset(4, 64, true) == 16);
+	CHECK(HlslPackOffset(16, 64, true) == 16);
+}
+
+TEST(CBufferLayoutMatchesReflection)
+{
+	std::string error;
+	CHECK(ValidateCBufferLayout<TestPerObject>(MakeBuffer(), &error));
+	CHECK(error.empty());
+
+	// Fields past the end of a shorter buffer are allowed
+	CHECK(ValidateCBufferLayout<TestPerObjectExtended>(MakeBuffer(), &error));
+}
+
+TEST(CBufferLayoutMatchesCachedReflection)
+{
+	// Checked against a .refl's contents, as loaded on a later run
+	ShaderReflectionData data;
+	data.BytecodeHash = 7;
+	data.ConstantBuffers.push_back(MakeBuffer());
+	std::vector<unsigned char> bytes;
+	SerializeShaderReflection(data, bytes);
+
+	ShaderReflectionData loaded;
+	CHECK(DeserializeShaderReflection(bytes.data(), bytes.size(), 7, loaded));
+	CHECK(loaded.ConstantBuffers.size() == 1);
+	if (loaded.ConstantBuffers.size() == 1)
+		CHECK(ValidateCBufferLayout<TestPerObject>(loaded.ConstantBuffers[0]));
+}
+
+TEST(CBufferLayoutRejectsSmallStruct)
+{
+	ShaderReflectionBuffer buffer = MakeBuffer();
+	buffer.Size = 96;
+	buffer.Variables.push_back({ "metalness", 80, 4 });
+
+	std::string error;
+	CHECK(!ValidateCBufferLayout<TestPerObject>(buffer, &error));
+	CHECK(error.find("80 bytes") != std::string::npos);
+}
+
+TEST(CBufferLayoutRejectsMissingField)
+{
+	ShaderReflectionBuffer buffer = MakeBuffer();
+	buffer.Variables[2].Name = "gloss";
+
+	std::string error;
+	CHECK(!ValidateCBufferLayout<TestPerObject>(buffer, &error));
+	CHECK(error.find("'gloss'") != std::string::npos);
+}
+
+TEST(CBufferLayoutRejectsWrongPlacement)
+{
+	std::string error;
+	ShaderReflectionBuffer moved = MakeBuffer();
+	moved.Variables[1].ByteOffset = 68;
+	CHECK(!ValidateCBufferLayout<TestPerObject>(moved, &error));
+	CHECK(error.find("'tint'") != std::string::npos);
+
+	ShaderReflectionBuffer resized = MakeBuffer();
+	resized.Variables[2].Size = 8;
+	CHECK(!ValidateCBufferLayout<TestPerObject>(resized, &error));
+	CHECK(error.find("'roughness'") != std::string::npos);
+}
+
+TEST(CBufferLayoutRejectsUndeclaredFieldInsideBuffer)
+{
+	// The shader no longer declares roughness, but the struct would
+	// still write into the space where it was
+	ShaderReflectionBuffer buffer = MakeBuffer();
+	buffer.Variables.pop_back();
+
+	std::string error;
+	CHECK(!ValidateCBufferLayout<TestPerObject>(buffer, &error));
+	CHECK(error.find("isn't declared") != std::string::npos);
+}
@@ -0,0 +1,56 @@
+#include "TestFramework.h"
+#include "CacheFiles.h"
+#include <fstream>
+
+// How many files are in a folder, to spot leftover temporaries
+static unsigned int CountFiles(const std::filesystem::path& directory)
+{
+	unsigned int files = 0;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory))
+		files += entry.is_regular_file();
+	return files;
+}
+
+TEST(WriteFileAtomicReplacesContents)
+{
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "CacheFilesTests";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	std::filesystem::path path = directory / "entry.bin";
+
+	CHECK(WriteFileAtomic(path, "first", 5));
+	CHECK(WriteFileAtomic(path, "second", 6));
+	CHECK(std::filesystem::file_size(path) == 6);
+	CHECK(CountFiles(directory) == 1);
+
+	std::filesystem::remove_all(directory);
+}
+
+TEST(WriteFileAtomicCleansUpFailedWrites)
+{
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "CacheFilesTests";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	std::filesystem::path path = directory / "entry.bin";
+
+	// A stream error part way through leaves nothing behind
+	bool written = WriteFileAtomic(path, [](std::ostream& out)
+	{
+		out << "partial";
+		out.setstate(std::ios::badbit);
+	});
+	CHECK(!written);
+	CHECK(!std::filesystem::exists(path));
+	CHECK(CountFiles(directory) == 0);
+
+	std::filesystem::remove_all(directory);
+}
+
+TEST(HashKeysAreStable)
+{
+	// FNV-1a's published value for "a"
+	CHECK(HashBytes("a", 1) == 0xaf63dc4c8601ec8cull);
+	CHECK(HashBytes("", 0) == 14695981039346656037ull);
+	CHECK(FormatHashKey(0xaf63dc4c8601ec8cull) == "af63dc4c8601ec8c");
+	CHECK(FormatHashKey(1) == "0000000000000001");
+}
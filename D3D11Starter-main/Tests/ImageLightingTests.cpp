@@ -0,0 +1,127 @@
+#include "TestFramework.h"
+#include "ImageLighting.h"
+#include "MipGenerator.h"
+#include <cmath>
+
+// --------------------------------------------------------
+// A one-level 16x16 sky whose radiance is radiance(dir),
+// sampled at each texel's direction
+// --------------------------------------------------------
+template<typename Radiance>
+static ImageLightingSource MakeSky(Radiance radiance)
+{
+	const unsigned int size = 16;
+	ImageLightingSource source;
+	source.Size = size;
+	source.Sizes.push_back(size);
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		std::vector<float>& texels = source.Faces[face].emplace_back(size * size * 4);
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				float dir[3];
+				GetCubeDirection(face, (x + 0.5f) * 2.0f / size - 1.0f, (y + 0.5f) * 2.0f / size - 1.0f, dir);
+				float length = sqrtf(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+				for (float& d : dir)
+					d /= length;
+
+				radiance(dir, &texels[(y * size + x) * 4]);
+			}
+		}
+	}
+	return source;
+}
+
+// What PixelShader.hlsl does with the coefficients for one channel
+static float EvaluateIrradiance(const float irradiance[9][4], unsigned int channel, float x, float y, float z)
+{
+	const float basis[9] =
+	{
+		0.282095f,
+		0.488603f * y,
+		0.488603f * z,
+		0.488603f * x,
+		1.092548f * x * y,
+		1.092548f * y * z,
+		0.315392f * (3.0f * z * z - 1.0f),
+		1.092548f * x * z,
+		0.546274f * (x * x - y * y),
+	};
+
+	float sum = 0;
+	for (int i = 0; i < 9; i++)
+		sum += irradiance[i][channel] * basis[i];
+	return sum;
+}
+
+static bool Near(float a, float b)
+{
+	return fabsf(a - b) < 0.02f;
+}
+
+TEST(ProjectIrradianceOfUniformSky)
+{
+	// Uniform radiance of 1 lights every normal with pi, which is 1 after the divide
+	ImageLightingSource sky = MakeSky([](const float*, float* texel) { texel[0] = texel[1] = texel[2] = texel[3] = 1.0f; });
+	ImageLightingSettings settings;
+	float irradiance[9][4];
+	ProjectIrradiance(sky, settings, irradiance, nullptr);
+
+	CHECK(Near(EvaluateIrradiance(irradiance, 0, 0, 1, 0), 1.0f));
+	CHECK(Near(EvaluateIrradiance(irradiance, 2, 0.6f, 0, -0.8f), 1.0f));
+	for (int i = 1; i < 9; i++)
+		CHECK(Near(irradiance[i][0], 0.0f));
+	CHECK(irradiance[0][3] == 0.0f);
+}
+
+TEST(ProjectIrradianceOfLinearSky)
+{
+	// Radiance of x, y and z in R, G and B.  A linear sky convolves
+	// to 2/3 of itself, so each channel only fills its own band 1 term.
+	ImageLightingSource sky = MakeSky([](const float* dir, float* texel)
+	{
+		texel[0] = dir[0];
+		texel[1] = dir[1];
+		texel[2] = dir[2];
+		texel[3] = 1.0f;
+	});
+	ImageLightingSettings settings;
+	float irradiance[9][4];
+	ProjectIrradiance(sky, settings, irradiance, nullptr);
+
+	CHECK(Near(EvaluateIrradiance(irradiance, 0, 1, 0, 0), 2.0f / 3));
+	CHECK(Near(EvaluateIrradiance(irradiance, 1, 0, 1, 0), 2.0f / 3));
+	CHECK(Near(EvaluateIrradiance(irradiance, 2, 0, 0, -1), -2.0f / 3));
+	CHECK(Near(EvaluateIrradiance(irradiance, 2, 0.6f, 0, 0.8f), 0.8f * 2.0f / 3));
+
+	CHECK(Near(irradiance[0][0], 0.0f));
+	CHECK(Near(irradiance[1][0], 0.0f) && Near(irradiance[2][0], 0.0f));
+	CHECK(Near(irradiance[3][1], 0.0f) && Near(irradiance[2][1], 0.0f));
+	CHECK(Near(irradiance[1][2], 0.0f) && Near(irradiance[3][2], 0.0f));
+}
+
+TEST(ProjectIrradianceMatchesOnThePool)
+{
+	ImageLightingSource sky = MakeSky([](const float* dir, float* texel)
+	{
+		texel[0] = dir[2] > 0 ? 4.0f : 0.1f; // A bright upper half
+		texel[1] = dir[0] * dir[0];
+		texel[2] = 0.5f;
+		texel[3] = 1.0f;
+	});
+	ImageLightingSettings settings;
+	float inlineIrradiance[9][4];
+	float pooledIrradiance[9][4];
+	ThreadPool pool(2);
+	ProjectIrradiance(sky, settings, inlineIrradiance, nullptr);
+	ProjectIrradiance(sky, settings, pooledIrradiance, &pool);
+
+	for (int i = 0; i < 9; i++)
+		for (int c = 0; c < 4; c++)
+			CHECK(fabsf(inlineIrradiance[i][c] - pooledIrradiance[i][c]) < 1e-5f);
+
+	// More light from above than below
+	CHECK(EvaluateIrradiance(inlineIrradiance, 0, 0, 0, 1) > EvaluateIrradiance(inlineIrradiance, 0, 0, 0, -1));
+}
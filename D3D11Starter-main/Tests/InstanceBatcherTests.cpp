@@ -0,0 +1,73 @@
+#include "TestFramework.h"
+#include "InstanceBatcher.h"
+
+TEST(InstanceBatcherGroupsMatchingDraws)
+{
+	// Three materials by two meshes, two draws each at different depths,
+	// plus one draw in another pass that mustn't be picked up
+	DrawList list;
+	for (unsigned int i = 0; i < 12; i++)
+		list.Add(MakeDrawKey(1, 0, i % 3, i % 2, i), i);
+	list.Add(MakeDrawKey(0, 0, 0, 1, 0), 99);
+	list.Sort();
+
+	size_t begin, end;
+	list.GetPassRange(1, begin, end);
+	InstanceBatcher batcher;
+	batcher.Build(list, begin, end, 64);
+
+	CHECK(batcher.GetBatches().size() == 6);
+	for (const InstanceBatch& batch : batcher.GetBatches())
+	{
+		CHECK(batch.Count == 2);
+
+		// Both instances share everything but depth
+		unsigned long long first = list.GetItems()[batch.First].Key;
+		unsigned long long second = list.GetItems()[batch.First + 1].Key;
+		CHECK(GetDrawKeyField(first, DrawKeyMaterialShift, DrawKeyMaterialBits) == GetDrawKeyField(second, DrawKeyMaterialShift, DrawKeyMaterialBits));
+		CHECK(GetDrawKeyField(first, DrawKeyMeshShift, DrawKeyMeshBits) == GetDrawKeyField(second, DrawKeyMeshShift, DrawKeyMeshBits));
+	}
+
+	const InstanceBatchStats& stats = batcher.GetStats();
+	CHECK(stats.Draws == 12);
+	CHECK(stats.Batches == 6);
+	CHECK(stats.BatchesFormed == 6);
+	CHECK(stats.DrawCallsSaved == 6);
+}
+
+TEST(InstanceBatcherRespectsMaxInstances)
+{
+	DrawList list;
+	for (unsigned int i = 0; i < 7; i++)
+		list.Add(MakeDrawKey(0, 0, 0, 0, i), i);
+	list.Sort();
+
+	InstanceBatcher batcher;
+	batcher.Build(list, 0, list.GetCount(), 3);
+	CHECK(batcher.GetBatches().size() == 3);
+	CHECK(batcher.GetBatches()[0].Count == 3);
+	CHECK(batcher.GetBatches()[2].First == 6);
+	CHECK(batcher.GetBatches()[2].Count == 1);
+
+	// One instance per draw turns batching off
+	batcher.Build(list, 0, list.GetCount(), 1);
+	CHECK(batcher.GetStats().Batches == 7);
+	CHECK(batcher.GetStats().BatchesFormed == 0);
+}
+
+TEST(InstanceBatcherOnlyJoinsNeighbours)
+{
+	// Unsorted, the two material 0 draws aren't adjacent
+	DrawList list;
+	list.Add(MakeDrawKey(0, 0, 0, 0, 0), 0);
+	list.Add(MakeDrawKey(0, 0, 1, 0, 0), 1);
+	list.Add(MakeDrawKey(0, 0, 0, 0, 0), 2);
+
+	InstanceBatcher batcher;
+	batcher.Build(list, 0, list.GetCount(), 64);
+	CHECK(batcher.GetStats().Batches == 3);
+
+	list.Sort();
+	batcher.Build(list, 0, list.GetCount(), 64);
+	CHECK(batcher.GetStats().Batches == 2);
+}
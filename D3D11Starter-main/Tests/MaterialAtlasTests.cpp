@@ -0,0 +1,87 @@
+#include "TestFramework.h"
+#include "MaterialAtlas.h"
+
+// --------------------------------------------------------
+// Saves a square texture with a mip chain to a temp file
+// and opens it, since the atlas works from containers.
+// Every byte of a mip is fill + mip.
+// --------------------------------------------------------
+static bool OpenTexture(TextureContainer& container, const char* name, unsigned int size, unsigned int format, unsigned int mips, unsigned char fill)
+{
+	DdsTexture texture;
+	texture.Width = size;
+	texture.Height = size;
+	texture.Format = format;
+	texture.MipCount = mips;
+	for (unsigned int mip = 0; mip < mips; mip++)
+	{
+		unsigned int mipSize = (size >> mip) ? (size >> mip) : 1;
+		DdsSurface surface;
+		surface.Width = mipSize;
+		surface.Height = mipSize;
+		surface.RowPitch = (mipSize + 3) / 4 * GetDdsFormatBlockBytes(format);
+		surface.Data.assign(GetDdsSurfaceBytes(format, mipSize, mipSize), (unsigned char)(fill + mip));
+		texture.Surfaces.push_back(surface);
+	}
+
+	std::filesystem::path path = std::filesystem::temp_directory_path() / (std::string("MaterialAtlasTests_") + name + ".dds");
+	std::string error;
+	return SaveDds(path, texture) && container.Open(path, error);
+}
+
+TEST(MaterialAtlasAllocatesSlices)
+{
+	TextureContainer albedoA, normalsA, albedoB, normalsB;
+	CHECK(OpenTexture(albedoA, "albedoA", 64, DDS_FORMAT_BC7_UNORM, 7, 10));
+	CHECK(OpenTexture(normalsA, "normalsA", 64, DDS_FORMAT_BC5_UNORM, 7, 20));
+	CHECK(OpenTexture(albedoB, "albedoB", 64, DDS_FORMAT_BC7_UNORM, 5, 30)); // Shorter chain
+	CHECK(OpenTexture(normalsB, "normalsB", 64, DDS_FORMAT_BC5_UNORM, 7, 40));
+
+	std::string error;
+	MaterialAtlas atlas(2);
+	CHECK(atlas.AddMaterial({ &albedoA, &normalsA }, error) == 0);
+	CHECK(atlas.AddMaterial({ &albedoB, &normalsB }, error) == 1);
+
+	// Same textures share a slice; a new combination gets its own
+	CHECK(atlas.AddMaterial({ &albedoA, &normalsA }, error) == 0);
+	CHECK(atlas.AddMaterial({ &albedoA, &normalsB }, error) == 2);
+	CHECK(atlas.GetSliceCount() == 3);
+
+	// The albedo array keeps only the mips every slice has
+	DdsTexture albedo = atlas.GetArrayDescription(0);
+	CHECK(albedo.ArraySize == 3 && albedo.MipCount == 5 && albedo.Format == DDS_FORMAT_BC7_UNORM);
+	CHECK(atlas.GetArrayDescription(1).MipCount == 7);
+
+	// Slice by slice, each with its mips top down
+	std::vector<TextureSubresource> subresources = atlas.GetArraySubresources(0);
+	CHECK(subresources.size() == 15);
+	if (subresources.size() == 15)
+	{
+		CHECK(subresources[0].Data[0] == 10);
+		CHECK(subresources[4].Data[0] == 14);
+		CHECK(subresources[5].Data[0] == 30);
+		CHECK(subresources[6].Width == 32);
+		CHECK(subresources[10].Data[0] == 10);
+	}
+	CHECK(atlas.GetArraySubresources(1).size() == 21);
+}
+
+TEST(MaterialAtlasTurnsAwayMismatches)
+{
+	TextureContainer albedo, normals, small, bc1;
+	CHECK(OpenTexture(albedo, "albedo", 64, DDS_FORMAT_BC7_UNORM, 7, 10));
+	CHECK(OpenTexture(normals, "normals", 64, DDS_FORMAT_BC5_UNORM, 7, 20));
+	CHECK(OpenTexture(small, "small", 32, DDS_FORMAT_BC7_UNORM, 6, 50));
+	CHECK(OpenTexture(bc1, "bc1", 64, DDS_FORMAT_BC1_UNORM, 7, 60));
+
+	std::string error;
+	MaterialAtlas atlas(2);
+	CHECK(atlas.AddMaterial({ &albedo, &normals }, error) == 0);
+
+	error.clear();
+	CHECK(atlas.AddMaterial({ &small, &normals }, error) == -1); // Size
+	CHECK(!error.empty());
+	CHECK(atlas.AddMaterial({ &albedo, &bc1 }, error) == -1);    // Format
+	CHECK(atlas.AddMaterial({ &albedo }, error) == -1);          // Channel count
+	CHECK(atlas.GetSliceCount() == 1);
+}
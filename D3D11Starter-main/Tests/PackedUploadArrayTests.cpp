@@ -0,0 +1,121 @@
+#include "TestFramework.h"
+#include "PackedUploadArray.h"
+
+// Same 64-byte stride as Light, without DirectXMath
+struct TestLight
+{
+	int Type;
+	float Values[15];
+};
+
+static TestLight MakeLight(int type)
+{
+	TestLight light = {};
+	light.Type = type;
+	return light;
+}
+
+TEST(PackedUploadArrayAddRemoveSet)
+{
+	PackedUploadArray<TestLight> lights(4);
+	CHECK(lights.Add(MakeLight(0)) == 0);
+	CHECK(lights.Add(MakeLight(1)) == 1);
+	CHECK(lights.Add(MakeLight(2)) == 2);
+	lights.TakeUpload();
+
+	// Removing keeps the rest packed and in order, and dirties the shifted tail
+	lights.Remove(0);
+	CHECK(lights.GetCount() == 2);
+	CHECK(lights.Get(0).Type == 1 && lights.Get(1).Type == 2);
+	CHECK(lights.GetDirtyFirst() == 0 && lights.GetDirtyCount() == 2);
+	lights.TakeUpload();
+
+	CHECK(lights.Set(1, MakeLight(7)));
+	CHECK(lights.Get(1).Type == 7);
+	CHECK(lights.GetDirtyFirst() == 1 && lights.GetDirtyCount() == 1);
+
+	// Out of range edits do nothing
+	CHECK(!lights.Set(5, MakeLight(7)));
+	lights.Remove(5);
+	CHECK(lights.GetCount() == 2);
+
+	lights.Clear();
+	CHECK(lights.GetCount() == 0 && !lights.IsDirty());
+}
+
+TEST(PackedUploadArraySkipsUnchangedSets)
+{
+	PackedUploadArray<TestLight> lights(4);
+	lights.Add(MakeLight(1));
+	lights.TakeUpload();
+
+	CHECK(!lights.Set(0, MakeLight(1)));
+	CHECK(!lights.IsDirty());
+	CHECK(lights.GetPendingUploadBytes() == 0);
+	CHECK(lights.TakeUpload().Count == 0);
+	CHECK(lights.GetLastUploadBytes() == 0);
+}
+
+TEST(PackedUploadArrayRecreatesOnGrow)
+{
+	PackedUploadArray<TestLight> lights(2);
+
+	// The first upload always builds the buffer
+	lights.Add(MakeLight(0));
+	PackedUpload upload = lights.TakeUpload();
+	CHECK(upload.Recreate && upload.First == 0 && upload.Count == 1);
+
+	lights.Add(MakeLight(1));
+	upload = lights.TakeUpload();
+	CHECK(!upload.Recreate && upload.First == 1 && upload.Count == 1);
+
+	// A third light doubles the capacity, and a fresh buffer gets everything
+	lights.Add(MakeLight(2));
+	CHECK(lights.GetCapacity() == 4);
+	CHECK(lights.GetPendingUploadBytes() == 3 * sizeof(TestLight));
+	upload = lights.TakeUpload();
+	CHECK(upload.Recreate && upload.First == 0 && upload.Count == 3);
+	CHECK(!lights.IsDirty());
+}
+
+TEST(PackedUploadArrayPendingMatchesUploaded)
+{
+	PackedUploadArray<TestLight> lights(8);
+	lights.Add(MakeLight(0));
+	lights.TakeUpload();
+
+	// Added then removed before an upload - the removed slot isn't sent
+	lights.Add(MakeLight(1));
+	lights.Add(MakeLight(2));
+	lights.Remove(2);
+	CHECK(lights.GetPendingUploadBytes() == sizeof(TestLight));
+	unsigned int pending = lights.GetPendingUploadBytes();
+	PackedUpload upload = lights.TakeUpload();
+	CHECK(upload.First == 1 && upload.Count == 1);
+	CHECK(lights.GetLastUploadBytes() == pending);
+
+	// Removing the last light leaves nothing to send
+	lights.Set(0, MakeLight(5));
+	lights.Remove(1);
+	CHECK(lights.GetPendingUploadBytes() == sizeof(TestLight));
+	lights.Remove(0);
+	CHECK(lights.GetPendingUploadBytes() == 0);
+	CHECK(lights.TakeUpload().Count == 0);
+
+	CHECK(lights.GetTotalUploadBytes() == 2 * sizeof(TestLight));
+}
+
+TEST(PackedUploadArrayRemoveLastBeforeFirstUpload)
+{
+	PackedUploadArray<TestLight> lights(4);
+	lights.Add(MakeLight(0));
+	lights.Add(MakeLight(1));
+	lights.Add(MakeLight(2));
+	lights.Remove(2);
+
+	CHECK(lights.GetDirtyCount() == 2);
+	CHECK(lights.GetPendingUploadBytes() == 2 * sizeof(TestLight));
+	PackedUpload upload = lights.TakeUpload();
+	CHECK(upload.Recreate && upload.First == 0 && upload.Count == 2);
+	CHECK(lights.GetLastUploadBytes() == 2 * sizeof(TestLight));
+}
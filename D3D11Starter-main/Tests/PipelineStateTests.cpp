@@ -0,0 +1,57 @@
+#include "TestFramework.h"
+#include "PipelineStateDesc.h"
+#include <memory>
+
+TEST(StateObjectCacheSharesEqualDescs)
+{
+	int created = 0;
+	StateObjectCache<RasterStateDesc, std::shared_ptr<int>> cache(
+		[&](const RasterStateDesc&) { return std::make_shared<int>(created++); });
+
+	RasterStateDesc solid;
+	RasterStateDesc noCull;
+	noCull.CullMode = 1; // D3D11_CULL_NONE
+
+	std::shared_ptr<int> a = cache.Get(solid);
+	std::shared_ptr<int> b = cache.Get(noCull);
+	std::shared_ptr<int> c = cache.Get(solid);
+
+	CHECK(a == c);
+	CHECK(a != b);
+	CHECK(created == 2);
+	CHECK(cache.GetRequestCount() == 3);
+	CHECK(cache.GetUniqueCount() == 2);
+}
+
+TEST(StateObjectCacheRetriesFailedCreates)
+{
+	int attempts = 0;
+	StateObjectCache<DepthStateDesc, std::shared_ptr<int>> cache(
+		[&](const DepthStateDesc&) { attempts++; return std::shared_ptr<int>(); });
+
+	DepthStateDesc desc;
+	CHECK(!cache.Get(desc));
+	CHECK(!cache.Get(desc));
+	CHECK(attempts == 2);
+	CHECK(cache.GetUniqueCount() == 0);
+}
+
+TEST(StateObjectCacheUsesPerRequestCreate)
+{
+	// Pipelines are built from more than their key, so the caller
+	// supplies the create function with each request
+	StateObjectCache<PipelineStateKey, std::shared_ptr<int>> cache;
+
+	PipelineStateKey key;
+	key.VertexShader = 1;
+	std::shared_ptr<int> first = cache.Get(key, [](const PipelineStateKey&) { return std::make_shared<int>(1); });
+	std::shared_ptr<int> second = cache.Get(key, [](const PipelineStateKey&) { return std::make_shared<int>(2); });
+
+	CHECK(first && *first == 1);
+	CHECK(first == second);
+
+	// No default create function, so a new key without one is a miss
+	key.PixelShader = 2;
+	CHECK(!cache.Get(key));
+	CHECK(cache.GetUniqueCount() == 1);
+}
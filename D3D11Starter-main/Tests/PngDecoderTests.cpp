@@ -0,0 +1,257 @@
+#include "TestFramework.h"
+#include "PngDecoder.h"
+#include <cstdlib>
+#include <cstring>
+
+// Raw deflate streams, made with Python's zlib (wbits = -15)
+
+// "Stored block" at level 0
+static const unsigned char storedStream[] = {
+	0x01, 0x0C, 0x00, 0xF3, 0xFF, 0x53, 0x74, 0x6F, 0x72, 0x65, 0x64, 0x20, 0x62, 0x6C, 0x6F, 0x63, 0x6B
+};
+
+// "abc" six times with Z_FIXED, so one literal run and one match
+static const unsigned char fixedStream[] = {
+	0x4B, 0x4C, 0x4A, 0x4E, 0x44, 0x45, 0x00
+};
+
+// MakeDynamicText(), which is skewed enough to get its own codes
+static const unsigned char dynamicStream[] = {
+	0x45, 0x8C, 0x81, 0x0D, 0x00, 0x20, 0x0C, 0xC2, 0x6E, 0xA5, 0xFD, 0xFF, 0x07, 0x65, 0x6A, 0x5C,
+	0xB6, 0xD0, 0x85, 0x80, 0x42, 0x12, 0x32, 0x52, 0xF8, 0xB3, 0x59, 0xBA, 0xF5, 0xB8, 0xDE, 0x61,
+	0x71, 0xA4, 0xEF, 0x8D, 0x4C, 0x51, 0x4F, 0xF3, 0xDA, 0xC2, 0x02
+};
+
+// 96 letters from a small LCG, mostly 'a'
+static std::string MakeDynamicText()
+{
+	std::string text;
+	unsigned int x = 12345;
+	for (int i = 0; i < 96; i++)
+	{
+		x = (x * 1103515245u + 12345u) & 0x7FFFFFFF;
+		text += "aaaabbc"[(x >> 16) % 7];
+	}
+	return text;
+}
+
+static bool InflateAll(const unsigned char* data, size_t size, std::string& text, std::string& error)
+{
+	std::vector<unsigned char> output;
+	if (!Inflate(data, size, output, error))
+		return false;
+
+	text.assign(output.begin(), output.end());
+	return true;
+}
+
+TEST(InflateStoredBlock)
+{
+	CHECK((storedStream[0] >> 1 & 3) == 0);
+
+	std::string text, error;
+	CHECK(InflateAll(storedStream, sizeof(storedStream), text, error));
+	CHECK(text == "Stored block");
+}
+
+TEST(InflateFixedHuffmanBlock)
+{
+	CHECK((fixedStream[0] >> 1 & 3) == 1);
+
+	std::string text, error;
+	CHECK(InflateAll(fixedStream, sizeof(fixedStream), text, error));
+	CHECK(text == "abcabcabcabcabcabc");
+}
+
+TEST(InflateDynamicHuffmanBlock)
+{
+	CHECK((dynamicStream[0] >> 1 & 3) == 2);
+
+	std::string text, error;
+	CHECK(InflateAll(dynamicStream, sizeof(dynamicStream), text, error));
+	CHECK(text == MakeDynamicText());
+}
+
+TEST(InflateAppendsToOutput)
+{
+	std::vector<unsigned char> output = { 'x' };
+	std::string error;
+	CHECK(Inflate(fixedStream, sizeof(fixedStream), output, error));
+	CHECK(output.size() == 19 && output[0] == 'x' && output[1] == 'a');
+}
+
+TEST(InflateRejectsBadStreams)
+{
+	std::string text, error;
+
+	// Cut short, in the data and in the header
+	CHECK(!InflateAll(storedStream, sizeof(storedStream) - 3, text, error));
+	CHECK(!error.empty());
+	error.clear();
+	CHECK(!InflateAll(dynamicStream, sizeof(dynamicStream) / 2, text, error));
+	CHECK(!error.empty());
+	error.clear();
+	CHECK(!InflateAll(dynamicStream, 4, text, error));
+	CHECK(!error.empty());
+
+	// Stored length doesn't match its complement
+	unsigned char stored[sizeof(storedStream)];
+	memcpy(stored, storedStream, sizeof(stored));
+	stored[3] ^= 0x01;
+	CHECK(!InflateAll(stored, sizeof(stored), text, error));
+
+	// Block type 3 is reserved
+	const unsigned char reserved[] = { 0x07, 0x00 };
+	CHECK(!InflateAll(reserved, sizeof(reserved), text, error));
+
+	// Too many length codes: HLIT of 31 means 288
+	const unsigned char tooMany[] = { 0xFD, 0x00, 0x00, 0x00 };
+	CHECK(!InflateAll(tooMany, sizeof(tooMany), text, error));
+}
+
+// --------------------------------------------------------
+// PNGs built in code.  The image data goes in one stored
+// deflate block, so each row's filter byte and filtered
+// bytes are exactly what the test wrote.  The decoder
+// doesn't check CRCs or the adler32, so those are zero.
+// --------------------------------------------------------
+static void PutBigEndian32(std::vector<unsigned char>& bytes, unsigned int value)
+{
+	for (int i = 3; i >= 0; i--)
+		bytes.push_back((unsigned char)(value >> (i * 8)));
+}
+
+static void PutChunk(std::vector<unsigned char>& png, const char* type, const std::vector<unsigned char>& body)
+{
+	PutBigEndian32(png, (unsigned int)body.size());
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), body.begin(), body.end());
+	PutBigEndian32(png, 0);
+}
+
+static std::vector<unsigned char> MakePng(unsigned int width, unsigned int height, unsigned char colorType, const std::vector<unsigned char>& filtered)
+{
+	std::vector<unsigned char> png = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+
+	std::vector<unsigned char> header;
+	PutBigEndian32(header, width);
+	PutBigEndian32(header, height);
+	header.insert(header.end(), { 8, colorType, 0, 0, 0 });
+	PutChunk(png, "IHDR", header);
+
+	unsigned int length = (unsigned int)filtered.size();
+	std::vector<unsigned char> data = { 0x78, 0x01, 0x01 };
+	data.insert(data.end(), { (unsigned char)length, (unsigned char)(length >> 8), (unsigned char)~length, (unsigned char)(~length >> 8) });
+	data.insert(data.end(), filtered.begin(), filtered.end());
+	PutBigEndian32(data, 0);
+	PutChunk(png, "IDAT", data);
+
+	PutChunk(png, "IEND", {});
+	return png;
+}
+
+// Independent of the decoder's own, to check against
+static int PaethPredict(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	if (pa <= pb && pa <= pc) return a;
+	return pb <= pc ? b : c;
+}
+
+// Applies one filter type to every row of RGBA8 pixels
+static std::vector<unsigned char> FilterRows(const std::vector<unsigned char>& pixels, unsigned int width, unsigned int height, unsigned char filter)
+{
+	const unsigned int stride = 4;
+	unsigned int rowBytes = width * stride;
+	std::vector<unsigned char> filtered;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		filtered.push_back(filter);
+		const unsigned char* row = &pixels[y * rowBytes];
+		const unsigned char* prior = y > 0 ? row - rowBytes : 0;
+		for (unsigned int x = 0; x < rowBytes; x++)
+		{
+			int a = x >= stride ? row[x - stride] : 0;
+			int b = prior ? prior[x] : 0;
+			int c = prior && x >= stride ? prior[x - stride] : 0;
+
+			int predicted = 0;
+			switch (filter)
+			{
+			case 1: predicted = a; break;
+			case 2: predicted = b; break;
+			case 3: predicted = (a + b) >> 1; break;
+			case 4: predicted = PaethPredict(a, b, c); break;
+			}
+			filtered.push_back((unsigned char)(row[x] - predicted));
+		}
+	}
+	return filtered;
+}
+
+TEST(DecodePngUndoesEachFilter)
+{
+	// Gradients in every channel, so no predictor is trivially right
+	const unsigned int width = 5, height = 4;
+	std::vector<unsigned char> pixels(width * height * 4);
+	for (unsigned int i = 0; i < pixels.size(); i++)
+		pixels[i] = (unsigned char)(i * 37 + (i / 20) * 11);
+
+	for (unsigned char filter = 0; filter <= 4; filter++)
+	{
+		std::vector<unsigned char> png = MakePng(width, height, 6, FilterRows(pixels, width, height, filter));
+
+		DecodedImage image;
+		std::string error;
+		CHECK(DecodePng(png.data(), png.size(), image, error));
+		CHECK(image.Width == width && image.Height == height);
+		CHECK(image.Pixels == pixels);
+	}
+}
+
+TEST(DecodePngExpandsRgbToRgba)
+{
+	std::vector<unsigned char> filtered = { 0, 10, 20, 30, 40, 50, 60 };
+	std::vector<unsigned char> png = MakePng(2, 1, 2, filtered);
+
+	DecodedImage image;
+	std::string error;
+	CHECK(DecodePng(png.data(), png.size(), image, error));
+	const std::vector<unsigned char> expected = { 10, 20, 30, 255, 40, 50, 60, 255 };
+	CHECK(image.Pixels == expected);
+
+	unsigned int width = 0, height = 0;
+	CHECK(ReadPngSize(png.data(), png.size(), width, height));
+	CHECK(width == 2 && height == 1);
+}
+
+TEST(DecodePngRejectsBadFiles)
+{
+	std::vector<unsigned char> pixels(2 * 2 * 4, 128);
+	std::vector<unsigned char> png = MakePng(2, 2, 6, FilterRows(pixels, 2, 2, 0));
+	DecodedImage image;
+	std::string error;
+
+	// Signature
+	std::vector<unsigned char> notPng = png;
+	notPng[1] = 'J';
+	CHECK(!DecodePng(notPng.data(), notPng.size(), image, error));
+
+	// Chunk running past the end of the file
+	CHECK(!DecodePng(png.data(), png.size() - 20, image, error));
+
+	// Less image data than the header promises
+	std::vector<unsigned char> tooShort = MakePng(2, 3, 6, FilterRows(pixels, 2, 2, 0));
+	CHECK(!DecodePng(tooShort.data(), tooShort.size(), image, error));
+
+	// Unknown row filter
+	std::vector<unsigned char> badFilter = MakePng(2, 2, 6, FilterRows(pixels, 2, 2, 5));
+	CHECK(!DecodePng(badFilter.data(), badFilter.size(), image, error));
+
+	// Interlaced, flagged in the last IHDR byte
+	std::vector<unsigned char> interlaced = png;
+	interlaced[8 + 8 + 12] = 1;
+	CHECK(!DecodePng(interlaced.data(), interlaced.size(), image, error));
+	CHECK(error == "Interlaced PNGs aren't supported");
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+
+#include "StateCache.h"
+
+// --------------------------------------------------------
+// An IStateSink that records every call it receives instead
+// of forwarding them to a device context, so StateCache can
+// be checked without a GPU
+// --------------------------------------------------------
+class RecordingStateSink : public IStateSink
+{
+public:
+	struct Call
+	{
+		StateCall Kind;
+		StateStage Stage;
+		unsigned int Slot;
+		const void* Object;
+	};
+
+	std::vector<Call> Calls;
+
+	void SetShader(StateStage stage, const void* shader) override { Record(STATE_CALL_SHADER, stage, 0, shader); }
+	void SetInputLayout(const void* layout) override { Record(STATE_CALL_INPUT_LAYOUT, STATE_STAGE_VERTEX, 0, layout); }
+	void SetConstantBuffer(StateStage stage, unsigned int slot, const void* buffer, unsigned int, unsigned int) override { Record(STATE_CALL_CONSTANT_BUFFER, stage, slot, buffer); }
+	void SetShaderResource(StateStage stage, unsigned int slot, const void* srv) override { Record(STATE_CALL_SHADER_RESOURCE, stage, slot, srv); }
+	void ClearShaderResources(StateStage stage, unsigned int firstSlot, unsigned int) override { Record(STATE_CALL_SHADER_RESOURCE, stage, firstSlot, 0); }
+	void SetSampler(StateStage stage, unsigned int slot, const void* sampler) override { Record(STATE_CALL_SAMPLER, stage, slot, sampler); }
+	void SetRasterState(const void* state) override { Record(STATE_CALL_RASTER, STATE_STAGE_VERTEX, 0, state); }
+	void SetDepthState(const void* state, unsigned int) override { Record(STATE_CALL_DEPTH, STATE_STAGE_PIXEL, 0, state); }
+	void SetBlendState(const void* state) override { Record(STATE_CALL_BLEND, STATE_STAGE_PIXEL, 0, state); }
+	void SetTopology(unsigned int) override { Record(STATE_CALL_TOPOLOGY, STATE_STAGE_VERTEX, 0, 0); }
+	void SetVertexBuffer(unsigned int slot, const void* buffer, unsigned int, unsigned int) override { Record(STATE_CALL_VERTEX_BUFFER, STATE_STAGE_VERTEX, slot, buffer); }
+	void SetIndexBuffer(const void* buffer, unsigned int, unsigned int) override { Record(STATE_CALL_INDEX_BUFFER, STATE_STAGE_VERTEX, 0, buffer); }
+	void SetRenderTarget(const void* rtv, const void*) override { Record(STATE_CALL_RENDER_TARGETS, STATE_STAGE_PIXEL, 0, rtv); }
+
+	// Number of recorded calls of one kind
+	unsigned int Count(StateCall kind) const
+	{
+		unsigned int count = 0;
+		for (const Call& call : Calls)
+			count += call.Kind == kind;
+		return count;
+	}
+
+private:
+	void Record(StateCall kind, StateStage stage, unsigned int slot, const void* object)
+	{
+		Calls.push_back({ kind, stage, slot, object });
+	}
+};
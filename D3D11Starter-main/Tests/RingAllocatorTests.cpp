@@ -0,0 +1,118 @@
+#include "TestFramework.h"
+#include "RingAllocator.h"
+
+// --------------------------------------------------------
+// Stands in for the GPU fence: frames are signalled with
+// increasing values, and the "GPU" finishes them only when
+// the test says so
+// --------------------------------------------------------
+struct FakeFence
+{
+	unsigned long long Signalled = 0;
+	unsigned long long Completed = 0;
+
+	unsigned long long Signal() { return ++Signalled; }
+	void CompleteUpTo(unsigned long long value) { Completed = value; }
+};
+
+TEST(RingAllocatorAlignsSizes)
+{
+	RingAllocator ring(4096);
+	CHECK(ring.GetCapacity() == 4096);
+	CHECK(ring.Allocate(1) == 0);
+	CHECK(ring.Allocate(300) == 256);
+	CHECK(ring.Allocate(256) == 768);
+	CHECK(ring.GetUsedBytes() == 1024);
+	CHECK(ring.AlignSize(257) == 512);
+
+	// Capacity is trimmed to a whole number of alignments
+	RingAllocator odd(1000);
+	CHECK(odd.GetCapacity() == 768);
+}
+
+TEST(RingAllocatorRejectsBadSizes)
+{
+	RingAllocator ring(1024);
+	CHECK(ring.Allocate(0) == RingAllocator::InvalidOffset);
+	CHECK(ring.Allocate(1025) == RingAllocator::InvalidOffset);
+	CHECK(ring.GetFailedAllocationCount() == 2);
+	CHECK(ring.GetUsedBytes() == 0);
+	CHECK(ring.Allocate(1024) == 0);
+}
+
+TEST(RingAllocatorWrapChargesCurrentFrame)
+{
+	FakeFence fence;
+	RingAllocator ring(1024);
+
+	CHECK(ring.Allocate(512) == 0);
+	ring.EndFrame(fence.Signal());
+	CHECK(ring.Allocate(256) == 512);
+
+	fence.CompleteUpTo(1);
+	ring.Retire(fence.Completed);
+	CHECK(ring.GetTail() == 512);
+	CHECK(ring.GetUsedBytes() == 256);
+
+	// Only 256 bytes left at the end, so this wraps to the front
+	// and the skipped 256 are charged to the frame in progress
+	CHECK(ring.Allocate(512) == 0);
+	CHECK(ring.GetWrapCount() == 1);
+	CHECK(ring.GetUsedBytes() == 1024);
+	CHECK(ring.Allocate(1) == RingAllocator::InvalidOffset);
+
+	// Retiring that one frame gives everything back, skipped bytes included
+	ring.EndFrame(fence.Signal());
+	fence.CompleteUpTo(2);
+	ring.Retire(fence.Completed);
+	CHECK(ring.GetUsedBytes() == 0);
+	CHECK(ring.GetFramesInFlight() == 0);
+}
+
+TEST(RingAllocatorWaitsForFullRing)
+{
+	FakeFence fence;
+	RingAllocator ring(1024);
+
+	CHECK(ring.Allocate(1024) == 0);
+	CHECK(ring.Allocate(1) == RingAllocator::InvalidOffset);
+	ring.EndFrame(fence.Signal());
+
+	// Still in flight, so nothing is freed
+	ring.Retire(fence.Completed);
+	CHECK(ring.Allocate(256) == RingAllocator::InvalidOffset);
+	CHECK(ring.GetFailedAllocationCount() == 2);
+
+	fence.CompleteUpTo(1);
+	ring.Retire(fence.Completed);
+	CHECK(ring.Allocate(256) == 0);
+	CHECK(ring.GetAllocationCount() == 2);
+}
+
+TEST(RingAllocatorRetiresFramesInOrder)
+{
+	FakeFence fence;
+	RingAllocator ring(4096);
+
+	for (unsigned int frame = 0; frame < 4; frame++)
+	{
+		CHECK(ring.Allocate(256 * (frame + 1)) != RingAllocator::InvalidOffset);
+		ring.EndFrame(fence.Signal());
+	}
+	CHECK(ring.GetFramesInFlight() == 4);
+	CHECK(ring.GetUsedBytes() == 2560);
+
+	fence.CompleteUpTo(2);
+	ring.Retire(fence.Completed);
+	CHECK(ring.GetFramesInFlight() == 2);
+	CHECK(ring.GetUsedBytes() == 1792);
+	CHECK(ring.GetTail() == 768);
+
+	fence.CompleteUpTo(4);
+	ring.Retire(fence.Completed);
+	CHECK(ring.GetFramesInFlight() == 0);
+	CHECK(ring.GetUsedBytes() == 0);
+
+	// An empty ring starts over at the front
+	CHECK(ring.Allocate(256) == 0);
+}
@@ -0,0 +1,184 @@
+#include "TestFramework.h"
+#include "ShaderReflectionData.h"
+#include <cstring>
+
+// Roughly what VertexShader.hlsl reflects to
+static ShaderReflectionData MakeReflection()
+{
+	ShaderReflectionData data;
+	data.BytecodeHash = 0x0123456789abcdefull;
+	data.ThreadGroupSize[0] = 8;
+	data.ThreadGroupSize[1] = 4;
+	data.ThreadGroupSize[2] = 1;
+
+	ShaderReflectionBuffer& perFrame = data.ConstantBuffers.emplace_back();
+	perFrame.Name = "PerFrame";
+	perFrame.BindIndex = 0;
+	perFrame.Size = 128;
+	perFrame.Variables.push_back({ "viewMat", 0, 64 });
+	perFrame.Variables.push_back({ "projMat", 64, 64 });
+
+	ShaderReflectionBuffer& perObject = data.ConstantBuffers.emplace_back();
+	perObject.Name = "PerObject";
+	perObject.BindIndex = 1;
+	perObject.Size = 80;
+	perObject.Variables.push_back({ "world", 0, 64 });
+	perObject.Variables.push_back({ "tint", 64, 12 });
+
+	data.Resources.push_back({ "Albedo", SHADER_RESOURCE_TEXTURE, 0 });
+	data.Resources.push_back({ "BasicSampler", SHADER_RESOURCE_SAMPLER, 0 });
+	data.InputParameters.push_back({ "POSITION", 0, 7, 3 });
+	data.InputParameters.push_back({ "TEXCOORD", 1, 3, 3 });
+	return data;
+}
+
+static void PatchU32(std::vector<unsigned char>& bytes, size_t offset, unsigned int value)
+{
+	for (int i = 0; i < 4; i++)
+		bytes[offset + i] = (unsigned char)(value >> (i * 8));
+}
+
+TEST(ShaderReflectionRoundTrips)
+{
+	ShaderReflectionData original = MakeReflection();
+	std::vector<unsigned char> bytes;
+	SerializeShaderReflection(original, bytes);
+
+	ShaderReflectionData loaded;
+	CHECK(DeserializeShaderReflection(bytes.data(), bytes.size(), original.BytecodeHash, loaded));
+	CHECK(loaded.BytecodeHash == original.BytecodeHash);
+	CHECK(loaded.ThreadGroupSize[0] == 8 && loaded.ThreadGroupSize[1] == 4 && loaded.ThreadGroupSize[2] == 1);
+
+	CHECK(loaded.ConstantBuffers.size() == 2);
+	if (loaded.ConstantBuffers.size() == 2)
+	{
+		const ShaderReflectionBuffer& cb = loaded.ConstantBuffers[1];
+		CHECK(cb.Name == "PerObject" && cb.BindIndex == 1 && cb.Size == 80);
+		CHECK(cb.Variables.size() == 2);
+		if (cb.Variables.size() == 2)
+			CHECK(cb.Variables[1].Name == "tint" && cb.Variables[1].ByteOffset == 64 && cb.Variables[1].Size == 12);
+	}
+
+	CHECK(loaded.Resources.size() == 2);
+	if (loaded.Resources.size() == 2)
+		CHECK(loaded.Resources[1].Name == "BasicSampler" && loaded.Resources[1].Kind == SHADER_RESOURCE_SAMPLER);
+
+	CHECK(loaded.InputParameters.size() == 2);
+	if (loaded.InputParameters.size() == 2)
+		CHECK(loaded.InputParameters[1].SemanticName == "TEXCOORD" && loaded.InputParameters[1].SemanticIndex == 1 && loaded.InputParameters[1].Mask == 3);
+
+	// Writing it again gives the same bytes
+	std::vector<unsigned char> again;
+	SerializeShaderReflection(loaded, again);
+	CHECK(again == bytes);
+}
+
+TEST(ShaderReflectionRejectsTruncatedData)
+{
+	ShaderReflectionData original = MakeReflection();
+	std::vector<unsigned char> bytes;
+	SerializeShaderReflection(original, bytes);
+
+	unsigned int accepted = 0;
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		ShaderReflectionData loaded;
+		accepted += DeserializeShaderReflection(bytes.data(), size, original.BytecodeHash, loaded);
+	}
+	CHECK(accepted == 0);
+
+	// Trailing bytes are just as wrong
+	bytes.push_back(0);
+	ShaderReflectionData loaded;
+	CHECK(!DeserializeShaderReflection(bytes.data(), bytes.size(), original.BytecodeHash, loaded));
+}
+
+TEST(ShaderReflectionRejectsOtherBytecode)
+{
+	ShaderReflectionData original = MakeReflection();
+	std::vector<unsigned char> bytes;
+	SerializeShaderReflection(original, bytes);
+
+	// A failed load leaves the output alone
+	ShaderReflectionData loaded;
+	loaded.BytecodeHash = 42;
+	CHECK(!DeserializeShaderReflection(bytes.data(), bytes.size(), original.BytecodeHash + 1, loaded));
+	CHECK(loaded.BytecodeHash == 42);
+
+	// So does a different magic or version
+	std::vector<unsigned char> wrongVersion = bytes;
+	PatchU32(wrongVersion, 4, 999);
+	CHECK(!DeserializeShaderReflection(wrongVersion.data(), wrongVersion.size(), original.BytecodeHash, loaded));
+}
+
+TEST(ShaderReflectionRejectsCorruptCounts)
+{
+	ShaderReflectionData original = MakeReflection();
+	std::vector<unsigned char> bytes;
+	SerializeShaderReflection(original, bytes);
+
+	// magic, version, hash and thread group size come first
+	const size_t bufferCountOffset = 4 + 4 + 8 + 12;
+	const size_t firstNameOffset = bufferCountOffset + 4;
+	const size_t firstBufferSizeOffset = firstNameOffset + 4 + strlen("PerFrame") + 8;
+	ShaderReflectionData loaded;
+
+	std::vector<unsigned char> corrupt = bytes;
+	PatchU32(corrupt, bufferCountOffset, 0xFFFFFFFF);
+	CHECK(!DeserializeShaderReflection(corrupt.data(), corrupt.size(), original.BytecodeHash, loaded));
+
+	corrupt = bytes;
+	PatchU32(corrupt, bufferCountOffset, 3);
+	CHECK(!DeserializeShaderReflection(corrupt.data(), corrupt.size(), original.BytecodeHash, loaded));
+
+	corrupt = bytes;
+	PatchU32(corrupt, firstNameOffset, 0x7FFFFFFF);
+	CHECK(!DeserializeShaderReflection(corrupt.data(), corrupt.size(), original.BytecodeHash, loaded));
+
+	// A buffer too small for its variables
+	corrupt = bytes;
+	PatchU32(corrupt, firstBufferSizeOffset, 100);
+	CHECK(!DeserializeShaderReflection(corrupt.data(), corrupt.size(), original.BytecodeHash, loaded));
+}
+
+TEST(ShaderReflectionSidecarFile)
+{
+	ShaderReflectionData original = MakeReflection();
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "ShaderReflectionDataTests";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+
+	std::filesystem::path path = GetShaderReflectionPath(directory / "VertexShader.cso");
+	CHECK(path.filename() == "VertexShader.refl");
+	CHECK(SaveShaderReflection(path, original));
+
+	ShaderReflectionData loaded;
+	CHECK(LoadShaderReflection(path, original.BytecodeHash, loaded));
+	CHECK(loaded.ConstantBuffers.size() == 2);
+
+	// The temporary file was renamed away
+	unsigned int files = 0;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory))
+		files += entry.is_regular_file();
+	CHECK(files == 1);
+
+	std::filesystem::remove_all(directory);
+}
+
+TEST(BuildShaderVariableTableResolvesHandles)
+{
+	ShaderVariableTable table;
+	table.Add("stale", 9, 9, 9); // Cleared by the build
+	BuildShaderVariableTable(MakeReflection(), table);
+	CHECK(table.GetCount() == 4);
+
+	ShaderVarHandle projMat = table.Find("projMat");
+	CHECK(projMat.IsValid());
+	CHECK(projMat.ConstantBufferIndex == 0 && projMat.ByteOffset == 64 && projMat.Size == 64);
+
+	ShaderVarHandle tint = table.Find(ShaderNameHash("tint"));
+	CHECK(tint.ConstantBufferIndex == 1 && tint.ByteOffset == 64 && tint.Size == 12);
+
+	CHECK(!table.Find("stale").IsValid());
+	CHECK(!table.Find("lightView").IsValid());
+}
@@ -0,0 +1,111 @@
+#include "TestFramework.h"
+#include "ShaderVariableTable.h"
+#include <cstdio>
+
+// Two names with the same FNV-1a hash, found by brute force
+static const char* collidingA = "var_moczf";
+static const char* collidingB = "var_wfbpp";
+
+TEST(ShaderVariableTableFindsByNameAndHash)
+{
+	ShaderVariableTable table;
+	table.Add("viewMat", 0, 0, 64);
+	table.Add("projMat", 0, 64, 64);
+	table.Add("world", 1, 0, 64);
+	table.Add("worldInvTranspose", 1, 64, 64);
+	CHECK(table.GetCount() == 4);
+	CHECK(!table.HasCollisions());
+
+	ShaderVarHandle byName = table.Find(std::string("worldInvTranspose"));
+	CHECK(byName.IsValid());
+	CHECK(byName.ConstantBufferIndex == 1 && byName.ByteOffset == 64 && byName.Size == 64);
+
+	constexpr unsigned int projHash = ShaderNameHash("projMat");
+	ShaderVarHandle byHash = table.Find(projHash);
+	CHECK(byHash.IsValid());
+	CHECK(byHash.ConstantBufferIndex == 0 && byHash.ByteOffset == 64);
+}
+
+TEST(ShaderVariableTableSearchesLargeTables)
+{
+	// More than eight entries switches from a scan to a binary search
+	ShaderVariableTable table;
+	for (unsigned int i = 0; i < 32; i++)
+		table.Add("var" + std::to_string(i), 0, i * 16, 16);
+	CHECK(table.GetCount() == 32);
+
+	for (unsigned int i = 0; i < 32; i++)
+	{
+		std::string name = "var" + std::to_string(i);
+		CHECK(table.Find(name).ByteOffset == i * 16);
+		CHECK(table.Find(ShaderNameHash(name.c_str())).ByteOffset == i * 16);
+	}
+}
+
+TEST(ShaderVariableTableKeepsFirstDuplicate)
+{
+	ShaderVariableTable table;
+	table.Add("world", 1, 0, 64);
+	table.Add("world", 2, 128, 16);
+	CHECK(table.GetCount() == 1);
+	CHECK(!table.HasCollisions());
+
+	ShaderVarHandle handle = table.Find(std::string("world"));
+	CHECK(handle.ConstantBufferIndex == 1 && handle.ByteOffset == 0 && handle.Size == 64);
+	CHECK(table.Find(ShaderNameHash("world")).IsValid());
+}
+
+TEST(ShaderVariableTableRefusesAmbiguousHashes)
+{
+	CHECK(ShaderNameHash(collidingA) == ShaderNameHash(collidingB));
+
+	ShaderVariableTable table;
+	table.Add("world", 1, 0, 64);
+	table.Add(collidingA, 0, 16, 16);
+	table.Add(collidingB, 0, 32, 16);
+	CHECK(table.GetCount() == 3);
+	CHECK(table.HasCollisions());
+
+	// The hash alone can't tell them apart, so it's refused
+	CHECK(!table.Find(ShaderNameHash(collidingA)).IsValid());
+
+	// Names still resolve, and unrelated hashes are unaffected
+	CHECK(table.Find(std::string(collidingA)).ByteOffset == 16);
+	CHECK(table.Find(std::string(collidingB)).ByteOffset == 32);
+	CHECK(table.Find(ShaderNameHash("world")).IsValid());
+
+	// Re-adding a colliding name is still just a duplicate
+	table.Add(collidingB, 0, 48, 16);
+	CHECK(table.GetCount() == 3);
+	CHECK(table.Find(std::string(collidingB)).ByteOffset == 32);
+
+	table.Clear();
+	CHECK(table.GetCount() == 0 && !table.HasCollisions());
+}
+
+TEST(ShaderVariableTableInvalidHandles)
+{
+	ShaderVariableTable table;
+	CHECK(!table.Find(std::string("world")).IsValid());
+	CHECK(!table.Find(ShaderNameHash("world")).IsValid());
+
+	table.Add("world", 1, 0, 64);
+	CHECK(!table.Find(std::string("worl")).IsValid());
+	CHECK(!table.Find(std::string("")).IsValid());
+	CHECK(!table.Find(ShaderNameHash("view")).IsValid());
+	CHECK(!ShaderVarHandle().IsValid());
+}
+
+TEST(ShaderVariableBenchmarkRuns)
+{
+	// Only checks that it works - the timings are printed for
+	// comparison, since a test machine's numbers vary too much
+	ShaderVariableBenchmarkResults results = ShaderVariableBenchmark(100000);
+	CHECK(results.Iterations == 100000);
+	CHECK(results.StringLookupNs > 0);
+	CHECK(results.HashLookupNs > 0);
+	CHECK(results.HandleNs > 0);
+
+	printf("  string %.1f ns, hash %.1f ns, handle %.1f ns per set\n",
+		results.StringLookupNs, results.HashLookupNs, results.HandleNs);
+}
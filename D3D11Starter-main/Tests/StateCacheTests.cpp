@@ -0,0 +1,104 @@
+#include "TestFramework.h"
+#include "RecordingStateSink.h"
+
+// Stand-ins for D3D objects - StateCache only compares pointers
+static int shaderA, shaderB, texture, sampler, buffer;
+
+TEST(StateCacheFiltersRedundantBinds)
+{
+	std::shared_ptr<RecordingStateSink> sink = std::make_shared<RecordingStateSink>();
+	StateCache cache(sink);
+
+	// Three entities sharing a material
+	for (int i = 0; i < 3; i++)
+	{
+		cache.SetShader(STATE_STAGE_VERTEX, &shaderA);
+		cache.SetShader(STATE_STAGE_PIXEL, &shaderB);
+		cache.SetShaderResource(STATE_STAGE_PIXEL, 0, &texture);
+		cache.SetSampler(STATE_STAGE_PIXEL, 0, &sampler);
+		cache.SetTopology(4);
+	}
+
+	CHECK(sink->Count(STATE_CALL_SHADER) == 2);
+	CHECK(sink->Count(STATE_CALL_SHADER_RESOURCE) == 1);
+	CHECK(sink->Count(STATE_CALL_SAMPLER) == 1);
+	CHECK(sink->Count(STATE_CALL_TOPOLOGY) == 1);
+	CHECK(cache.GetTotalIssued() == 5);
+	CHECK(cache.GetTotalFiltered() == 10);
+	CHECK(cache.GetFilteredCount(STATE_CALL_SHADER) == 4);
+}
+
+TEST(StateCachePassesChangedBinds)
+{
+	std::shared_ptr<RecordingStateSink> sink = std::make_shared<RecordingStateSink>();
+	StateCache cache(sink);
+
+	cache.SetShader(STATE_STAGE_PIXEL, &shaderA);
+	cache.SetShader(STATE_STAGE_PIXEL, &shaderB);
+	cache.SetShader(STATE_STAGE_VERTEX, &shaderB); // Other stage, own slot
+
+	// Same buffer at a new offset is a different binding
+	cache.SetConstantBuffer(STATE_STAGE_VERTEX, 1, &buffer, 0, 16);
+	cache.SetConstantBuffer(STATE_STAGE_VERTEX, 1, &buffer, 16, 16);
+	cache.SetConstantBuffer(STATE_STAGE_VERTEX, 1, &buffer, 16, 16);
+
+	CHECK(sink->Count(STATE_CALL_SHADER) == 3);
+	CHECK(sink->Count(STATE_CALL_CONSTANT_BUFFER) == 2);
+	CHECK(sink->Calls.back().Slot == 1);
+	CHECK(cache.GetTotalFiltered() == 1);
+}
+
+TEST(StateCacheRenderTargetForgetsShaderResources)
+{
+	std::shared_ptr<RecordingStateSink> sink = std::make_shared<RecordingStateSink>();
+	StateCache cache(sink);
+
+	cache.SetShader(STATE_STAGE_PIXEL, &shaderA);
+	cache.SetShaderResource(STATE_STAGE_PIXEL, 3, &texture);
+	cache.SetRenderTarget(&texture, 0);
+	cache.SetRenderTarget(&texture, 0); // Never filtered
+	cache.SetShaderResource(STATE_STAGE_PIXEL, 3, &texture);
+	cache.SetShader(STATE_STAGE_PIXEL, &shaderA);
+
+	CHECK(sink->Count(STATE_CALL_RENDER_TARGETS) == 2);
+	CHECK(sink->Count(STATE_CALL_SHADER_RESOURCE) == 2);
+	CHECK(sink->Count(STATE_CALL_SHADER) == 1);
+}
+
+TEST(StateCacheClearSkipsEmptySlots)
+{
+	std::shared_ptr<RecordingStateSink> sink = std::make_shared<RecordingStateSink>();
+	StateCache cache(sink);
+
+	cache.ClearShaderResources(STATE_STAGE_PIXEL, 0, 16);
+	cache.ClearShaderResources(STATE_STAGE_PIXEL, 0, 16);
+	cache.ClearShaderResources(STATE_STAGE_PIXEL, 0, 8);
+	cache.SetShaderResource(STATE_STAGE_PIXEL, 0, 0);
+	cache.SetShaderResource(STATE_STAGE_PIXEL, 2, &texture);
+	cache.ClearShaderResources(STATE_STAGE_PIXEL, 0, 8);
+
+	CHECK(sink->Calls.size() == 3);
+	CHECK(sink->Count(STATE_CALL_SHADER_RESOURCE) == 3);
+}
+
+TEST(StateCacheInvalidateAndDisable)
+{
+	std::shared_ptr<RecordingStateSink> sink = std::make_shared<RecordingStateSink>();
+	StateCache cache(sink);
+
+	cache.SetRasterState(&shaderA);
+	cache.Invalidate();
+	cache.SetRasterState(&shaderA);
+	CHECK(sink->Count(STATE_CALL_RASTER) == 2);
+
+	// With filtering off every call reaches the sink, and is counted
+	cache.SetEnabled(false);
+	cache.SetBlendState(&shaderB);
+	cache.SetBlendState(&shaderB);
+	CHECK(sink->Count(STATE_CALL_BLEND) == 2);
+	CHECK(cache.GetIssuedCount(STATE_CALL_BLEND) == 2);
+	CHECK(cache.GetTotalFiltered() == 0);
+
+	cache.ResetStats();
+	CHECK(cache.GetTotalIssued() == 0);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+
+// --------------------------------------------------------
+// Just enough of a test runner for the CPU-side modules.
+//
+// TEST(Name) { ... } registers a test, CHECK() records a
+// failure and keeps going, and TestMain.cpp runs every test
+// and returns non-zero if any check failed.
+// --------------------------------------------------------
+struct TestCase
+{
+	const char* Name;
+	void (*Run)();
+};
+
+std::vector<TestCase>& GetTestCases();
+void ReportCheckFailure(const char* file, int line, const char* expression);
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, void (*run)()) { GetTestCases().push_back({ name, run }); }
+};
+
+#define TEST(Name) \
+	static void Name(); \
+	static TestRegistrar Name##Registrar(#Name, Name); \
+	static void Name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) ReportCheckFailure(__FILE__, __LINE__, #expression); } while (0)
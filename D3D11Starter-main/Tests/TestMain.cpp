@@ -0,0 +1,35 @@
+#include "TestFramework.h"
+#include <cstdio>
+
+static unsigned int checkFailures = 0;
+
+std::vector<TestCase>& GetTestCases()
+{
+	// Function-local so registration order across files doesn't matter
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+void ReportCheckFailure(const char* file, int line, const char* expression)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+	checkFailures++;
+}
+
+int main()
+{
+	unsigned int failedTests = 0;
+	for (const TestCase& test : GetTestCases())
+	{
+		unsigned int before = checkFailures;
+		test.Run();
+
+		bool passed = checkFailures == before;
+		printf("%s %s\n", passed ? "[pass]" : "[FAIL]", test.Name);
+		if (!passed)
+			failedTests++;
+	}
+
+	printf("\n%zu tests, %u failed\n", GetTestCases().size(), failedTests);
+	return failedTests == 0 ? 0 : 1;
+}
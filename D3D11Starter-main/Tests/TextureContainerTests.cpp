@@ -0,0 +1,154 @@
+#include "TestFramework.h"
+#include "TextureContainer.h"
+#include <cstring>
+
+static void Put32(std::vector<unsigned char>& bytes, unsigned int value)
+{
+	for (int i = 0; i < 4; i++)
+		bytes.push_back((unsigned char)(value >> (i * 8)));
+}
+
+static void Put64(std::vector<unsigned char>& bytes, unsigned long long value)
+{
+	Put32(bytes, (unsigned int)value);
+	Put32(bytes, (unsigned int)(value >> 32));
+}
+
+// --------------------------------------------------------
+// An 8x8 RGBA8 KTX2 array with two layers.  Levels are
+// stored smallest first, as KTX2 requires, and every byte
+// of a surface is layer * 16 + mip.
+// --------------------------------------------------------
+static std::vector<unsigned char> MakeKtx2(unsigned int vkFormat, unsigned int levels)
+{
+	std::vector<unsigned char> file = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	Put32(file, vkFormat);
+	Put32(file, 1);      // Type size
+	Put32(file, 8);      // Width
+	Put32(file, 8);      // Height
+	Put32(file, 0);      // Depth
+	Put32(file, 2);      // Layers
+	Put32(file, 1);      // Faces
+	Put32(file, levels);
+	Put32(file, 0);      // No supercompression
+	for (int i = 0; i < 4; i++)
+		Put32(file, 0);  // DFD and KVD
+	Put64(file, 0);      // SGD
+	Put64(file, 0);
+
+	size_t index = file.size();
+	file.resize(index + levels * 24);
+
+	std::vector<unsigned long long> offsets(levels);
+	for (int mip = (int)levels - 1; mip >= 0; mip--)
+	{
+		while (file.size() % 4)
+			file.push_back(0);
+		offsets[mip] = file.size();
+
+		unsigned int size = 8 >> mip;
+		for (unsigned int layer = 0; layer < 2; layer++)
+			file.insert(file.end(), size * size * 4, (unsigned char)(layer * 16 + mip));
+	}
+
+	for (unsigned int mip = 0; mip < levels; mip++)
+	{
+		unsigned int size = 8 >> mip;
+		std::vector<unsigned char> entry;
+		Put64(entry, offsets[mip]);
+		Put64(entry, size * size * 4 * 2);
+		Put64(entry, size * size * 4 * 2);
+		memcpy(&file[index + mip * 24], entry.data(), entry.size());
+	}
+	return file;
+}
+
+TEST(TextureContainerReadsSavedDds)
+{
+	// 8x4 BC7 cube with a full mip chain, every byte set to slice * 16 + mip
+	DdsTexture texture;
+	texture.Width = 8;
+	texture.Height = 4;
+	texture.Format = DDS_FORMAT_BC7_UNORM;
+	texture.MipCount = 4;
+	texture.ArraySize = 6;
+	texture.IsCubemap = true;
+	for (unsigned int slice = 0; slice < 6; slice++)
+	{
+		for (unsigned int mip = 0; mip < 4; mip++)
+		{
+			DdsSurface surface;
+			surface.Width = (8 >> mip) ? (8 >> mip) : 1;
+			surface.Height = (4 >> mip) ? (4 >> mip) : 1;
+			surface.RowPitch = (surface.Width + 3) / 4 * 16;
+			surface.Data.assign(GetDdsSurfaceBytes(texture.Format, surface.Width, surface.Height), (unsigned char)(slice * 16 + mip));
+			texture.Surfaces.push_back(surface);
+		}
+	}
+
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "TextureContainerTests.dds";
+	CHECK(SaveDds(path, texture));
+
+	std::string error;
+	{
+		TextureContainer container;
+		CHECK(container.Open(path, error));
+		CHECK(container.GetType() == TEXTURE_CONTAINER_DDS);
+
+		const DdsTexture& description = container.GetDescription();
+		CHECK(description.Width == 8 && description.Height == 4);
+		CHECK(description.Format == DDS_FORMAT_BC7_UNORM);
+		CHECK(description.IsCubemap && description.ArraySize == 6 && description.MipCount == 4);
+		CHECK(container.GetSubresources().size() == 24);
+
+		if (container.GetSubresources().size() == 24)
+		{
+			CHECK(container.GetSubresource(0, 0).RowPitch == 32);
+			CHECK(container.GetSubresource(0, 0).SlicePitch == 32);
+			CHECK(container.GetSubresource(2, 3).Data[0] == 3 * 16 + 2);
+			CHECK(container.GetSubresource(3, 5).Data[15] == 5 * 16 + 3);
+		}
+	}
+	std::filesystem::remove(path);
+}
+
+TEST(TextureContainerReadsKtx2)
+{
+	std::vector<unsigned char> file = MakeKtx2(37, 4); // VK_FORMAT_R8G8B8A8_UNORM
+	std::string error;
+	TextureContainer container;
+	CHECK(container.Parse(file.data(), file.size(), error));
+	CHECK(container.GetType() == TEXTURE_CONTAINER_KTX2);
+	CHECK(container.GetDescription().Format == DDS_FORMAT_R8G8B8A8_UNORM);
+	CHECK(container.GetDescription().ArraySize == 2 && container.GetDescription().MipCount == 4);
+	CHECK(container.GetSubresources().size() == 8);
+
+	// Handed out slice by slice, top mip first, whatever the file order
+	if (container.GetSubresources().size() == 8)
+	{
+		CHECK(container.GetSubresource(0, 1).Data[0] == 16);
+		CHECK(container.GetSubresource(0, 1).RowPitch == 32 && container.GetSubresource(0, 1).SlicePitch == 256);
+		CHECK(container.GetSubresource(3, 1).Data[0] == 19 && container.GetSubresource(3, 1).RowPitch == 4);
+		CHECK(container.GetSubresources()[5].Data == container.GetSubresource(1, 1).Data);
+	}
+}
+
+TEST(TextureContainerRejectsBadFiles)
+{
+	std::string error;
+	TextureContainer container;
+
+	std::vector<unsigned char> file = MakeKtx2(37, 4);
+	CHECK(!container.Parse(file.data(), file.size() - 1, error));
+	CHECK(!error.empty());
+	CHECK(container.GetSubresources().empty());
+	CHECK(!container.Parse(file.data(), 40, error));
+
+	// More levels than an 8x8 chain has
+	file = MakeKtx2(37, 5);
+	CHECK(!container.Parse(file.data(), file.size(), error));
+
+	// Unknown format
+	file = MakeKtx2(999, 4);
+	CHECK(!container.Parse(file.data(), file.size(), error));
+}
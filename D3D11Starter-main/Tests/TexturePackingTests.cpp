@@ -0,0 +1,84 @@
+#include "TestFramework.h"
+#include "TexturePacking.h"
+#include "TextureCook.h"
+
+// Square RGBA image whose red channel is set by fill(x, y)
+template<typename Fill>
+static DecodedImage MakeImage(unsigned int size, Fill fill)
+{
+	DecodedImage image;
+	image.Width = size;
+	image.Height = size;
+	image.Pixels.resize(size * size * 4, 255);
+	for (unsigned int y = 0; y < size; y++)
+		for (unsigned int x = 0; x < size; x++)
+			image.Pixels[(y * size + x) * 4] = fill(x, y);
+	return image;
+}
+
+TEST(PackOrmPutsEachMapInItsChannel)
+{
+	DecodedImage roughness = MakeImage(8, [](unsigned int x, unsigned int y) { return (unsigned char)(x * 30 + y); });
+	DecodedImage metalness = MakeImage(8, [](unsigned int, unsigned int) { return (unsigned char)200; });
+	DecodedImage occlusion = MakeImage(8, [](unsigned int x, unsigned int) { return (unsigned char)(x * 10); });
+
+	DecodedImage packed;
+	PackOrm(&occlusion, roughness, metalness, packed);
+	CHECK(packed.Width == 8 && packed.Height == 8);
+
+	const unsigned char* texel = &packed.Pixels[(2 * 8 + 5) * 4];
+	CHECK(texel[0] == 50);  // Occlusion
+	CHECK(texel[1] == 152); // Roughness
+	CHECK(texel[2] == 200); // Metalness
+	CHECK(texel[3] == 255);
+	CHECK(VerifyOrmPacking(packed, &occlusion, roughness, metalness) == 0);
+
+	// A single wrong channel shows up
+	packed.Pixels[(3 * 8 + 1) * 4 + 1] ^= 0x40;
+	CHECK(VerifyOrmPacking(packed, &occlusion, roughness, metalness) == 1);
+}
+
+TEST(PackOrmResizesSmallerMaps)
+{
+	DecodedImage roughness = MakeImage(8, [](unsigned int x, unsigned int) { return (unsigned char)(x * 30); });
+	DecodedImage metalness = MakeImage(2, [](unsigned int, unsigned int) { return (unsigned char)64; });
+
+	// No occlusion map, so R is fully lit
+	DecodedImage packed;
+	PackOrm(nullptr, roughness, metalness, packed);
+	CHECK(packed.Width == 8 && packed.Height == 8);
+	CHECK(packed.Pixels[0] == 255);
+	CHECK(packed.Pixels[(7 * 8 + 7) * 4 + 2] == 64);
+	CHECK(VerifyOrmPacking(packed, nullptr, roughness, metalness) == 0);
+}
+
+// Bytes for a square map with a full mip chain in a DDS_FORMAT_*
+static size_t GetMapBytes(unsigned int size, unsigned int format)
+{
+	DdsTexture texture;
+	texture.Width = size;
+	texture.Height = size;
+	texture.MipCount = GetMipLevelCount(size, size);
+	texture.Format = format;
+	return GetDdsTextureBytes(texture);
+}
+
+TEST(PackedOrmIsNoLargerThanSeparateMaps)
+{
+	// Cooked the way Game.cpp asks for ORM maps, otherwise defaults
+	TextureCookSettings settings;
+	settings.Usage = TEXTURE_USAGE_ORM;
+	settings.Compress = true;
+	CHECK(!settings.HighPrecisionOrm);
+
+	BlockFormat format = GetBlockFormat(settings.Usage, settings.Quality);
+	CHECK(format == BLOCK_FORMAT_BC1);
+	size_t packed = GetMapBytes(512, GetBlockFormatDds(format, settings.SRGB));
+
+	// Roughness and metalness on their own, as the cooker counts them
+	size_t separate = 2 * GetMapBytes(512, DDS_FORMAT_BC4_UNORM);
+	CHECK(packed <= separate);
+
+	// Even at low quality
+	CHECK(GetBlockFormat(TEXTURE_USAGE_ORM, BLOCK_QUALITY_FAST) == BLOCK_FORMAT_BC1);
+}
@@ -0,0 +1,107 @@
+#include "TestFramework.h"
+#include "TextureResidency.h"
+
+// 1024x1024 BC7 with a full mip chain
+static DdsTexture MakeDescription()
+{
+	DdsTexture description;
+	description.Width = 1024;
+	description.Height = 1024;
+	description.MipCount = 11;
+	description.Format = DDS_FORMAT_BC7_UNORM;
+	return description;
+}
+
+TEST(ResidencyEvictsLeastRecentlyUsed)
+{
+	DdsTexture description = MakeDescription();
+	size_t full = GetDdsTextureBytes(description);
+
+	// Room for two and a bit textures out of three
+	TextureResidencyPolicy policy(full * 2 + full / 10);
+	unsigned int a = policy.AddTexture("a", description);
+	unsigned int b = policy.AddTexture("b", description);
+	unsigned int c = policy.AddTexture("c", description);
+	CHECK(policy.GetStats().FullBytes == full * 3);
+	CHECK(policy.GetBytesFromMip(a, 0) == full);
+
+	policy.RequestMip(b, 0);
+	policy.RequestMip(c, 0);
+	policy.Update();
+	CHECK(policy.GetResidentMip(a) > 0);
+	CHECK(policy.GetResidentMip(b) == 0 && policy.GetResidentMip(c) == 0);
+	CHECK(policy.GetStats().ResidentBytes <= policy.GetBudget());
+
+	// Now a is wanted and b isn't: a streams back one mip per
+	// frame while b gives up its top mips to make room
+	unsigned int dropped = policy.GetResidentMip(a);
+	for (unsigned int frame = 0; frame < 20; frame++)
+	{
+		policy.RequestMip(a, 0);
+		policy.RequestMip(c, 0);
+		policy.Update();
+		if (frame == 0)
+			CHECK(policy.GetResidentMip(a) == dropped - 1);
+	}
+	CHECK(policy.GetResidentMip(a) == 0 && policy.GetResidentMip(c) == 0);
+	CHECK(policy.GetResidentMip(b) > 0);
+}
+
+TEST(ResidencyNeverDropsTheTail)
+{
+	DdsTexture description = MakeDescription();
+	TextureResidencyPolicy policy(1);
+	unsigned int texture = policy.AddTexture("a", description);
+	policy.Update();
+
+	// 1024 >> 4 is the 64 texel tail
+	CHECK(policy.GetResidentMip(texture) == 4);
+	CHECK(policy.GetStats().OverBudget);
+}
+
+TEST(ResidencyBudgetIsNeverExceeded)
+{
+	DdsTexture description = MakeDescription();
+	size_t full = GetDdsTextureBytes(description);
+
+	TextureResidencyPolicy policy(full * 3);
+	for (unsigned int i = 0; i < 16; i++)
+		policy.AddTexture("texture" + std::to_string(i), description);
+
+	// Random textures at random detail each frame, repeatable
+	unsigned int seed = 12345;
+	auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+	unsigned int framesOver = 0;
+	for (unsigned int frame = 0; frame < 500; frame++)
+	{
+		for (unsigned int i = 0; i < 6; i++)
+			policy.RequestMip(next() % policy.GetTextureCount(), next() % 5);
+		policy.Update();
+
+		size_t resident = 0;
+		for (unsigned int t = 0; t < policy.GetTextureCount(); t++)
+			resident += policy.GetBytesFromMip(t, policy.GetResidentMip(t));
+
+		CHECK(resident == policy.GetStats().ResidentBytes);
+		if (resident > policy.GetBudget())
+			framesOver++;
+	}
+	CHECK(framesOver == 0);
+	CHECK(!policy.GetStats().OverBudget);
+	CHECK(policy.GetStats().MipsStreamed > 0);
+
+	TextureResidencySimulationSettings settings;
+	settings.Frames = 300;
+	settings.BudgetBytes = 16 * 1024 * 1024;
+	TextureResidencySimulationResults results = SimulateTextureResidency(settings);
+	CHECK(results.FramesOverBudget == 0);
+	CHECK(results.PeakBytes <= settings.BudgetBytes);
+}
+
+TEST(ResidencyScreenMip)
+{
+	CHECK(TextureResidencyPolicy::GetScreenMip(1024, 1, 1024) == 0);
+	CHECK(TextureResidencyPolicy::GetScreenMip(1024, 1, 700) == 0);
+	CHECK(TextureResidencyPolicy::GetScreenMip(1024, 2, 256) == 3);
+}
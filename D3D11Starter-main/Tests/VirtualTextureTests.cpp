@@ -0,0 +1,97 @@
+#include "TestFramework.h"
+#include "VirtualTexture.h"
+
+// 8x8 pages at mip 0, down to one page at mip 3
+static VirtualTextureDesc MakeDesc()
+{
+	VirtualTextureDesc desc;
+	desc.Width = 1024;
+	desc.Height = 1024;
+	desc.PageSize = 128;
+	desc.CacheSlots = 8;
+	desc.MaxUploadsPerFrame = 4;
+	return desc;
+}
+
+TEST(VirtualPageIdsRoundTrip)
+{
+	unsigned int page = MakeVirtualPageId(3, 1000, 42);
+	CHECK(GetVirtualPageMip(page) == 3);
+	CHECK(GetVirtualPageX(page) == 1000);
+	CHECK(GetVirtualPageY(page) == 42);
+	CHECK(page != VirtualPageInvalid);
+}
+
+TEST(VirtualTextureFallsBackToPinnedMip)
+{
+	VirtualTexture texture(MakeDesc());
+	CHECK(texture.GetMipCount() == 4);
+	CHECK(texture.GetPagesX(0) == 8 && texture.GetPagesX(3) == 1);
+
+	// With no feedback only the pinned coarsest page loads
+	const std::vector<VirtualPageLoad>& loads = texture.Update(nullptr, 0);
+	CHECK(loads.size() == 1);
+	if (loads.size() == 1)
+		CHECK(loads[0].Page == MakeVirtualPageId(3, 0, 0));
+
+	// Every page points at it until something better arrives
+	CHECK(texture.GetPageTable(0)[5].Mip == 3);
+}
+
+TEST(VirtualTextureLoadsRequestedPages)
+{
+	VirtualTexture texture(MakeDesc());
+	texture.Update(nullptr, 0); // Hands out the pinned page
+
+	// Two mip 0 pages, one seen far more, plus feedback to ignore
+	std::vector<unsigned int> feedback(100, MakeVirtualPageId(0, 0, 0));
+	feedback.insert(feedback.end(), 10, MakeVirtualPageId(0, 7, 7));
+	feedback.push_back(VirtualPageInvalid);
+	feedback.push_back(MakeVirtualPageId(9, 0, 0)); // No such mip
+
+	// Both pages and their missing ancestors want loading, but
+	// only four uploads fit in a frame
+	std::vector<VirtualPageLoad> loads = texture.Update(feedback.data(), feedback.size());
+	const VirtualTextureStats& stats = texture.GetStats();
+	CHECK(stats.FeedbackSamples == 110);
+	CHECK(stats.RequestedPages == 2);
+	CHECK(stats.Misses == 2);
+	CHECK(loads.size() == 4);
+	CHECK(stats.Pending == 2);
+
+	// The rest arrive next frame, then everything hits
+	texture.Update(feedback.data(), feedback.size());
+	CHECK(texture.IsResident(MakeVirtualPageId(0, 0, 0)));
+	CHECK(texture.IsResident(MakeVirtualPageId(0, 7, 7)));
+	CHECK(texture.GetPageTable(0)[0].Mip == 0);
+	CHECK(texture.GetPageTable(0)[1].Mip == 1); // Neighbour shows the parent
+
+	CHECK(texture.Update(feedback.data(), feedback.size()).empty());
+	CHECK(texture.GetStats().Hits == 2);
+	CHECK(texture.GetStats().SampleHits == 110);
+}
+
+TEST(VirtualTextureKeepsPagesInUse)
+{
+	VirtualTextureDesc desc = MakeDesc();
+	VirtualTexture texture(desc);
+
+	// One page seen every frame while the rest of the view sweeps
+	// across the texture, needing far more pages than the cache holds
+	unsigned int kept = MakeVirtualPageId(0, 0, 0);
+	for (unsigned int frame = 0; frame < 32; frame++)
+	{
+		std::vector<unsigned int> feedback(20, kept);
+		feedback.push_back(MakeVirtualPageId(0, frame % 8, 1 + frame / 8 % 7));
+
+		for (const VirtualPageLoad& load : texture.Update(feedback.data(), feedback.size()))
+		{
+			CHECK(load.Slot < desc.CacheSlots);
+			CHECK(load.Evicted != kept);
+		}
+		CHECK(texture.GetResidentPages() <= desc.CacheSlots);
+		if (frame > 1)
+			CHECK(texture.IsResident(kept));
+	}
+	CHECK(texture.GetStats().TotalEvictions > 0);
+}
@@ -0,0 +1,245 @@
+#include "TextureContainer.h"
+
+#include <cstring>
+
+namespace
+{
+	const unsigned char Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	// The fixed part of a KTX2 file, after the identifier.  The
+	// 64-bit fields sit at offset 52, so pack to keep them there.
+#pragma pack(push, 4)
+	struct Ktx2Header
+	{
+		unsigned int VkFormat;
+		unsigned int TypeSize;
+		unsigned int PixelWidth;
+		unsigned int PixelHeight;
+		unsigned int PixelDepth;
+		unsigned int LayerCount;
+		unsigned int FaceCount;
+		unsigned int LevelCount;
+		unsigned int SupercompressionScheme;
+		unsigned int DfdByteOffset;
+		unsigned int DfdByteLength;
+		unsigned int KvdByteOffset;
+		unsigned int KvdByteLength;
+		unsigned long long SgdByteOffset;
+		unsigned long long SgdByteLength;
+	};
+#pragma pack(pop)
+
+	struct Ktx2Level
+	{
+		unsigned long long ByteOffset;
+		unsigned long long ByteLength;
+		unsigned long long UncompressedByteLength;
+	};
+
+	static_assert(sizeof(Ktx2Header) == 68, "KTX2 header size");
+	static_assert(sizeof(Ktx2Level) == 24, "KTX2 level index size");
+
+	// VkFormat to the matching DDS_FORMAT_* (a DXGI_FORMAT), or 0
+	unsigned int GetKtx2Format(unsigned int vkFormat)
+	{
+		switch (vkFormat)
+		{
+		case 37: return DDS_FORMAT_R8G8B8A8_UNORM;       // VK_FORMAT_R8G8B8A8_UNORM
+		case 43: return DDS_FORMAT_R8G8B8A8_UNORM_SRGB;  // VK_FORMAT_R8G8B8A8_SRGB
+		case 131:                                        // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+		case 133: return DDS_FORMAT_BC1_UNORM;           // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+		case 132:                                        // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+		case 134: return DDS_FORMAT_BC1_UNORM_SRGB;      // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+		case 139: return DDS_FORMAT_BC4_UNORM;           // VK_FORMAT_BC4_UNORM_BLOCK
+		case 141: return DDS_FORMAT_BC5_UNORM;           // VK_FORMAT_BC5_UNORM_BLOCK
+		case 145: return DDS_FORMAT_BC7_UNORM;           // VK_FORMAT_BC7_UNORM_BLOCK
+		case 146: return DDS_FORMAT_BC7_UNORM_SRGB;      // VK_FORMAT_BC7_SRGB_BLOCK
+		default: return 0;
+		}
+	}
+
+	// Pitches of one surface; rows of blocks for block formats
+	TextureSubresource MakeSubresource(const unsigned char* data, unsigned int format, unsigned int width, unsigned int height)
+	{
+		TextureSubresource subresource;
+		subresource.Data = data;
+		subresource.Width = width;
+		subresource.Height = height;
+		subresource.SlicePitch = (unsigned int)GetDdsSurfaceBytes(format, width, height);
+		if (unsigned int blockBytes = GetDdsFormatBlockBytes(format))
+			subresource.RowPitch = (width + 3) / 4 * blockBytes;
+		else
+			subresource.RowPitch = width * GetDdsFormatPixelBytes(format);
+		return subresource;
+	}
+
+	unsigned int MipSize(unsigned int size, unsigned int mip)
+	{
+		return size >> mip ? size >> mip : 1;
+	}
+}
+
+bool TextureContainer::Open(const std::filesystem::path& path, std::string& error)
+{
+	Close();
+	if (!file.Open(path))
+	{
+		error = "Can't open " + path.string();
+		return false;
+	}
+
+	if (!Parse(file.GetData(), file.GetSize(), error))
+	{
+		error = path.filename().string() + ": " + error;
+		file.Close();
+		return false;
+	}
+	return true;
+}
+
+bool TextureContainer::Parse(const unsigned char* data, size_t size, std::string& error)
+{
+	description = DdsTexture();
+	subresources.clear();
+
+	bool parsed = false;
+	if (size >= sizeof(Ktx2Identifier) && memcmp(data, Ktx2Identifier, sizeof(Ktx2Identifier)) == 0)
+		parsed = ParseKtx2(data, size, error);
+	else
+		parsed = ParseDds(data, size, error);
+
+	if (!parsed)
+	{
+		description = DdsTexture();
+		subresources.clear();
+	}
+	return parsed;
+}
+
+void TextureContainer::Close()
+{
+	file.Close();
+	description = DdsTexture();
+	subresources.clear();
+}
+
+const TextureSubresource& TextureContainer::GetSubresource(unsigned int mip, unsigned int slice) const
+{
+	return subresources[(size_t)slice * description.MipCount + mip];
+}
+
+// --------------------------------------------------------
+// DDS stores each slice's whole mip chain in turn, tightly
+// packed, which is already subresource order
+// --------------------------------------------------------
+bool TextureContainer::ParseDds(const unsigned char* data, size_t size, std::string& error)
+{
+	size_t offset = 0;
+	if (!ParseDdsHeader(data, size, description, offset, error))
+		return false;
+
+	type = TEXTURE_CONTAINER_DDS;
+	subresources.reserve((size_t)description.ArraySize * description.MipCount);
+	for (unsigned int slice = 0; slice < description.ArraySize; slice++)
+	{
+		for (unsigned int mip = 0; mip < description.MipCount; mip++)
+		{
+			unsigned int width = MipSize(description.Width, mip);
+			unsigned int height = MipSize(description.Height, mip);
+			subresources.push_back(MakeSubresource(data + offset, description.Format, width, height));
+			offset += subresources.back().SlicePitch;
+		}
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// KTX2 stores mips smallest first, each level holding every
+// layer and face, and indexes them by offset - so levels
+// are found through the index and the subresources are
+// reordered to match D3D11
+// --------------------------------------------------------
+bool TextureContainer::ParseKtx2(const unsigned char* data, size_t size, std::string& error)
+{
+	Ktx2Header header = {};
+	size_t indexOffset = sizeof(Ktx2Identifier) + sizeof(Ktx2Header);
+	if (size < indexOffset)
+	{
+		error = "Too small for a KTX2 header";
+		return false;
+	}
+	memcpy(&header, data + sizeof(Ktx2Identifier), sizeof(header));
+
+	if (header.SupercompressionScheme != 0)
+	{
+		error = "Supercompressed KTX2 isn't supported";
+		return false;
+	}
+	if (header.PixelDepth > 1 || header.PixelHeight == 0)
+	{
+		error = "Only 2D textures are supported";
+		return false;
+	}
+	if (header.FaceCount != 1 && header.FaceCount != 6)
+	{
+		error = "Bad face count";
+		return false;
+	}
+
+	description.Width = header.PixelWidth;
+	description.Height = header.PixelHeight;
+	description.MipCount = header.LevelCount ? header.LevelCount : 1;
+	description.ArraySize = (header.LayerCount ? header.LayerCount : 1) * header.FaceCount;
+	description.IsCubemap = header.FaceCount == 6;
+	description.Format = GetKtx2Format(header.VkFormat);
+	if (description.Format == 0)
+	{
+		error = "Unsupported VkFormat " + std::to_string(header.VkFormat);
+		return false;
+	}
+	if (description.Width == 0 || description.Width > 16384 || description.Height > 16384 || description.ArraySize > 2048)
+	{
+		error = "Bad dimensions";
+		return false;
+	}
+
+	// No more mips than a full chain down to 1x1
+	unsigned int largest = description.Width > description.Height ? description.Width : description.Height;
+	if (description.MipCount > 15 || (largest >> (description.MipCount - 1)) == 0)
+	{
+		error = "Bad mip count";
+		return false;
+	}
+	if (size - indexOffset < (size_t)description.MipCount * sizeof(Ktx2Level))
+	{
+		error = "Truncated level index";
+		return false;
+	}
+
+	// Each level is every layer's faces, one after another
+	subresources.resize((size_t)description.ArraySize * description.MipCount);
+	for (unsigned int mip = 0; mip < description.MipCount; mip++)
+	{
+		Ktx2Level level = {};
+		memcpy(&level, data + indexOffset + mip * sizeof(Ktx2Level), sizeof(level));
+
+		unsigned int width = MipSize(description.Width, mip);
+		unsigned int height = MipSize(description.Height, mip);
+		unsigned long long surfaceBytes = GetDdsSurfaceBytes(description.Format, width, height);
+		if (level.ByteOffset > size || level.ByteLength > size - level.ByteOffset ||
+			level.ByteLength < surfaceBytes * description.ArraySize)
+		{
+			error = "Level " + std::to_string(mip) + " is outside the file";
+			return false;
+		}
+
+		for (unsigned int slice = 0; slice < description.ArraySize; slice++)
+		{
+			const unsigned char* surface = data + level.ByteOffset + slice * surfaceBytes;
+			subresources[(size_t)slice * description.MipCount + mip] = MakeSubresource(surface, description.Format, width, height);
+		}
+	}
+
+	type = TEXTURE_CONTAINER_KTX2;
+	return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "DdsFile.h"
+#include "MappedFile.h"
+
+enum TextureContainerType
+{
+	TEXTURE_CONTAINER_DDS,
+	TEXTURE_CONTAINER_KTX2,
+};
+
+// --------------------------------------------------------
+// One mip of one array slice, pointing into the container's
+// memory.  The fields line up with D3D11_SUBRESOURCE_DATA,
+// so a subresource can be handed to CreateTexture2D as is.
+// --------------------------------------------------------
+struct TextureSubresource
+{
+	const unsigned char* Data = nullptr;
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	unsigned int RowPitch = 0;   // One row of texels, or of 4x4 blocks
+	unsigned int SlicePitch = 0; // The whole surface
+};
+
+// --------------------------------------------------------
+// Reads cooked DDS and KTX2 files without copying or
+// decoding them.  The file is memory mapped and every
+// subresource is just a pointer into the mapping, so the
+// container must outlive any use of them.
+//
+// KTX2 files must not be supercompressed, and both kinds
+// must hold a 2D texture, array or cube map in one of the
+// DDS_FORMAT_* formats.  Every size and offset is checked
+// against the file before a subresource is handed out.
+// --------------------------------------------------------
+class TextureContainer
+{
+public:
+	TextureContainer() = default;
+
+	TextureContainer(const TextureContainer&) = delete;
+	TextureContainer& operator=(const TextureContainer&) = delete;
+
+	// Maps and parses a .dds or .ktx2, picked by its contents
+	bool Open(const std::filesystem::path& path, std::string& error);
+
+	// Parses memory the caller keeps alive (used by Open, and
+	// handy for checking synthetic files)
+	bool Parse(const unsigned char* data, size_t size, std::string& error);
+
+	void Close();
+
+	TextureContainerType GetType() const { return type; }
+
+	// Dimensions, mips, format and array size (cube faces count
+	// as slices).  Surfaces is always empty - see below.
+	const DdsTexture& GetDescription() const { return description; }
+
+	// Every subresource, in D3D11CalcSubresource order:
+	// slice by slice, each with its mips top down
+	const std::vector<TextureSubresource>& GetSubresources() const { return subresources; }
+	const TextureSubresource& GetSubresource(unsigned int mip, unsigned int slice) const;
+
+private:
+	MappedFile file;
+	TextureContainerType type = TEXTURE_CONTAINER_DDS;
+	DdsTexture description;
+	std::vector<TextureSubresource> subresources;
+
+	bool ParseDds(const unsigned char* data, size_t size, std::string& error);
+	bool ParseKtx2(const unsigned char* data, size_t size, std::string& error);
+};
@@ -0,0 +1,442 @@
+#include "TextureCook.h"
+#include "CacheFiles.h"
+#include "CpuHelpers.h"
+#include "MappedFile.h"
+#include "TexturePacking.h"
+
+#include <chrono>
+#include <cstdio>
+
+// Bump when cooked output changes, so every texture re-cooks once
+static const char* TextureCookKeyVersion = "cook-5";
+
+std::filesystem::path TextureCookResults::GetOutput(const std::string& name) const
+{
+	for (const TextureCookReport& report : Reports)
+	{
+		if (report.Name == name)
+			return report.Output;
+	}
+	return std::filesystem::path();
+}
+
+void BuildTextureMips(const DecodedImage& image, const TextureCookSettings& settings, const DecodedImage* normals, DdsTexture& texture)
+{
+	texture = DdsTexture();
+	texture.Width = image.Width;
+	texture.Height = image.Height;
+	texture.Format = settings.SRGB ? DDS_FORMAT_R8G8B8A8_UNORM_SRGB : DDS_FORMAT_R8G8B8A8_UNORM;
+
+	// Runs inline, since cooking already spreads textures over the pool
+	MipChainJob job;
+	job.Image = &image;
+	job.Usage = settings.Usage;
+	job.Normals = normals;
+	job.Output = &texture.Surfaces;
+	job.LevelCount = settings.GenerateMips ? 0 : 1;
+	GenerateMips({ job }, nullptr);
+	texture.MipCount = (unsigned int)texture.Surfaces.size();
+}
+
+// Dimensions and memory use of a cooked texture
+static void FillSizes(const DdsTexture& texture, TextureCookReport& report)
+{
+	report.Width = texture.Width;
+	report.Height = texture.Height;
+	report.MipCount = texture.MipCount;
+	report.Format = texture.Format;
+	report.Bytes = GetDdsTextureBytes(texture);
+
+	DdsTexture uncompressed = texture;
+	uncompressed.Format = DDS_FORMAT_R8G8B8A8_UNORM;
+	report.UncompressedBytes = GetDdsTextureBytes(uncompressed);
+}
+
+// --------------------------------------------------------
+// What the maps packed into an ORM texture would take if
+// each were cooked on its own: a one-channel BC4 chain when
+// compressing, RGBA8 otherwise.  Only reads PNG headers, so
+// cached textures can report it too.
+// --------------------------------------------------------
+static size_t GetSeparateBytes(const std::vector<const MappedFile*>& sources, const TextureCookSettings& settings)
+{
+	size_t bytes = 0;
+	for (const MappedFile* source : sources)
+	{
+		DdsTexture texture;
+		if (!source->IsOpen() || !ReadPngSize(source->GetData(), source->GetSize(), texture.Width, texture.Height))
+			continue;
+
+		texture.MipCount = settings.GenerateMips ? GetMipLevelCount(texture.Width, texture.Height) : 1;
+		if (settings.Compress && texture.Width % 4 == 0 && texture.Height % 4 == 0)
+			texture.Format = DDS_FORMAT_BC4_UNORM;
+		bytes += GetDdsTextureBytes(texture);
+	}
+	return bytes;
+}
+
+// The settings' share of a cache key
+static std::string GetSettingsKey(const TextureCookSettings& settings)
+{
+	std::string key = TextureCookKeyVersion;
+	key += '\0';
+	key += settings.GenerateMips ? "mips" : "nomips";
+	key += '\0';
+	key += settings.SRGB ? "srgb" : "linear";
+	key += '\0';
+	key += std::to_string(settings.Usage);
+	key += '\0';
+	key += settings.Compress ? "bc" + std::to_string(settings.Quality) : "raw";
+	key += '\0';
+	key += settings.HighPrecisionOrm ? "ormbc7" : "ormbc1";
+	key += '\0';
+	return key;
+}
+
+// The block format a job compresses to, with the ORM opt-in applied
+static BlockFormat GetCookBlockFormat(const TextureCookSettings& settings)
+{
+	if (settings.Usage == TEXTURE_USAGE_ORM && settings.HighPrecisionOrm && settings.Quality == BLOCK_QUALITY_HIGH)
+		return BLOCK_FORMAT_BC7;
+
+	return GetBlockFormat(settings.Usage, settings.Quality);
+}
+
+TextureCooker::TextureCooker(const std::filesystem::path& outputDirectory) :
+	outputDirectory(outputDirectory)
+{
+}
+
+TextureCookResults TextureCooker::Cook(const std::vector<TextureCookJob>& jobs, ThreadPool& pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::error_code error;
+	std::filesystem::create_directories(outputDirectory, error);
+
+	TextureCookResults results;
+	results.Reports.resize(jobs.size());
+
+	// Cube maps have enough work inside to fill the pool alone
+	std::vector<unsigned int> textures;
+	for (unsigned int i = 0; i < jobs.size(); i++)
+	{
+		if (jobs[i].CubeFaces.empty())
+			textures.push_back(i);
+		else
+			results.Reports[i] = CookCube(jobs[i], pool);
+	}
+
+	pool.ParallelFor((unsigned int)textures.size(), [&](unsigned int i)
+	{
+		results.Reports[textures[i]] = CookOne(jobs[textures[i]]);
+	});
+
+	for (const TextureCookReport& report : results.Reports)
+	{
+		if (report.Output.empty()) results.Failed++;
+		else if (report.Cached) results.Cached++;
+		else results.Cooked++;
+	}
+
+	results.Milliseconds = MsSince(start);
+	return results;
+}
+
+TextureCookReport TextureCooker::CookOne(const TextureCookJob& job)
+{
+	TextureCookReport report;
+	report.Name = job.Name;
+
+	// The key covers the source bytes, the settings and the cooker itself
+	auto stageStart = std::chrono::high_resolution_clock::now();
+	MappedFile source(job.Source);
+	if (!source.IsOpen())
+	{
+		report.Error = "Can't open " + job.Source.string();
+		return report;
+	}
+
+	std::string hash;
+	std::string keyData = GetSettingsKey(job.Settings);
+	hash = FormatHashKey(HashBytes(source.GetData(), source.GetSize()));
+	keyData += hash;
+
+	// A missing normal map just means roughness isn't widened
+	MappedFile normalSource;
+	if (!job.NormalSource.empty() && normalSource.Open(job.NormalSource))
+	{
+		hash = FormatHashKey(HashBytes(normalSource.GetData(), normalSource.GetSize()));
+		keyData += '\0';
+		keyData += hash;
+	}
+
+	// Packed maps are keyed by everything merged into them
+	bool packOrm = job.Settings.Usage == TEXTURE_USAGE_ORM;
+	MappedFile metalnessSource, occlusionSource;
+	if (packOrm)
+	{
+		if (!metalnessSource.Open(job.MetalnessSource))
+		{
+			report.Error = "Can't open " + job.MetalnessSource.string();
+			return report;
+		}
+		if (!job.OcclusionSource.empty() && !occlusionSource.Open(job.OcclusionSource))
+		{
+			report.Error = "Can't open " + job.OcclusionSource.string();
+			return report;
+		}
+
+		hash = FormatHashKey(HashBytes(metalnessSource.GetData(), metalnessSource.GetSize()));
+		keyData += '\0';
+		keyData += "metal";
+		keyData += hash;
+		if (occlusionSource.IsOpen())
+		{
+			hash = FormatHashKey(HashBytes(occlusionSource.GetData(), occlusionSource.GetSize()));
+			keyData += '\0';
+			keyData += "ao";
+			keyData += hash;
+		}
+
+		report.SeparateBytes = GetSeparateBytes({ &occlusionSource, &source, &metalnessSource }, job.Settings);
+	}
+
+	hash = FormatHashKey(HashBytes(keyData.data(), keyData.size()));
+	std::filesystem::path output = outputDirectory / (job.Name + "_" + hash + ".dds");
+	report.HashMs = MsSince(stageStart);
+
+	DdsTexture header;
+	if (std::filesystem::exists(output) && ReadDdsHeader(output, header))
+	{
+		report.Output = output;
+		report.Cached = true;
+		FillSizes(header, report);
+		return report;
+	}
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	DecodedImage image;
+	if (!DecodePng(source.GetData(), source.GetSize(), image, report.Error))
+	{
+		report.Error = job.Source.filename().string() + ": " + report.Error;
+		return report;
+	}
+	source.Close();
+
+	DecodedImage normals;
+	if (normalSource.IsOpen() && !DecodePng(normalSource.GetData(), normalSource.GetSize(), normals, report.Error))
+	{
+		report.Error = job.NormalSource.filename().string() + ": " + report.Error;
+		return report;
+	}
+	normalSource.Close();
+
+	if (packOrm)
+	{
+		// Source is the roughness map, which goes in G
+		DecodedImage metalness, occlusion;
+		if (!DecodePng(metalnessSource.GetData(), metalnessSource.GetSize(), metalness, report.Error))
+		{
+			report.Error = job.MetalnessSource.filename().string() + ": " + report.Error;
+			return report;
+		}
+		if (occlusionSource.IsOpen() && !DecodePng(occlusionSource.GetData(), occlusionSource.GetSize(), occlusion, report.Error))
+		{
+			report.Error = job.OcclusionSource.filename().string() + ": " + report.Error;
+			return report;
+		}
+		metalnessSource.Close();
+		occlusionSource.Close();
+
+		const DecodedImage* occlusionImage = occlusion.Pixels.empty() ? nullptr : &occlusion;
+		DecodedImage packed;
+		PackOrm(occlusionImage, image, metalness, packed);
+		unsigned int mismatches = VerifyOrmPacking(packed, occlusionImage, image, metalness);
+		if (mismatches > 0)
+		{
+			report.Error = job.Name + ": " + std::to_string(mismatches) + " texels packed into the wrong channels";
+			return report;
+		}
+		image = std::move(packed);
+	}
+	report.DecodeMs = MsSince(stageStart);
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	DdsTexture texture;
+	BuildTextureMips(image, job.Settings, normals.Pixels.empty() ? nullptr : &normals, texture);
+	report.MipMs = MsSince(stageStart);
+
+	// Block formats need the top level in whole blocks
+	BlockFormat blockFormat = GetCookBlockFormat(job.Settings);
+	if (job.Settings.Compress && texture.Width % 4 == 0 && texture.Height % 4 == 0)
+	{
+		stageStart = std::chrono::high_resolution_clock::now();
+		DdsSurface top = texture.Surfaces[0];
+		for (DdsSurface& surface : texture.Surfaces)
+		{
+			DdsSurface compressed;
+			CompressSurface(surface, blockFormat, job.Settings.Quality, compressed, nullptr);
+			surface = std::move(compressed);
+		}
+		texture.Format = GetBlockFormatDds(blockFormat, job.Settings.SRGB);
+		report.CompressMs = MsSince(stageStart);
+
+		DdsSurface decoded;
+		DecompressSurface(texture.Surfaces[0], blockFormat, texture.Width, texture.Height, decoded);
+		report.Psnr = GetSurfacePsnr(top, decoded, GetBlockFormatChannels(blockFormat));
+	}
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	if (!SaveDds(output, texture))
+	{
+		report.Error = "Can't write " + output.string();
+		return report;
+	}
+	report.WriteMs = MsSince(stageStart);
+
+	report.Output = output;
+	FillSizes(texture, report);
+	return report;
+}
+
+TextureCookReport TextureCooker::CookCube(const TextureCookJob& job, ThreadPool& pool)
+{
+	TextureCookReport report;
+	report.Name = job.Name;
+	if (job.CubeFaces.size() != 6)
+	{
+		report.Error = job.Name + ": a cube map needs six faces";
+		return report;
+	}
+	if (job.Settings.Usage != TEXTURE_USAGE_COLOR && job.Settings.Usage != TEXTURE_USAGE_LINEAR)
+	{
+		report.Error = job.Name + ": cube maps must be color or linear";
+		return report;
+	}
+
+	// Keyed by every face, in order
+	auto stageStart = std::chrono::high_resolution_clock::now();
+	MappedFile sources[6];
+	unsigned long long faceHashes[6] = {};
+	pool.ParallelFor(6, [&](unsigned int f)
+	{
+		if (sources[f].Open(job.CubeFaces[f]))
+			faceHashes[f] = HashBytes(sources[f].GetData(), sources[f].GetSize());
+	});
+
+	std::string hash;
+	std::string keyData = GetSettingsKey(job.Settings) + "cube";
+	for (unsigned int f = 0; f < 6; f++)
+	{
+		if (!sources[f].IsOpen())
+		{
+			report.Error = "Can't open " + job.CubeFaces[f].string();
+			return report;
+		}
+		hash = FormatHashKey(faceHashes[f]);
+		keyData += '\0';
+		keyData += hash;
+	}
+
+	hash = FormatHashKey(HashBytes(keyData.data(), keyData.size()));
+	std::filesystem::path output = outputDirectory / (job.Name + "_" + hash + ".dds");
+	report.HashMs = MsSince(stageStart);
+
+	DdsTexture header;
+	if (std::filesystem::exists(output) && ReadDdsHeader(output, header) && header.IsCubemap)
+	{
+		report.Output = output;
+		report.Cached = true;
+		FillSizes(header, report);
+		return report;
+	}
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	DecodedImage images[6];
+	std::string errors[6];
+	pool.ParallelFor(6, [&](unsigned int f)
+	{
+		if (!DecodePng(sources[f].GetData(), sources[f].GetSize(), images[f], errors[f]))
+			errors[f] = job.CubeFaces[f].filename().string() + ": " + errors[f];
+		sources[f].Close();
+	});
+	for (unsigned int f = 0; f < 6; f++)
+	{
+		if (!errors[f].empty())
+		{
+			report.Error = errors[f];
+			return report;
+		}
+	}
+	report.DecodeMs = MsSince(stageStart);
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	std::vector<DdsSurface> faceMips[6];
+	CubeMipJob mipJob;
+	mipJob.Usage = job.Settings.Usage;
+	mipJob.LevelCount = job.Settings.GenerateMips ? 0 : 1;
+	for (unsigned int f = 0; f < 6; f++)
+	{
+		mipJob.Faces[f] = &images[f];
+		mipJob.Outputs[f] = &faceMips[f];
+	}
+	if (!GenerateCubeMips(mipJob, &pool))
+	{
+		report.Error = job.Name + ": cube faces must be square and the same size";
+		return report;
+	}
+	report.MipMs = MsSince(stageStart);
+
+	// Face by face, each with its mips - D3D11's subresource order
+	DdsTexture texture;
+	texture.Width = images[0].Width;
+	texture.Height = images[0].Height;
+	texture.MipCount = (unsigned int)faceMips[0].size();
+	texture.ArraySize = 6;
+	texture.IsCubemap = true;
+	texture.Format = job.Settings.SRGB ? DDS_FORMAT_R8G8B8A8_UNORM_SRGB : DDS_FORMAT_R8G8B8A8_UNORM;
+	for (unsigned int f = 0; f < 6; f++)
+	{
+		for (DdsSurface& surface : faceMips[f])
+			texture.Surfaces.push_back(std::move(surface));
+	}
+
+	// Every face and mip compresses on its own; PSNR is the worst top face
+	BlockFormat blockFormat = GetCookBlockFormat(job.Settings);
+	if (job.Settings.Compress && texture.Width % 4 == 0 && texture.Height % 4 == 0)
+	{
+		stageStart = std::chrono::high_resolution_clock::now();
+		double psnr[6] = {};
+		pool.ParallelFor((unsigned int)texture.Surfaces.size(), [&](unsigned int i)
+		{
+			DdsSurface compressed;
+			CompressSurface(texture.Surfaces[i], blockFormat, job.Settings.Quality, compressed, nullptr);
+			if (i % texture.MipCount == 0)
+			{
+				DdsSurface decoded;
+				DecompressSurface(compressed, blockFormat, texture.Width, texture.Height, decoded);
+				psnr[i / texture.MipCount] = GetSurfacePsnr(texture.Surfaces[i], decoded, GetBlockFormatChannels(blockFormat));
+			}
+			texture.Surfaces[i] = std::move(compressed);
+		});
+		texture.Format = GetBlockFormatDds(blockFormat, job.Settings.SRGB);
+		report.CompressMs = MsSince(stageStart);
+
+		report.Psnr = psnr[0];
+		for (double facePsnr : psnr)
+			report.Psnr = facePsnr < report.Psnr ? facePsnr : report.Psnr;
+	}
+
+	stageStart = std::chrono::high_resolution_clock::now();
+	if (!SaveDds(output, texture))
+	{
+		report.Error = "Can't write " + output.string();
+		return report;
+	}
+	report.WriteMs = MsSince(stageStart);
+
+	report.Output = output;
+	FillSizes(texture, report);
+	return report;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "BlockCompress.h"
+#include "DdsFile.h"
+#include "MipGenerator.h"
+#include "PngDecoder.h"
+#include "ThreadPool.h"
+
+// --------------------------------------------------------
+// How a source image is turned into a GPU texture.  Part of
+// the cache key, so changing a setting re-cooks the texture.
+// --------------------------------------------------------
+struct TextureCookSettings
+{
+	bool GenerateMips = true;
+	bool SRGB = false; // Store an _SRGB format, so sampling decodes to linear
+	TextureUsage Usage = TEXTURE_USAGE_LINEAR; // How mips are filtered
+	bool Compress = false; // Block compress, in a format picked by usage
+	BlockQuality Quality = BLOCK_QUALITY_HIGH;
+	bool HighPrecisionOrm = false; // ORM maps: BC7 at high quality instead of BC1, at twice the size
+};
+
+struct TextureCookJob
+{
+	std::string Name; // Output is Name_<key>.dds
+	std::filesystem::path Source;
+	std::filesystem::path NormalSource;    // Roughness and ORM maps: the normal map that widens their mips
+	std::filesystem::path MetalnessSource; // ORM maps: packed into B, with Source's roughness in G
+	std::filesystem::path OcclusionSource; // ORM maps, optional: packed into R
+	std::vector<std::filesystem::path> CubeFaces; // Cube maps: six faces, +X -X +Y -Y +Z -Z, instead of Source
+	TextureCookSettings Settings;
+};
+
+// --------------------------------------------------------
+// What happened to one texture, with each stage timed.
+// Cached textures only pay for hashing the source (and
+// reading the DDS header back); PSNR is only measured when
+// a texture is actually compressed.
+// --------------------------------------------------------
+struct TextureCookReport
+{
+	std::string Name;
+	std::filesystem::path Output; // Empty if it failed
+	bool Cached = false;
+	std::string Error;
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	unsigned int MipCount = 0;
+	unsigned int Format = 0;      // DDS_FORMAT_*
+	size_t Bytes = 0;             // Every mip, as stored
+	size_t UncompressedBytes = 0; // The same mips as RGBA8
+	size_t SeparateBytes = 0;     // ORM maps: their inputs cooked one by one instead
+	double Psnr = 0;              // Top mip against the source, 0 if not measured
+	double HashMs = 0;
+	double DecodeMs = 0;
+	double MipMs = 0;
+	double CompressMs = 0;
+	double WriteMs = 0;
+};
+
+struct TextureCookResults
+{
+	unsigned int Cooked = 0;
+	unsigned int Cached = 0;
+	unsigned int Failed = 0;
+	double Milliseconds = 0;
+	std::vector<TextureCookReport> Reports; // Same order as the jobs
+
+	// Cooked file for a job, or empty if it failed
+	std::filesystem::path GetOutput(const std::string& name) const;
+};
+
+// Fills a texture with the image and, if asked, a mip chain
+// down to 1x1 filtered to suit its usage.  Normals are only
+// read for roughness and ORM maps.
+void BuildTextureMips(const DecodedImage& image, const TextureCookSettings& settings, const DecodedImage* normals, DdsTexture& texture);
+
+// --------------------------------------------------------
+// Decodes PNG sources and writes GPU-ready DDS files, on the
+// thread pool.  Each output's name carries a key hashed from
+// the source bytes, settings and cooker version, so a texture
+// is only re-cooked when one of those changes; later runs
+// find the existing file and skip straight to loading it.
+//
+// ORM jobs pack their three sources into one texture first,
+// and fail unless every texel landed in the right channel.
+//
+// Cube jobs write all six faces into one DDS cube map, so
+// loading it is a single file map and CreateTexture2D.  They
+// cook first, each spread across the whole pool: faces decode
+// side by side, then mips build and compress per face and
+// level, with the seams welded across faces.
+// --------------------------------------------------------
+class TextureCooker
+{
+public:
+	TextureCooker(const std::filesystem::path& outputDirectory);
+
+	// Don't call from inside a pool task - this waits on the pool
+	TextureCookResults Cook(const std::vector<TextureCookJob>& jobs, ThreadPool& pool);
+
+private:
+	std::filesystem::path outputDirectory;
+
+	TextureCookReport CookOne(const TextureCookJob& job);
+	TextureCookReport CookCube(const TextureCookJob& job, ThreadPool& pool);
+};
@@ -0,0 +1,85 @@
+#include "TextureManager.h"
+#include "TextureUpload.h"
+
+TextureManager::TextureManager(size_t budgetBytes) :
+	policy(budgetBytes)
+{
+}
+
+bool TextureManager::Load(const std::string& name, const std::filesystem::path& cooked, std::shared_ptr<Materials> material, const std::string& slot)
+{
+	for (Texture& texture : textures)
+	{
+		if (texture.Name == name)
+		{
+			texture.Users.push_back(User{ material, slot });
+			material->AddTextureSRV(slot, texture.Srv);
+			return true;
+		}
+	}
+
+	// Starts fully resident; the first Update() trims it if needed
+	Texture texture;
+	texture.Name = name;
+	texture.Container = std::make_unique<TextureContainer>();
+	std::string error;
+	if (!texture.Container->Open(cooked, error) || !CreateTextureFromContainer(*texture.Container, texture.Srv))
+		return false;
+
+	texture.Users.push_back(User{ material, slot });
+	material->AddTextureSRV(slot, texture.Srv);
+	policy.AddTexture(name, texture.Container->GetDescription());
+	textures.push_back(std::move(texture));
+	return true;
+}
+
+const TextureContainer* TextureManager::GetContainer(const std::string& name) const
+{
+	for (const Texture& texture : textures)
+	{
+		if (texture.Name == name)
+			return texture.Container.get();
+	}
+	return nullptr;
+}
+
+void TextureManager::RequestMaterial(Materials* material, float screenPixels)
+{
+	// Tiling repeats the texture across the surface, so it needs
+	// that many more texels for the same on-screen sharpness
+	const float* uvScale = material->GetUVScale();
+	float repeats = uvScale[0] > uvScale[1] ? uvScale[0] : uvScale[1];
+
+	for (unsigned int i = 0; i < textures.size(); i++)
+	{
+		for (const User& user : textures[i].Users)
+		{
+			if (user.Material.get() != material)
+				continue;
+
+			const DdsTexture& description = policy.GetDescription(i);
+			unsigned int size = description.Width > description.Height ? description.Width : description.Height;
+			policy.RequestMip(i, TextureResidencyPolicy::GetScreenMip(size, repeats, screenPixels));
+			break;
+		}
+	}
+}
+
+void TextureManager::Update()
+{
+	lastUploads = 0;
+	for (const TextureResidencyChange& change : policy.Update())
+	{
+		// A failed upload keeps the old texture, so nothing goes missing
+		Texture& texture = textures[change.Texture];
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+		if (!CreateTextureFromContainer(*texture.Container, srv, change.NewMip))
+			continue;
+
+		texture.Srv = srv;
+		for (User& user : texture.Users)
+			user.Material->SetTextureSRV(user.Slot, srv);
+		lastUploads++;
+	}
+	totalUploads += lastUploads;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Materials.h"
+#include "TextureContainer.h"
+#include "TextureResidency.h"
+
+// --------------------------------------------------------
+// Keeps the cooked material textures within a GPU memory
+// budget.  Each texture stays memory mapped, and whenever
+// the residency policy changes how many of its top mips it
+// may keep, the texture is recreated from the mapping with
+// just those mips and swapped into every material using it.
+//
+// Each frame, report how big each material is on screen,
+// then call Update() once.
+// --------------------------------------------------------
+class TextureManager
+{
+public:
+	TextureManager(size_t budgetBytes);
+
+	// Maps a cooked texture, uploads it and binds it to a
+	// material's slot.  Loading the same name again just adds
+	// another user.  False if the file won't open or upload.
+	bool Load(const std::string& name, const std::filesystem::path& cooked, std::shared_ptr<Materials> material, const std::string& slot);
+
+	// Something using this material covers screenPixels rows;
+	// asks for the mips its textures need at that size
+	void RequestMaterial(Materials* material, float screenPixels);
+
+	// Lets the policy settle and re-uploads what it changed
+	void Update();
+
+	TextureResidencyPolicy& GetPolicy() { return policy; }
+
+	// The mapped file behind a loaded texture, always with every
+	// mip whatever is resident, or null if it wasn't loaded
+	const TextureContainer* GetContainer(const std::string& name) const;
+
+	// Textures re-uploaded by the last Update(), and in total
+	unsigned int GetLastUploads() const { return lastUploads; }
+	unsigned long long GetTotalUploads() const { return totalUploads; }
+
+private:
+	struct User
+	{
+		std::shared_ptr<Materials> Material;
+		std::string Slot;
+	};
+
+	struct Texture
+	{
+		std::string Name;
+		std::unique_ptr<TextureContainer> Container;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Srv;
+		std::vector<User> Users;
+	};
+
+	TextureResidencyPolicy policy;
+	std::vector<Texture> textures; // Same order as the policy's
+	unsigned int lastUploads = 0;
+	unsigned long long totalUploads = 0;
+};
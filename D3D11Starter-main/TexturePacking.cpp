@@ -0,0 +1,99 @@
+#include "TexturePacking.h"
+
+void ResizeImage(const DecodedImage& source, unsigned int width, unsigned int height, DecodedImage& output)
+{
+	output.Width = width;
+	output.Height = height;
+	output.Pixels.resize((size_t)width * height * 4);
+
+	if (source.Width == width && source.Height == height)
+	{
+		output.Pixels = source.Pixels;
+		return;
+	}
+
+	// Texel centers line up, as they do when the GPU samples
+	float scaleX = (float)source.Width / width;
+	float scaleY = (float)source.Height / height;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		float sy = (y + 0.5f) * scaleY - 0.5f;
+		sy = sy < 0 ? 0 : sy;
+		unsigned int y0 = (unsigned int)sy;
+		unsigned int y1 = y0 + 1 < source.Height ? y0 + 1 : y0;
+		float fy = sy - y0;
+
+		for (unsigned int x = 0; x < width; x++)
+		{
+			float sx = (x + 0.5f) * scaleX - 0.5f;
+			sx = sx < 0 ? 0 : sx;
+			unsigned int x0 = (unsigned int)sx;
+			unsigned int x1 = x0 + 1 < source.Width ? x0 + 1 : x0;
+			float fx = sx - x0;
+
+			const unsigned char* p00 = &source.Pixels[((size_t)y0 * source.Width + x0) * 4];
+			const unsigned char* p10 = &source.Pixels[((size_t)y0 * source.Width + x1) * 4];
+			const unsigned char* p01 = &source.Pixels[((size_t)y1 * source.Width + x0) * 4];
+			const unsigned char* p11 = &source.Pixels[((size_t)y1 * source.Width + x1) * 4];
+			unsigned char* out = &output.Pixels[((size_t)y * width + x) * 4];
+			for (int c = 0; c < 4; c++)
+			{
+				float top = p00[c] + (p10[c] - p00[c]) * fx;
+				float bottom = p01[c] + (p11[c] - p01[c]) * fx;
+				out[c] = (unsigned char)(top + (bottom - top) * fy + 0.5f);
+			}
+		}
+	}
+}
+
+// Every input at the packed size, so texels line up
+static void ResizeOrmInputs(const DecodedImage* occlusion, const DecodedImage& roughness, const DecodedImage& metalness,
+	DecodedImage& occlusionOut, DecodedImage& roughnessOut, DecodedImage& metalnessOut)
+{
+	unsigned int width = roughness.Width > metalness.Width ? roughness.Width : metalness.Width;
+	unsigned int height = roughness.Height > metalness.Height ? roughness.Height : metalness.Height;
+	if (occlusion)
+	{
+		width = occlusion->Width > width ? occlusion->Width : width;
+		height = occlusion->Height > height ? occlusion->Height : height;
+		ResizeImage(*occlusion, width, height, occlusionOut);
+	}
+
+	ResizeImage(roughness, width, height, roughnessOut);
+	ResizeImage(metalness, width, height, metalnessOut);
+}
+
+void PackOrm(const DecodedImage* occlusion, const DecodedImage& roughness, const DecodedImage& metalness, DecodedImage& packed)
+{
+	DecodedImage o, r, m;
+	ResizeOrmInputs(occlusion, roughness, metalness, o, r, m);
+
+	packed.Width = r.Width;
+	packed.Height = r.Height;
+	packed.Pixels.resize(r.Pixels.size());
+	for (size_t i = 0; i < packed.Pixels.size(); i += 4)
+	{
+		packed.Pixels[i + 0] = occlusion ? o.Pixels[i] : 255;
+		packed.Pixels[i + 1] = r.Pixels[i];
+		packed.Pixels[i + 2] = m.Pixels[i];
+		packed.Pixels[i + 3] = 255;
+	}
+}
+
+unsigned int VerifyOrmPacking(const DecodedImage& packed, const DecodedImage* occlusion, const DecodedImage& roughness, const DecodedImage& metalness)
+{
+	DecodedImage o, r, m;
+	ResizeOrmInputs(occlusion, roughness, metalness, o, r, m);
+	if (packed.Width != r.Width || packed.Height != r.Height)
+		return packed.Width * packed.Height > r.Width * r.Height ? packed.Width * packed.Height : r.Width * r.Height;
+
+	unsigned int mismatches = 0;
+	for (size_t i = 0; i < packed.Pixels.size(); i += 4)
+	{
+		unsigned char expectedOcclusion = occlusion ? o.Pixels[i] : 255;
+		if (packed.Pixels[i] != expectedOcclusion || packed.Pixels[i + 1] != r.Pixels[i] ||
+			packed.Pixels[i + 2] != m.Pixels[i] || packed.Pixels[i + 3] != 255)
+			mismatches++;
+	}
+	return mismatches;
+}
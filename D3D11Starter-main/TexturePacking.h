@@ -0,0 +1,25 @@
+#pragma once
+#include "PngDecoder.h"
+
+// Bilinear resize, for bringing maps of different sizes
+// together (the PBR metalness maps are often much smaller)
+void ResizeImage(const DecodedImage& source, unsigned int width, unsigned int height, DecodedImage& output);
+
+// --------------------------------------------------------
+// Packs occlusion, roughness and metalness into the R, G
+// and B of one texture (the glTF "ORM" layout), so the
+// pixel shader reads all three with a single sample.
+//
+// The result is as large as the largest input, and each
+// input's red channel is used.  Without an occlusion map,
+// R is 1 (fully lit); alpha is always 1.
+// --------------------------------------------------------
+void PackOrm(const DecodedImage* occlusion, const DecodedImage& roughness, const DecodedImage& metalness, DecodedImage& packed);
+
+// --------------------------------------------------------
+// Checks a packed texture against its sources, resampled
+// the same way, texel by texel.  Returns how many texels
+// don't match, so zero means every channel landed where
+// the shader expects it.
+// --------------------------------------------------------
+unsigned int VerifyOrmPacking(const DecodedImage& packed, const DecodedImage* occlusion, const DecodedImage& roughness, const DecodedImage& metalness);
@@ -0,0 +1,206 @@
+#include "TextureResidency.h"
+#include "CpuHelpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+TextureResidencyPolicy::TextureResidencyPolicy(size_t budgetBytes) :
+	budget(budgetBytes)
+{
+}
+
+unsigned int TextureResidencyPolicy::AddTexture(const std::string& name, const DdsTexture& description)
+{
+	Texture texture;
+	texture.Name = name;
+	texture.Description = description;
+	texture.Description.Surfaces.clear();
+
+	// Sizes from each mip down, built from the bottom up
+	unsigned int mipCount = description.MipCount ? description.MipCount : 1;
+	texture.BytesFromMip.resize(mipCount + 1, 0);
+	for (unsigned int mip = mipCount; mip-- > 0;)
+	{
+		unsigned int width = description.Width >> mip ? description.Width >> mip : 1;
+		unsigned int height = description.Height >> mip ? description.Height >> mip : 1;
+		texture.BytesFromMip[mip] = texture.BytesFromMip[mip + 1] +
+			GetDdsSurfaceBytes(description.Format, width, height) * description.ArraySize;
+	}
+
+	// Block compressed textures need their top mip in whole blocks
+	bool blocks = GetDdsFormatBlockBytes(description.Format) != 0;
+	while (texture.LowestMip + 1 < mipCount)
+	{
+		unsigned int next = texture.LowestMip + 1;
+		unsigned int width = description.Width >> next ? description.Width >> next : 1;
+		unsigned int height = description.Height >> next ? description.Height >> next : 1;
+		if ((width > height ? width : height) < MinResidentSize || (blocks && (width % 4 != 0 || height % 4 != 0)))
+			break;
+		texture.LowestMip = next;
+	}
+
+	stats.FullBytes += texture.BytesFromMip[0];
+	stats.ResidentBytes += texture.BytesFromMip[0];
+	textures.push_back(texture);
+	return (unsigned int)textures.size() - 1;
+}
+
+void TextureResidencyPolicy::RequestMip(unsigned int texture, unsigned int mip)
+{
+	// Several users in one frame - the most detailed wins
+	Texture& t = textures[texture];
+	t.RequestedMip = t.Requested && t.RequestedMip < mip ? t.RequestedMip : mip;
+	t.Requested = true;
+}
+
+const std::vector<TextureResidencyChange>& TextureResidencyPolicy::Update()
+{
+	frame++;
+	changes.clear();
+
+	// Aim at what was asked for.  Only textures used this frame
+	// stream in, one mip per frame; the rest keep what they have
+	// until the budget needs their room.  Dropping is immediate.
+	std::vector<unsigned int> targets(textures.size());
+	size_t total = 0;
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		Texture& t = textures[i];
+		if (t.Requested)
+		{
+			t.WantedMip = t.RequestedMip < t.LowestMip ? t.RequestedMip : t.LowestMip;
+			t.LastUsed = frame;
+			t.Requested = false;
+		}
+
+		if (t.WantedMip < t.ResidentMip)
+			targets[i] = t.LastUsed == frame ? t.ResidentMip - 1 : t.ResidentMip;
+		else
+			targets[i] = t.WantedMip;
+		total += t.BytesFromMip[targets[i]];
+	}
+
+	// Over budget: take top mips from the least recently used
+	// (the biggest first among equals) until it fits
+	if (total > budget)
+	{
+		std::vector<unsigned int> order(textures.size());
+		for (unsigned int i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+		{
+			if (textures[a].LastUsed != textures[b].LastUsed)
+				return textures[a].LastUsed < textures[b].LastUsed;
+			return textures[a].BytesFromMip[targets[a]] > textures[b].BytesFromMip[targets[b]];
+		});
+
+		for (unsigned int i : order)
+		{
+			Texture& t = textures[i];
+			while (total > budget && targets[i] < t.LowestMip)
+			{
+				total -= t.BytesFromMip[targets[i]] - t.BytesFromMip[targets[i] + 1];
+				targets[i]++;
+			}
+			if (total <= budget)
+				break;
+		}
+	}
+
+	stats.ResidentBytes = total;
+	stats.OverBudget = total > budget;
+	stats.ReducedTextures = 0;
+	stats.MissingMips = 0;
+	for (unsigned int i = 0; i < textures.size(); i++)
+	{
+		Texture& t = textures[i];
+		if (targets[i] != t.ResidentMip)
+		{
+			changes.push_back(TextureResidencyChange{ i, t.ResidentMip, targets[i] });
+			if (targets[i] > t.ResidentMip)
+				stats.MipsDropped += targets[i] - t.ResidentMip;
+			else
+				stats.MipsStreamed += t.ResidentMip - targets[i];
+			t.ResidentMip = targets[i];
+		}
+
+		if (t.ResidentMip > 0)
+			stats.ReducedTextures++;
+		if (t.LastUsed == frame && t.ResidentMip > t.WantedMip)
+			stats.MissingMips += t.ResidentMip - t.WantedMip;
+	}
+
+	return changes;
+}
+
+unsigned int TextureResidencyPolicy::GetScreenMip(unsigned int textureSize, float repeats, float screenPixels)
+{
+	float texels = textureSize * repeats;
+	if (screenPixels <= 0)
+		return 31; // Clamped to the texture's tail
+	if (texels <= screenPixels)
+		return 0;
+	return (unsigned int)std::log2(texels / screenPixels);
+}
+
+TextureResidencySimulationResults SimulateTextureResidency(const TextureResidencySimulationSettings& settings)
+{
+	TextureResidencySimulationResults results;
+	results.Frames = settings.Frames;
+	results.BudgetBytes = settings.BudgetBytes;
+
+	DdsTexture description;
+	description.Width = settings.TextureSize;
+	description.Height = settings.TextureSize;
+	description.Format = settings.Format;
+	description.MipCount = 1;
+	while ((settings.TextureSize >> description.MipCount) > 0)
+		description.MipCount++;
+
+	TextureResidencyPolicy policy(settings.BudgetBytes);
+	for (unsigned int i = 0; i < settings.Textures; i++)
+		policy.AddTexture("Object " + std::to_string(i), description);
+	results.FullBytes = policy.GetStats().FullBytes;
+
+	// Unit-radius objects every 10 units down the z axis, seen by a
+	// 60 degree camera flying past them from end to end
+	const float spacing = 10.0f;
+	const float viewDistance = 60.0f;
+	const float tanHalfFov = std::tan(3.14159265f / 6.0f);
+	float start = -20.0f;
+	float end = settings.Textures * spacing + 20.0f;
+
+	double updateMs = 0;
+	unsigned long long missingMips = 0;
+	for (unsigned int frame = 0; frame < settings.Frames; frame++)
+	{
+		float camera = start + (end - start) * frame / (settings.Frames > 1 ? settings.Frames - 1 : 1);
+		for (unsigned int i = 0; i < settings.Textures; i++)
+		{
+			float distance = i * spacing - camera;
+			if (distance < 0.5f || distance > viewDistance)
+				continue;
+
+			float screenPixels = settings.ScreenHeight / (distance * tanHalfFov);
+			float repeats = i % 2 ? 2.0f : 1.0f;
+			policy.RequestMip(i, TextureResidencyPolicy::GetScreenMip(settings.TextureSize, repeats, screenPixels));
+		}
+
+		auto updateStart = std::chrono::high_resolution_clock::now();
+		policy.Update();
+		updateMs += MsSince(updateStart);
+
+		const TextureResidencyStats& stats = policy.GetStats();
+		results.PeakBytes = std::max(results.PeakBytes, stats.ResidentBytes);
+		if (stats.ResidentBytes > settings.BudgetBytes)
+			results.FramesOverBudget++;
+		missingMips += stats.MissingMips;
+	}
+
+	results.MipsDropped = policy.GetStats().MipsDropped;
+	results.MipsStreamed = policy.GetStats().MipsStreamed;
+	results.MissingMipsPerFrame = settings.Frames ? (double)missingMips / settings.Frames : 0;
+	results.UpdateUs = settings.Frames ? updateMs * 1000.0 / settings.Frames : 0;
+	return results;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "DdsFile.h"
+
+// A texture whose most detailed resident mip changed this update
+struct TextureResidencyChange
+{
+	unsigned int Texture = 0;
+	unsigned int OldMip = 0;
+	unsigned int NewMip = 0;
+};
+
+struct TextureResidencyStats
+{
+	size_t ResidentBytes = 0;
+	size_t FullBytes = 0;         // Every texture with every mip
+	unsigned int ReducedTextures = 0; // Missing at least one top mip
+	unsigned int MissingMips = 0; // Wanted this frame but not resident
+	bool OverBudget = false;      // Even the smallest mips don't fit
+	unsigned long long MipsDropped = 0;  // Since the start
+	unsigned long long MipsStreamed = 0;
+};
+
+// --------------------------------------------------------
+// Decides how much of each texture stays on the GPU.  No
+// Direct3D here - it only tracks sizes and makes choices,
+// so it can be driven by a simulator as easily as a frame.
+//
+// Each frame, whatever is drawn asks for the mip its screen
+// size needs.  Update() then aims every texture at what was
+// last asked of it and, if that's over budget, drops top
+// mips from the least recently used textures first, never
+// below a small always-resident tail.  Dropping happens at
+// once; streaming back in is one mip per texture per frame,
+// most recently used first, and only while it fits.
+// --------------------------------------------------------
+class TextureResidencyPolicy
+{
+public:
+	TextureResidencyPolicy(size_t budgetBytes);
+
+	// Tracks a texture, fully resident until told otherwise.
+	// Only the description (size, mips, format) is used.
+	unsigned int AddTexture(const std::string& name, const DdsTexture& description);
+
+	void SetBudget(size_t budgetBytes) { budget = budgetBytes; }
+	size_t GetBudget() const { return budget; }
+
+	// Marks a texture used this frame, needing at least this
+	// much detail (0 is the full size top mip)
+	void RequestMip(unsigned int texture, unsigned int mip);
+
+	// Settles this frame's residency; returns what changed
+	const std::vector<TextureResidencyChange>& Update();
+
+	unsigned int GetTextureCount() const { return (unsigned int)textures.size(); }
+	const std::string& GetName(unsigned int texture) const { return textures[texture].Name; }
+	const DdsTexture& GetDescription(unsigned int texture) const { return textures[texture].Description; }
+	unsigned int GetResidentMip(unsigned int texture) const { return textures[texture].ResidentMip; }
+	unsigned int GetWantedMip(unsigned int texture) const { return textures[texture].WantedMip; }
+	const TextureResidencyStats& GetStats() const { return stats; }
+
+	// Bytes for a texture from one mip down to the smallest
+	size_t GetBytesFromMip(unsigned int texture, unsigned int mip) const { return textures[texture].BytesFromMip[mip]; }
+
+	// --------------------------------------------------------
+	// The mip that matches a texture repeated some number of
+	// times across something screenPixels tall, so roughly
+	// one texel lands on each pixel
+	// --------------------------------------------------------
+	static unsigned int GetScreenMip(unsigned int textureSize, float repeats, float screenPixels);
+
+	// Tails smaller than this many texels across always stay
+	static const unsigned int MinResidentSize = 64;
+
+private:
+	struct Texture
+	{
+		std::string Name;
+		DdsTexture Description;
+		std::vector<size_t> BytesFromMip;
+		unsigned int LowestMip = 0;   // Coarsest mip allowed as the top
+		unsigned int ResidentMip = 0;
+		unsigned int WantedMip = 0;
+		unsigned int RequestedMip = 0; // This frame, if requested
+		bool Requested = false;
+		unsigned long long LastUsed = 0;
+	};
+
+	std::vector<Texture> textures;
+	size_t budget;
+	unsigned long long frame = 0;
+	std::vector<TextureResidencyChange> changes;
+	TextureResidencyStats stats;
+};
+
+// --------------------------------------------------------
+// Runs the policy over a scripted fly-through: a row of
+// objects, each with its own texture, passed by a camera
+// that only sees a few at a time.  Reports how well the
+// budget held and how much detail was missing on screen.
+// --------------------------------------------------------
+struct TextureResidencySimulationSettings
+{
+	unsigned int Textures = 48;
+	unsigned int TextureSize = 1024;
+	unsigned int Format = DDS_FORMAT_BC7_UNORM;
+	unsigned int Frames = 1200;
+	size_t BudgetBytes = 32 * 1024 * 1024;
+	float ScreenHeight = 1080;
+};
+
+struct TextureResidencySimulationResults
+{
+	unsigned int Frames = 0;
+	size_t FullBytes = 0;
+	size_t BudgetBytes = 0;
+	size_t PeakBytes = 0;
+	unsigned int FramesOverBudget = 0;
+	unsigned long long MipsDropped = 0;
+	unsigned long long MipsStreamed = 0;
+	double MissingMipsPerFrame = 0; // Wanted on screen but not resident
+	double UpdateUs = 0;            // Average Update() time
+};
+
+TextureResidencySimulationResults SimulateTextureResidency(const TextureResidencySimulationSettings& settings);
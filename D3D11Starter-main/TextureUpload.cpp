@@ -0,0 +1,131 @@
+#include "TextureUpload.h"
+#include "Graphics.h"
+
+#include <vector>
+
+// Container subresources as D3D11 initial data
+static D3D11_SUBRESOURCE_DATA GetInitialData(const TextureSubresource& subresource)
+{
+	D3D11_SUBRESOURCE_DATA data = {};
+	data.pSysMem = subresource.Data;
+	data.SysMemPitch = subresource.RowPitch;
+	data.SysMemSlicePitch = subresource.SlicePitch;
+	return data;
+}
+
+// Arrays of one slice get a 2D view unless asked for an array one
+static bool CreateTextureAndView(const D3D11_TEXTURE2D_DESC& desc, const std::vector<D3D11_SUBRESOURCE_DATA>& initialData, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv, bool arrayView = false)
+{
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(Graphics::Device->CreateTexture2D(&desc, initialData.data(), texture.GetAddressOf())))
+		return false;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = desc.Format;
+	if (desc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE)
+	{
+		srvDesc.ViewDimension = desc.ArraySize > 6 ? D3D11_SRV_DIMENSION_TEXTURECUBEARRAY : D3D11_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCubeArray.MipLevels = desc.MipLevels; // Lines up with TextureCube.MipLevels
+		srvDesc.TextureCubeArray.NumCubes = desc.ArraySize / 6;
+	}
+	else if (desc.ArraySize > 1 || arrayView)
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MipLevels = desc.MipLevels;
+		srvDesc.Texture2DArray.ArraySize = desc.ArraySize;
+	}
+	else
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = desc.MipLevels;
+	}
+
+	return SUCCEEDED(Graphics::Device->CreateShaderResourceView(texture.Get(), &srvDesc, srv.ReleaseAndGetAddressOf()));
+}
+
+bool CreateTextureFromContainer(const TextureContainer& container, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv, unsigned int firstMip)
+{
+	const DdsTexture& description = container.GetDescription();
+	if (container.GetSubresources().empty() || firstMip >= description.MipCount)
+		return false;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = container.GetSubresource(firstMip, 0).Width;
+	desc.Height = container.GetSubresource(firstMip, 0).Height;
+	desc.MipLevels = description.MipCount - firstMip;
+	desc.ArraySize = description.ArraySize;
+	desc.Format = (DXGI_FORMAT)description.Format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.MiscFlags = description.IsCubemap ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData;
+	initialData.reserve((size_t)desc.ArraySize * desc.MipLevels);
+	for (unsigned int slice = 0; slice < desc.ArraySize; slice++)
+	{
+		for (unsigned int mip = firstMip; mip < description.MipCount; mip++)
+			initialData.push_back(GetInitialData(container.GetSubresource(mip, slice)));
+	}
+
+	return CreateTextureAndView(desc, initialData, srv);
+}
+
+bool CreateCubemapFromContainers(const TextureContainer* const faces[6], Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
+{
+	const DdsTexture& first = faces[0]->GetDescription();
+	unsigned int mipLevels = first.MipCount;
+	for (int i = 0; i < 6; i++)
+	{
+		const DdsTexture& face = faces[i]->GetDescription();
+		if (faces[i]->GetSubresources().empty() || face.Width != first.Width || face.Height != first.Height ||
+			face.Format != first.Format || face.ArraySize != 1)
+			return false;
+		mipLevels = face.MipCount < mipLevels ? face.MipCount : mipLevels;
+	}
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = first.Width;
+	desc.Height = first.Height;
+	desc.MipLevels = mipLevels;
+	desc.ArraySize = 6;
+	desc.Format = (DXGI_FORMAT)first.Format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+	// Face by face, each with its mips - subresource order
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData;
+	initialData.reserve(6 * mipLevels);
+	for (int i = 0; i < 6; i++)
+	{
+		for (unsigned int mip = 0; mip < mipLevels; mip++)
+			initialData.push_back(GetInitialData(faces[i]->GetSubresource(mip, 0)));
+	}
+
+	return CreateTextureAndView(desc, initialData, srv);
+}
+
+bool CreateTextureArray(const DdsTexture& description, const std::vector<TextureSubresource>& subresources, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
+{
+	if (description.ArraySize == 0 || subresources.size() != (size_t)description.ArraySize * description.MipCount)
+		return false;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = description.Width;
+	desc.Height = description.Height;
+	desc.MipLevels = description.MipCount;
+	desc.ArraySize = description.ArraySize;
+	desc.Format = (DXGI_FORMAT)description.Format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData;
+	initialData.reserve(subresources.size());
+	for (const TextureSubresource& subresource : subresources)
+		initialData.push_back(GetInitialData(subresource));
+
+	return CreateTextureAndView(desc, initialData, srv, true);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+
+#include "TextureContainer.h"
+
+// --------------------------------------------------------
+// Creates an immutable texture and view straight from a
+// container's mapped subresources.  The pointers go right
+// into D3D11_SUBRESOURCE_DATA, so nothing is copied or
+// decoded on the CPU side - the driver reads the file's
+// pages directly.  Arrays and cube maps get a matching view.
+//
+// Mips above firstMip are left out, so the texture starts
+// at that mip's size and only takes its share of memory.
+// --------------------------------------------------------
+bool CreateTextureFromContainer(const TextureContainer& container, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv, unsigned int firstMip = 0);
+
+// --------------------------------------------------------
+// Builds a cube map from six single-face containers (+X, -X,
+// +Y, -Y, +Z, -Z) in one CreateTexture2D, keeping the mips
+// every face has.  Fails unless all six share a size and
+// format.
+// --------------------------------------------------------
+bool CreateCubemapFromContainers(const TextureContainer* const faces[6], Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+
+// --------------------------------------------------------
+// Creates a Texture2DArray from subresources gathered from
+// any number of containers (MaterialAtlas does this), in
+// D3D11 order.  The view is always an array view, even for
+// a single slice, so it matches a Texture2DArray in HLSL.
+// --------------------------------------------------------
+bool CreateTextureArray(const DdsTexture& description, const std::vector<TextureSubresource>& subresources, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
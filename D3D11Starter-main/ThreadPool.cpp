@@ -0,0 +1,98 @@
+#include "ThreadPool.h"
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned int threadCount) :
+	stopping(false)
+{
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+// --------------------------------------------------------
+// Finishes everything already queued, then joins
+// --------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+			if (stopping && tasks.empty())
+				return;
+
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+
+		task();
+	}
+}
+
+// --------------------------------------------------------
+// Hands out indices one at a time, so uneven work still
+// balances across threads
+//
+// count - Number of iterations
+// body  - Called once per index, from any thread
+// --------------------------------------------------------
+void ThreadPool::ParallelFor(unsigned int count, const std::function<void(unsigned int)>& body)
+{
+	if (count == 0)
+		return;
+
+	std::atomic<unsigned int> next = 0;
+	auto run = [&]()
+	{
+		for (unsigned int i = next++; i < count; i = next++)
+			body(i);
+	};
+
+	// No point waking more workers than there are iterations
+	unsigned int helpers = count - 1 < GetThreadCount() ? count - 1 : GetThreadCount();
+	std::vector<std::future<void>> futures;
+	for (unsigned int h = 0; h < helpers; h++)
+		futures.push_back(Submit(run));
+
+	run();
+
+	// Rethrows the first exception from a worker, if any
+	for (std::future<void>& f : futures)
+		f.get();
+}
+
+// --------------------------------------------------------
+// Lets load-time code take an optional pool, so the same
+// path can be timed inline and in parallel
+// --------------------------------------------------------
+void ThreadPool::ForEach(ThreadPool* pool, unsigned int count, const std::function<void(unsigned int)>& body)
+{
+	if (pool)
+	{
+		pool->ParallelFor(count, body);
+		return;
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+		body(i);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// A fixed set of worker threads pulling tasks from one
+// shared queue.  Used for load-time work (shaders, texture
+// cooking) that can run side by side.
+//
+// Submit() returns a std::future, so results and any
+// exceptions come back to whoever calls get().
+// --------------------------------------------------------
+class ThreadPool
+{
+public:
+	// Zero picks one thread per hardware thread, minus the caller's
+	ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	template<typename Task>
+	auto Submit(Task&& task) -> std::future<decltype(task())>;
+
+	// Runs body(0) ... body(count - 1) across the pool and waits
+	// for all of them.  The calling thread helps out.  Don't call
+	// this from inside a pool task - it waits on queued work.
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& body);
+
+	// ParallelFor across the pool if there is one, otherwise a
+	// plain loop on the calling thread
+	static void ForEach(ThreadPool* pool, unsigned int count, const std::function<void(unsigned int)>& body);
+
+	unsigned int GetThreadCount() const { return (unsigned int)workers.size(); }
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	bool stopping;
+
+	void WorkerLoop();
+};
+
+// --------------------------------------------------------
+// Queues a task for the next free worker
+// --------------------------------------------------------
+template<typename Task>
+auto ThreadPool::Submit(Task&& task) -> std::future<decltype(task())>
+{
+	using Result = decltype(task());
+
+	// std::function needs something copyable, so share the packaged task
+	auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+	std::future<Result> future = packaged->get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		tasks.push([packaged]() { (*packaged)(); });
+	}
+	queueCondition.notify_one();
+
+	return future;
+}
@@ -1,16 +1,21 @@
 #include "ShaderIncludes.hlsli"
 
-cbuffer DataFromCpu : register(b0)
+// Set once per frame
+cbuffer PerFrame : register(b0)
 {
-	float4 colorTint;
-	float4x4 world;
     float4x4 viewMat;
     float4x4 projMat;
-	float4x4 worldInvTranspose;
     matrix lightView;
     matrix lightProj;
 }
 
+// Set for every draw
+cbuffer PerObject : register(b1)
+{
+	float4x4 world;
+	float4x4 worldInvTranspose;
+}
+
 // Struct representing a single vertex worth of data
 // - This should match the vertex definition in our C++ code
 // - By "match", I mean the size, order and number of members
@@ -70,6 +75,9 @@ VertexToPixel main( VertexShaderInput input )
     matrix shadowWVP = mul(lightProj, mul(lightView, world));
     output.shadowMapPos = mul(shadowWVP, float4(input.localPosition, 1.0f));
 	
+	// Only instanced draws come from the material atlas
+	output.materialIndex = 0;
+	
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
 	return output;
@@ -0,0 +1,430 @@
+#include "VirtualTexture.h"
+#include "CpuHelpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+
+unsigned int MakeVirtualPageId(unsigned int mip, unsigned int x, unsigned int y)
+{
+	return (mip & 0xF) << 28 | (y & 0x3FFF) << 14 | (x & 0x3FFF);
+}
+
+unsigned int GetVirtualPageMip(unsigned int page) { return page >> 28; }
+unsigned int GetVirtualPageX(unsigned int page) { return page & 0x3FFF; }
+unsigned int GetVirtualPageY(unsigned int page) { return (page >> 14) & 0x3FFF; }
+
+VirtualTexture::VirtualTexture(const VirtualTextureDesc& textureDesc) :
+	desc(textureDesc)
+{
+	if (desc.PageSize == 0)
+		desc.PageSize = 128;
+
+	// Mips until one page covers the whole texture, within what
+	// page ids can hold (mip 15 is the invalid id's)
+	size_t pageCount = 0;
+	for (unsigned int mip = 0; mip < 15; mip++)
+	{
+		unsigned int width = desc.Width >> mip ? desc.Width >> mip : 1;
+		unsigned int height = desc.Height >> mip ? desc.Height >> mip : 1;
+		Mip m;
+		m.PagesX = std::min((width + desc.PageSize - 1) / desc.PageSize, 16384u);
+		m.PagesY = std::min((height + desc.PageSize - 1) / desc.PageSize, 16384u);
+		m.FirstPage = pageCount;
+		mips.push_back(m);
+		pageCount += (size_t)m.PagesX * m.PagesY;
+		if (m.PagesX == 1 && m.PagesY == 1)
+			break;
+	}
+	mipCount = (unsigned int)mips.size();
+	pageSlots.resize(pageCount, -1);
+	pageSamples.resize(pageCount, 0);
+
+	unsigned int paddedSize = desc.PageSize + desc.PageBorder * 2;
+	pageBytes = GetDdsSurfaceBytes(desc.Format, paddedSize, paddedSize);
+
+	// The coarsest mip gets the first slots for good; the rest
+	// start empty, which puts them first in line to be used
+	const Mip& coarsest = mips.back();
+	unsigned int pinned = coarsest.PagesX * coarsest.PagesY;
+	slots.resize(std::max(desc.CacheSlots, pinned + 1));
+	for (unsigned int i = 0; i < slots.size(); i++)
+	{
+		if (i < pinned)
+		{
+			unsigned int page = MakeVirtualPageId(mipCount - 1, i % coarsest.PagesX, i / coarsest.PagesX);
+			slots[i].Page = page;
+			slots[i].Pinned = true;
+			pageSlots[coarsest.FirstPage + i] = (int)i;
+			pinnedLoads.push_back(VirtualPageLoad{ page, i, VirtualPageInvalid });
+			residentPages++;
+		}
+		else
+		{
+			Append((int)i);
+		}
+	}
+}
+
+const std::vector<VirtualPageLoad>& VirtualTexture::Update(const unsigned int* feedback, size_t count)
+{
+	frame++;
+	loads.swap(pinnedLoads);
+	pinnedLoads.clear();
+
+	stats.FeedbackSamples = 0;
+	stats.RequestedPages = 0;
+	stats.Hits = 0;
+	stats.Misses = 0;
+	stats.SampleHits = 0;
+	stats.Pending = 0;
+
+	// Count each page's samples, remembering which pages had any.
+	// Sorting just those keeps the order independent of the feedback's.
+	requestedPages.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!IsValidPage(feedback[i]))
+			continue;
+		if (GetPageSamples(feedback[i])++ == 0)
+			requestedPages.push_back(feedback[i]);
+	}
+	std::sort(requestedPages.begin(), requestedPages.end());
+
+	struct Candidate
+	{
+		unsigned int Page;
+		unsigned int Samples;
+		unsigned int Gap; // Mips between the page and what's shown in its place
+	};
+	std::vector<Candidate> candidates;
+	std::unordered_map<unsigned int, size_t> candidateIndex;
+
+	for (unsigned int page : requestedPages)
+	{
+		unsigned int samples = GetPageSamples(page);
+		GetPageSamples(page) = 0;
+
+		stats.RequestedPages++;
+		stats.FeedbackSamples += samples;
+
+		int slot = GetPageSlot(page);
+		if (slot >= 0)
+		{
+			stats.Hits++;
+			stats.SampleHits += samples;
+			Touch(slot);
+			continue;
+		}
+		stats.Misses++;
+
+		// Whatever stands in for it is in use too.  The coarsest
+		// mip is pinned, so the walk always ends.
+		unsigned int shown = GetParent(page);
+		while (GetPageSlot(shown) < 0)
+			shown = GetParent(shown);
+		Touch(GetPageSlot(shown));
+
+		// Everything missing on the way gets this page's samples
+		for (unsigned int missing = page; missing != shown; missing = GetParent(missing))
+		{
+			auto found = candidateIndex.find(missing);
+			if (found == candidateIndex.end())
+			{
+				candidateIndex[missing] = candidates.size();
+				candidates.push_back(Candidate{ missing, samples, GetVirtualPageMip(shown) - GetVirtualPageMip(missing) });
+			}
+			else
+			{
+				candidates[found->second].Samples += samples;
+			}
+		}
+	}
+
+	// Most blur over the most samples first; coarser, then lower
+	// ids break ties so the order doesn't depend on the hash map
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+	{
+		unsigned long long pa = (unsigned long long)a.Samples * a.Gap;
+		unsigned long long pb = (unsigned long long)b.Samples * b.Gap;
+		if (pa != pb)
+			return pa > pb;
+		if (GetVirtualPageMip(a.Page) != GetVirtualPageMip(b.Page))
+			return GetVirtualPageMip(a.Page) > GetVirtualPageMip(b.Page);
+		return a.Page < b.Page;
+	});
+
+	unsigned int uploads = 0;
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		// Out of uploads, or every slot is in use this frame
+		int slot = lruHead;
+		if (uploads >= desc.MaxUploadsPerFrame || slot < 0 || slots[slot].LastUsed == frame)
+		{
+			stats.Pending = (unsigned int)(candidates.size() - i);
+			break;
+		}
+
+		VirtualPageLoad load;
+		load.Page = candidates[i].Page;
+		load.Slot = (unsigned int)slot;
+		load.Evicted = slots[slot].Page;
+		if (load.Evicted != VirtualPageInvalid)
+		{
+			GetPageSlot(load.Evicted) = -1;
+			dirtyPages.push_back(load.Evicted);
+			stats.TotalEvictions++;
+			residentPages--;
+		}
+		dirtyPages.push_back(load.Page);
+
+		slots[slot].Page = load.Page;
+		GetPageSlot(load.Page) = slot;
+		Touch(slot);
+		residentPages++;
+		loads.push_back(load);
+		uploads++;
+	}
+
+	stats.Uploads = (unsigned int)loads.size();
+	stats.UploadBytes = loads.size() * pageBytes;
+	stats.TotalHits += stats.Hits;
+	stats.TotalMisses += stats.Misses;
+	stats.TotalSamples += stats.FeedbackSamples;
+	stats.TotalSampleHits += stats.SampleHits;
+	stats.TotalUploads += stats.Uploads;
+	stats.TotalUploadBytes += stats.UploadBytes;
+	return loads;
+}
+
+bool VirtualTexture::IsResident(unsigned int page) const
+{
+	if (!IsValidPage(page))
+		return false;
+	const Mip& m = mips[GetVirtualPageMip(page)];
+	return pageSlots[m.FirstPage + (size_t)GetVirtualPageY(page) * m.PagesX + GetVirtualPageX(page)] >= 0;
+}
+
+const std::vector<VirtualPageTableEntry>& VirtualTexture::GetPageTable(unsigned int mip)
+{
+	// A page's residency only changes the entries it covers in
+	// its own and finer mips.  A change to a coarse page covers
+	// a lot, so past a point it's cheaper to redo everything.
+	size_t touched = 0;
+	for (unsigned int page : dirtyPages)
+		touched += (size_t)1 << (GetVirtualPageMip(page) * 2);
+
+	if (pageTables.empty() || touched > pageSlots.size() / 4)
+	{
+		pageTables.resize(mipCount);
+		for (unsigned int m = mipCount; m-- > 0;)
+		{
+			pageTables[m].resize((size_t)mips[m].PagesX * mips[m].PagesY);
+			RefreshPageTable(m, 0, 0, mips[m].PagesX, mips[m].PagesY);
+		}
+	}
+	else
+	{
+		// Coarsest first, so finer entries copy up-to-date parents
+		std::sort(dirtyPages.begin(), dirtyPages.end(), [](unsigned int a, unsigned int b)
+		{
+			return GetVirtualPageMip(a) > GetVirtualPageMip(b);
+		});
+		for (unsigned int page : dirtyPages)
+		{
+			unsigned int m = GetVirtualPageMip(page);
+			for (unsigned int level = m + 1; level-- > 0;)
+			{
+				unsigned int shift = m - level;
+				RefreshPageTable(level,
+					GetVirtualPageX(page) << shift, GetVirtualPageY(page) << shift,
+					(GetVirtualPageX(page) + 1) << shift, (GetVirtualPageY(page) + 1) << shift);
+			}
+		}
+	}
+
+	dirtyPages.clear();
+	return pageTables[mip];
+}
+
+// --------------------------------------------------------
+// Redoes one mip's entries in [x0, x1) x [y0, y1): a resident
+// page points at itself, anything else copies its parent.
+// The mip above must already be current.
+// --------------------------------------------------------
+void VirtualTexture::RefreshPageTable(unsigned int mip, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1)
+{
+	const Mip& level = mips[mip];
+	std::vector<VirtualPageTableEntry>& table = pageTables[mip];
+	x1 = std::min(x1, level.PagesX);
+	y1 = std::min(y1, level.PagesY);
+	for (unsigned int y = y0; y < y1; y++)
+	{
+		for (unsigned int x = x0; x < x1; x++)
+		{
+			size_t index = (size_t)y * level.PagesX + x;
+			int slot = pageSlots[level.FirstPage + index];
+			if (slot >= 0)
+			{
+				table[index] = VirtualPageTableEntry{ (unsigned short)slot, (unsigned short)mip };
+				continue;
+			}
+
+			const Mip& parent = mips[mip + 1];
+			unsigned int px = std::min(x / 2, parent.PagesX - 1);
+			unsigned int py = std::min(y / 2, parent.PagesY - 1);
+			table[index] = pageTables[mip + 1][(size_t)py * parent.PagesX + px];
+		}
+	}
+}
+
+bool VirtualTexture::IsValidPage(unsigned int page) const
+{
+	unsigned int mip = GetVirtualPageMip(page);
+	return mip < mipCount && GetVirtualPageX(page) < mips[mip].PagesX && GetVirtualPageY(page) < mips[mip].PagesY;
+}
+
+int& VirtualTexture::GetPageSlot(unsigned int page)
+{
+	const Mip& m = mips[GetVirtualPageMip(page)];
+	return pageSlots[m.FirstPage + (size_t)GetVirtualPageY(page) * m.PagesX + GetVirtualPageX(page)];
+}
+
+unsigned int& VirtualTexture::GetPageSamples(unsigned int page)
+{
+	const Mip& m = mips[GetVirtualPageMip(page)];
+	return pageSamples[m.FirstPage + (size_t)GetVirtualPageY(page) * m.PagesX + GetVirtualPageX(page)];
+}
+
+unsigned int VirtualTexture::GetParent(unsigned int page) const
+{
+	unsigned int mip = GetVirtualPageMip(page) + 1;
+	unsigned int x = std::min(GetVirtualPageX(page) / 2, mips[mip].PagesX - 1);
+	unsigned int y = std::min(GetVirtualPageY(page) / 2, mips[mip].PagesY - 1);
+	return MakeVirtualPageId(mip, x, y);
+}
+
+// Marks a slot used this frame.  Pinned slots aren't in the list.
+void VirtualTexture::Touch(int slot)
+{
+	slots[slot].LastUsed = frame;
+	if (slots[slot].Pinned)
+		return;
+	Unlink(slot);
+	Append(slot);
+}
+
+void VirtualTexture::Unlink(int slot)
+{
+	Slot& s = slots[slot];
+	if (s.Prev >= 0)
+		slots[s.Prev].Next = s.Next;
+	else
+		lruHead = s.Next;
+	if (s.Next >= 0)
+		slots[s.Next].Prev = s.Prev;
+	else
+		lruTail = s.Prev;
+	s.Prev = s.Next = -1;
+}
+
+void VirtualTexture::Append(int slot)
+{
+	Slot& s = slots[slot];
+	s.Prev = lruTail;
+	s.Next = -1;
+	if (lruTail >= 0)
+		slots[lruTail].Next = slot;
+	else
+		lruHead = slot;
+	lruTail = slot;
+}
+
+VirtualTextureSimulationResults SimulateVirtualTexture(const VirtualTextureSimulationSettings& settings)
+{
+	VirtualTexture texture(settings.Texture);
+	const VirtualTextureDesc& desc = texture.GetDesc();
+
+	VirtualTextureSimulationResults results;
+	results.Frames = settings.Frames;
+	results.CacheSlots = desc.CacheSlots;
+	results.CacheBytes = desc.CacheSlots * texture.GetPageBytes();
+
+	// A 60 degree camera pitched 25 degrees down, so the view
+	// runs from right below it out to the horizon
+	const float tanHalfFov = std::tan(3.14159265f / 6.0f);
+	const float pitch = 25.0f * 3.14159265f / 180.0f;
+	const float aspect = (float)settings.FeedbackWidth / settings.FeedbackHeight;
+	const float pixelAngle = 2.0f * tanHalfFov / settings.ScreenHeight;
+	const float forwardY = std::cos(pitch), forwardZ = -std::sin(pitch);
+	const float upY = std::sin(pitch), upZ = std::cos(pitch);
+
+	std::vector<unsigned int> feedback((size_t)settings.FeedbackWidth * settings.FeedbackHeight);
+	double updateMs = 0;
+	double tableMs = 0;
+	unsigned long long pending = 0;
+	for (unsigned int frame = 0; frame < settings.Frames; frame++)
+	{
+		// Weave up the middle of the terrain
+		float cameraX = desc.Width * (0.5f + 0.25f * std::sin(frame * 0.01f));
+		float cameraY = std::fmod(frame * settings.CameraSpeed, (float)desc.Height);
+
+		for (unsigned int py = 0; py < settings.FeedbackHeight; py++)
+		{
+			for (unsigned int px = 0; px < settings.FeedbackWidth; px++)
+			{
+				float sx = ((px + 0.5f) / settings.FeedbackWidth * 2 - 1) * tanHalfFov * aspect;
+				float sy = (1 - (py + 0.5f) / settings.FeedbackHeight * 2) * tanHalfFov;
+				float dx = sx;
+				float dy = forwardY + sy * upY;
+				float dz = forwardZ + sy * upZ;
+				float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+				unsigned int& entry = feedback[(size_t)py * settings.FeedbackWidth + px];
+				entry = VirtualPageInvalid;
+				if (dz >= -0.001f)
+					continue; // Sky
+
+				float t = settings.CameraHeight / -dz;
+				float gx = cameraX + dx * t;
+				float gy = cameraY + dy * t;
+				if (gx < 0 || gy < 0 || gx >= desc.Width || gy >= desc.Height)
+					continue;
+
+				// Texels under one full-size screen pixel at that distance
+				float texels = t * length * pixelAngle;
+				unsigned int mip = texels > 1 ? (unsigned int)std::log2(texels) : 0;
+				mip = std::min(mip, texture.GetMipCount() - 1);
+				unsigned int x = ((unsigned int)gx >> mip) / desc.PageSize;
+				unsigned int y = ((unsigned int)gy >> mip) / desc.PageSize;
+				entry = MakeVirtualPageId(mip, x, y);
+			}
+		}
+
+		auto updateStart = std::chrono::high_resolution_clock::now();
+		texture.Update(feedback.data(), feedback.size());
+		updateMs += MsSince(updateStart);
+
+		auto tableStart = std::chrono::high_resolution_clock::now();
+		texture.GetPageTable(0);
+		tableMs += MsSince(tableStart);
+
+		const VirtualTextureStats& stats = texture.GetStats();
+		results.PeakUploadMB = std::max(results.PeakUploadMB, stats.UploadBytes / (1024.0 * 1024.0));
+		pending += stats.Pending;
+	}
+
+	const VirtualTextureStats& stats = texture.GetStats();
+	unsigned int frames = settings.Frames ? settings.Frames : 1;
+	unsigned long long requests = stats.TotalHits + stats.TotalMisses;
+	results.HitRate = requests ? (double)stats.TotalHits / requests : 0;
+	results.SampleHitRate = stats.TotalSamples ? (double)stats.TotalSampleHits / stats.TotalSamples : 0;
+	results.UploadsPerFrame = (double)stats.TotalUploads / frames;
+	results.UploadMBPerFrame = stats.TotalUploadBytes / (1024.0 * 1024.0) / frames;
+	results.Evictions = stats.TotalEvictions;
+	results.PendingPerFrame = (double)pending / frames;
+	results.UpdateUs = updateMs * 1000.0 / frames;
+	results.PageTableUs = tableMs * 1000.0 / frames;
+	return results;
+}
@@ -0,0 +1,204 @@
+#pragma once
+#include <vector>
+
+#include "DdsFile.h"
+
+// --------------------------------------------------------
+// Page ids, as a feedback pass writes them to an R32_UINT
+// target and as the page table is keyed: the page's mip and
+// its position in that mip's grid of pages.
+//
+//   mip 4 | y 14 | x 14
+// --------------------------------------------------------
+const unsigned int VirtualPageInvalid = 0xFFFFFFFF; // Feedback texels nothing drew to
+
+unsigned int MakeVirtualPageId(unsigned int mip, unsigned int x, unsigned int y);
+unsigned int GetVirtualPageMip(unsigned int page);
+unsigned int GetVirtualPageX(unsigned int page);
+unsigned int GetVirtualPageY(unsigned int page);
+
+struct VirtualTextureDesc
+{
+	unsigned int Width = 65536; // Texels at mip 0
+	unsigned int Height = 65536;
+	unsigned int PageSize = 128;  // Texels across a page, not counting its border
+	unsigned int PageBorder = 4;  // Texels borrowed from each neighbour, so filtering doesn't seam
+	unsigned int Format = DDS_FORMAT_BC7_UNORM;
+	unsigned int CacheSlots = 1024; // Pages the physical texture holds
+	unsigned int MaxUploadsPerFrame = 32;
+};
+
+// A page to copy into the physical texture this frame
+struct VirtualPageLoad
+{
+	unsigned int Page = VirtualPageInvalid;
+	unsigned int Slot = 0;
+	unsigned int Evicted = VirtualPageInvalid; // What was in the slot before
+};
+
+// --------------------------------------------------------
+// One page table texel: the physical slot to sample and the
+// mip of the page in it.  While a page is missing its entry
+// points at the nearest resident ancestor instead, so the
+// shader still finds something, just blurrier.
+// --------------------------------------------------------
+struct VirtualPageTableEntry
+{
+	unsigned short Slot = 0;
+	unsigned short Mip = 0;
+};
+
+struct VirtualTextureStats
+{
+	// The last Update()
+	unsigned int FeedbackSamples = 0; // Valid feedback entries
+	unsigned int RequestedPages = 0;  // Distinct pages among them
+	unsigned int Hits = 0;            // Requested pages already resident
+	unsigned int Misses = 0;
+	unsigned int SampleHits = 0;      // Samples whose page was resident
+	unsigned int Uploads = 0;
+	unsigned int Pending = 0;         // Wanted but left for later frames
+	size_t UploadBytes = 0;
+
+	// Since the start
+	unsigned long long TotalHits = 0;
+	unsigned long long TotalMisses = 0;
+	unsigned long long TotalSamples = 0;
+	unsigned long long TotalSampleHits = 0;
+	unsigned long long TotalUploads = 0;
+	unsigned long long TotalEvictions = 0;
+	unsigned long long TotalUploadBytes = 0;
+};
+
+// --------------------------------------------------------
+// The CPU side of a virtual texture too big to keep in
+// memory.  The texture is split into fixed-size pages, and a
+// physical cache of CacheSlots pages holds the ones recently
+// seen.  No Direct3D here: it reads feedback, decides what
+// to load and where, and keeps the page table; the caller
+// does the copies and uploads the table.
+//
+// Each frame, Update() takes the feedback pass's page ids,
+// counts the samples per page and marks what's resident as
+// used.  Missing pages - and any missing ancestors between
+// them and what's shown in their place - are loaded in order
+// of samples times mips of blur, so one coarse page covering
+// many missing ones usually comes first.  Loads go into
+// empty slots, then the least recently used ones; anything
+// used this frame is never evicted.  The coarsest mip is
+// pinned, so every page always has something to fall back to.
+// --------------------------------------------------------
+class VirtualTexture
+{
+public:
+	VirtualTexture(const VirtualTextureDesc& desc);
+
+	const VirtualTextureDesc& GetDesc() const { return desc; }
+
+	// Down to the mip that fits in one page
+	unsigned int GetMipCount() const { return mipCount; }
+	unsigned int GetPagesX(unsigned int mip) const { return mips[mip].PagesX; }
+	unsigned int GetPagesY(unsigned int mip) const { return mips[mip].PagesY; }
+
+	// One page with its border, as uploaded
+	size_t GetPageBytes() const { return pageBytes; }
+
+	// --------------------------------------------------------
+	// Reads a frame's feedback and picks what to load.  Copy
+	// each load into its slot before drawing with the new page
+	// table.  The first call also loads the pinned pages.
+	// --------------------------------------------------------
+	const std::vector<VirtualPageLoad>& Update(const unsigned int* feedback, size_t count);
+
+	bool IsResident(unsigned int page) const;
+	unsigned int GetResidentPages() const { return residentPages; }
+
+	// One mip of the page table, row by row.  Brought up to date
+	// on demand, redoing only what loads and evictions covered.
+	const std::vector<VirtualPageTableEntry>& GetPageTable(unsigned int mip);
+
+	const VirtualTextureStats& GetStats() const { return stats; }
+
+private:
+	struct Mip
+	{
+		unsigned int PagesX;
+		unsigned int PagesY;
+		size_t FirstPage; // Into pageSlots
+	};
+
+	// Slots are kept in a list from least to most recently used
+	struct Slot
+	{
+		unsigned int Page = VirtualPageInvalid;
+		unsigned long long LastUsed = 0;
+		int Prev = -1;
+		int Next = -1;
+		bool Pinned = false;
+	};
+
+	VirtualTextureDesc desc;
+	unsigned int mipCount = 0;
+	size_t pageBytes = 0;
+	std::vector<Mip> mips;
+	std::vector<int> pageSlots; // Every page of every mip, -1 if not resident
+	std::vector<unsigned int> pageSamples; // Feedback counts, only non-zero during Update()
+	std::vector<Slot> slots;
+	int lruHead = -1;
+	int lruTail = -1;
+	unsigned int residentPages = 0;
+	unsigned long long frame = 0;
+
+	std::vector<VirtualPageLoad> pinnedLoads; // Handed out by the first Update()
+	std::vector<VirtualPageLoad> loads;
+	std::vector<unsigned int> requestedPages;
+
+	std::vector<std::vector<VirtualPageTableEntry>> pageTables;
+	std::vector<unsigned int> dirtyPages; // Loaded or evicted since the table was last brought up to date
+
+	VirtualTextureStats stats;
+
+	bool IsValidPage(unsigned int page) const;
+	int& GetPageSlot(unsigned int page);
+	unsigned int& GetPageSamples(unsigned int page);
+	void RefreshPageTable(unsigned int mip, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1);
+	unsigned int GetParent(unsigned int page) const;
+	void Touch(int slot);
+	void Unlink(int slot);
+	void Append(int slot);
+};
+
+// --------------------------------------------------------
+// Runs a virtual texture over synthetic feedback: a camera
+// flying low over a huge terrain, looking ahead, with each
+// feedback texel asking for the page and mip its ground hit
+// needs.  Reports hit rates and upload bandwidth.
+// --------------------------------------------------------
+struct VirtualTextureSimulationSettings
+{
+	VirtualTextureDesc Texture;
+	unsigned int Frames = 600;
+	unsigned int FeedbackWidth = 160; // An eighth of the screen each way
+	unsigned int FeedbackHeight = 90;
+	unsigned int ScreenHeight = 720;
+	float CameraHeight = 1500; // In texels above the ground
+	float CameraSpeed = 80;    // Texels per frame
+};
+
+struct VirtualTextureSimulationResults
+{
+	unsigned int Frames = 0;
+	unsigned int CacheSlots = 0;
+	size_t CacheBytes = 0;
+	double HitRate = 0;       // Of distinct requested pages
+	double SampleHitRate = 0; // Of feedback samples
+	double UploadsPerFrame = 0;
+	double UploadMBPerFrame = 0;
+	double PeakUploadMB = 0; // Most in one frame, pinned pages included
+	unsigned long long Evictions = 0;
+	double PendingPerFrame = 0;
+	double UpdateUs = 0;    // Average Update() time
+	double PageTableUs = 0; // Average time bringing the page table up to date
+};
+
+VirtualTextureSimulationResults SimulateVirtualTexture(const VirtualTextureSimulationSettings& settings);